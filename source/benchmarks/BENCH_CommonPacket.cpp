@@ -0,0 +1,106 @@
+//
+// Common packet format parsing and reply assembly
+//
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include "cip/connection/CIP_CommonPacket.hpp"
+#include "opener_user_conf.hpp"
+
+// Interface handle and timeout are not part of the common packet format
+static const CipUsint unconnected_request[] = {
+    0x02, 0x00,                                     // item count
+    0x00, 0x00, 0x00, 0x00,                         // null address item
+    0xB2, 0x00, 0x08, 0x00,                         // unconnected data item
+    0x0E, 0x03, 0x20, 0x06, 0x24, 0x01, 0x30, 0x01  // Get_Attribute_Single 6/1/1
+};
+
+static const CipUsint forward_open_reply_items[] = {
+    0x02, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+    0xB2, 0x00, 0x04, 0x00,
+    0xDB, 0x00, 0x00, 0x00,
+    0x01, 0x80, 0x10, 0x00,                         // T->O sockaddr info item
+    0x00, 0x02, 0x08, 0xAE, 0xEF, 0xC0, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static void BM_CreateCommonPacketFormatStructure(benchmark::State & state)
+{
+    CipUsint message[sizeof(unconnected_request)];
+    CIP_CommonPacket::PacketFormat packet;
+    memcpy(message, unconnected_request, sizeof(message));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(CIP_CommonPacket::CreateCommonPacketFormatStructure(message, sizeof(message), &packet));
+    }
+}
+BENCHMARK(BM_CreateCommonPacketFormatStructure);
+
+static void BM_CreateCommonPacketFormatStructureSockaddr(benchmark::State & state)
+{
+    CipUsint message[sizeof(forward_open_reply_items)];
+    CIP_CommonPacket::PacketFormat packet;
+    memcpy(message, forward_open_reply_items, sizeof(message));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(CIP_CommonPacket::CreateCommonPacketFormatStructure(message, sizeof(message), &packet));
+    }
+}
+BENCHMARK(BM_CreateCommonPacketFormatStructureSockaddr);
+
+// Reply to an unconnected request with response data of the given size
+static void BM_AssembleLinearMessage(benchmark::State & state)
+{
+    static CipUsint reply[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    CipMessageRouterResponse_t response;
+    CIP_CommonPacket::PacketFormat packet;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.item_count = 2;
+    packet.address_item.type_id = CIP_CommonPacket::kCipItemIdNullAddress;
+    packet.data_item.type_id = CIP_CommonPacket::kCipItemIdUnconnectedDataItem;
+
+    response.reply_service = 0x8E;
+    response.reserved = 0;
+    response.general_status = kCipGeneralStatusCodeSuccess;
+    response.size_additional_status = 0;
+    response.additional_status = nullptr;
+    response.response_data.assign((size_t) state.range(0), 0x5A);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(CIP_CommonPacket::AssembleLinearMessage(&response, &packet, reply));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AssembleLinearMessage)->Arg(4)->Arg(64)->Arg(500)->Arg(1500)->Arg(4000);
+
+// Class 1 frame with a payload of the given size
+static void BM_AssembleIOMessage(benchmark::State & state)
+{
+    static CipUsint frame[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    static CipUsint payload[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    CIP_CommonPacket::PacketFormat packet;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.item_count = 2;
+    packet.address_item.type_id = CIP_CommonPacket::kCipItemIdSequencedAddressItem;
+    packet.address_item.length = 8;
+    packet.address_item.data.connection_identifier = 0x1001;
+    packet.data_item.type_id = CIP_CommonPacket::kCipItemIdConnectedDataItem;
+    packet.data_item.length = (CipUint) state.range(0);
+    packet.data_item.data = payload;
+
+    for (auto _ : state)
+    {
+        packet.address_item.data.sequence_number++;
+        benchmark::DoNotOptimize(CIP_CommonPacket::AssembleIOMessage(&packet, frame));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AssembleIOMessage)->Arg(8)->Arg(32)->Arg(500)->Arg(1500)->Arg(4000);
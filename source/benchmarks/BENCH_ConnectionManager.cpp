@@ -0,0 +1,214 @@
+//
+// Connection setup and I/O production of the connection manager
+//
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <cstring>
+#include "cip/CIP_Objects/CIP_0005_Connection/CIP_Connection.hpp"
+#include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/CIP_AppConnType.hpp"
+#include "opener_user_conf.hpp"
+
+#define IO_RPI_US 10000
+
+static void push_uint(std::vector<CipUsint> * data, CipUint value)
+{
+    data->push_back((CipUsint) (value & 0xFF));
+    data->push_back((CipUsint) (value >> 8));
+}
+
+static void push_udint(std::vector<CipUsint> * data, CipUdint value)
+{
+    push_uint(data, (CipUint) (value & 0xFFFF));
+    push_uint(data, (CipUint) (value >> 16));
+}
+
+// Class 3 connection to the message router, keyed to this device
+static void build_forward_open(CipMessageRouterRequest_t * req, CipUint serial)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceForwardOpen;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_udint(&req->request_data, 0);
+    push_udint(&req->request_data, 0x1000 + serial);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(2);
+    req->request_data.insert(req->request_data.end(), 3, 0);
+    push_udint(&req->request_data, 500000);          // O->T RPI
+    push_uint(&req->request_data, 0x4300 | 504);
+    push_udint(&req->request_data, 500000);          // T->O RPI
+    push_uint(&req->request_data, 0x4300 | 504);
+    req->request_data.push_back(0xA3);               // server, application triggered, class 3
+    req->request_data.push_back(7);
+
+    req->request_data.push_back(0x34);               // electronic key
+    req->request_data.push_back(4);
+    push_uint(&req->request_data, OPENER_DEVICE_VENDOR_ID);
+    push_uint(&req->request_data, OPENER_DEVICE_TYPE);
+    push_uint(&req->request_data, OPENER_DEVICE_PRODUCT_CODE);
+    req->request_data.push_back(OPENER_DEVICE_MAJOR_REVISION);
+    req->request_data.push_back(OPENER_DEVICE_MINOR_REVISION);
+    req->request_data.push_back(0x20);               // message router class
+    req->request_data.push_back(0x02);
+    req->request_data.push_back(0x24);               // instance 1
+    req->request_data.push_back(0x01);
+}
+
+// Input only connection with a multicast T->O connection, produced without a TCP peer
+static void build_large_forward_open_io(CipMessageRouterRequest_t * req, CipUint serial, CipUint t_to_o_size,
+                                        CipUsint input_assembly, CipUsint config_assembly)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceLargeForwardOpen;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_udint(&req->request_data, 0);
+    push_udint(&req->request_data, 0);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(2);
+    req->request_data.insert(req->request_data.end(), 3, 0);
+    push_udint(&req->request_data, IO_RPI_US);       // O->T RPI
+    push_udint(&req->request_data, 0);               // null O->T connection
+    push_udint(&req->request_data, IO_RPI_US);       // T->O RPI
+    push_udint(&req->request_data, ((CipUdint) CIP_ConnectionManager::kRoutingTypeMulticastConnection << 16) | t_to_o_size);
+    req->request_data.push_back(0x01);               // cyclic, class 1
+    req->request_data.push_back(3);
+    req->request_data.push_back(0x20);               // assembly class
+    req->request_data.push_back(0x04);
+    req->request_data.push_back(0x24);               // configuration instance
+    req->request_data.push_back(config_assembly);
+    req->request_data.push_back(0x2C);               // produced connection point
+    req->request_data.push_back(input_assembly);
+}
+
+static void build_forward_close(CipMessageRouterRequest_t * req, CipUint serial)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceForwardClose;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(0);
+    req->request_data.push_back(0);
+}
+
+// One scanner reconnecting, a Forward_Open and its Forward_Close per iteration,
+// with the heap allocations of the connection instances per cycle
+static void BM_ForwardOpenClose(benchmark::State & state)
+{
+    CIP_ConnectionManager * manager = (CIP_ConnectionManager *) CIP_ConnectionManager::GetInstance(0);
+    CipMessageRouterRequest_t open_request, close_request;
+    CipMessageRouterResponse_t resp;
+    build_forward_open(&open_request, 1);
+    build_forward_close(&close_request, 1);
+    CipUdint heap_allocations = CIP_Connection::GetHeapAllocations() + CIP_ConnectionManager::GetHeapAllocations();
+
+    for (auto _ : state)
+    {
+        if (kCipGeneralStatusCodeSuccess != manager->InstanceServices(open_request.service, &open_request, &resp).status)
+        {
+            state.SkipWithError("Forward_Open failed");
+            break;
+        }
+        manager->InstanceServices(close_request.service, &close_request, &resp);
+    }
+
+    heap_allocations = CIP_Connection::GetHeapAllocations() + CIP_ConnectionManager::GetHeapAllocations() - heap_allocations;
+    state.counters["heap_allocations"] = benchmark::Counter((double) heap_allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ForwardOpenClose);
+
+// Input assembly of the payload size, with an empty configuration assembly in front
+static CipUsint get_input_assembly(CipUint payload_size, CipUsint * config_assembly)
+{
+    static CipByte input_data[4000];
+    static CipUint sizes[4];
+    static CipUsint instances[4];
+    static CipUsint empty_assembly = 0;
+
+    if (0 == empty_assembly)
+    {
+        empty_assembly = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+        CIP_Assembly::Create(nullptr, 0);
+    }
+    *config_assembly = empty_assembly;
+    for (int i = 0; i < 4; i++)
+    {
+        if (0 == sizes[i])
+        {
+            sizes[i] = payload_size;
+            instances[i] = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+            CIP_Assembly::Create(input_data, payload_size);
+        }
+        if (payload_size == sizes[i])
+        {
+            CIP_AppConnType::ConfigureInputOnlyConnectionPoint(0, 0, instances[i], empty_assembly);
+            return instances[i];
+        }
+    }
+    return 0;
+}
+
+// One multicast frame of the given payload per iteration, produced and received on the loopback interface
+static void BM_ProduceAndReceive(benchmark::State & state)
+{
+    static CipUsint frame[OPENER_IO_FRAME_BUFFER_SIZE];
+    CipUint payload_size = (CipUint) state.range(0);
+    CIP_ConnectionManager * manager = (CIP_ConnectionManager *) CIP_ConnectionManager::GetInstance(0);
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+
+    CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address = htonl(INADDR_LOOPBACK);
+    CIP_TCPIP_Interface::g_time_to_live_value = 1;
+
+    struct sockaddr_in receiver_address;
+    memset(&receiver_address, 0, sizeof(receiver_address));
+    receiver_address.sin_family = AF_INET;
+    receiver_address.sin_port = htons(0x08AE);
+    receiver_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    NET_Connection receiver;
+    struct timeval receive_timeout = { 1, 0 };
+    receiver.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    receiver.SetSocketOpt(SOL_SOCKET, SO_REUSEADDR, 1);
+    setsockopt(receiver.GetSocketHandle(), SOL_SOCKET, SO_RCVTIMEO, (char *) &receive_timeout, sizeof(receive_timeout));
+    if (0 != receiver.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) &receiver_address))
+    {
+        state.SkipWithError("cannot bind the receiver");
+        return;
+    }
+
+    CipUsint config_assembly;
+    CipUsint input_assembly = get_input_assembly(payload_size, &config_assembly);
+    build_large_forward_open_io(&req, 1, (CipUint) (payload_size + 2), input_assembly, config_assembly);
+    if (kCipGeneralStatusCodeSuccess != manager->InstanceServices(req.service, &req, &resp).status)
+    {
+        state.SkipWithError("Forward_Open failed");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        CIP_AppConnType::ManageMulticastProducers(IO_RPI_US / 1000);
+        // item count, sequenced address item, data item header and sequence count precede the data
+        if (20 + (int) payload_size != recv(receiver.GetSocketHandle(), frame, sizeof(frame), 0))
+        {
+            state.SkipWithError("frame not received");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * payload_size);
+
+    build_forward_close(&req, 1);
+    manager->InstanceServices(req.service, &req, &resp);
+}
+BENCHMARK(BM_ProduceAndReceive)->Arg(500)->Arg(1500)->Arg(4000);
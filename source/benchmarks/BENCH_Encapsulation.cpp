@@ -0,0 +1,187 @@
+//
+// Explicit messages received on TCP, from the encapsulation header to the reply
+//
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include "cip/connection/network/ethIP/NET_EthIP_Encap.hpp"
+#include "cip/connection/CIP_RequestContext.hpp"
+#include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "opener_user_conf.hpp"
+
+// The session is bound to this handle only, nothing is sent on it
+#define BENCHMARK_SOCKET 1000
+
+static CipUsint buffer[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+
+// Requests are handled in the buffer of one context, as in the network handler
+static CIP_RequestContext * begin_request()
+{
+    static CIP_RequestContext context;
+    if (nullptr == context.buffer)
+        context.Init(buffer, sizeof(buffer));
+    context.Begin(BENCHMARK_SOCKET, nullptr);
+    return &context;
+}
+
+static CipUdint register_session()
+{
+    static CipUdint session_handle = 0;
+    if (0 == session_handle)
+    {
+        CipUsint *frame = begin_request()->buffer;
+        memset(frame, 0, ENCAPSULATION_HEADER_LENGTH + 4);
+        frame[0] = 0x65;
+        frame[2] = 0x04;
+        frame[ENCAPSULATION_HEADER_LENGTH] = 1;   // protocol version
+        int remaining_bytes;
+        NET_EthIP_Encap::HandleReceivedExplictTcpData(begin_request(), ENCAPSULATION_HEADER_LENGTH + 4, &remaining_bytes);
+        session_handle = (CipUdint) (frame[4] | (frame[5] << 8) | (frame[6] << 16) | (frame[7] << 24));
+    }
+    return session_handle;
+}
+
+// The handler replies in place, the request is copied back every iteration
+static int run_frame(benchmark::State & state, const CipUsint * frame, unsigned int frame_length)
+{
+    CIP_RequestContext *context = begin_request();
+    int remaining_bytes;
+    int reply_length = 0;
+
+    for (auto _ : state)
+    {
+        memcpy(buffer, frame, frame_length);
+        reply_length = NET_EthIP_Encap::HandleReceivedExplictTcpData(context, frame_length, &remaining_bytes);
+        benchmark::DoNotOptimize(reply_length);
+    }
+    return reply_length;
+}
+
+static void BM_HandleNop(benchmark::State & state)
+{
+    CipUsint frame[ENCAPSULATION_HEADER_LENGTH] = { 0x00 };
+    run_frame(state, frame, sizeof(frame));
+}
+BENCHMARK(BM_HandleNop);
+
+static void BM_HandleListIdentity(benchmark::State & state)
+{
+    CipUsint frame[ENCAPSULATION_HEADER_LENGTH] = { 0x63 };
+    if (0 >= run_frame(state, frame, sizeof(frame)))
+        state.SkipWithError("no ListIdentity reply");
+}
+BENCHMARK(BM_HandleListIdentity);
+
+// SendRRData with an unconnected Get_Attribute_Single of the connection manager
+static void BM_HandleSendRRDataGetAttribute(benchmark::State & state)
+{
+    CipUsint frame[ENCAPSULATION_HEADER_LENGTH + 24] = { 0x6F, 0x00, 24 };
+    const CipUsint command_data[] = {
+        0x00, 0x00, 0x00, 0x00,                         // interface handle
+        0x00, 0x00,                                     // timeout
+        0x02, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0xB2, 0x00, 0x08, 0x00,
+        0x0E, 0x03, 0x20, 0x06, 0x24, 0x01, 0x30, 0x01
+    };
+    CipUdint session_handle = register_session();
+    for (int i = 0; i < 4; i++)
+        frame[4 + i] = (CipUsint) (session_handle >> (8 * i));
+    memcpy(frame + ENCAPSULATION_HEADER_LENGTH, command_data, sizeof(command_data));
+
+    //general status of the reply after the command specific data and the item headers
+    int reply_length = run_frame(state, frame, sizeof(frame));
+    if ((ENCAPSULATION_HEADER_LENGTH + 18 >= reply_length)
+        || (kCipGeneralStatusCodeSuccess != buffer[ENCAPSULATION_HEADER_LENGTH + 18]))
+        state.SkipWithError("Get_Attribute_Single failed");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HandleSendRRDataGetAttribute);
+
+// Class 3 connection of the session to the message router, opened with a SendRRData Forward_Open
+static CIP_ConnectionManager * open_class3_connection(CipUdint session_handle)
+{
+    const CipUsint forward_open[] = {
+        0x54, 0x02, 0x20, 0x06, 0x24, 0x01,             // Forward_Open of the connection manager
+        0x0A, 0x0E,
+        0x00, 0x00, 0x00, 0x00,                         // O->T id, chosen by the target
+        0x01, 0x10, 0x00, 0x00,                         // T->O id
+        0x01, 0x00, 0x34, 0x12, 0xFE, 0xCA, 0x00, 0x00, // serial number, originator vendor and serial number
+        0x02, 0x00, 0x00, 0x00,
+        0x20, 0xA1, 0x07, 0x00, 0xF8, 0x43,             // O->T RPI and parameters
+        0x20, 0xA1, 0x07, 0x00, 0xF8, 0x43,             // T->O RPI and parameters
+        0xA3, 0x02,                                     // server, application triggered, class 3
+        0x20, 0x02, 0x24, 0x01                          // message router
+    };
+    const CipUsint command_data[] = {
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00,
+        0x02, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        0xB2, 0x00, sizeof(forward_open), 0x00
+    };
+    CipUsint *frame = begin_request()->buffer;
+    memset(frame, 0, ENCAPSULATION_HEADER_LENGTH);
+    frame[0] = 0x6F;
+    frame[2] = sizeof(command_data) + sizeof(forward_open);
+    for (int i = 0; i < 4; i++)
+        frame[4 + i] = (CipUsint) (session_handle >> (8 * i));
+    memcpy(frame + ENCAPSULATION_HEADER_LENGTH, command_data, sizeof(command_data));
+    memcpy(frame + ENCAPSULATION_HEADER_LENGTH + sizeof(command_data), forward_open, sizeof(forward_open));
+
+    int remaining_bytes;
+    NET_EthIP_Encap::HandleReceivedExplictTcpData(begin_request(), ENCAPSULATION_HEADER_LENGTH + frame[2], &remaining_bytes);
+    return CIP_ConnectionManager::FindConnection(1, 0x1234, 0xCAFE);
+}
+
+// SendUnitData with the Get_Attribute_Single of BM_HandleSendRRDataGetAttribute, sent over a class 3 connection
+static void BM_HandleSendUnitDataGetAttribute(benchmark::State & state)
+{
+    CipUsint frame[ENCAPSULATION_HEADER_LENGTH + 30] = { 0x70, 0x00, 30 };
+    CipUsint command_data[] = {
+        0x00, 0x00, 0x00, 0x00,                         // interface handle
+        0x00, 0x00,                                     // timeout
+        0x02, 0x00,
+        0xA1, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, // connected address item
+        0xB1, 0x00, 0x0A, 0x00, 0x00, 0x00,             // connected data item and sequence count
+        0x0E, 0x03, 0x20, 0x06, 0x24, 0x01, 0x30, 0x01
+    };
+    CipUdint session_handle = register_session();
+    CIP_ConnectionManager *connection = open_class3_connection(session_handle);
+    if (nullptr == connection)
+    {
+        state.SkipWithError("Forward_Open failed");
+        return;
+    }
+    CipUdint connection_id = connection->consuming_instance->CIP_consumed_connection_id;
+    for (int i = 0; i < 4; i++)
+    {
+        frame[4 + i] = (CipUsint) (session_handle >> (8 * i));
+        command_data[12 + i] = (CipUsint) (connection_id >> (8 * i));
+    }
+    memcpy(frame + ENCAPSULATION_HEADER_LENGTH, command_data, sizeof(command_data));
+
+    //every request moves the sequence count on, a repeated one is answered from the reply cache
+    CIP_RequestContext *context = begin_request();
+    CipUint sequence_count = 0;
+    int remaining_bytes;
+    int reply_length = 0;
+    for (auto _ : state)
+    {
+        sequence_count++;
+        frame[ENCAPSULATION_HEADER_LENGTH + 20] = (CipUsint) sequence_count;
+        frame[ENCAPSULATION_HEADER_LENGTH + 21] = (CipUsint) (sequence_count >> 8);
+        memcpy(buffer, frame, sizeof(frame));
+        reply_length = NET_EthIP_Encap::HandleReceivedExplictTcpData(context, sizeof(frame), &remaining_bytes);
+        benchmark::DoNotOptimize(reply_length);
+    }
+
+    //general status of the reply after the item headers and the sequence count
+    if ((ENCAPSULATION_HEADER_LENGTH + 24 >= reply_length)
+        || (kCipGeneralStatusCodeSuccess != buffer[ENCAPSULATION_HEADER_LENGTH + 24]))
+        state.SkipWithError("Get_Attribute_Single failed");
+    state.SetItemsProcessed(state.iterations());
+
+    CIP_ConnectionManager::CloseConnection(connection);
+}
+BENCHMARK(BM_HandleSendUnitDataGetAttribute);
@@ -0,0 +1,86 @@
+//
+// Byte order conversion of message fields
+//
+
+#include <benchmark/benchmark.h>
+#include "cip/connection/network/NET_Endianconv.hpp"
+
+#define FIELDS_PER_MESSAGE 64
+
+static CipUsint message[FIELDS_PER_MESSAGE * sizeof(CipUlint)];
+
+// Every iteration runs over a whole message, as a decoder or encoder would
+static void BM_GetIntFromMessage(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        CipUsint *buffer = message;
+        for (int i = 0; i < FIELDS_PER_MESSAGE; i++)
+            benchmark::DoNotOptimize(NET_Endianconv::GetIntFromMessage(buffer));
+    }
+    state.SetItemsProcessed(state.iterations() * FIELDS_PER_MESSAGE);
+}
+BENCHMARK(BM_GetIntFromMessage);
+
+static void BM_GetDintFromMessage(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        CipUsint *buffer = message;
+        for (int i = 0; i < FIELDS_PER_MESSAGE; i++)
+            benchmark::DoNotOptimize(NET_Endianconv::GetDintFromMessage(buffer));
+    }
+    state.SetItemsProcessed(state.iterations() * FIELDS_PER_MESSAGE);
+}
+BENCHMARK(BM_GetDintFromMessage);
+
+static void BM_GetLintFromMessage(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        CipUsint *buffer = message;
+        for (int i = 0; i < FIELDS_PER_MESSAGE; i++)
+            benchmark::DoNotOptimize(NET_Endianconv::GetLintFromMessage(buffer));
+    }
+    state.SetItemsProcessed(state.iterations() * FIELDS_PER_MESSAGE);
+}
+BENCHMARK(BM_GetLintFromMessage);
+
+static void BM_AddIntToMessage(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        CipUsint *buffer = message;
+        for (int i = 0; i < FIELDS_PER_MESSAGE; i++)
+            NET_Endianconv::AddIntToMessage((CipUint) i, buffer);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * FIELDS_PER_MESSAGE);
+}
+BENCHMARK(BM_AddIntToMessage);
+
+static void BM_AddDintToMessage(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        CipUsint *buffer = message;
+        for (int i = 0; i < FIELDS_PER_MESSAGE; i++)
+            NET_Endianconv::AddDintToMessage((CipUdint) i, buffer);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * FIELDS_PER_MESSAGE);
+}
+BENCHMARK(BM_AddDintToMessage);
+
+static void BM_AddLintToMessage(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        CipUsint *buffer = message;
+        for (int i = 0; i < FIELDS_PER_MESSAGE; i++)
+            NET_Endianconv::AddLintToMessage((CipUlint) i, buffer);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * FIELDS_PER_MESSAGE);
+}
+BENCHMARK(BM_AddLintToMessage);
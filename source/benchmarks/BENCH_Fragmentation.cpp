@@ -0,0 +1,270 @@
+//
+// Fragmented parameter transfers over a class 5 connection on the loopback interface
+//
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include "cip/connection/network/ethIP/NET_EthIP_Encap.hpp"
+#include "cip/connection/network/NET_Connection.hpp"
+#include "cip/connection/CIP_RequestContext.hpp"
+#include "cip/CIP_Objects/CIP_0005_Connection/CIP_Connection_Fragmentation.hpp"
+#include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "opener_user_conf.hpp"
+
+#define FRAGMENTED_TRANSFER_SIZE (1024 * 1024)
+#define FRAGMENTED_CONNECTION_SIZE 4000
+#define PARAMETER_DATA_POINT 0x80
+
+static CipByte device_parameters[FRAGMENTED_TRANSFER_SIZE];
+static CipByte parameters[FRAGMENTED_TRANSFER_SIZE];
+static CipUsint frame[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+static CipUsint reply[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+
+//reply frame: encapsulation header, connected reply header and the fragment header
+static const int reply_header_length = ENCAPSULATION_HEADER_LENGTH + 22 + 1;
+static const CipUint max_fragment_data = FRAGMENTED_CONNECTION_SIZE - 2 - 1;
+
+static void put_uint(CipUsint *& message, CipUint value)
+{
+    *message++ = (CipUsint) (value & 0xFF);
+    *message++ = (CipUsint) (value >> 8);
+}
+
+static void put_udint(CipUsint *& message, CipUdint value)
+{
+    put_uint(message, (CipUint) (value & 0xFFFF));
+    put_uint(message, (CipUint) (value >> 16));
+}
+
+static CipUsint * put_encapsulation_header(CipUsint * message, CipUint command, CipUdint session_handle, CipUint data_length)
+{
+    put_uint(message, command);
+    put_uint(message, data_length);
+    put_udint(message, session_handle);
+    put_udint(message, 0);                     // status
+    memset(message, 0, 12);                    // sender context and options
+    return message + 12;
+}
+
+static CipUint build_fragment_frame(CipUdint session_handle, CipUdint connection_id, CipUint sequence_count,
+                                    CipUsint fragment_header, const CipByte * data, CipUint data_length)
+{
+    bool first = (CIP_Connection_Fragmentation::kFragmentTypeFirst == (fragment_header >> 6));
+    CipUint fragment_length = (CipUint) (1 + (first ? 4 : 0) + data_length);
+    CipUsint *message = put_encapsulation_header(frame, 0x70, session_handle, (CipUint) (22 + fragment_length));
+    put_udint(message, 0);                     // interface handle
+    put_uint(message, 0);                      // timeout
+    put_uint(message, 2);
+    put_uint(message, CIP_CommonPacket::kCipItemIdConnectionAddress);
+    put_uint(message, 4);
+    put_udint(message, connection_id);
+    put_uint(message, CIP_CommonPacket::kCipItemIdConnectedDataItem);
+    put_uint(message, (CipUint) (2 + fragment_length));
+    put_uint(message, sequence_count);
+    *message++ = fragment_header;
+    if (first)
+        put_udint(message, FRAGMENTED_TRANSFER_SIZE);
+    memcpy(message, data, data_length);
+    return (CipUint) (ENCAPSULATION_HEADER_LENGTH + 22 + fragment_length);
+}
+
+// Class 5 connection to the parameter data point, both directions fragmented
+static void build_fragmented_forward_open(CipMessageRouterRequest_t * req)
+{
+    const CipUsint request_data[] = {
+        0x0A, 0x0E,
+        0x00, 0x00, 0x00, 0x00,                         // O->T id, chosen by the target
+        0x32, 0x10, 0x00, 0x00,                         // T->O id
+        0x32, 0x00, 0x34, 0x12, 0xFE, 0xCA, 0x00, 0x00, // serial number, originator vendor and serial number
+        0x02, 0x00, 0x00, 0x00,
+        0x20, 0xA1, 0x07, 0x00,                         // O->T RPI
+        FRAGMENTED_CONNECTION_SIZE & 0xFF, FRAGMENTED_CONNECTION_SIZE >> 8, 0x00, 0x43,
+        0x20, 0xA1, 0x07, 0x00,                         // T->O RPI
+        FRAGMENTED_CONNECTION_SIZE & 0xFF, FRAGMENTED_CONNECTION_SIZE >> 8, 0x00, 0x43,
+        0xA5, 0x04,                                     // server, application triggered, class 5
+        0x20, 0x04, 0x24, 0x01,                         // configuration instance
+        0x2C, PARAMETER_DATA_POINT,                     // consumed connection point
+        0x2C, PARAMETER_DATA_POINT                      // produced connection point
+    };
+    req->service = CIP_ConnectionManager::kConnMgrServiceLargeForwardOpen;
+    req->request_data.assign(request_data, request_data + sizeof(request_data));
+}
+
+static bool receive_frame(int socket, CipUsint * message, CipUint * frame_length)
+{
+    if (ENCAPSULATION_HEADER_LENGTH != recv(socket, (char *) message, ENCAPSULATION_HEADER_LENGTH, MSG_WAITALL))
+        return false;
+    CipUint data_length = (CipUint) (message[2] | (message[3] << 8));
+    if ((0 != data_length) && (data_length != recv(socket, (char *) message + ENCAPSULATION_HEADER_LENGTH, data_length, MSG_WAITALL)))
+        return false;
+    *frame_length = (CipUint) (ENCAPSULATION_HEADER_LENGTH + data_length);
+    return true;
+}
+
+// A session and a class 5 connection of an originator connected over TCP on the loopback interface
+class FragmentedTransfer
+{
+public:
+    NET_Connection listener, originator, target;
+    CIP_RequestContext context;
+    CipUsint context_buffer[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    CipUdint session_handle = 0;
+    CipUdint connection_id = 0;
+    CipUint sequence_count = 1;
+
+    bool Open()
+    {
+        struct sockaddr_in listener_address;
+        memset(&listener_address, 0, sizeof(listener_address));
+        listener_address.sin_family = AF_INET;
+        listener_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t address_length = sizeof(listener_address);
+
+        listener.InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        originator.InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if ((0 != listener.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) &listener_address))
+            || (0 != listener.Listen(1))
+            || (0 != getsockname(listener.GetSocketHandle(), (struct sockaddr *) &listener_address, &address_length))
+            || (0 != connect(originator.GetSocketHandle(), (struct sockaddr *) &listener_address, address_length)))
+            return false;
+        target.SetSocketHandle(accept(listener.GetSocketHandle(), nullptr, nullptr));
+        context.Init(context_buffer, sizeof(context_buffer));
+
+        CipUsint *message = put_encapsulation_header(frame, 0x65, 0, 4);
+        put_uint(message, 1);
+        put_uint(message, 0);
+        if (ENCAPSULATION_HEADER_LENGTH + 4 != Exchange(ENCAPSULATION_HEADER_LENGTH + 4))
+            return false;
+        session_handle = (CipUdint) (reply[4] | (reply[5] << 8) | (reply[6] << 16) | (reply[7] << 24));
+
+        //Forward_Opens are handled as received from the originator
+        CIP_ConnectionManager *manager = (CIP_ConnectionManager *) CIP_ConnectionManager::GetInstance(0);
+        CipMessageRouterRequest_t req;
+        CipMessageRouterResponse_t resp;
+        build_fragmented_forward_open(&req);
+        context.Begin(target.GetSocketHandle(), nullptr);
+        req.context = &context;
+        if (kCipGeneralStatusCodeSuccess != manager->InstanceServices(req.service, &req, &resp).status)
+            return false;
+        connection_id = CIP_ConnectionManager::FindConnection(0x32, 0x1234, 0xCAFE)->consuming_instance->CIP_consumed_connection_id;
+        return true;
+    }
+
+    void Close()
+    {
+        CIP_ConnectionManager *connection = CIP_ConnectionManager::FindConnection(0x32, 0x1234, 0xCAFE);
+        if (nullptr != connection)
+            CIP_ConnectionManager::CloseConnection(connection);
+        NET_EthIP_Encap::CloseSession(target.GetSocketHandle());
+    }
+
+    // Send the frame from the originator, handle it on the target and return the reply length
+    int Exchange(CipUint frame_length)
+    {
+        CipUint length;
+        int remaining_bytes;
+
+        context.Begin(target.GetSocketHandle(), nullptr);
+        if ((frame_length != originator.SendData(frame, frame_length))
+            || !receive_frame(target.GetSocketHandle(), context.buffer, &length))
+            return -1;
+        int reply_length = NET_EthIP_Encap::HandleReceivedExplictTcpData(&context, length, &remaining_bytes);
+        if ((0 >= reply_length) || (reply_length != target.SendData(context.buffer, (CipUdint) reply_length))
+            || !receive_frame(originator.GetSocketHandle(), reply, &length))
+            return -1;
+        return length;
+    }
+};
+
+// Download of the whole parameter set, each fragment is acknowledged
+static void BM_FragmentedWrite(benchmark::State & state)
+{
+    CIP_Connection_Fragmentation::ConfigureDataPoint(PARAMETER_DATA_POINT, device_parameters, sizeof(device_parameters));
+    FragmentedTransfer transfer;
+    if (!transfer.Open())
+    {
+        state.SkipWithError("cannot open the class 5 connection");
+        transfer.Close();
+        CIP_Connection_Fragmentation::ClearDataPoints();
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        CipUdint offset = 0;
+        CipUsint count = 0;
+        while (offset < FRAGMENTED_TRANSFER_SIZE)
+        {
+            CipUint length = (CipUint) ((0 == offset) ? max_fragment_data - 4 : max_fragment_data);
+            if (FRAGMENTED_TRANSFER_SIZE - offset < length)
+                length = (CipUint) (FRAGMENTED_TRANSFER_SIZE - offset);
+            CipUsint type = (0 == offset) ? CIP_Connection_Fragmentation::kFragmentTypeFirst
+                : ((offset + length == FRAGMENTED_TRANSFER_SIZE) ? CIP_Connection_Fragmentation::kFragmentTypeLast
+                                                                   : CIP_Connection_Fragmentation::kFragmentTypeMiddle);
+            CipUint frame_length = build_fragment_frame(transfer.session_handle, transfer.connection_id,
+                                                        transfer.sequence_count++, (CipUsint) ((type << 6) | count),
+                                                        parameters + offset, length);
+            if ((reply_header_length + 1 != transfer.Exchange(frame_length))
+                || (kCipGeneralStatusCodeSuccess != reply[reply_header_length]))
+            {
+                state.SkipWithError("fragment not acknowledged");
+                break;
+            }
+            offset += length;
+            count = (CipUsint) ((count + 1) & CIP_Connection_Fragmentation::kFragmentCountMask);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * FRAGMENTED_TRANSFER_SIZE);
+
+    transfer.Close();
+    CIP_Connection_Fragmentation::ClearDataPoints();
+}
+BENCHMARK(BM_FragmentedWrite)->Unit(benchmark::kMillisecond);
+
+// Upload of the whole parameter set, each acknowledge asks for the next fragment
+static void BM_FragmentedRead(benchmark::State & state)
+{
+    CIP_Connection_Fragmentation::ConfigureDataPoint(PARAMETER_DATA_POINT, device_parameters, sizeof(device_parameters));
+    FragmentedTransfer transfer;
+    if (!transfer.Open())
+    {
+        state.SkipWithError("cannot open the class 5 connection");
+        transfer.Close();
+        CIP_Connection_Fragmentation::ClearDataPoints();
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        CipUdint offset = 0;
+        CipUsint count = 0;
+        bool done = false;
+        while (!done)
+        {
+            CipUint frame_length = build_fragment_frame(transfer.session_handle, transfer.connection_id, transfer.sequence_count++,
+                                                        (CipUsint) ((CIP_Connection_Fragmentation::kFragmentTypeAcknowledge << 6) | count),
+                                                        nullptr, 0);
+            int reply_length = transfer.Exchange(frame_length);
+            CipUsint type = (CipUsint) (reply[reply_header_length - 1] >> 6);
+            int data_start = reply_header_length + ((CIP_Connection_Fragmentation::kFragmentTypeFirst == type) ? 4 : 0);
+            if ((reply_length < data_start) || (CIP_Connection_Fragmentation::kFragmentTypeAcknowledge == type))
+            {
+                state.SkipWithError("no fragment received");
+                break;
+            }
+            offset += reply_length - data_start;
+            done = (CIP_Connection_Fragmentation::kFragmentTypeLast == type);
+            count = (CipUsint) ((count + 1) & CIP_Connection_Fragmentation::kFragmentCountMask);
+        }
+        if (FRAGMENTED_TRANSFER_SIZE != offset)
+        {
+            state.SkipWithError("parameter set incomplete");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * FRAGMENTED_TRANSFER_SIZE);
+
+    transfer.Close();
+    CIP_Connection_Fragmentation::ClearDataPoints();
+}
+BENCHMARK(BM_FragmentedRead)->Unit(benchmark::kMillisecond);
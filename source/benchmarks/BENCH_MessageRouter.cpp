@@ -0,0 +1,77 @@
+//
+// Request path decoding, attribute encoding and message routing
+//
+
+#include <benchmark/benchmark.h>
+#include "cip/CIP_Common.hpp"
+#include "cip/CIP_Objects/template/CIP_Object_base.h"
+#include "cip/CIP_Objects/CIP_0002_MessageRouter/CIP_MessageRouter.hpp"
+
+static void BM_DecodePaddedEPath(benchmark::State & state)
+{
+    // path size in words, class, instance and attribute
+    CipUsint path[] = { 0x03, 0x20, 0x06, 0x24, 0x01, 0x30, 0x01 };
+    CipEpath epath;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(CIP_Common::DecodePaddedEPath(&epath, path));
+    }
+}
+BENCHMARK(BM_DecodePaddedEPath);
+
+static void BM_EncodeDataUdint(benchmark::State & state)
+{
+    CipUdint value = 0x12345678;
+    std::vector<CipUsint> message;
+    message.reserve(64);
+
+    for (auto _ : state)
+    {
+        message.clear();
+        benchmark::DoNotOptimize(CIP_Object_base::EncodeData(kCipUdint, &value, &message));
+    }
+}
+BENCHMARK(BM_EncodeDataUdint);
+
+static void BM_EncodeDataShortString(benchmark::State & state)
+{
+    static CipByte name[] = "OpENer PC";
+    CipShortString value = { sizeof(name) - 1, name };
+    std::vector<CipUsint> message;
+    message.reserve(64);
+
+    for (auto _ : state)
+    {
+        message.clear();
+        benchmark::DoNotOptimize(CIP_Object_base::EncodeData(kCipShortString, &value, &message));
+    }
+}
+BENCHMARK(BM_EncodeDataShortString);
+
+// Get_Attribute_Single of the open requests counter of the connection manager
+static void BM_RouteMessage(benchmark::State & state)
+{
+    CipUsint request_message[] = { 0x0E, 0x03, 0x20, 0x06, 0x24, 0x01, 0x30, 0x01 };
+    CipMessageRouterRequest_t request;
+    CipMessageRouterResponse_t response;
+
+    if (kCipGeneralStatusCodeSuccess != CIP_MessageRouter::CreateMessageRouterRequestStructure(
+        request_message, sizeof(request_message), &request).status)
+    {
+        state.SkipWithError("request could not be decoded");
+        return;
+    }
+    response.response_data.reserve(64);
+
+    CipStatus status;
+    for (auto _ : state)
+    {
+        response.response_data.clear();
+        status = CIP_MessageRouter::route_message(&request, &response);
+        benchmark::DoNotOptimize(status);
+    }
+    if (kCipStatusError == status.status)
+        state.SkipWithError("the request was not routed");
+}
+BENCHMARK(BM_RouteMessage);
@@ -0,0 +1,120 @@
+//
+// Network backends of the handler: an I/O frame received on loopback, and produced frames sent in batches
+//
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "cip/connection/network/NET_Connection.hpp"
+#include "cip/connection/network/NET_IoBackend.hpp"
+#include "opener_user_conf.hpp"
+
+#define FRAME_LENGTH 64
+
+static int open_socket(struct sockaddr_in * address)
+{
+    int socket_handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    socklen_t address_length = sizeof(*address);
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = inet_addr("127.0.0.1");
+    bind(socket_handle, (struct sockaddr *) address, sizeof(*address));
+    getsockname(socket_handle, (struct sockaddr *) address, &address_length);
+    return socket_handle;
+}
+
+static bool init_backend(benchmark::State & state)
+{
+    NET_IoBackend::Backend_e backend = (NET_IoBackend::Backend_e) state.range(0);
+    if (!NET_IoBackend::SetBackend(backend) || (kCipStatusOk != NET_IoBackend::Init().status)
+        || (backend != NET_IoBackend::GetBackend()))
+    {
+        state.SkipWithError("backend not available");
+        return false;
+    }
+    state.SetLabel(NET_IoBackend::GetName(backend));
+    return true;
+}
+
+// One frame from the originator to a consuming socket, until it has been taken out of the socket
+static void BM_BackendReceive(benchmark::State & state)
+{
+    if (!init_backend(state))
+        return;
+
+    struct sockaddr_in consumer_address, originator_address, from_address;
+    int consumer = open_socket(&consumer_address);
+    int originator = open_socket(&originator_address);
+    NET_IoBackend::Watch(consumer, NET_IoBackend::kWatchDatagrams);
+
+    CipUsint frame[FRAME_LENGTH] = { 0x02 };
+    CipUsint buffer[OPENER_IO_FRAME_BUFFER_SIZE];
+    for (auto _ : state)
+    {
+        sendto(originator, frame, sizeof(frame), 0, (struct sockaddr *) &consumer_address, sizeof(consumer_address));
+
+        int received_size = -1;
+        while (0 > received_size)
+        {
+            struct timeval timeout = { 0, 100000 };
+            if ((0 >= NET_IoBackend::Wait(consumer + 1, &timeout))
+                || !NET_Connection::SelectIsSet(consumer, NET_Connection::kReadSet))
+                continue;
+
+            CipUlint receive_time;
+            socklen_t from_address_length = sizeof(from_address);
+            received_size = NET_IoBackend::IsReceiving()
+                            ? NET_IoBackend::ReceiveQueued(consumer, buffer, sizeof(buffer), &from_address, &receive_time)
+                            : (int) recvfrom(consumer, buffer, sizeof(buffer), 0, (struct sockaddr *) &from_address,
+                                             &from_address_length);
+        }
+        benchmark::DoNotOptimize(received_size);
+    }
+
+    NET_IoBackend::Unwatch(consumer);
+    close(consumer);
+    close(originator);
+    NET_IoBackend::Finish();
+}
+BENCHMARK(BM_BackendReceive)->DenseRange(NET_IoBackend::kBackendSelect, NET_IoBackend::kBackendIoUring);
+
+// A batch of produced frames per loop, io_uring submits them as one chain with the next wait
+static void BM_BackendProduce(benchmark::State & state)
+{
+    if (!init_backend(state))
+        return;
+
+    struct sockaddr_in producer_address, consumer_address;
+    int producer = open_socket(&producer_address);
+    int consumer = open_socket(&consumer_address);
+    NET_IoBackend::Watch(producer, NET_IoBackend::kWatchReadable);
+
+    CipUsint frame[FRAME_LENGTH] = { 0x02 };
+    CipUsint buffer[FRAME_LENGTH];
+    int batch = (int) state.range(1);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < batch; i++)
+        {
+            NET_IoBackend::SendTo(producer, frame, sizeof(frame), (struct sockaddr *) &consumer_address, 0);
+        }
+        struct timeval timeout = { 0, 0 };
+        NET_IoBackend::Wait(producer + 1, &timeout);
+
+        //the consumer is drained outside of the measurement
+        state.PauseTiming();
+        while (0 < recv(consumer, buffer, sizeof(buffer), MSG_DONTWAIT))
+        {
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+
+    NET_IoBackend::Unwatch(producer);
+    close(producer);
+    close(consumer);
+    NET_IoBackend::Finish();
+}
+BENCHMARK(BM_BackendProduce)->ArgsProduct({ { NET_IoBackend::kBackendSelect, NET_IoBackend::kBackendEpoll,
+                                              NET_IoBackend::kBackendIoUring }, { 1, 8 } });
@@ -0,0 +1,75 @@
+//
+// Instance lookups of the CIP object template
+//
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "cip/CIP_Objects/template/CIP_Object_template.hpp"
+
+#define NUMBER_OF_LOOKUP_INSTANCES 1000
+#define NUMBER_OF_LOOKUPS 10000
+
+// Class with the instance table of a large device, it is only looked up
+class BENCH_LookupObject : public CIP_Object_template<BENCH_LookupObject>
+{
+public:
+    static void Init()
+    {
+        class_id = 0x64;
+        class_name = "Lookup";
+        revision = 1;
+        max_instances = NUMBER_OF_LOOKUP_INSTANCES;
+
+        for (CipUint i = 0; i < NUMBER_OF_LOOKUP_INSTANCES; i++)
+        {
+            BENCH_LookupObject * instance = new BENCH_LookupObject();
+            AddClassInstance(instance, instance->id);
+        }
+    }
+
+    void * retrieveAttribute(CipUsint attributeNumber)
+    {
+        return nullptr;
+    }
+
+    CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
+    {
+        CipStatus stat;
+        stat.status = kCipGeneralStatusCodeServiceNotSupported;
+        stat.extended_status = 0;
+        return stat;
+    }
+};
+
+// Random lookups from a misbehaving client, half of them for instances that do not exist
+static void BM_InstanceLookup(benchmark::State & state)
+{
+    if (0 == BENCH_LookupObject::GetNumberOfInstances())
+        BENCH_LookupObject::Init();
+
+    std::mt19937 generator(4);
+    std::uniform_int_distribution<CipUdint> valid(0, NUMBER_OF_LOOKUP_INSTANCES - 1);
+    std::uniform_int_distribution<CipUdint> invalid(NUMBER_OF_LOOKUP_INSTANCES, 0xFFFFFFFF);
+    std::vector<CipUdint> instance_numbers;
+    for (CipUdint i = 0; i < NUMBER_OF_LOOKUPS; i++)
+        instance_numbers.push_back((i & 1) ? invalid(generator) : valid(generator));
+
+    CipUdint mapped = 0;
+    for (auto _ : state)
+    {
+        mapped = 0;
+        for (CipUdint instance_number : instance_numbers)
+        {
+            const BENCH_LookupObject * instance = BENCH_LookupObject::GetInstance(instance_number);
+            if ((nullptr != instance) && (BENCH_LookupObject::GetInstanceNumber(instance) == (CipDint) instance_number))
+                mapped++;
+        }
+        benchmark::DoNotOptimize(mapped);
+    }
+
+    if (NUMBER_OF_LOOKUPS / 2 != mapped)
+        state.SkipWithError("valid instances not found");
+    state.SetItemsProcessed(state.iterations() * NUMBER_OF_LOOKUPS);
+}
+BENCHMARK(BM_InstanceLookup);
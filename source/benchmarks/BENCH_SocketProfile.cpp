@@ -0,0 +1,73 @@
+//
+// Socket profiles: request/response latency of a TCP session with and without its tuning
+//
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "cip/connection/network/NET_Connection.hpp"
+#include "opener_user_conf.hpp"
+
+#define REQUEST_LENGTH 48
+#define REPLY_HEADER_LENGTH 24
+#define REPLY_DATA_LENGTH 40
+
+// A loopback connection, the session end is tuned with the session profile if asked to
+static bool connect_session(int * client, int * session, bool tuned)
+{
+    struct sockaddr_in address;
+    socklen_t address_length = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    int listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    *client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if ((0 != bind(listener, (struct sockaddr *) &address, sizeof(address))) || (0 != listen(listener, 1))
+        || (0 != getsockname(listener, (struct sockaddr *) &address, &address_length))
+        || (0 != connect(*client, (struct sockaddr *) &address, address_length)))
+    {
+        close(listener);
+        close(*client);
+        return false;
+    }
+    *session = accept(listener, nullptr, nullptr);
+    close(listener);
+    if (tuned)
+        NET_Connection::ApplyProfile(*session, NET_Connection::kSocketTcpSession);
+    return 0 <= *session;
+}
+
+// The reply leaves in two writes, as a reply flushed from the send queue in parts does.
+// Untuned, Nagle holds the second write back until the client's delayed ACK.
+static void BM_SessionRoundTrip(benchmark::State & state)
+{
+    bool tuned = 0 != state.range(0);
+    int client, session;
+    if (!connect_session(&client, &session, tuned))
+    {
+        state.SkipWithError("no loopback connection");
+        return;
+    }
+    state.SetLabel(tuned ? "session profile" : "socket defaults");
+
+    CipUsint request[REQUEST_LENGTH] = { 0x6F };
+    CipUsint reply[REPLY_HEADER_LENGTH + REPLY_DATA_LENGTH] = { 0x6F };
+    CipUsint buffer[sizeof(reply)];
+    for (auto _ : state)
+    {
+        send(client, request, sizeof(request), 0);
+        recv(session, buffer, sizeof(request), MSG_WAITALL);
+        if (tuned)
+            NET_Connection::QuickAck(session);
+        send(session, reply, REPLY_HEADER_LENGTH, 0);
+        send(session, reply + REPLY_HEADER_LENGTH, REPLY_DATA_LENGTH, 0);
+        benchmark::DoNotOptimize(recv(client, buffer, sizeof(reply), MSG_WAITALL));
+    }
+
+    close(client);
+    close(session);
+}
+// a stalled round trip takes tens of ms, fifty show the difference
+BENCHMARK(BM_SessionRoundTrip)->Arg(0)->Arg(1)->Iterations(50)->UseRealTime()->Unit(benchmark::kMicrosecond);
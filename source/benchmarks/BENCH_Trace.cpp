@@ -0,0 +1,32 @@
+//
+// Cost of a trace point recorded into the trace ring of the thread
+//
+
+#include <benchmark/benchmark.h>
+#include "utils/tracebuffer.hpp"
+#include "trace.hpp"
+
+// A typical trace point: a couple of integers and a short string
+static void BM_TraceWrite(benchmark::State & state)
+{
+    static const CipUint format_id = TraceBuffer::RegisterFormat(OPENER_TRACE_LEVEL_INFO, __FILE__, __LINE__,
+                                                                 "connection 0x%x of %s: %d frames\n");
+    CipUdint frames = 0;
+    for (auto _ : state)
+    {
+        TraceBuffer::Write(format_id, 0x1234u, "scanner", frames++);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceWrite);
+
+// A trace point of a level masked at runtime
+static void BM_TraceMasked(benchmark::State & state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(TraceBuffer::IsLevelEnabled(OPENER_TRACE_LEVEL_INFO));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceMasked);
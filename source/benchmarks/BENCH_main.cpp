@@ -0,0 +1,23 @@
+//
+// Micro-benchmarks of the encoding, parsing and dispatch hot paths
+//
+// The stack is initialized once, then every registered benchmark runs.
+// Results are written as JSON with --benchmark_out=<file> --benchmark_out_format=json,
+// the run_benchmarks target does so for the current commit.
+//
+
+#include <benchmark/benchmark.h>
+#include "cip/CIP_Common.hpp"
+
+int main(int argc, char ** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    CIP_Common::CipStackInit(1);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
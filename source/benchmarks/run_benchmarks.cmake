@@ -0,0 +1,20 @@
+#Runs the benchmark suite and stamps the JSON results with the commit they were taken on
+execute_process(COMMAND git rev-parse --short HEAD
+                WORKING_DIRECTORY ${SOURCE_DIR}
+                OUTPUT_VARIABLE commit
+                OUTPUT_STRIP_TRAILING_WHITESPACE
+                RESULT_VARIABLE git_result)
+if (NOT git_result EQUAL 0)
+    set(commit unknown)
+endif()
+
+set(output ${OUTPUT_DIR}/benchmarks-${commit}.json)
+execute_process(COMMAND ${BENCHMARK}
+                    --benchmark_out=${output}
+                    --benchmark_out_format=json
+                    --benchmark_context=commit=${commit}
+                RESULT_VARIABLE benchmark_result)
+if (NOT benchmark_result EQUAL 0)
+    message(FATAL_ERROR "benchmarks failed")
+endif()
+message(STATUS "benchmark results written to ${output}")
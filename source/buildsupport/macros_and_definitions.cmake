@@ -38,6 +38,30 @@ MACRO(HEADER_DIRECTORIES return_list)
 ENDMACRO()
 #-------------------------------------------------------------
 
+#trace levels compiled in with OpENer_TRACES, the levels traced at runtime are a subset of them
+macro(createTraceLevelOptions)
+    add_definitions(-DOPENER_WITH_TRACES)
+    set(OpENer_TRACE_LEVEL_ERROR ON CACHE BOOL "Compile in error traces")
+    set(OpENer_TRACE_LEVEL_WARNING ON CACHE BOOL "Compile in warning traces")
+    set(OpENer_TRACE_LEVEL_STATE ON CACHE BOOL "Compile in state traces")
+    set(OpENer_TRACE_LEVEL_INFO ON CACHE BOOL "Compile in info traces")
+
+    set(trace_level 0)
+    if(OpENer_TRACE_LEVEL_ERROR)
+        math(EXPR trace_level "${trace_level} + 1")
+    endif()
+    if(OpENer_TRACE_LEVEL_WARNING)
+        math(EXPR trace_level "${trace_level} + 2")
+    endif()
+    if(OpENer_TRACE_LEVEL_STATE)
+        math(EXPR trace_level "${trace_level} + 4")
+    endif()
+    if(OpENer_TRACE_LEVEL_INFO)
+        math(EXPR trace_level "${trace_level} + 8")
+    endif()
+    add_definitions(-DOPENER_TRACE_LEVEL=${trace_level})
+endmacro()
+
 #process all options passed in main cmakeLists
 macro(process_options)
     #process platform switch
@@ -46,11 +70,48 @@ macro(process_options)
         add_definitions(-D__linux__)
     endif()
 
+    #process network backend switch, epoll and io_uring are only there on linux,
+    #io_uring only if it is asked for as it reserves its buffers statically
+    add_definitions(-DOPENER_NETWORK_BACKEND_${OpENer_NETWORK_BACKEND})
+    if (${OpENer_NETWORK_BACKEND} STREQUAL IO_URING)
+        set(OpENer_IO_URING ON)
+    endif()
+    if (${OpENer_IO_URING} AND NOT ${OpENer_PLATFORM} STREQUAL WIN32)
+        include(CheckCXXSourceCompiles)
+        check_cxx_source_compiles("
+            #include <linux/io_uring.h>
+            int main() { return IORING_RECV_MULTISHOT + IORING_REGISTER_PBUF_RING + IORING_ASYNC_CANCEL_FD
+                                + sizeof(struct io_uring_recvmsg_out); }" OpENer_HAVE_IO_URING)
+        if (OpENer_HAVE_IO_URING)
+            add_definitions(-DOPENER_WITH_IO_URING)
+        endif()
+    endif()
+
+    #process network feature switches
+    if (${OpENer_IO_SHARDS})
+        add_definitions(-DOPENER_WITH_IO_SHARDS)
+    endif()
+    if (${OpENer_EXPLICIT_WORKERS})
+        add_definitions(-DOPENER_WITH_EXPLICIT_WORKERS)
+    endif()
+    if (${OpENer_TCP_SEND_QUEUES})
+        add_definitions(-DOPENER_WITH_TCP_SEND_QUEUES)
+    endif()
+
+    #process virtual adapter switches
+    add_definitions(-DOPENER_VIRTUAL_ADAPTERS=${OpENer_VIRTUAL_ADAPTERS})
+    add_definitions(-DOPENER_VIRTUAL_ADAPTER_DATA_SIZE=${OpENer_VIRTUAL_ADAPTER_DATA_SIZE})
+
     #process thread switch
     if (${OpENer_USETHREAD})
         add_definitions(-DUSETHREAD)
     endif()
 
+    #process static memory switch
+    if (${OpENer_STATIC_MEMORY})
+        add_definitions(-DOPENER_STATIC_MEMORY)
+    endif()
+
     #process trace switch
     if(${OpENer_TRACES})
         createTraceLevelOptions()
@@ -89,4 +150,14 @@ macro(build_example net_type example_name)
             )
 endmacro()
 
+macro(build_tool tool_name)
+    find_package(Threads REQUIRED)
+    add_executable(${tool_name} ${tool_name}.cpp)
+
+    target_link_libraries(${tool_name} OpENerLib ${CMAKE_THREAD_LIBS_INIT})
 
+    set_target_properties( ${tool_name}
+            PROPERTIES
+            RUNTIME_OUTPUT_DIRECTORY ${CMAKE_RUNTIME_OUTPUT_DIRECTORY}/tools
+            )
+endmacro()
@@ -4,7 +4,12 @@
 
 #include "OpENer_Interface.hpp"
 #include "cip/connection/network/NET_NetworkHandler.hpp"
+#include "cip/CIP_Objects/CIP_0001_Identity/CIP_Identity.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/connection/network/NET_IoShards.hpp"
+#include "cip/connection/network/NET_ExplicitWorkers.hpp"
 #include "cip/CIP_Common.hpp"
+#include "utils/staticmemory.hpp"
 #include <random>
 
 #ifdef WIN
@@ -29,14 +34,11 @@ std::map<CipUdint, OpENer_ExplicitConnection*> OpENer_Interface::Explicit_Connec
 #endif
 
 //Methods
-bool OpENer_Interface::OpENer_Initialize(CipUint serialNumber)
+bool OpENer_Interface::OpENer_Initialize(CipUdint serialNumber, int io_shards, int explicit_workers)
 {
     g_end_stack = 0;
     CipUint unique_connection_id;
 
-    //for a real device the serial number should be unique per device
-    SetDeviceSerialNumber(serialNumber);
-
     // nUniqueConnectionID should be sufficiently random or incremented and stored
     //  in non-volatile memory each time the device boots.
     std::default_random_engine generator;
@@ -46,11 +48,29 @@ bool OpENer_Interface::OpENer_Initialize(CipUint serialNumber)
     // Setup the CIP Layer
     CipStackInit(unique_connection_id);
 
+    //for a real device the serial number should be unique per device, the Identity has been initialized with 0
+    SetDeviceSerialNumber(serialNumber);
+
     // Setup Network Handles
     if (kCipGeneralStatusCodeSuccess == NET_NetworkHandler::NetworkHandlerInitialize ().status)
     {
         g_end_stack = 0;
 
+        //the TCP/IP Interface and Ethernet Link follow the interface from now on
+        if (kCipGeneralStatusCodeSuccess != CIP_TCPIP_Interface::ScanInterfaces().status)
+        {
+            OPENER_TRACE_WARN("the interface attributes are not updated\n");
+        }
+
+        //threads allocate when they are created, so they start before the heap is sealed
+        if ((0 < io_shards) && (kCipStatusOk != NET_IoShards::Start(io_shards).status))
+        {
+            OPENER_TRACE_WARN("the I/O stays on the network handler thread\n");
+        }
+        if ((0 < explicit_workers) && (kCipStatusOk != NET_ExplicitWorkers::Start(explicit_workers).status))
+        {
+            OPENER_TRACE_WARN("the explicit messages stay on the network handler thread\n");
+        }
 
 #ifdef USETHREAD
         //Create thread to keep OpENer working
@@ -63,6 +83,8 @@ bool OpENer_Interface::OpENer_Initialize(CipUint serialNumber)
     #endif
 #endif
 
+        //Every pool is allocated by now, the stack runs without the heap
+        StaticMemory::Seal();
         return true;
     }
 
@@ -72,6 +94,8 @@ bool OpENer_Interface::OpENer_Initialize(CipUint serialNumber)
 
 bool OpENer_Interface::OpENer_Shutdown()
 {
+    StaticMemory::Unseal();
+
     //TODO: clean up all Explicit and IO connections
 
     //TODO: if cipstatusok, finish handler
@@ -208,6 +232,11 @@ CipStatus OpENer_Interface::AfterDataReceived(void *)
 	return kCipGeneralStatusCodeSuccess;
 }
 
+void OpENer_Interface::RunIdleChanged(CipUdint run_idle_value)
+{
+
+}
+
 CipStatus OpENer_Interface::ConfigureNetworkInterface(const char* ip_address, const char* subnet_mask, const char* gateway_address)
 {
 	return kCipGeneralStatusCodeSuccess;
@@ -230,12 +259,12 @@ void OpENer_Interface::ConfigureHostName(const char* host_name)
 
 void OpENer_Interface::SetDeviceSerialNumber(CipUdint serial_number)
 {
-
+    CIP_Identity::SetDeviceSerialNumber(serial_number);
 }
 
 void OpENer_Interface::SetDeviceStatus(CipUint device_status)
 {
-
+    CIP_Identity::SetDeviceStatus(device_status);
 }
 
 void OpENer_Interface::CipStackInit(CipUint unique_connection_id)
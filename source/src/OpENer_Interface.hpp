@@ -213,8 +213,19 @@ class OpENer_Interface
 {
 
     public:
-        //Initialize or shutdown OpENer CIP stack
-        static bool OpENer_Initialize(CipUint serial_number);
+        /** @brief Initialize the stack and seal the heap
+         *
+         * The I/O shards and the explicit message workers are started here, before
+         * the heap is sealed, see NET_IoShards and NET_ExplicitWorkers. The stack
+         * runs on the calling thread alone if they cannot be started.
+         *
+         * @param serial_number serial number of the Identity object, unique per device
+         * @param io_shards number of I/O shard threads, 0 for none
+         * @param explicit_workers number of explicit message worker threads, 0 for none
+         */
+        static bool OpENer_Initialize(CipUdint serial_number, int io_shards = 0, int explicit_workers = 0);
+
+        //Shutdown OpENer CIP stack
 
         /******************************************************************************/
         /*!\brief Signal handler function for ending stack execution
@@ -239,17 +250,6 @@ class OpENer_Interface
         static CipStatus AfterDataReceived(void *);
 
 
-    //TODO: fix
-    /** @brief The number of bytes used for the Ethernet message buffer on
-     * the pc port. For different platforms it may makes sense to
-     * have more than one buffer.
-     *
-     *  This buffer size will be used for any received message.
-     *  The same buffer is used for the replied explicit message.
-     */
-    #define PC_OPENER_ETHERNET_BUFFER_SIZE 512
-
-
     /**  @defgroup CIP_API OpENer User interface
      * @brief This is the public interface of the OpENer. It provides all function
      * needed to implement an EtherNet/IP enabled slave-device.
@@ -531,10 +531,14 @@ class OpENer_Interface
      * @brief Inform the application that the Run/Idle State has been changed
      * by the originator.
      *
+     * Called from the consuming path when a class 0/1 frame carries another
+     * run/idle header than the previous one of its connection. Connections
+     * start in idle, so the first idle frame is not reported.
+     *
      * @param run_idle_value the current value of the run/idle flag according to CIP
      * spec Vol 1 3-6.5
      */
-    void RunIdleChanged(CipUdint run_idle_value);
+    static void RunIdleChanged(CipUdint run_idle_value);
 
 
     /** @ingroup CIP_CALLBACK_API
@@ -3,14 +3,23 @@
  * All rights reserved.
  *
  ******************************************************************************/
+#include <cstring>
 #include "CIP_AppConnType.hpp"
+#include "connection/network/NET_Endianconv.hpp"
+#include "connection/network/NET_BufferPool.hpp"
+#include "connection/network/NET_IoBackend.hpp"
+#include "connection/network/NET_VirtualAdapters.hpp"
+#include "utils/iolatency.hpp"
+#include "utils/netstatistics.hpp"
 
 //Static variables
-CIP_AppConnType::ExclusiveOwnerConnection * CIP_AppConnType::g_exlusive_owner_connections;
+CIP_AppConnType::ExclusiveOwnerConnection CIP_AppConnType::g_exlusive_owner_connections[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS];
 
-CIP_AppConnType::InputOnlyConnection * CIP_AppConnType::g_input_only_connections;
+CIP_AppConnType::InputOnlyConnection CIP_AppConnType::g_input_only_connections[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_INPUT_ONLY_CONNS];
 
-CIP_AppConnType::ListenOnlyConnection * CIP_AppConnType::g_listen_only_connections;
+CIP_AppConnType::ListenOnlyConnection CIP_AppConnType::g_listen_only_connections[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_LISTEN_ONLY_CONNS];
+
+CIP_AppConnType::MulticastProducer CIP_AppConnType::g_multicast_producers[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_MULTICAST_PRODUCERS];
 
 //Methods
 
@@ -19,9 +28,13 @@ void CIP_AppConnType::ConfigureExclusiveOwnerConnectionPoint(unsigned int connec
 {
     if (OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS > connection_number)
     {
-        g_exlusive_owner_connections[connection_number].output_assembly = output_assembly;
-        g_exlusive_owner_connections[connection_number].input_assembly = input_assembly;
-        g_exlusive_owner_connections[connection_number].config_assembly = config_assembly;
+        //all adapters have the same connection points
+        for (int adapter = 0; adapter < OPENER_VIRTUAL_ADAPTERS; adapter++)
+        {
+            g_exlusive_owner_connections[adapter][connection_number].output_assembly = output_assembly;
+            g_exlusive_owner_connections[adapter][connection_number].input_assembly = input_assembly;
+            g_exlusive_owner_connections[adapter][connection_number].config_assembly = config_assembly;
+        }
     }
 }
 
@@ -29,9 +42,13 @@ void CIP_AppConnType::ConfigureInputOnlyConnectionPoint(unsigned int connection_
 {
     if (OPENER_CIP_NUM_INPUT_ONLY_CONNS > connection_number)
     {
-        g_input_only_connections[connection_number].output_assembly = output_assembly;
-        g_input_only_connections[connection_number].input_assembly = input_assembly;
-        g_input_only_connections[connection_number].config_assembly = config_assembly;
+        //all adapters have the same connection points
+        for (int adapter = 0; adapter < OPENER_VIRTUAL_ADAPTERS; adapter++)
+        {
+            g_input_only_connections[adapter][connection_number].output_assembly = output_assembly;
+            g_input_only_connections[adapter][connection_number].input_assembly = input_assembly;
+            g_input_only_connections[adapter][connection_number].config_assembly = config_assembly;
+        }
     }
 }
 
@@ -42,101 +59,131 @@ void CIP_AppConnType::ConfigureListenOnlyConnectionPoint(unsigned int connection
 {
     if (OPENER_CIP_NUM_LISTEN_ONLY_CONNS > connection_number)
     {
-        g_listen_only_connections[connection_number].output_assembly = output_assembly;
-        g_listen_only_connections[connection_number].input_assembly = input_assembly;
-        g_listen_only_connections[connection_number].config_assembly = config_assembly;
+        //all adapters have the same connection points
+        for (int adapter = 0; adapter < OPENER_VIRTUAL_ADAPTERS; adapter++)
+        {
+            g_listen_only_connections[adapter][connection_number].output_assembly = output_assembly;
+            g_listen_only_connections[adapter][connection_number].input_assembly = input_assembly;
+            g_listen_only_connections[adapter][connection_number].config_assembly = config_assembly;
+        }
     }
 }
 
-const  CIP_Connection* CIP_AppConnType::GetIoConnectionForConnectionData(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
+CipStatus CIP_AppConnType::GetIoConnectionForConnectionData(CIP_ConnectionManager* connection_manager, CipUint* extended_error)
 {
-    const CIP_Connection* io_connection = nullptr;
+    CIP_ConnectionManager** io_connection_slot = nullptr;
     *extended_error = 0;
 
-    io_connection = GetExclusiveOwnerConnection(connection_manager, extended_error);
-    if (nullptr == io_connection)
+    io_connection_slot = GetExclusiveOwnerConnection(connection_manager, extended_error);
+    if ((nullptr == io_connection_slot) && (0 == *extended_error))
+    {
+        /* we found no connection and don't have an error so try input only next */
+        io_connection_slot = GetInputOnlyConnection(connection_manager, extended_error);
+    }
+    if ((nullptr == io_connection_slot) && (0 == *extended_error))
+    {
+        /* we found no connection and don't have an error so try listen only next */
+        io_connection_slot = GetListenOnlyConnection(connection_manager, extended_error);
+    }
+
+    if (nullptr == io_connection_slot)
     {
         if (0 == *extended_error)
         {
-            /* we found no connection and don't have an error so try input only next */
-            io_connection = GetInputOnlyConnection(connection_manager, extended_error);
-            if (nullptr == io_connection)
-            {
-                if (0 == *extended_error)
-                {
-                    /* we found no connection and don't have an error so try listen only next */
-                    io_connection = GetListenOnlyConnection(connection_manager, extended_error);
-                    if ((nullptr == io_connection) && (0 == *extended_error))
-                    {
-                        /* no application connection type was found that suits the given data */
-                        /* TODO check error code VS */
-                        *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeInconsistentApplicationPathCombo;
-                    }
-                    else
-                    {
-                        ((CIP_Connection*)connection_manager)->Instance_type = CIP_Connection::kConnectionTypeIo;//CIP_AppConnType::kAppConnTypeIoListenOnly;
-                    }
-                }
-            }
-            else
-            {
-                ((CIP_Connection*)connection_manager)->Instance_type = CIP_Connection::kConnectionTypeIo; //CIP_AppConnType::kAppConnTypeIoInputOnly;
-            }
+            /* no application connection type was found that suits the given data */
+            /* TODO check error code VS */
+            *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeInconsistentApplicationPathCombo;
         }
+        return kCipStatusError;
     }
-    else
+
+    *io_connection_slot = connection_manager;
+    return kCipStatusOk;
+}
+
+void CIP_AppConnType::ReleaseIoConnection(const CIP_ConnectionManager* connection_manager)
+{
+    ExclusiveOwnerConnection* exclusive_owner_connections = g_exlusive_owner_connections[connection_manager->adapter];
+    InputOnlyConnection* input_only_connections = g_input_only_connections[connection_manager->adapter];
+    ListenOnlyConnection* listen_only_connections = g_listen_only_connections[connection_manager->adapter];
+    int i, j;
+
+    for (i = 0; i < OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS; i++)
     {
-        ((CIP_Connection*)connection_manager)->Instance_type = CIP_Connection::kConnectionTypeIo; //CIP_AppConnType::kAppConnTypeIoExclusiveOwner;
+        if (exclusive_owner_connections[i].connection_data == connection_manager)
+        {
+            exclusive_owner_connections[i].connection_data = nullptr;
+            return;
+        }
     }
 
-    if (nullptr != io_connection)
+    for (i = 0; i < OPENER_CIP_NUM_INPUT_ONLY_CONNS; i++)
     {
-        //todo: fix CIP_ConnectionManager::CopyConnectionData((CIP_Connection*)io_connection, connection_manager->producing_instance);
+        for (j = 0; j < OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH; j++)
+        {
+            if (input_only_connections[i].connection_data[j] == connection_manager)
+            {
+                input_only_connections[i].connection_data[j] = nullptr;
+                return;
+            }
+        }
     }
 
-    return io_connection;
+    for (i = 0; i < OPENER_CIP_NUM_LISTEN_ONLY_CONNS; i++)
+    {
+        for (j = 0; j < OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH; j++)
+        {
+            if (listen_only_connections[i].connection_data[j] == connection_manager)
+            {
+                listen_only_connections[i].connection_data[j] = nullptr;
+                return;
+            }
+        }
+    }
 }
 
-const  CIP_Connection* CIP_AppConnType::GetExclusiveOwnerConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
+CIP_ConnectionManager** CIP_AppConnType::GetExclusiveOwnerConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
 {
-    CIP_Connection* exclusive_owner_connection = nullptr;
+    ExclusiveOwnerConnection* exclusive_owner_connections = g_exlusive_owner_connections[connection_manager->adapter];
     int i;
 
     for (i = 0; i < OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS; i++)
     {
-        if ((g_exlusive_owner_connections[i].output_assembly == connection_manager->connection_path.connection_point[0])
-            && (g_exlusive_owner_connections[i].input_assembly == connection_manager->connection_path.connection_point[1])
-            && (g_exlusive_owner_connections[i].config_assembly == connection_manager->connection_path.connection_point[2]))
+        if ((exclusive_owner_connections[i].output_assembly == connection_manager->connection_path.connection_point[0])
+            && (exclusive_owner_connections[i].input_assembly == connection_manager->connection_path.connection_point[1])
+            && (exclusive_owner_connections[i].config_assembly == connection_manager->connection_path.connection_point[2]))
         {
-
             /* check if on other connection point with the same output assembly is currently connected */
-            //todo: fix if (nullptr != CIP_ConnectionManager::GetConnectedOutputAssembly(connection_manager->connection_path.connection_point[0]))
+            for (int j = 0; j < OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS; j++)
             {
-                *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeErrorOwnershipConflict;
-                break;
+                if ((nullptr != exclusive_owner_connections[j].connection_data)
+                    && (exclusive_owner_connections[j].output_assembly == exclusive_owner_connections[i].output_assembly))
+                {
+                    *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeErrorOwnershipConflict;
+                    return nullptr;
+                }
             }
-            exclusive_owner_connection = (g_exlusive_owner_connections[i].connection_data);
-            break;
+            return &exclusive_owner_connections[i].connection_data;
         }
     }
-    return exclusive_owner_connection;
+    return nullptr;
 }
 
-const CIP_Connection* CIP_AppConnType::GetInputOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
+CIP_ConnectionManager** CIP_AppConnType::GetInputOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
 {
-    CIP_Connection* input_only_connection = nullptr;
+    InputOnlyConnection* input_only_connections = g_input_only_connections[connection_manager->adapter];
     int i, j;
 
     for (i = 0; i < OPENER_CIP_NUM_INPUT_ONLY_CONNS; i++)
     {
-        if (g_input_only_connections[i].output_assembly == connection_manager->connection_path.connection_point[0])
+        if (input_only_connections[i].output_assembly == connection_manager->connection_path.connection_point[0])
         { /* we have the same output assembly */
-            if (g_input_only_connections[i].input_assembly != connection_manager->connection_path.connection_point[1])
+            if (input_only_connections[i].input_assembly != connection_manager->connection_path.connection_point[1])
             {
                 *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeInvalidProducingApplicationPath;
                 break;
             }
-            if (g_input_only_connections[i].config_assembly!= connection_manager->connection_path.connection_point[2])
+            if (input_only_connections[i].config_assembly!= connection_manager->connection_path.connection_point[2])
             {
                 *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeInconsistentApplicationPathCombo;
                 break;
@@ -144,24 +191,25 @@ const CIP_Connection* CIP_AppConnType::GetInputOnlyConnection(const CIP_Connecti
 
             for (j = 0; j < OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH; j++)
             {
-                if (CIP_Connection::kConnectionStateNonExistent == g_input_only_connections[i].connection_data[j].State)
+                if (nullptr == input_only_connections[i].connection_data[j])
                 {
-                    return (&g_input_only_connections[i].connection_data[j]);
+                    return &input_only_connections[i].connection_data[j];
                 }
             }
             *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeTargetObjectOutOfConnections;
             break;
         }
     }
-    return input_only_connection;
+    return nullptr;
 }
 
-const CIP_Connection* CIP_AppConnType::GetListenOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
+CIP_ConnectionManager** CIP_AppConnType::GetListenOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error)
 {
-    CIP_Connection* listen_only_connection = nullptr;
+    ListenOnlyConnection* listen_only_connections = g_listen_only_connections[connection_manager->adapter];
     int i, j;
 
-    if (CIP_ConnectionManager::kRoutingTypeMulticastConnection != connection_manager->t_to_o_network_connection_parameter)
+    if (CIP_ConnectionManager::kRoutingTypeMulticastConnection
+        != (connection_manager->t_to_o_network_connection_parameter & CIP_ConnectionManager::kNetworkConnectionParameterTypeMask))
     {
         /* a listen only connection has to be a multicast connection. */
         *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeNonListenOnlyConnectionNotOpened; /* maybe not the best error message however there is no suitable definition in the cip spec */
@@ -170,20 +218,20 @@ const CIP_Connection* CIP_AppConnType::GetListenOnlyConnection(const CIP_Connect
 
     for (i = 0; i < OPENER_CIP_NUM_LISTEN_ONLY_CONNS; i++)
     {
-        if (g_listen_only_connections[i].output_assembly == connection_manager->connection_path.connection_point[0])
+        if (listen_only_connections[i].output_assembly == connection_manager->connection_path.connection_point[0])
         { /* we have the same output assembly */
-            if (g_listen_only_connections[i].input_assembly != connection_manager->connection_path.connection_point[1])
+            if (listen_only_connections[i].input_assembly != connection_manager->connection_path.connection_point[1])
             {
                 *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeInvalidProducingApplicationPath;
                 break;
             }
-            if (g_listen_only_connections[i].config_assembly != connection_manager->connection_path.connection_point[2])
+            if (listen_only_connections[i].config_assembly != connection_manager->connection_path.connection_point[2])
             {
                 *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeInconsistentApplicationPathCombo;
                 break;
             }
 
-            if (nullptr == GetExistingProducerMulticastConnection(connection_manager->connection_path.connection_point[1]))
+            if (nullptr == GetExistingProducerMulticastConnection(connection_manager->adapter, connection_manager->connection_path.connection_point[1]))
             {
                 *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeNonListenOnlyConnectionNotOpened;
                 break;
@@ -191,133 +239,361 @@ const CIP_Connection* CIP_AppConnType::GetListenOnlyConnection(const CIP_Connect
 
             for (j = 0; j < OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH; j++)
             {
-                if (CIP_Connection::kConnectionStateNonExistent == g_listen_only_connections[i].connection_data[j].State)
+                if (nullptr == listen_only_connections[i].connection_data[j])
                 {
-                    return &g_listen_only_connections[i].connection_data[j];
+                    return &listen_only_connections[i].connection_data[j];
                 }
             }
             *extended_error = CIP_ConnectionManager::kConnMgrStatusCodeTargetObjectOutOfConnections;
             break;
         }
     }
-    return listen_only_connection;
+    return nullptr;
 }
 
-const CIP_Connection* CIP_AppConnType::GetExistingProducerMulticastConnection(CipUdint input_point)
+const CIP_Connection* CIP_AppConnType::GetExistingProducerMulticastConnection(CipUint adapter, CipUdint input_point)
 {
-    const CIP_ConnectionManager* producer_multicast_connection_manager;
+    /* the control master of the shared producer is the connection that
+     * produces the input assembly and manages the connection */
+    const MulticastProducer* producer = GetMulticastProducer(adapter, input_point);
 
-    for(unsigned int i = 0; i < CIP_ConnectionManager::active_connections_set->size(); i++)
+    if ((nullptr == producer) || (nullptr == producer->control_master))
     {
-        producer_multicast_connection_manager = CIP_ConnectionManager::active_connections_set->at(i);
+        return nullptr;
+    }
+    return producer->control_master->producing_instance;
+}
+
+const CIP_Connection* CIP_AppConnType::GetNextNonControlMasterConnection(CipUint adapter, CipUdint input_point)
+{
+    const MulticastProducer* producer = GetMulticastProducer(adapter, input_point);
+
+    if (nullptr == producer)
+    {
+        return nullptr;
+    }
 
-        if (CIP_Connection::kConnectionTypeIo == producer_multicast_connection_manager->producing_instance->Instance_type) //check against original
+    for (unsigned int i = 0; i < producer->number_of_consumers; i++)
+    {
+        if (producer->consumers[i] != producer->control_master)
         {
-            if ((input_point == producer_multicast_connection_manager->connection_path.connection_point[1])
-                && (CIP_ConnectionManager::kRoutingTypeMulticastConnection == (producer_multicast_connection_manager->t_to_o_network_connection_parameter & CIP_ConnectionManager::kRoutingTypeMulticastConnection))
-                && (kEipInvalidSocket!= producer_multicast_connection_manager->producing_instance->netConn->GetSocketHandle()))//todo:kUdpCommuncationDirectionProducing)))
-            {
-                /* we have a connection that produces the same input assembly,
-         * is a multicast producer and manages the connection.
-         */
-                break;
-            }
+            /* we have a connection that produces the same input assembly,
+             * is a multicast producer and does not manage the connection. */
+            return producer->consumers[i]->producing_instance;
         }
     }
-    return producer_multicast_connection_manager->producing_instance;
+    return nullptr;
 }
 
-const CIP_Connection* CIP_AppConnType::GetNextNonControlMasterConnection(CipUdint input_point)
+CIP_AppConnType::MulticastProducer* CIP_AppConnType::GetMulticastProducer(CipUint adapter, CipUdint input_point)
 {
-    CIP_ConnectionManager* next_non_control_master_connection_manager;
+    if ((0 == input_point) || (OPENER_VIRTUAL_ADAPTERS <= adapter))
+    {
+        return nullptr;
+    }
 
-     for(unsigned int i = 0; i < CIP_ConnectionManager::active_connections_set->size(); i++)
+    for (int i = 0; i < OPENER_CIP_NUM_MULTICAST_PRODUCERS; i++)
     {
-        next_non_control_master_connection_manager = (CIP_ConnectionManager*)CIP_ConnectionManager::active_connections_set->at(i);
+        if (input_point == g_multicast_producers[adapter][i].input_assembly)
+        {
+            return &g_multicast_producers[adapter][i];
+        }
+    }
+    return nullptr;
+}
+
+CIP_AppConnType::MulticastProducer* CIP_AppConnType::AttachMulticastConsumer(CIP_ConnectionManager* connection)
+{
+    CipUdint input_point = connection->connection_path.connection_point[1];
+    MulticastProducer* producer = GetMulticastProducer(connection->adapter, input_point);
 
-        if (CIP_Connection::kConnectionTypeIo == next_non_control_master_connection_manager->producing_instance->Instance_type)
-        //todo: check against original if ((CIP_Connection::kConnectionTypeIo; //CIP_AppConnType::kAppConnTypeIoExclusiveOwner == next_non_control_master_connection->Instance_type)
-        //    || (CIP_Connection::kConnectionTypeIo; //CIP_AppConnType::kAppConnTypeIoInputOnly == next_non_control_master_connection->Instance_type))
+    if (nullptr == producer)
+    {
+        /* first consumer of this input assembly, take a free producer */
+        for (int i = 0; i < OPENER_CIP_NUM_MULTICAST_PRODUCERS; i++)
         {
-            if ((input_point == next_non_control_master_connection_manager->connection_path.connection_point[1])
-                && (CIP_ConnectionManager::kRoutingTypeMulticastConnection == (next_non_control_master_connection_manager->t_to_o_network_connection_parameter
-                              & CIP_ConnectionManager::kRoutingTypeMulticastConnection))
-                && (kEipInvalidSocket == next_non_control_master_connection_manager->producing_instance->netConn->GetSocketHandle()))//todo:kUdpCommuncationDirectionProducing)))
+            if (0 == g_multicast_producers[connection->adapter][i].input_assembly)
             {
-                /* we have a connection that produces the same input assembly,
-         * is a multicast producer and does not manages the connection.
-         */
+                producer = &g_multicast_producers[connection->adapter][i];
+                memset(producer, 0, sizeof(MulticastProducer));
+                producer->input_assembly = input_point;
                 break;
             }
         }
+        if (nullptr == producer)
+        {
+            OPENER_TRACE_WARN("no free multicast producer for input assembly %u\n", (unsigned int) input_point);
+            return nullptr;
+        }
+    }
+
+    for (unsigned int i = 0; i < producer->number_of_consumers; i++)
+    {
+        if (producer->consumers[i] == connection)
+        {
+            return producer; /* already attached */
+        }
+    }
+
+    if (OPENER_CIP_NUM_MULTICAST_CONSUMERS_PER_PRODUCER <= producer->number_of_consumers)
+    {
+        OPENER_TRACE_WARN("multicast producer for input assembly %u is out of consumer slots\n", (unsigned int) input_point);
+        return nullptr;
+    }
+
+    producer->consumers[producer->number_of_consumers++] = connection;
+
+    if (nullptr == producer->control_master)
+    {
+        producer->control_master = connection;
+    }
+    else if ((nullptr != connection->producing_instance) && (nullptr != producer->control_master->producing_instance))
+    {
+        /* all consumers receive the same frame, so they share its connection id */
+        connection->producing_instance->CIP_produced_connection_id = producer->control_master->producing_instance->CIP_produced_connection_id;
     }
-    return next_non_control_master_connection_manager->producing_instance;
+
+    UpdateMulticastProductionInterval(producer);
+    return producer;
 }
 
-void CIP_AppConnType::CloseAllConnectionsForInputWithSameType(CipUdint input_point, CIP_Connection::ConnectionType_e Instance_type)
+void CIP_AppConnType::DetachMulticastConsumer(CIP_ConnectionManager* connection)
 {
-    const CIP_ConnectionManager* connection_manager;
-    const CIP_Connection* connection_to_delete;
+    MulticastProducer* producer = GetMulticastProducer(connection->adapter, connection->connection_path.connection_point[1]);
 
-    for(unsigned int i = 0; i < CIP_ConnectionManager::active_connections_set->size(); i++)
+    if (nullptr == producer)
     {
-        connection_manager = CIP_ConnectionManager::active_connections_set->at(i);
+        return;
+    }
 
-        //check instance against original
-        if ((Instance_type == connection_manager->producing_instance->Instance_type) && (input_point == connection_manager->connection_path.connection_point[1]))
+    for (unsigned int i = 0; i < producer->number_of_consumers; i++)
+    {
+        if (producer->consumers[i] == connection)
         {
+            /* order of the consumers does not matter, fill the gap with the last one */
+            producer->consumers[i] = producer->consumers[--producer->number_of_consumers];
+            producer->consumers[producer->number_of_consumers] = nullptr;
+            break;
+        }
+    }
 
-            //TODO:CheckIoConnectionEvent(connection_manager->connection_path.connection_point[0], connection_manager->connection_path.connection_point[1], kIoConnectionEventClosed);
+    if (0 == producer->number_of_consumers)
+    {
+        memset(producer, 0, sizeof(MulticastProducer));
+        return;
+    }
+
+    if (producer->control_master == connection)
+    {
+        /* hand the producing socket and the sequence counts over to the next
+         * connection so that the remaining consumers see no interruption */
+        CIP_ConnectionManager* next_master = producer->consumers[0];
 
-            /* FIXME check if this is ok */
-            //connection_to_delete->connection_close_function(connection_to_delete);
-            //todo:fix CIP_ConnectionManager::CloseConnection ((CIP_ConnectionManager*)connection_manager); /*will remove the connection from the active connection list */
+        if ((nullptr != next_master->producing_instance) && (nullptr != connection->producing_instance))
+        {
+            /* swap, so that each pooled connection object keeps a socket holder */
+            NET_Connection* producing_socket = connection->producing_instance->netConn;
+            connection->producing_instance->netConn = next_master->producing_instance->netConn;
+            next_master->producing_instance->netConn = producing_socket;
+            producing_socket->remote_address = (struct sockaddr*) &next_master->remote_address;
         }
+        next_master->eip_level_sequence_count_producing = connection->eip_level_sequence_count_producing;
+        next_master->sequence_count_producing = connection->sequence_count_producing;
+        producer->control_master = next_master;
     }
+
+    UpdateMulticastProductionInterval(producer);
 }
 
-void CIP_AppConnType::CloseAllConnections(void)
+void CIP_AppConnType::UpdateMulticastProductionInterval(MulticastProducer* producer)
 {
-    CIP_ConnectionManager* connection_manager;
-    for(unsigned int i = 0; i < CIP_ConnectionManager::active_connections_set->size(); i++)
+    CipUdint fastest_interval = 0;
+
+    for (unsigned int i = 0; i < producer->number_of_consumers; i++)
+    {
+        CipUdint interval = producer->consumers[i]->t_to_o_requested_packet_interval;
+        if ((0 == fastest_interval) || ((0 != interval) && (interval < fastest_interval)))
+        {
+            fastest_interval = interval;
+        }
+    }
+    producer->requested_packet_interval = fastest_interval;
+
+    /* a faster consumer must not wait for the rest of a slower period */
+    CipDint period = (CipDint) (fastest_interval / 1000);
+    if (producer->transmission_trigger_timer > period)
     {
-        connection_manager = (CIP_ConnectionManager*)CIP_ConnectionManager::active_connections_set->at(i);
-        /*FIXME check if m_pfCloseFunc would be suitable*/
-        //todo: fix CIP_ConnectionManager::CloseConnection(connection_manager);
-        /* Close connection will remove the connection from the list therefore we
-     * need to get again the start until there is no connection left
-     */
+        producer->transmission_trigger_timer = period;
     }
 }
 
-CipBool CIP_AppConnType::ConnectionWithSameConfigPointExists(CipUdint config_point)
+void CIP_AppConnType::ManageMulticastProducers(MilliSeconds elapsed_time)
 {
-    CIP_ConnectionManager* connection_manager;
-    for(unsigned int i = 0; i < CIP_ConnectionManager::active_connections_set->size(); i++)
+    int entered_adapter = NET_VirtualAdapters::GetCurrentAdapter();
+
+    for (int i = 0; i < OPENER_CIP_NUM_MULTICAST_PRODUCERS * NET_VirtualAdapters::GetNumberOfAdapters(); i++)
     {
-        connection_manager = (CIP_ConnectionManager*)CIP_ConnectionManager::active_connections_set->at(i);
+        int adapter = i / OPENER_CIP_NUM_MULTICAST_PRODUCERS;
+        MulticastProducer* producer = &g_multicast_producers[adapter][i % OPENER_CIP_NUM_MULTICAST_PRODUCERS];
 
-        if (config_point == connection_manager->connection_path.connection_point[2]) {
-            break;
+        if ((0 == producer->input_assembly) || (nullptr == producer->control_master))
+        {
+            continue;
+        }
+
+        producer->transmission_trigger_timer -= (CipDint) elapsed_time;
+        if (0 >= producer->transmission_trigger_timer)
+        {
+            /* reload with the period of the fastest consumer, keep the phase if we were late */
+            producer->transmission_trigger_timer += (CipDint) (producer->requested_packet_interval / 1000);
+            if (0 >= producer->transmission_trigger_timer)
+            {
+                producer->transmission_trigger_timer = (CipDint) (producer->requested_packet_interval / 1000);
+            }
+
+            //the frame carries the assembly data of the adapter
+            NET_VirtualAdapters::Enter(adapter);
+            if (kCipStatusOk != ProduceMulticastFrame(producer).status)
+            {
+                OPENER_TRACE_ERR("sending multicast frame for input assembly %u failed\n", (unsigned int) producer->input_assembly);
+            }
         }
     }
-    return (CipBool) (nullptr != connection_manager);
+    NET_VirtualAdapters::Enter(entered_adapter);
 }
 
-void CIP_AppConnType::InitializeIoConnectionData(void)
+CipStatus CIP_AppConnType::ProduceMulticastFrame(MulticastProducer* producer)
 {
-    g_exlusive_owner_connections = new ExclusiveOwnerConnection[OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS]();
+    if (kCipStatusOk != ProduceIoFrame(producer->control_master, producer->input_assembly).status)
+    {
+        return kCipStatusError;
+    }
 
+    producer->produced_frames++;
+    return kCipStatusOk;
+}
 
-    g_input_only_connections = new InputOnlyConnection[OPENER_CIP_NUM_INPUT_ONLY_CONNS]();
-    /*for (int i = 0; i < OPENER_CIP_NUM_INPUT_ONLY_CONNS; i++)
+CipStatus CIP_AppConnType::ProduceIoFrame(CIP_ConnectionManager* connection_manager, CipUdint input_assembly)
+{
+    if ((nullptr == connection_manager->producing_instance) || (nullptr == connection_manager->producing_instance->netConn))
     {
-        g_input_only_connections[i].connection_data = new CIP_ConnectionManager[OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH]();
-    }*/
+        return kCipStatusError;
+    }
 
-    g_listen_only_connections = new ListenOnlyConnection[OPENER_CIP_NUM_LISTEN_ONLY_CONNS]();
-    /*for (int i = 0; i < OPENER_CIP_NUM_LISTEN_ONLY_CONNS; i++)
+    const CIP_Assembly* assembly = CIP_Assembly::GetInstance(input_assembly);
+    if (nullptr == assembly)
     {
-        g_listen_only_connections[i].connection_data = new CIP_ConnectionManager[OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH]();
-    }*/
+        return kCipStatusError;
+    }
+
+    CipUlint frame_start = IoLatency::IsEnabled() ? IoLatency::Now() : 0;
+    const CipByteArray* assembly_data = assembly->GetAssemblyData();
+
+    /* 2 bytes item count + 12 bytes sequenced address item + 4 bytes data item header + 2 bytes sequence count */
+    if (NET_BufferPool::GetBufferSize(NET_BufferPool::kBufferClassIo) < (unsigned int) (assembly_data->length + 20))
+    {
+        return kCipStatusError;
+    }
+
+    /* the payload and the frame are only needed while the frame is sent */
+    CipUsint* payload_buffer = NET_BufferPool::Allocate(NET_BufferPool::kBufferClassIo);
+    CipUsint* frame_buffer = NET_BufferPool::Allocate(NET_BufferPool::kBufferClassIo);
+    if ((nullptr == payload_buffer) || (nullptr == frame_buffer))
+    {
+        NET_BufferPool::Release(NET_BufferPool::kBufferClassIo, payload_buffer);
+        NET_BufferPool::Release(NET_BufferPool::kBufferClassIo, frame_buffer);
+        return kCipStatusError;
+    }
+
+    CipUsint* payload_runner = payload_buffer;
+    connection_manager->sequence_count_producing++;
+    NET_Endianconv::AddIntToMessage(connection_manager->sequence_count_producing, payload_runner);
+    memcpy(payload_runner, assembly_data->data, assembly_data->length);
+
+    CIP_CommonPacket::PacketFormat packet;
+    packet.item_count = 2;
+    packet.address_item.type_id = CIP_CommonPacket::kCipItemIdSequencedAddressItem;
+    packet.address_item.length = 8;
+    packet.address_item.data.connection_identifier = connection_manager->producing_instance->CIP_produced_connection_id;
+    packet.address_item.data.sequence_number = ++connection_manager->eip_level_sequence_count_producing;
+    packet.data_item.type_id = CIP_CommonPacket::kCipItemIdConnectedDataItem;
+    packet.data_item.length = (CipUint) (assembly_data->length + 2);
+    packet.data_item.data = payload_buffer;
+    packet.address_info_item[0].type_id = 0;
+    packet.address_info_item[1].type_id = 0;
+
+    int frame_length = CIP_CommonPacket::AssembleIOMessage(&packet, frame_buffer);
+
+    //connection records are numbered from 1 on
+    int connection = (int) connection_manager->id - 1;
+
+    /* with io_uring the frame is copied and goes out with the next loop, errors are counted when it completes */
+    NET_Connection* producing_socket = connection_manager->producing_instance->netConn;
+    int sent_length = NET_IoBackend::SendTo(producing_socket->GetSocketHandle(), frame_buffer, (CipUdint) frame_length,
+                                            producing_socket->remote_address, connection);
+
+    NET_BufferPool::Release(NET_BufferPool::kBufferClassIo, payload_buffer);
+    NET_BufferPool::Release(NET_BufferPool::kBufferClassIo, frame_buffer);
+
+    if (frame_length != sent_length)
+    {
+        NetStatistics::Count(NetStatistics::kOutErrors);
+        NetStatistics::CountError(NetStatistics::kEndpointConnection, connection);
+        return kCipStatusError;
+    }
+
+    CipUdint destination = ntohl(((struct sockaddr_in*) producing_socket->remote_address)->sin_addr.s_addr);
+    NetStatistics::Count(NetStatistics::kOutOctets, (CipUlint) sent_length);
+    NetStatistics::Count(IN_MULTICAST(destination) ? NetStatistics::kOutNucastPackets : NetStatistics::kOutUcastPackets);
+    NetStatistics::CountSent(NetStatistics::kEndpointConnection, connection, (CipUdint) sent_length);
+
+    IoLatency::RecordProduced(input_assembly, frame_start);
+    return kCipStatusOk;
+}
+
+void CIP_AppConnType::CloseAllConnectionsForInputWithSameType(CipUdint input_point, CIP_Connection::ConnectionType_e Instance_type)
+{
+    /* closing removes the connection from the active list, so walk it backwards */
+    for (CipUint i = CIP_ConnectionManager::number_of_active_connections; i > 0; i--)
+    {
+        CIP_ConnectionManager* connection_manager = CIP_ConnectionManager::active_connections[i - 1];
+
+        //check instance against original
+        if ((nullptr != connection_manager->producing_instance)
+            && (Instance_type == connection_manager->producing_instance->Instance_type)
+            && (input_point == connection_manager->connection_path.connection_point[1]))
+        {
+            //TODO:CheckIoConnectionEvent(connection_manager->connection_path.connection_point[0], connection_manager->connection_path.connection_point[1], kIoConnectionEventClosed);
+            CIP_ConnectionManager::CloseConnection(connection_manager);
+        }
+    }
+}
+
+void CIP_AppConnType::CloseAllConnections(void)
+{
+    while (0 < CIP_ConnectionManager::number_of_active_connections)
+    {
+        CIP_ConnectionManager::CloseConnection(
+            CIP_ConnectionManager::active_connections[CIP_ConnectionManager::number_of_active_connections - 1]);
+    }
+}
+
+CipBool CIP_AppConnType::ConnectionWithSameConfigPointExists(CipUdint config_point)
+{
+    for (CipUint i = 0; i < CIP_ConnectionManager::number_of_active_connections; i++)
+    {
+        if (config_point == CIP_ConnectionManager::active_connections[i]->connection_path.connection_point[2])
+        {
+            return (CipBool) true;
+        }
+    }
+    return (CipBool) false;
+}
+
+void CIP_AppConnType::InitializeIoConnectionData(void)
+{
+    memset(g_exlusive_owner_connections, 0, sizeof(g_exlusive_owner_connections));
+    memset(g_input_only_connections, 0, sizeof(g_input_only_connections));
+    memset(g_listen_only_connections, 0, sizeof(g_listen_only_connections));
+    memset(g_multicast_producers, 0, sizeof(g_multicast_producers));
 }
@@ -29,35 +29,40 @@ public:
 /** @brief check if for the given connection data received in a forward_open request
  *  a suitable connection is available.
  *
- *  If a suitable connection is found the connection data is transfered the
- *  application connection type is set (i.e., EConnType).
+ *  If a suitable connection point is found the connection takes its free slot
+ *  until it is released with ReleaseIoConnection.
  *  @param connection_object connection data to be used
  *  @param extended_error if an error occurred this value has the according
  *     error code for the response
- *  @return
- *        - on success: A pointer to the connection object already containing the connection
- *          data given in pa_pstConnData.
- *        - on error: nullptr
+ *  @return kCipStatusOk on success, kCipStatusError otherwise
  */
-    static const CIP_Connection* GetIoConnectionForConnectionData (const CIP_ConnectionManager *connection_object, CipUint *extended_error);
+    static CipStatus GetIoConnectionForConnectionData (CIP_ConnectionManager *connection_object, CipUint *extended_error);
+
+/** @brief Free the connection point slot taken by an I/O connection
+ *
+ * @param connection_object the connection, nothing is done if it holds no slot
+ */
+    static void ReleaseIoConnection (const CIP_ConnectionManager *connection_object);
 
 /** @brief Check if there exists already an exclusive owner or listen only connection
  *         which produces the input assembly.
  *
+ *  @param adapter the virtual adapter the connections are opened on
  *  @param input_point the Input point to be produced
  *  @return if a connection could be found a pointer to this connection if not nullptr
  */
-    static const CIP_Connection* GetExistingProducerMulticastConnection (CipUdint input_point);
+    static const CIP_Connection* GetExistingProducerMulticastConnection (CipUint adapter, CipUdint input_point);
 
 /** @brief check if there exists an producing multicast exclusive owner or
  * listen only connection that should produce the same input but is not in charge
  * of the connection.
  *
+ * @param adapter the virtual adapter the connections are opened on
  * @param input_point the produced input
  * @return if a connection could be found the pointer to this connection
  *      otherwise nullptr.
  */
-    static const CIP_Connection* GetNextNonControlMasterConnection (CipUdint input_point);
+    static const CIP_Connection* GetNextNonControlMasterConnection (CipUint adapter, CipUdint input_point);
 
 /** @brief Close all connection producing the same input and have the same type
  * (i.e., listen only or input only).
@@ -130,41 +135,115 @@ public:
                                              unsigned int input_assembly_id, unsigned int configuration_assembly_id);
 
 
+/** @brief Shared T->O producer of one multicast input assembly
+ *
+ * All multicast connections consuming the same input assembly are attached to
+ * one producer. It emits a single frame per period, using the fastest T->O RPI
+ * among its consumers, so adding listeners costs neither CPU nor bandwidth.
+ */
+    typedef struct {
+        CipUdint input_assembly; /**< the T-to-O point produced, 0 if the producer is free */
+        CIP_ConnectionManager *consumers[OPENER_CIP_NUM_MULTICAST_CONSUMERS_PER_PRODUCER]; /**< attached connections */
+        unsigned int number_of_consumers;
+        CIP_ConnectionManager *control_master; /**< consumer whose connection id and socket are used to produce */
+        CipUdint requested_packet_interval; /**< fastest T->O RPI of the consumers in microseconds */
+        CipDint transmission_trigger_timer; /**< milliseconds until the next frame is due */
+        CipUdint produced_frames; /**< number of frames sent by this producer */
+    } MulticastProducer;
+
+/** @brief Attach a multicast connection to the shared producer of its input assembly
+ *
+ * The producer is allocated on the first attach. The first attached connection
+ * becomes the control master, and the production period is lowered if the new
+ * connection asks for a faster RPI.
+ *
+ * @param connection the connection to attach, its T->O point selects the producer
+ * @return the producer the connection was attached to, nullptr if no producer
+ *      or consumer slot is left
+ */
+    static MulticastProducer* AttachMulticastConsumer (CIP_ConnectionManager *connection);
+
+/** @brief Detach a connection from its shared multicast producer
+ *
+ * If the control master leaves, the next attached connection takes over. The
+ * production period is recalculated and the producer is freed with its last
+ * consumer.
+ *
+ * @param connection the connection to detach
+ */
+    static void DetachMulticastConsumer (CIP_ConnectionManager *connection);
+
+/** @brief Get the shared producer of an input assembly
+ *
+ * @param adapter the virtual adapter the producer belongs to
+ * @param input_point the produced input assembly
+ * @return the producer, nullptr if the input is not produced via multicast
+ */
+    static MulticastProducer* GetMulticastProducer (CipUint adapter, CipUdint input_point);
+
+/** @brief Advance the producer timers and send one frame for each due producer
+ *
+ * The producers of all virtual adapters are served, each one is entered for its frame.
+ *
+ * @param elapsed_time milliseconds passed since the last call
+ */
+    static void ManageMulticastProducers (MilliSeconds elapsed_time);
+
+/** @brief Send one T->O frame with the current data of an input assembly
+ *
+ * The frame goes out on the producing socket of the connection, with its
+ * connection id and its next sequence counts. It is timed by the produce
+ * probes of IoLatency.
+ *
+ * @param connection_manager the producing connection
+ * @param input_assembly the produced T-to-O point
+ * @return kCipStatusError if the frame could not be assembled or sent
+ */
+    static CipStatus ProduceIoFrame (CIP_ConnectionManager *connection_manager, CipUdint input_assembly);
+
     typedef struct {
         unsigned int output_assembly; /**< the O-to-T point for the connection */
         unsigned int input_assembly; /**< the T-to-O point for the connection */
         unsigned int config_assembly; /**< the config point for the connection */
-        CIP_Connection *connection_data; /**< the connection data, only one connection is allowed per O-to-T point*/
+        CIP_ConnectionManager *connection_data; /**< the connection data, only one connection is allowed per O-to-T point*/
     } ExclusiveOwnerConnection;
 
     typedef struct {
         unsigned int output_assembly; /**< the O-to-T point for the connection */
         unsigned int input_assembly; /**< the T-to-O point for the connection */
         unsigned int config_assembly; /**< the config point for the connection */
-        CIP_Connection *connection_data;//[OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH]; /*< the connection data */
+        CIP_ConnectionManager *connection_data[OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH]; /*< the connection data */
     } InputOnlyConnection;
 
     typedef struct {
         unsigned int output_assembly; /**< the O-to-T point for the connection */
         unsigned int input_assembly; /**< the T-to-O point for the connection */
         unsigned int config_assembly; /**< the config point for the connection */
-        CIP_Connection *connection_data;//[OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH]; /**< the connection data */
+        CIP_ConnectionManager *connection_data[OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH]; /**< the connection data */
     } ListenOnlyConnection;
 
 
 
 private:
 
-    static ExclusiveOwnerConnection *g_exlusive_owner_connections;
+    //one row of connection point slots and producers per virtual adapter, see NET_VirtualAdapters
+    static ExclusiveOwnerConnection g_exlusive_owner_connections[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS];
+
+    static InputOnlyConnection g_input_only_connections[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_INPUT_ONLY_CONNS];
+
+    static ListenOnlyConnection g_listen_only_connections[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_LISTEN_ONLY_CONNS];
+
+    static MulticastProducer g_multicast_producers[OPENER_VIRTUAL_ADAPTERS][OPENER_CIP_NUM_MULTICAST_PRODUCERS];
 
-    static InputOnlyConnection *g_input_only_connections;
+    static CipStatus ProduceMulticastFrame(MulticastProducer* producer);
 
-    static ListenOnlyConnection *g_listen_only_connections;
+    static void UpdateMulticastProductionInterval(MulticastProducer* producer);
 
-    static const CIP_Connection* GetExclusiveOwnerConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error);
+    /* the lookups return the free slot the connection is stored in, nullptr if there is none */
+    static CIP_ConnectionManager** GetExclusiveOwnerConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error);
 
-    static const CIP_Connection* GetInputOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error);
+    static CIP_ConnectionManager** GetInputOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error);
 
-    static const CIP_Connection* GetListenOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error);
+    static CIP_ConnectionManager** GetListenOnlyConnection(const CIP_ConnectionManager* connection_manager, CipUint* extended_error);
 };
 #endif
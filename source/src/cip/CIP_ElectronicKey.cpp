@@ -3,11 +3,50 @@
 //
 
 #include "CIP_ElectronicKey.hpp"
+#include "../opener_user_conf.hpp"
 
 CipStatus CIP_ElectronicKey::validate_key()
 {
-    //TODO: implement key validation
-    CipStatus stat;
-    stat = kCipGeneralStatusCodeSuccess;
+    CipStatus stat(kCipGeneralStatusCodeKeyFailureInPath);
+    CipUsint major_revision = (CipUsint) (data.fields_t.major_revision & 0x7F);
+    bool compatibility = (0 != (data.fields_t.major_revision & 0x80));
+
+    if (kKeyFormatTable != key_format)
+    {
+        stat.extended_status = kKeyStatusInvalidSegmentType;
+        return stat;
+    }
+
+    if ( ((0 != data.fields_t.vendor_id) && (OPENER_DEVICE_VENDOR_ID != data.fields_t.vendor_id))
+         || ((0 != data.fields_t.product_code) && (OPENER_DEVICE_PRODUCT_CODE != data.fields_t.product_code)) )
+    {
+        stat.extended_status = kKeyStatusVendorIdOrProductCodeMismatch;
+        return stat;
+    }
+
+    if ((0 != data.fields_t.device_type) && (OPENER_DEVICE_TYPE != data.fields_t.device_type))
+    {
+        stat.extended_status = kKeyStatusDeviceTypeMismatch;
+        return stat;
+    }
+
+    if (compatibility)
+    {
+        //A compatible device has the same major revision and a minor revision at least as high
+        if ( (0 == major_revision) || (OPENER_DEVICE_MAJOR_REVISION != major_revision)
+             || (OPENER_DEVICE_MINOR_REVISION < data.fields_t.minor_revision) )
+        {
+            stat.extended_status = kKeyStatusRevisionMismatch;
+            return stat;
+        }
+    }
+    else if ( ((0 != major_revision) && (OPENER_DEVICE_MAJOR_REVISION != major_revision))
+              || ((0 != data.fields_t.minor_revision) && (OPENER_DEVICE_MINOR_REVISION != data.fields_t.minor_revision)) )
+    {
+        stat.extended_status = kKeyStatusRevisionMismatch;
+        return stat;
+    }
+
+    stat.status = kCipGeneralStatusCodeSuccess;
     return stat;
 }
@@ -41,7 +41,26 @@ public:
 
     key_data_t data;
 
+    /** @brief Key format of the electronic keys supported by this device */
+    static const CipUsint kKeyFormatTable = 4;
+
+    /** @brief Extended status of a failed key check, Vol.1 3-5.6 */
+    typedef enum
+    {
+        kKeyStatusVendorIdOrProductCodeMismatch = 0x0114,
+        kKeyStatusDeviceTypeMismatch            = 0x0115,
+        kKeyStatusRevisionMismatch              = 0x0116,
+        kKeyStatusInvalidSegmentType            = 0x0315
+    } key_status_e;
+
     //Instance methods
+    /** @brief Check the key against the identity of this device
+     *
+     * Zero key values match any device. With the compatibility bit set an older
+     * minor revision of the same major revision is accepted as well.
+     * @return kCipGeneralStatusCodeSuccess, or kCipGeneralStatusCodeKeyFailureInPath
+     *      with one of key_status_e as extended status
+     */
     CipStatus validate_key();
 
 
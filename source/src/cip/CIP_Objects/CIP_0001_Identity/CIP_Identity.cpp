@@ -24,26 +24,125 @@
  * --------------------
  */
 
+#include <cstring>
 #include <cip/ciptypes.hpp>
 #include "CIP_Identity.hpp"
 
+//Static variables
+alignas(4) CipByte CIP_Identity::wire_image[kWireImageAlignment + kWireImageSize];
+int CIP_Identity::wire_image_length = 0;
 
 //Methods
 
-/** Private functions, sets the devices serial number
+/** Sets the devices serial number
  * @param serial_number The serial number of the device
  */
 void CIP_Identity::SetDeviceSerialNumber(CipUdint serial_number)
 {
-    serial_number = serial_number;
+    CIP_Identity *instance = (CIP_Identity *) GetInstance(0);
+    if (nullptr == instance)
+    {
+        return;
+    }
+    __atomic_store_n(&instance->serial_number, serial_number, __ATOMIC_RELAXED);
+    PatchWireImage(kWireImageSerialNumber, serial_number, 4);
 }
 
-/** Private functions, sets the devices status
- * @param status The serial number of the deivce
+/** Sets the devices status
+ * @param status The status of the device
  */
 void CIP_Identity::SetDeviceStatus(CipUint status)
 {
-    status = status;
+    CIP_Identity *instance = (CIP_Identity *) GetInstance(0);
+    if (nullptr == instance)
+    {
+        return;
+    }
+    __atomic_store_n(&instance->status.val, status, __ATOMIC_RELAXED);
+    PatchWireImage(kWireImageStatus, status, 2);
+}
+
+/** Stores a little endian value of 2 or 4 bytes in the wire image with one atomic write
+ */
+void CIP_Identity::PatchWireImage(int offset, CipUdint value, int size)
+{
+    CipByte encoded[4];
+    for (int i = 0; i < size; i++)
+    {
+        encoded[i] = (CipByte) (value >> (8 * i));
+    }
+
+    if (2 == size)
+    {
+        CipUint word;
+        memcpy(&word, encoded, sizeof(word));
+        __atomic_store_n((CipUint *) &wire_image[kWireImageAlignment + offset], word, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        CipUdint word;
+        memcpy(&word, encoded, sizeof(word));
+        __atomic_store_n((CipUdint *) &wire_image[kWireImageAlignment + offset], word, __ATOMIC_RELAXED);
+    }
+}
+
+void CIP_Identity::UpdateWireImage()
+{
+    const CIP_Identity *instance = GetInstance(0);
+    if (nullptr == instance)
+    {
+        return;
+    }
+
+    CipByte *image = &wire_image[kWireImageAlignment];
+    const CipUint words[3] = { instance->vendor_id, instance->device_type, instance->product_code };
+    for (int i = 0; i < 3; i++)
+    {
+        image[2 * i] = (CipByte) words[i];
+        image[2 * i + 1] = (CipByte) (words[i] >> 8);
+    }
+    image[6] = instance->revision.major_revision;
+    image[7] = instance->revision.minor_revision;
+    PatchWireImage(kWireImageStatus, __atomic_load_n(&instance->status.val, __ATOMIC_RELAXED), 2);
+    PatchWireImage(kWireImageSerialNumber, __atomic_load_n(&instance->serial_number, __ATOMIC_RELAXED), 4);
+
+    image[kWireImageProductName] = instance->product_name.length;
+    if (0 < instance->product_name.length)
+    {
+        memcpy(&image[kWireImageProductName + 1], instance->product_name.string, instance->product_name.length);
+    }
+    wire_image_length = kWireImageProductName + 1 + instance->product_name.length;
+    image[wire_image_length] = instance->state;
+}
+
+int CIP_Identity::CopyWireImage(CipByte *buffer, bool with_state)
+{
+    const CipByte *image = &wire_image[kWireImageAlignment];
+
+    //the status and the serial number are loaded as a whole, they may be written by another thread meanwhile
+    memcpy(buffer, image, kWireImageStatus);
+    CipUint status = __atomic_load_n((const CipUint *) &image[kWireImageStatus], __ATOMIC_RELAXED);
+    CipUdint serial_number = __atomic_load_n((const CipUdint *) &image[kWireImageSerialNumber], __ATOMIC_RELAXED);
+    memcpy(&buffer[kWireImageStatus], &status, sizeof(status));
+    memcpy(&buffer[kWireImageSerialNumber], &serial_number, sizeof(serial_number));
+    memcpy(&buffer[kWireImageProductName], &image[kWireImageProductName],
+           (size_t) (wire_image_length - kWireImageProductName + (with_state ? 1 : 0)));
+
+    return wire_image_length + (with_state ? 1 : 0);
+}
+
+/** Get_Attribute_All of the attributes 1 to 7, copied from the wire image
+ */
+CipStatus CIP_Identity::GetAttributeAllIdentity(CipMessageRouterRequest_t* message_router_request,
+                                                CipMessageRouterResponse_t* message_router_response)
+{
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->size_additional_status = 0;
+    message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+    message_router_response->response_data.resize((size_t) wire_image_length);
+    CopyWireImage(message_router_response->response_data.data(), false);
+    return kCipGeneralStatusCodeSuccess;
 }
 
 /** Reset service
@@ -130,6 +229,18 @@ CipStatus CIP_Identity::Init() {
 
         instance->revision = identityRevision_t {1, 0};
 
+        //the device the stack runs as, the application may change it before the network is started
+        instance->vendor_id     = OPENER_DEVICE_VENDOR_ID;
+        instance->device_type   = OPENER_DEVICE_TYPE;
+        instance->product_code  = OPENER_DEVICE_PRODUCT_CODE;
+        instance->status.val    = 0;
+        instance->serial_number = 0;
+        instance->product_name  = {sizeof(OPENER_DEVICE_NAME) - 1, (CipByte *) OPENER_DEVICE_NAME};
+        instance->state         = 0xFF;
+        UpdateWireImage();
+
+        instance->classServicesProperties.emplace(kServiceGetAttributeAll, CipServiceProperties_t{ "GetAttributeAll" });
+
         instAttrInfo.emplace(1, CipAttrInfo_t{kCipUint, SZ(CipUint), kAttrFlagGetableSingleAndAll, "vendor_id"});
         instAttrInfo.emplace(2, CipAttrInfo_t{kCipUint, SZ(CipUint), kAttrFlagGetableSingleAndAll, "device_type"});
         instAttrInfo.emplace(3, CipAttrInfo_t{kCipUint, SZ(CipUint), kAttrFlagGetableSingleAndAll, "product_code"});
@@ -212,6 +323,10 @@ void * CIP_Identity::retrieveAttribute(CipUsint attributeNumber)
 CipStatus CIP_Identity::retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
 {
 	CipStatus stat;
+	if ((this->id == 0) && (kServiceGetAttributeAll == serviceNumber))
+	{
+		return this->GetAttributeAllIdentity(req, resp);
+	}
 	stat.status = kCipGeneralStatusCodeServiceNotSupported;
 	return stat;
 }
\ No newline at end of file
@@ -89,20 +89,65 @@ private:
 
 
 
+    /** @brief Offsets in the wire image, the status and the serial number are patched in place */
+    enum
+    {
+        kWireImageStatus       = 8,
+        kWireImageSerialNumber = 10,
+        kWireImageProductName  = 14,
+        kWireImageSize         = 14 + 1 + 255 + 1
+    };
+
+    /** @brief Leading bytes of wire_image, so that the status lands on an even and the serial number on a
+     * multiple of four address and both can be stored with single atomic writes
+     */
+    static const int kWireImageAlignment = 2;
+
+    alignas(4) static CipByte wire_image[kWireImageAlignment + kWireImageSize];
+    static int wire_image_length; /**< without the state */
+
+    static void PatchWireImage(int offset, CipUdint value, int size);
+    CipStatus GetAttributeAllIdentity(CipMessageRouterRequest_t* message_router_request,
+                                      CipMessageRouterResponse_t* message_router_response);
+
     void * retrieveAttribute(CipUsint attributeNumber);
     CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
 public:
     CipStatus Reset(CipMessageRouterRequest_t* message_router_request, CipMessageRouterResponse_t* message_router_response);
+
+    /** @brief Set the status of the device, may be called from any thread
+     *
+     * The attribute and the wire image are written with single atomic stores,
+     * a ListIdentity or Get_Attribute_All served by the I/O thread sees the new
+     * value from then on without any lock.
+     */
     static void SetDeviceStatus(CipUint status);
+
+    /** @brief Set the serial number of the device, may be called from any thread, see SetDeviceStatus */
     static void SetDeviceSerialNumber(CipUdint serial_number);
 
+    /** @brief Encode the wire image of the attributes 1 to 8 again
+     *
+     * The image is the body of the ListIdentity item after the socket address
+     * and, without the state, the data of the Get_Attribute_All reply. It has
+     * to be updated by the control thread after the vendor, device type,
+     * product code, revision, product name or state have been changed.
+     */
+    static void UpdateWireImage();
+
+    /** @brief Copy the wire image to a message, the state is appended if with_state
+     *
+     * @return number of bytes copied
+     */
+    static int CopyWireImage(CipByte* buffer, bool with_state);
+
     // Object instance attributes 1 to 18
     CipUint            vendor_id;
     CipUint            device_type;
     CipUint            product_code;
     identityRevision_t revision;
     identityStatus_t   status;
-    CipUint            serial_number;
+    CipUdint           serial_number;
     CipShortString     product_name;
     CipUsint           state;
     CipUint            configurationConsistencyVal;
@@ -3,8 +3,90 @@
 //
 
 #include "TEST_Cip_Identity.hpp"
+#include "OpENer_Interface.hpp"
 
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <thread>
+
+static CipUdint read_dint(const CipByte * buffer)
+{
+    return (CipUdint) buffer[0] | ((CipUdint) buffer[1] << 8) | ((CipUdint) buffer[2] << 16) | ((CipUdint) buffer[3] << 24);
+}
+
+// The wire image follows the attributes, the status and serial number set are patched in
+bool test_wire_image(CIP_Identity * identity)
+{
+    CipByte image[300];
+
+    CIP_Identity::SetDeviceStatus(0x0034);
+    CIP_Identity::SetDeviceSerialNumber(0x12345678);
+    int length = CIP_Identity::CopyWireImage(image, true);
+
+    if ((length != 14 + 1 + identity->product_name.length + 1) || (OPENER_DEVICE_VENDOR_ID != (image[0] | (image[1] << 8)))
+        || (0x34 != image[8]) || (0x00 != image[9]) || (0x12345678 != read_dint(&image[10]))
+        || (identity->product_name.length != image[14])
+        || (0 != memcmp(&image[15], identity->product_name.string, identity->product_name.length))
+        || (0xFF != image[length - 1]))
+        return false;
+
+    //Get_Attribute_All returns the same, without the state
+    CipMessageRouterRequest_t req{};
+    CipMessageRouterResponse_t resp{};
+    req.service = kServiceGetAttributeAll;
+    identity->InstanceServices(kServiceGetAttributeAll, &req, &resp);
+    return (kCipGeneralStatusCodeSuccess == resp.general_status) && (resp.response_data.size() == (size_t) (length - 1))
+           && (0 == memcmp(resp.response_data.data(), image, resp.response_data.size()))
+           && (0x12345678 == identity->serial_number) && (0x0034 == identity->status.val);
+}
+
+// The application interface sets the status and serial number of the Identity
+bool test_application_interface(CIP_Identity * identity)
+{
+    OpENer_Interface::SetDeviceStatus(0x0031);
+    OpENer_Interface::SetDeviceSerialNumber(0xCAFEF00D);
+    return (0xCAFEF00D == identity->serial_number) && (0x0031 == identity->status.val);
+}
+
+// An application thread changing the status and serial number is never seen half written
+bool test_concurrent_status()
+{
+    CIP_Identity::SetDeviceStatus(0x0000);
+    CIP_Identity::SetDeviceSerialNumber(0x00000000);
+
+    std::atomic<bool> running(true);
+    std::atomic<bool> started(false);
+    std::thread application([&running, &started]() {
+        started = true;
+        for (CipUdint i = 0; running; i++)
+        {
+            CIP_Identity::SetDeviceStatus((i & 1) ? 0xFFFF : 0x0000);
+            CIP_Identity::SetDeviceSerialNumber((i & 1) ? 0xFFFFFFFF : 0x00000000);
+        }
+    });
+
+    CipByte image[300];
+    int changes = 0;
+    bool torn = false;
+    CipUdint last_serial = 0;
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+    for (int i = 0; (i < 20000000) && (changes < 1000) && !torn; i++)
+    {
+        CIP_Identity::CopyWireImage(image, false);
+        CipUdint serial = read_dint(&image[10]);
+        torn = ((image[8] != image[9]) || ((0x00000000 != serial) && (0xFFFFFFFF != serial)));
+        changes += (serial != last_serial) ? 1 : 0;
+        last_serial = serial;
+    }
+    running = false;
+    application.join();
+
+    return !torn;
+}
 
 int main()
 {
@@ -16,10 +98,20 @@ int main()
 		identity_instance->product_code = 0;
 
 		std::cout << "prodcode " << identity_instance->product_code << " " << std::endl;
+
+		if ( !test_wire_image(identity_instance) )
+			return -1;
+
+		if ( !test_application_interface(identity_instance) )
+			return -1;
+
+		if ( !test_concurrent_status() )
+			return -1;
+
 		CIP_Identity::Shut();
 
 		return 0;
 	}
 	else
 		return -1;
-}
\ No newline at end of file
+}
@@ -11,16 +11,15 @@
 #include "../../CIP_Segment.hpp"
 #include "../../CIP_ElectronicKey.hpp"
 #include "CIP_MessageRouter.hpp"
+#include "../CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "../../../opener_user_conf.hpp"
 
-#define ROUTER_MESSAGE_BUFFER_SIZE 100
 #include <typeinfo>
 #include <CIP_Objects/CIP_Object.hpp>
 
 
-CipMessageRouterRequest_t        CIP_MessageRouter::g_message_router_request;
-CipMessageRouterResponse_t       CIP_MessageRouter::g_message_router_response;
-std::vector<CipUsint>            CIP_MessageRouter::g_message_data_reply_buffer;
 std::map<CipUdint, CIP_Object_generic*>  CIP_MessageRouter::message_router_registered_classes;
+std::set<CipUdint> CIP_MessageRouter::thread_safe_classes;
 
 //Methods
 CIP_MessageRouter::CIP_MessageRouter()
@@ -39,9 +38,6 @@ CipStatus CIP_MessageRouter::Init()
 
     if (number_of_instances == 0)
     {
-        //Init static variables
-        g_message_data_reply_buffer.reserve (ROUTER_MESSAGE_BUFFER_SIZE);
-
         //Build class instance
         max_instances = 1;
         revision = 1;
@@ -61,12 +57,6 @@ CipStatus CIP_MessageRouter::Init()
         //instAttrInfo.emplace(4 , CipAttrInfo_t{kCipUsint , SZ(CipUintArray), kAttrFlagGetableSingleAndAll, "Active Connections"});
 
 
-        /* reserved for future use -> set to zero */
-        g_message_router_response.reserved = 0;
-
-        // set reply buffer, using a fixed buffer (about 100 bytes)
-        g_message_router_response.response_data = g_message_data_reply_buffer;
-
         stat.status = kCipStatusOk;
     }
     else
@@ -98,7 +88,7 @@ CIP_Object_generic * CIP_MessageRouter::GetRegisteredObject(CipUdint class_id)
         return message_router_registered_classes[class_id];
 }
 
-CipStatus CIP_MessageRouter::RegisterCIPClass(void* CIP_ClassInstance, CipUdint classId)
+CipStatus CIP_MessageRouter::RegisterCIPClass(void* CIP_ClassInstance, CipUdint classId, bool thread_safe)
 {
     CipStatus stat;
     auto ret = message_router_registered_classes.find(classId);
@@ -107,6 +97,10 @@ CipStatus CIP_MessageRouter::RegisterCIPClass(void* CIP_ClassInstance, CipUdint
     {
 
         message_router_registered_classes.emplace(classId, (CIP_Object_generic*)CIP_ClassInstance);
+        if (thread_safe)
+        {
+            thread_safe_classes.insert(classId);
+        }
         stat.status = kCipStatusOk;
     }
     else
@@ -117,66 +111,110 @@ CipStatus CIP_MessageRouter::RegisterCIPClass(void* CIP_ClassInstance, CipUdint
 
 }
 
-CipStatus CIP_MessageRouter::NotifyMR(CipUsint* data, int data_length)
+CipStatus CIP_MessageRouter::NotifyMR(CIP_RequestContext* context, CipUsint* data, int data_length)
 {
     CipStatus cip_status = kCipGeneralStatusCodeSuccess;
     CipStatus nStatus;
+    CipMessageRouterRequest_t & message_router_request = context->request;
+    CipMessageRouterResponse_t & message_router_response = context->response;
 
-    g_message_router_response.response_data = g_message_data_reply_buffer; /* set reply buffer, using a fixed buffer (about 100 bytes) */
+    /* the reply buffer keeps its capacity from request to request */
+    message_router_response.response_data.clear();
+    message_router_response.size_additional_status = 0;
+    /* the services find the session and the originator of the request here */
+    message_router_request.context = context;
 
     OPENER_TRACE_INFO("notifyMR: routing unconnected message\n");
     /* error from create MR structure*/
-    nStatus = CreateMessageRouterRequestStructure(data, (CipInt) data_length, &g_message_router_request);
+    nStatus = CreateMessageRouterRequestStructure(data, (CipInt) data_length, &message_router_request);
 
     if ( kCipGeneralStatusCodeSuccess != nStatus.status )
     {
         OPENER_TRACE_ERR("notifyMR: error from createMRRequeststructure\n");
 
-        g_message_router_response.general_status = nStatus.status;
-        g_message_router_response.size_additional_status = 0;
-        g_message_router_response.reserved = 0;
-        //g_message_router_response->data_length = 0;
-        g_message_router_response.reply_service = (CipUsint) (0x80 | g_message_router_request.service);
+        message_router_response.general_status = nStatus.status;
+        message_router_response.size_additional_status = 0;
+        message_router_response.reserved = 0;
+        //message_router_response.data_length = 0;
+        message_router_response.reply_service = (CipUsint) (0x80 | message_router_request.service);
     }
     else
     {
         /* forward request to appropriate Object if it is registered*/
-        CIP_Object_generic * registered_object = GetRegisteredObject(g_message_router_request.request_path.class_id);
+        CIP_Object_generic * registered_object = GetRegisteredObject(message_router_request.request_path.class_id);
         if (registered_object == nullptr)
         {
             OPENER_TRACE_ERR(
                 "notifyMR: sending CIP_ERROR_OBJECT_DOES_NOT_EXIST reply, class id 0x%x is not registered\n",
-                (unsigned)g_message_router_request.request_path.class_id);
+                (unsigned)message_router_request.request_path.class_id);
 
-            g_message_router_response.general_status = kCipGeneralStatusCodePathDestinationUnknown; /*according to the test tool this should be the correct error flag instead of CIP_ERROR_OBJECT_DOES_NOT_EXIST;*/
-            g_message_router_response.size_additional_status = 0;
-            g_message_router_response.reserved = 0;
-            //g_message_router_response->data_length = 0;
-            g_message_router_response.reply_service = (CipUsint)(0x80 | g_message_router_request.service);
+            message_router_response.general_status = kCipGeneralStatusCodePathDestinationUnknown; /*according to the test tool this should be the correct error flag instead of CIP_ERROR_OBJECT_DOES_NOT_EXIST;*/
+            message_router_response.size_additional_status = 0;
+            message_router_response.reserved = 0;
+            //message_router_response.data_length = 0;
+            message_router_response.reply_service = (CipUsint)(0x80 | message_router_request.service);
         }
         else
         {
             /* call notify function from Object with ClassID (gMRRequest.RequestPath.ClassID)
             object will or will not make an reply into gMRResponse*/
-            g_message_router_response.reserved = 0;
+            message_router_response.reserved = 0;
             //OPENER_ASSERT(nullptr != registered_object->CIP_ClassInstance);
 
-            OPENER_TRACE_INFO("notifyMR: calling notify function of class '%s'\n",
-                registered_object->CIP_ClassInstance->class_name);
+            OPENER_TRACE_INFO("notifyMR: calling notify function of class 0x%x\n",
+                (unsigned)message_router_request.request_path.class_id);
+
+            message_router_response.reply_service = (CipUsint) (0x80 | message_router_request.service);
+            message_router_response.general_status = kCipGeneralStatusCodeSuccess;
 
-            //todo:cip_status = NotifyClass(registered_object->CIP_ClassInstance, &g_message_router_request, &g_message_router_response);
+            auto *instance = (CIP_Object_generic*)registered_object->glue.GetInstance(
+                message_router_request.request_path.instance_number);
+            /* objects with a single instance are implemented by their class instance, it serves instance 1 */
+            if ((nullptr == instance) && (1 == message_router_request.request_path.instance_number)
+                && (1 == registered_object->glue.GetNumberOfInstances()))
+            {
+                instance = registered_object;
+            }
+
+            if (nullptr == instance)
+            {
+                OPENER_TRACE_ERR("notifyMR: instance %u of class 0x%x does not exist\n",
+                    (unsigned)message_router_request.request_path.instance_number,
+                    (unsigned)message_router_request.request_path.class_id);
+                message_router_response.general_status = kCipGeneralStatusCodeObjectDoesNotExist;
+                nStatus = CipStatus(kCipGeneralStatusCodeObjectDoesNotExist);
+            }
+            else
+            {
+                /* the explicit message workers may execute services concurrently */
+                bool serialized = 0 == thread_safe_classes.count(message_router_request.request_path.class_id);
+                if (serialized)
+                {
+                    CIP_ConnectionManager::Lock();
+                }
+                nStatus = instance->glue.retrieveService(message_router_request.service,
+                                                         &message_router_request, &message_router_response);
+                if (serialized)
+                {
+                    CIP_ConnectionManager::Unlock();
+                }
+                if (kCipGeneralStatusCodeServiceNotSupported == nStatus.status)
+                {
+                    message_router_response.general_status = kCipGeneralStatusCodeServiceNotSupported;
+                }
+            }
 
 #ifdef OPENER_TRACE_ENABLED
-            switch(cip_status)
+            switch(nStatus.status)
             {
                 case (kCipStatusError):
-                    OPENER_TRACE_ERR("notifyMR: notify function of class '%s' returned an error\n", registered_object->CIP_ClassInstance->class_name);
+                    OPENER_TRACE_ERR("notifyMR: notify function of class 0x%x returned an error\n", (unsigned)message_router_request.request_path.class_id);
                     break;
                 case (kCipGeneralStatusCodeSuccess):
-                    OPENER_TRACE_INFO("notifyMR: notify function of class '%s' returned no reply\n", registered_object->CIP_ClassInstance->class_name);
+                    OPENER_TRACE_INFO("notifyMR: notify function of class 0x%x returned no reply\n", (unsigned)message_router_request.request_path.class_id);
                     break;
                 default:
-                    OPENER_TRACE_INFO("notifyMR: notify function of class '%s' returned a reply\n", registered_object->CIP_ClassInstance->class_name);
+                    OPENER_TRACE_INFO("notifyMR: notify function of class 0x%x returned a reply\n", (unsigned)message_router_request.request_path.class_id);
             }
 #endif
         }
@@ -199,13 +237,12 @@ CipStatus CIP_MessageRouter::CreateMessageRouterRequestStructure(CipUsint* data,
         return kCipGeneralStatusCodePathSegmentError;
     }
 
-    message_router_request->request_data.emplace (message_router_request->request_data.begin(), *data);
-    //message_router_request->data_length = (CipInt) (data_length - number_of_decoded_bytes);
-
-    if (message_router_request->request_data.size() - number_of_decoded_bytes < 0)
+    if (data_length < number_of_decoded_bytes)
         return kCipGeneralStatusCodePathSizeInvalid;
-    else
-        return kCipGeneralStatusCodeSuccess;
+
+    /* the request data follows the path */
+    message_router_request->request_data.assign(data + number_of_decoded_bytes, data + data_length);
+    return kCipGeneralStatusCodeSuccess;
 }
 
 void CIP_MessageRouter::DeleteAllClasses()
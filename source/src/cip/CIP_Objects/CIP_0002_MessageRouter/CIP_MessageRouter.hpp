@@ -10,7 +10,9 @@
 #include "../../ciptypes.hpp"
 #include "../template/CIP_Object_template.hpp"
 #include "../CIP_Object.hpp"
+#include "../../connection/CIP_RequestContext.hpp"
 #include <map>
+#include <set>
 
 
 /** @brief Structure for storing the Response generated by an explict message.
@@ -31,10 +33,6 @@ class CIP_MessageRouter : public CIP_Object_template<CIP_MessageRouter>
            kCipSymbolicPathSegmentError           = 2 //syntax can't be understood by the node
         } CipSymbolicPath_e;
 
-        static CipMessageRouterRequest_t  g_message_router_request;
-        static CipMessageRouterResponse_t g_message_router_response;
-
-        static std::vector<CipUsint> g_message_data_reply_buffer;
         /** @brief Initialize the data structures of the message router
          *  @return kCipGeneralStatusCodeSuccess if class was initialized, otherwise kCipStatusError
          */
@@ -58,6 +56,14 @@ class CIP_MessageRouter : public CIP_Object_template<CIP_MessageRouter>
          */
         static std::map<CipUdint, CIP_Object_generic*> message_router_registered_classes;
 
+        /** @brief Classes whose services may be executed by several threads at a time
+         *
+         * The services of any other class are executed with
+         * CIP_ConnectionManager::Lock held, so the explicit message workers, the
+         * class 3 connections and the I/O shards never run them concurrently.
+         */
+        static std::set<CipUdint> thread_safe_classes;
+
 
         /*! Register a class at the message router.
          *  In order that the message router can deliver
@@ -69,10 +75,11 @@ class CIP_MessageRouter : public CIP_Object_template<CIP_MessageRouter>
          */
         /** @brief Register an Class to the message router
          *  @param CIP_ClassInstance Pointer to a class object to be registered.
+         *  @param thread_safe true if the class takes care of concurrent services by itself
          *  @return status      0 .. success
          *                     -1 .. error no memory available to register more objects
          */
-        static CipStatus RegisterCIPClass(void * CIP_ClassInstance, CipUdint classId);
+        static CipStatus RegisterCIPClass(void * CIP_ClassInstance, CipUdint classId, bool thread_safe = false);
 
 
         /** @brief Get the registered MessageRouter object corresponding to ClassID.
@@ -99,14 +106,14 @@ class CIP_MessageRouter : public CIP_Object_template<CIP_MessageRouter>
 
         /** @brief Notify the MessageRouter that an explicit message (connected or unconnected)
          *  has been received. This function will be called from the encapsulation layer.
-         *  The CPF structure is already parsed an can be accessed via the global variable:
-         *  g_stCPFDataItem.
+         *  The CPF structure is already parsed into the context of the message.
+         *  @param context the message being handled, the request is parsed into it and the response built there
          *  @param data pointer to the data buffer of the message directly at the beginning of the CIP part.
          *  @param data_length number of bytes in the data buffer
          *  @return  EIP_ERROR on fault
          *           EIP_OK on success
          */
-        static CipStatus NotifyMR(CipUsint* data, int data_length);
+        static CipStatus NotifyMR(CIP_RequestContext* context, CipUsint* data, int data_length);
 
 
         /** @brief Free all data allocated by the classes created in the CIP stack
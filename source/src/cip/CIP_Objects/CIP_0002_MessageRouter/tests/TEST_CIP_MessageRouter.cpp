@@ -5,6 +5,7 @@
 #include "TEST_CIP_MessageRouter.h"
 #include <iostream>
 #include <ciptypes.hpp>
+#include "cip/connection/CIP_RequestContext.hpp"
 
 int main()
 {
@@ -38,12 +39,31 @@ int main()
     CipMessageRouterResponse_t resp{};
     CipStatus stat{};
 
-    stat = registered_class_ptr->glue.retrieveService(1,&req,&resp);
+    req.service = kServiceGetAttributeAll;
+    stat = registered_class_ptr->glue.retrieveService(kServiceGetAttributeAll,&req,&resp);
 
-    //Exit of registered service call failed
+    //Exit of registered service call failed, the Identity answers Get_Attribute_All from its wire image
+    if ((stat.status != kCipGeneralStatusCodeSuccess) || (resp.general_status != kCipGeneralStatusCodeSuccess)
+        || resp.response_data.empty())
+        exit(-1);
+
+    //Exit if a service the Identity does not have is not refused
+    stat = registered_class_ptr->glue.retrieveService(kServiceSetAttributeAll,&req,&resp);
     if (stat.status != kCipGeneralStatusCodeServiceNotSupported)
         exit(-1);
 
+    //Requests are routed to the addressed instance, the Identity's instance 1 is its class instance
+    CIP_RequestContext context;
+    CipUsint get_attribute_all[] = { kServiceGetAttributeAll, 0x02, 0x20, 0x01, 0x24, 0x01 };
+    CIP_MessageRouter::NotifyMR(&context, get_attribute_all, sizeof(get_attribute_all));
+    if ((context.response.general_status != kCipGeneralStatusCodeSuccess) || context.response.response_data.empty())
+        exit(-1);
+
+    get_attribute_all[5] = 2;
+    CIP_MessageRouter::NotifyMR(&context, get_attribute_all, sizeof(get_attribute_all));
+    if (context.response.general_status != kCipGeneralStatusCodeObjectDoesNotExist)
+        exit(-1);
+
     //Try to shutdown registered class
     //todo: implement glue to registered_class_ptr->Shut();
 
@@ -54,7 +54,7 @@ CipStatus CIP_DeviceNET_Link::Init()
         //DeviceNet Object Service - GetAttributeSingle
 		//class_ptr->InsertService(kServiceGetAttributeSingle,    &GetAttributeSingleDeviceNetInterface, "GetAttributeSingleDeviceNetInterface");
         //service code 0E
-		object_Set.emplace(0, class_ptr);
+		AddClassInstance(class_ptr, 0);
 
         //DeviceNet instance attributes
 		class_ptr->instAttrInfo.emplace( 1, CipAttrInfo_t{kCipUsint, sizeof(CipUsint), kAttrFlagSetAndGetAble, "mac_id"   }); // bind attributes to the instance
@@ -91,7 +91,7 @@ CipStatus CIP_DeviceNET_Link::Init()
         //Reserved (5xUINT)
 
         //Active Node Table (ARRAY'o'bool)
-		object_Set.emplace(class_ptr->id, class_ptr);
+		AddClassInstance(class_ptr, class_ptr->id);
     }
 	return kCipGeneralStatusCodeSuccess;
 }
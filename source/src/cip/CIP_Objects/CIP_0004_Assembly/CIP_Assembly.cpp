@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include "CIP_Assembly.hpp"
 #include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "utils/iolatency.hpp"
 
 // create the CIP Assembly object with zero instances
 CipStatus CIP_Assembly::Init(void)
@@ -18,10 +19,11 @@ CipStatus CIP_Assembly::Init(void)
         class_id = kCipAssemblyClassCode;
         class_name = "Assembly";
         revision = 0;
+        max_instances = 1 + OPENER_CIP_NUM_ASSEMBLIES;
 
         CIP_Assembly *instance = new CIP_Assembly();
 
-        object_Set.emplace(object_Set.size(), instance);
+        AddClassInstance(instance, 0);
 
         instance->classAttrInfo.emplace(3, CipAttrInfo_t{kCipByteArray, sizeof(CipByteArray), kAttrFlagGetableSingle, "AssemblyByteArray"});
 
@@ -55,25 +57,34 @@ CipStatus CIP_Assembly::Create(CipByte* data, CipUint data_length)
 
     instance->assemblyByteArray.length = data_length;
     instance->assemblyByteArray.data   = data;
+    AddClassInstance(instance, instance->id);
 
 	return stat;
 }
 
-CipStatus CIP_Assembly::NotifyAssemblyConnectedDataReceived(CipUsint* data, CipUint data_length)
+const CipByteArray* CIP_Assembly::GetAssemblyData() const
 {
-	CipByteArray* assemblyByteArray = nullptr;;
+    return &assemblyByteArray;
+}
 
+void CIP_Assembly::SetAssemblyData(CipByte* data)
+{
+    assemblyByteArray.data = data;
+}
+
+CipStatus CIP_Assembly::NotifyAssemblyConnectedDataReceived(CipUsint* data, CipUint data_length) const
+{
     /* empty path (path size = 0) need to be checked and taken care of in future */
     /* copy received data to Attribute 3 */
-    //assemblyByteArray = (decltype (assemblyByteArray))(this->attributes[2]->getData());
-    if (assemblyByteArray->length != data_length)
+    if (assemblyByteArray.length != data_length)
     {
         OPENER_TRACE_ERR("wrong amount of data arrived for assembly object\n");
         return kCipStatusError; /*TODO question should we notify the application that wrong data has been recieved???*/
     }
     else
     {
-        memcpy(assemblyByteArray->data, data, data_length);
+        memcpy(assemblyByteArray.data, data, data_length);
+        IoLatency::RecordConsumed();
         /* call the application that new data arrived */
     }
 
@@ -43,7 +43,17 @@ public:
 		 *     - EIP_OK the received data was okay
 		 *     - EIP_ERROR the received data was wrong
 		 */
-		CipStatus NotifyAssemblyConnectedDataReceived(CipUsint* data, CipUint data_length);
+		CipStatus NotifyAssemblyConnectedDataReceived(CipUsint* data, CipUint data_length) const;
+
+		/** @brief Get the data of an Assembly object (attribute 3)
+		 *
+		 *  Used by producing I/O connections to encode the assembly data into the produced frame.
+		 *  @return pointer to the byte array holding the assembly data
+		 */
+		const CipByteArray* GetAssemblyData() const;
+
+		/** @brief Point attribute 3 at other data of the same length, see NET_VirtualAdapters::Enter */
+		void SetAssemblyData(CipByte* data);
 
 	private:
 		CipByteArray assemblyByteArray;
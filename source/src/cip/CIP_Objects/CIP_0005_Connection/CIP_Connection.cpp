@@ -9,6 +9,10 @@
 #include <cip/ciptypes.hpp>
 #include "CIP_Connection.hpp"
 
+//Static variables
+CIP_Connection * CIP_Connection::free_connections[CIP_CONNECTION_POOL_SIZE];
+CipUint CIP_Connection::number_of_free_connections = 0;
+
 CipStatus CIP_Connection::Init()
 {
     if (number_of_instances == 0)
@@ -16,7 +20,7 @@ CipStatus CIP_Connection::Init()
         class_id = kCipConnectionClassCode;
         class_name = "Connection";
         revision = 1;
-        max_instances = 10;
+        max_instances = 1 + CIP_CONNECTION_POOL_SIZE;
 
         RegisterGenericClassAttributes();
         //Chapter 5 vol 5
@@ -26,8 +30,24 @@ CipStatus CIP_Connection::Init()
 
 
         CIP_Connection *instance = new CIP_Connection();
+        instance->netConn = nullptr;
+        instance->ClearAttributes();
         AddClassInstance(instance,0);
 
+        //Allocate the whole pool up front, instances stay registered for their lifetime
+        //and are free while in the non existent state. The free list is a stack
+        //with the lowest instance number on top.
+        for (CipUint i = 0; i < CIP_CONNECTION_POOL_SIZE; i++)
+        {
+            instance = new CIP_Connection();
+            instance->netConn = new NET_Connection();
+            instance->Connection_binding_list.connections_list.reserve(MAX_BOUND_CONN);
+            instance->ClearAttributes();
+            AddClassInstance(instance, instance->id);
+            free_connections[CIP_CONNECTION_POOL_SIZE - 1 - i] = instance;
+        }
+        number_of_free_connections = CIP_CONNECTION_POOL_SIZE;
+
 		//Setup instances attributes
 		//Chapter 3-4.4 vol 1
 		instAttrInfo.emplace( 1, CipAttrInfo_t{ kCipUsint, sizeof( CipUsint), kAttrFlagGetableSingleAndAll, "State"                                 });
@@ -64,22 +84,80 @@ CipStatus CIP_Connection::Init()
     }
     return kCipGeneralStatusCodeSuccess;
 }
+CIP_Connection * CIP_Connection::AllocateConnection()
+{
+    if (0 == number_of_free_connections)
+    {
+        OPENER_TRACE_WARN("connection: all %d connection objects are in use\n", CIP_CONNECTION_POOL_SIZE);
+        return nullptr;
+    }
+
+    CIP_Connection * connection = free_connections[--number_of_free_connections];
+    connection->ClearAttributes();
+    connection->State = kConnectionStateConfiguring;
+    return connection;
+}
+
+void CIP_Connection::ReleaseConnection(CIP_Connection * connection)
+{
+    if ((nullptr == connection) || (0 == connection->id) || (kConnectionStateNonExistent == connection->State))
+    {
+        return;
+    }
+
+    if (nullptr != connection->netConn)
+    {
+        connection->netConn->CloseSocket();
+        connection->netConn->remote_address = nullptr;
+        connection->netConn->originator_address = nullptr;
+    }
+    connection->ClearAttributes();
+    free_connections[number_of_free_connections++] = connection;
+}
+
+CipUint CIP_Connection::GetNumberOfFreeConnections()
+{
+    return number_of_free_connections;
+}
+
+void CIP_Connection::ClearAttributes()
+{
+    State = kConnectionStateNonExistent;
+    Instance_type = kConnectionTypeExplicit;
+    TransportClass_trigger.val = 0;
+    DeviceNet_produced_connection_id = 0;
+    DeviceNet_consumed_connection_id = 0;
+    DeviceNet_initial_comm_characteristics = 0;
+    Produced_connection_size = 0;
+    Consumed_connection_size = 0;
+    Expected_packet_rate = 0;
+    CIP_produced_connection_id = 0;
+    CIP_consumed_connection_id = 0;
+    Watchdog_timeout_action = kWatchdogTimeoutActionAutoDelete;
+    Produced_connection_path_length = 0;
+    Produced_connection_path = CipEpath();
+    Consumed_connection_path_length = 0;
+    Consumed_connection_path = CipEpath();
+    Production_inhibit_time = 0;
+    Connection_timeout_multiplier = 0;
+    Connection_binding_list.num_connections = 0;
+    Connection_binding_list.connections_list.clear();
+    Link_consumer = nullptr;
+    Link_producer = nullptr;
+    Fragmentation.Close();
+}
+
 //Class services
 CipStatus CIP_Connection::Create(CipMessageRouterRequest_t* message_router_request,
                                  CipMessageRouterResponse_t* message_router_response)
 {
     CipStatus stat;
-    CIP_Connection *instance;
-    try
-    {
-         instance = new CIP_Connection();
-    }
-    catch (const std::range_error& error)
+    CIP_Connection *instance = AllocateConnection();
+    if (nullptr == instance)
     {
-        stat.status = kCipStatusError;
+        stat.status = kCipGeneralStatusCodeResourceUnavailable;
         return stat;
     }
-    AddClassInstance(instance,-1);
     stat.status = kCipStatusOk;
     stat.extended_status = (CipUsint) instance->id;
     return stat;
@@ -97,17 +175,17 @@ CipStatus CIP_Connection::Delete(CipMessageRouterRequest_t* message_router_reque
 {
     if (this->id == 0)
     {
-        //If class, close and delete all connections other than the class instance
-        for (int i = 1; i < object_Set.size(); i++)
+        //If class, close all connections other than the class instance, highest
+        //instance first so the pool hands out the lowest instance number next
+        for (CipUdint i = (CipUdint) object_Set.size() - 1; i > 0; i--)
         {
-            delete object_Set[i];
-            object_Set.erase(i);
+            ReleaseConnection((CIP_Connection*)object_Set[i]);
         }
     }
     else
     {
-        //If instance, kill itself
-        delete this;
+        //If instance, return itself to the pool
+        ReleaseConnection(this);
     }
 	CipStatus stat;
 	return stat;
@@ -170,7 +248,8 @@ CipStatus CIP_Connection::Bind(CipMessageRouterRequest_t* message_router_request
     conn0 = (CIP_Connection*)GetInstance(bindArgs->bound_instances[0]);
     conn1 = (CIP_Connection*)GetInstance(bindArgs->bound_instances[1]);
 
-    if ( (conn0 == nullptr) | (conn1 == nullptr))
+    if ( (conn0 == nullptr) | (conn1 == nullptr)
+         || (conn0->State == kConnectionStateNonExistent) | (conn1->State == kConnectionStateNonExistent) )
     {
         //One or both connections don't exist
         status.extended_status = 0x01;
@@ -317,7 +396,6 @@ CipStatus CIP_Connection::Behaviour()
             {
                 case kConnectionTriggerDirectionServer:
                     //todo: fix placeholders
-                    CipByte * last_msg_ptr, *recv_data_ptr, recv_data_len;
                     CipNotification notification;
                     switch (TransportClass_trigger.bitfield_u.transport_class)
                     {
@@ -330,8 +408,9 @@ CipStatus CIP_Connection::Behaviour()
                             //Link_consumer consumes a message, check for duplicates (based on last received sequence count,
                             // notifying the application if dupe happened(and dropping the message), or if the message was received
 
+                            //duplicates never get here, CIP_ConnectionManager::HandleReceivedConnectedData drops them
                             Link_consumer->Receive ();
-                            check_for_duplicate(last_msg_ptr, recv_data_ptr) ? notification = kCipNotificationDuplicate : notification = kCipNotificationReceived;
+                            notification = kCipNotificationReceived;
                             CIP_MessageRouter::notify_application(Consumed_connection_path, Consumed_connection_path_length, &notification);
 
                             //todo: implement class 1 server behaviour
@@ -356,7 +435,6 @@ CipStatus CIP_Connection::Behaviour()
                             // tells the connection to produce a message with Link_producer, and then send it
                            
                             Link_consumer->Receive();
-                            check_for_duplicate(last_msg_ptr, recv_data_ptr) ? notification = kCipNotificationDuplicate : notification = kCipNotificationReceived;
                             //todo: fix CIP_MessageRouter::route_message(Consumed_connection_path, Consumed_connection_path_length, recv_data_ptr, recv_data_len);//
 
                             //todo: implement class 3 server behaviour
@@ -460,12 +538,22 @@ CipStatus CIP_Connection::Behaviour()
 }
 
 
-bool CIP_Connection::check_for_duplicate(CipByte * last_msg_ptr, CipByte * curr_msg_ptr)
+bool CIP_Connection::IsNewerSequenceNumber(CipUdint sequence_number, CipUdint last_sequence_number)
 {
-    if ( ((CipUint*)last_msg_ptr)[0] == ((CipUint*)curr_msg_ptr)[0])
-        return true; //Dupe found
-    else
-        return false; //Not a dupe
+    //the difference is interpreted as signed, so numbers up to half the range ahead are newer
+    return 0 < (CipDint) (sequence_number - last_sequence_number);
+}
+
+bool CIP_Connection::check_for_duplicate(CipUint last_sequence_count, CipUint sequence_count)
+{
+    //a count that is not ahead of the last one was already consumed (or is stale)
+    return 0 >= (CipInt) (CipUint) (sequence_count - last_sequence_count);
+}
+
+bool CIP_Connection::IsFragmentedTransportClass(CipUsint transport_class)
+{
+    return (kConnectionTriggerTransportClass4 <= transport_class)
+           && (kConnectionTriggerTransportClass6 >= transport_class);
 }
 
 CipStatus CIP_Connection::Shut()
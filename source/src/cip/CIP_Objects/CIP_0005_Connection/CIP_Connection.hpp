@@ -8,11 +8,16 @@
 #include "../template/CIP_Object_template.hpp"
 #include "CIP_Connection_LinkConsumer.hpp"
 #include "CIP_Connection_LinkProducer.hpp"
+#include "CIP_Connection_Fragmentation.hpp"
 #include <vector>
 #include "../../connection/network/NET_Connection.hpp"
 
 
 #define MAX_BOUND_CONN 10
+
+/** @brief Number of connection objects allocated at init, an I/O connection
+ * uses one for each direction */
+#define CIP_CONNECTION_POOL_SIZE (2 * OPENER_CIP_NUM_CONNECTIONS)
 class CIP_Connection;
 class CIP_Connection : public CIP_Object_template<CIP_Connection>
 {
@@ -141,9 +146,44 @@ public:
     CIP_Connection_LinkConsumer * Link_consumer;
     CIP_Connection_LinkProducer * Link_producer;
 
+    //Fragment stream of transport classes 4 to 6
+    CIP_Connection_Fragmentation Fragmentation;
+
     static CipStatus Init();
     static CipStatus Shut();
 
+    /** @brief Take a connection object out of the pool allocated at init
+     *
+     * The object is cleared and put in the configuring state. Neither memory is
+     * allocated nor an exception thrown, so this is safe on the connection setup path.
+     * @return the connection object, nullptr if the pool is exhausted
+     */
+    static CIP_Connection * AllocateConnection();
+
+    /** @brief Close the sockets of a connection object and return it to the pool
+     *
+     * @param connection the connection object, ignored if already free
+     */
+    static void ReleaseConnection(CIP_Connection * connection);
+
+    /** @brief Number of connection objects left in the pool */
+    static CipUint GetNumberOfFreeConnections();
+
+    /** @brief Wraparound safe comparison of 32 bit EIP sequence numbers
+     *
+     * @return true if sequence_number comes after last_sequence_number
+     */
+    static bool IsNewerSequenceNumber(CipUdint sequence_number, CipUdint last_sequence_number);
+
+    /** @brief Check a 16 bit CIP sequence count against the last consumed one
+     *
+     * @return true if the data with this sequence count was already consumed
+     */
+    static bool check_for_duplicate(CipUint last_sequence_count, CipUint sequence_count);
+
+    /** @brief Transport classes 4 to 6 carry their data in fragments, see CIP_Connection_Fragmentation */
+    static bool IsFragmentedTransportClass(CipUsint transport_class);
+
     //Class services
     CipStatus Create(CipMessageRouterRequest_t* message_router_request,
                      CipMessageRouterResponse_t* message_router_response);
@@ -176,8 +216,11 @@ public:
     //Temporary
     NET_Connection * netConn;
 private:
+    static CIP_Connection * free_connections[CIP_CONNECTION_POOL_SIZE];
+    static CipUint number_of_free_connections;
+
+    void ClearAttributes();
     CipStatus Behaviour();
-    bool check_for_duplicate(CipByte * last_msg_ptr, CipByte * curr_msg_ptr);
 	void * retrieveAttribute(CipUsint attributeNumber);
 	CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
 };
@@ -0,0 +1,226 @@
+//
+// Fragmented transport of connection classes 4 to 6
+//
+
+#include <cstring>
+#include "CIP_Connection_Fragmentation.hpp"
+#include "../../ciperror.hpp"
+#include "../../../opener_user_conf.hpp"
+#include "../../connection/network/NET_Endianconv.hpp"
+
+CIP_Connection_Fragmentation::DataPoint_t CIP_Connection_Fragmentation::data_points[OPENER_CIP_NUM_FRAGMENTED_DATA_POINTS];
+CipUint CIP_Connection_Fragmentation::number_of_data_points = 0;
+
+CipStatus CIP_Connection_Fragmentation::ConfigureDataPoint(CipUdint connection_point, CipByte * data, CipUdint length)
+{
+    CipUint i = 0;
+    while ((i < number_of_data_points) && (data_points[i].connection_point != connection_point))
+    {
+        i++;
+    }
+    if (OPENER_CIP_NUM_FRAGMENTED_DATA_POINTS == i)
+    {
+        return kCipStatusError;
+    }
+    if (i == number_of_data_points)
+    {
+        number_of_data_points++;
+    }
+
+    data_points[i].connection_point = connection_point;
+    data_points[i].data = data;
+    data_points[i].length = length;
+    return kCipStatusOk;
+}
+
+bool CIP_Connection_Fragmentation::FindDataPoint(CipUdint connection_point, CipByte ** data, CipUdint * length)
+{
+    for (CipUint i = 0; i < number_of_data_points; i++)
+    {
+        if (data_points[i].connection_point == connection_point)
+        {
+            *data = data_points[i].data;
+            *length = data_points[i].length;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CIP_Connection_Fragmentation::ClearDataPoints()
+{
+    number_of_data_points = 0;
+}
+
+void CIP_Connection_Fragmentation::Open(CipByte * consumed_data, CipUdint consumed_length,
+                                        const CipByte * produced_data, CipUdint produced_length,
+                                        CipUint max_fragment_length)
+{
+    Close();
+    this->consumed_data = consumed_data;
+    this->consumed_length = consumed_length;
+    this->produced_data = produced_data;
+    this->produced_length = produced_length;
+    this->max_fragment_length = max_fragment_length;
+}
+
+void CIP_Connection_Fragmentation::Close()
+{
+    consumed_data = nullptr;
+    consumed_length = 0;
+    produced_data = nullptr;
+    produced_length = 0;
+    max_fragment_length = 0;
+    write_in_progress = false;
+    write_length = 0;
+    write_offset = 0;
+    write_count = 0;
+    completed_writes = 0;
+    read_in_progress = false;
+    read_offset = 0;
+    read_count = 0;
+}
+
+int CIP_Connection_Fragmentation::HandleFragment(CipUsint * fragment, CipUint fragment_length, CipUsint * reply)
+{
+    if (kFragmentHeaderLength > fragment_length)
+    {
+        return kCipStatusError;
+    }
+
+    CipUsint type = (CipUsint) (fragment[0] >> 6);
+    CipUsint count = (CipUsint) (fragment[0] & kFragmentCountMask);
+    if (kFragmentTypeAcknowledge == type)
+    {
+        return ProduceFragment(count, reply);
+    }
+    return ConsumeFragment(type, count, fragment + kFragmentHeaderLength,
+                           (CipUint) (fragment_length - kFragmentHeaderLength), reply);
+}
+
+int CIP_Connection_Fragmentation::ConsumeFragment(CipUsint type, CipUsint count, CipUsint * data,
+                                                  CipUint data_length, CipUsint * reply)
+{
+    CipUsint general_status = kCipGeneralStatusCodeSuccess;
+
+    if (kFragmentTypeFirst == type)
+    {
+        if (kTransferLengthLength > data_length)
+        {
+            return kCipStatusError;
+        }
+        write_length = NET_Endianconv::GetDintFromMessage(data);
+        data_length = (CipUint) (data_length - kTransferLengthLength);
+        write_offset = 0;
+        write_in_progress = false;
+
+        if (nullptr == consumed_data)
+        {
+            general_status = kCipGeneralStatusCodeObjectDoesNotExist;
+        }
+        else if (write_length > consumed_length)
+        {
+            general_status = kCipGeneralStatusCodeTooMuchData;
+        }
+        else if (0 != count)
+        {
+            general_status = kCipGeneralStatusCodeInvalidParameter;
+        }
+    }
+    else if (!write_in_progress || (count != ((write_count + 1) & kFragmentCountMask)))
+    {
+        general_status = kCipGeneralStatusCodeServiceFragmentationSequenceNotInProgress;
+    }
+
+    if ((kCipGeneralStatusCodeSuccess == general_status) && (data_length > write_length - write_offset))
+    {
+        general_status = kCipGeneralStatusCodeTooMuchData;
+    }
+
+    if (kCipGeneralStatusCodeSuccess == general_status)
+    {
+        //straight into the data point, the transfer is complete with its last byte
+        memcpy(consumed_data + write_offset, data, data_length);
+        write_offset += data_length;
+        write_count = count;
+        write_in_progress = (write_offset < write_length);
+
+        if (!write_in_progress)
+        {
+            completed_writes++;
+        }
+        else if (kFragmentTypeLast == type)
+        {
+            general_status = kCipGeneralStatusCodeNotEnoughData;
+        }
+    }
+
+    if (kCipGeneralStatusCodeSuccess != general_status)
+    {
+        write_in_progress = false;
+    }
+    return EncodeAcknowledge(count, general_status, reply);
+}
+
+int CIP_Connection_Fragmentation::ProduceFragment(CipUsint count, CipUsint * reply)
+{
+    if (nullptr == produced_data)
+    {
+        return EncodeAcknowledge(count, kCipGeneralStatusCodeObjectDoesNotExist, reply);
+    }
+
+    bool first = false;
+    if (!read_in_progress || (count != read_count))
+    {
+        //count 0 (re)starts a transfer, any other count is out of sequence
+        if (0 != count)
+        {
+            read_in_progress = false;
+            return EncodeAcknowledge(count, kCipGeneralStatusCodeServiceFragmentationSequenceNotInProgress, reply);
+        }
+        first = true;
+        read_offset = 0;
+    }
+
+    CipUint header_length = (CipUint) (kFragmentHeaderLength + (first ? kTransferLengthLength : 0));
+    if (max_fragment_length <= header_length)
+    {
+        read_in_progress = false;
+        return EncodeAcknowledge(count, kCipGeneralStatusCodeReplyDataTooLarge, reply);
+    }
+
+    CipUdint fragment_data_length = produced_length - read_offset;
+    if (fragment_data_length > (CipUdint) (max_fragment_length - header_length))
+    {
+        fragment_data_length = (CipUdint) (max_fragment_length - header_length);
+    }
+
+    CipUsint *message = reply + kFragmentHeaderLength;
+    if (first)
+    {
+        NET_Endianconv::AddDintToMessage(produced_length, message);
+    }
+    memcpy(message, produced_data + read_offset, fragment_data_length);
+    read_offset += fragment_data_length;
+    read_count = (CipUsint) ((count + 1) & kFragmentCountMask);
+    read_in_progress = (read_offset < produced_length);
+
+    CipUsint type = kFragmentTypeMiddle;
+    if (first)
+    {
+        type = kFragmentTypeFirst;
+    }
+    else if (!read_in_progress)
+    {
+        type = kFragmentTypeLast;
+    }
+    reply[0] = (CipUsint) ((type << 6) | count);
+    return (int) (header_length + fragment_data_length);
+}
+
+int CIP_Connection_Fragmentation::EncodeAcknowledge(CipUsint count, CipUsint general_status, CipUsint * reply)
+{
+    reply[0] = (CipUsint) ((kFragmentTypeAcknowledge << 6) | count);
+    reply[1] = general_status;
+    return kAcknowledgeLength;
+}
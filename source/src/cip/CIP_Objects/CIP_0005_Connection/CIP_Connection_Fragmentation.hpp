@@ -0,0 +1,118 @@
+//
+// Fragmented transport of connection classes 4 to 6
+//
+
+#ifndef OPENERMAIN_CIP_CONNECTION_FRAGMENTATION_HPP
+#define OPENERMAIN_CIP_CONNECTION_FRAGMENTATION_HPP
+
+#include "../../ciptypes.hpp"
+
+/** @brief Streams transfers larger than a frame over a class 4, 5 or 6 connection
+ *
+ *  Every connected data item carries one fragment after its 16 bit sequence count
+ *  byte\bits   7   6           5   4   3   2   1   0
+ *      0       Fragment type   Fragment count (modulo 64)
+ *
+ *  The originator writes the consumed data point with a first fragment, whose
+ *  data is preceded by the UDINT length of the whole transfer, followed by middle
+ *  fragments and a last one. Each is answered by an acknowledge fragment with
+ *  the same count and a USINT general status.
+ *
+ *  The originator reads the produced data point with acknowledge fragments, the
+ *  count 0 starts a transfer and every further one asks for the next count. The
+ *  reply is the data fragment, the first one again preceded by the UDINT length
+ *  of the whole transfer, or an acknowledge fragment with the error status.
+ *
+ *  Data is copied between the frames and the data points one fragment at a time,
+ *  a transfer is never staged in memory as a whole.
+ */
+class CIP_Connection_Fragmentation
+{
+public:
+    typedef enum
+    {
+        kFragmentTypeFirst       = 0,
+        kFragmentTypeMiddle      = 1,
+        kFragmentTypeLast        = 2,
+        kFragmentTypeAcknowledge = 3
+    } FragmentType_e;
+
+    static const CipUsint kFragmentCountMask = 0x3F;
+    static const CipUint kFragmentHeaderLength = 1;
+    static const CipUint kTransferLengthLength = 4;
+    static const CipUint kAcknowledgeLength = 2;
+
+    /** @brief Register the storage behind a connection point of fragmented connections
+     *
+     * A data point is looked up before the assembly instance with the same number,
+     * it may be larger than an assembly. Registering a connection point again
+     * replaces its storage.
+     * @return kCipStatusError if all OPENER_CIP_NUM_FRAGMENTED_DATA_POINTS are taken
+     */
+    static CipStatus ConfigureDataPoint(CipUdint connection_point, CipByte * data, CipUdint length);
+
+    /** @brief Look up the storage registered for a connection point
+     *
+     * @return true if the connection point has a data point, data and length are set then
+     */
+    static bool FindDataPoint(CipUdint connection_point, CipByte ** data, CipUdint * length);
+
+    /** @brief Remove all data points */
+    static void ClearDataPoints();
+
+    /** @brief Bind the stream to its data points, either may be nullptr
+     *
+     * @param max_fragment_length largest fragment produced, without the sequence count
+     */
+    void Open(CipByte * consumed_data, CipUdint consumed_length,
+              const CipByte * produced_data, CipUdint produced_length, CipUint max_fragment_length);
+
+    /** @brief Unbind the data points and drop the transfers in progress */
+    void Close();
+
+    /** @brief Handle a received fragment and encode the reply fragment
+     *
+     * @param fragment the fragment after the sequence count
+     * @param fragment_length its length in bytes
+     * @param reply buffer for the reply, of at least the max_fragment_length given to Open
+     * @return length of the reply fragment, kCipStatusError for a malformed fragment
+     */
+    int HandleFragment(CipUsint * fragment, CipUint fragment_length, CipUsint * reply);
+
+    /** @brief Number of writes of the consumed data point completed */
+    CipUdint GetCompletedWrites() const { return completed_writes; }
+
+private:
+    typedef struct
+    {
+        CipUdint connection_point;
+        CipByte * data;
+        CipUdint length;
+    } DataPoint_t;
+
+    static DataPoint_t data_points[];
+    static CipUint number_of_data_points;
+
+    CipByte * consumed_data;
+    CipUdint consumed_length;
+    const CipByte * produced_data;
+    CipUdint produced_length;
+    CipUint max_fragment_length;
+
+    bool write_in_progress;
+    CipUdint write_length;
+    CipUdint write_offset;
+    CipUsint write_count;
+    CipUdint completed_writes;
+
+    bool read_in_progress;
+    CipUdint read_offset;
+    CipUsint read_count;
+
+    int ConsumeFragment(CipUsint type, CipUsint count, CipUsint * data, CipUint data_length, CipUsint * reply);
+    int ProduceFragment(CipUsint count, CipUsint * reply);
+    static int EncodeAcknowledge(CipUsint count, CipUsint general_status, CipUsint * reply);
+};
+
+
+#endif //OPENERMAIN_CIP_CONNECTION_FRAGMENTATION_HPP
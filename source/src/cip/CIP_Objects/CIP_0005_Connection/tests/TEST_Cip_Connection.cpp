@@ -4,8 +4,10 @@
 
 #include "TEST_Cip_Connection.hpp"
 #include <iostream>
+#include <cstring>
 #include <cip/ciptypes.hpp>
 #include <ciptypes.hpp>
+#include <cip/ciperror.hpp>
 
 
 bool test_class_services()
@@ -107,6 +109,132 @@ bool test_instance_services()
 	return true;
 }
 
+// One fragment of a write, the first one carries the transfer length
+static int send_fragment(CIP_Connection_Fragmentation * stream, CipUsint type, CipUsint count,
+                         const CipByte * data, CipUdint data_length, CipUdint transfer_length, CipUsint * reply)
+{
+    CipUsint fragment[64];
+    CipUint length = 0;
+    fragment[length++] = (CipUsint) ((type << 6) | count);
+    if (CIP_Connection_Fragmentation::kFragmentTypeFirst == type)
+    {
+        for (int i = 0; i < 4; i++)
+            fragment[length++] = (CipUsint) (transfer_length >> (8 * i));
+    }
+    memcpy(fragment + length, data, data_length);
+    return stream->HandleFragment(fragment, (CipUint) (length + data_length), reply);
+}
+
+static int request_fragment(CIP_Connection_Fragmentation * stream, CipUsint count, CipUsint * reply)
+{
+    CipUsint fragment = (CipUsint) ((CIP_Connection_Fragmentation::kFragmentTypeAcknowledge << 6) | count);
+    return stream->HandleFragment(&fragment, 1, reply);
+}
+
+bool test_fragmentation()
+{
+    CIP_Connection_Fragmentation stream;
+    CipByte consumed[1000];
+    CipByte produced[1000];
+    CipByte source[1000];
+    CipUsint reply[64];
+    const CipUint max_fragment_length = 21;
+    const CipUsint first = CIP_Connection_Fragmentation::kFragmentTypeFirst;
+    const CipUsint middle = CIP_Connection_Fragmentation::kFragmentTypeMiddle;
+    const CipUsint last = CIP_Connection_Fragmentation::kFragmentTypeLast;
+    const CipUsint acknowledge = CIP_Connection_Fragmentation::kFragmentTypeAcknowledge;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        source[i] = (CipByte) (i * 7);
+        produced[i] = (CipByte) (i * 3);
+    }
+    memset(consumed, 0, sizeof(consumed));
+    stream.Open(consumed, sizeof(consumed), produced, sizeof(produced), max_fragment_length);
+
+    //Write in 20 byte fragments, the count wraps after 63
+        CipUdint offset = 0;
+        CipUsint count = 0;
+        while (offset < sizeof(source))
+        {
+            CipUdint length = (sizeof(source) - offset < 20) ? sizeof(source) - offset : 20;
+            CipUsint type = (0 == offset) ? first : ((offset + length == sizeof(source)) ? last : middle);
+            if ((2 != send_fragment(&stream, type, count, source + offset, length, sizeof(source), reply))
+                || (reply[0] != ((acknowledge << 6) | count)) || (kCipGeneralStatusCodeSuccess != reply[1]))
+                return false;
+            offset += length;
+            count = (CipUsint) ((count + 1) & CIP_Connection_Fragmentation::kFragmentCountMask);
+        }
+        if ((0 != memcmp(consumed, source, sizeof(source))) || (1 != stream.GetCompletedWrites()))
+            return false;
+
+    //Out of sequence, too long and too short transfers are rejected
+        send_fragment(&stream, middle, 1, source, 10, 0, reply);
+        if (kCipGeneralStatusCodeServiceFragmentationSequenceNotInProgress != reply[1])
+            return false;
+
+        send_fragment(&stream, first, 0, source, 10, sizeof(consumed) + 1, reply);
+        if (kCipGeneralStatusCodeTooMuchData != reply[1])
+            return false;
+
+        send_fragment(&stream, first, 0, source, 10, 30, reply);
+        send_fragment(&stream, middle, 2, source, 10, 0, reply);
+        if (kCipGeneralStatusCodeServiceFragmentationSequenceNotInProgress != reply[1])
+            return false;
+
+        send_fragment(&stream, first, 0, source, 10, 30, reply);
+        send_fragment(&stream, last, 1, source, 10, 0, reply);
+        if ((kCipGeneralStatusCodeNotEnoughData != reply[1]) || (1 != stream.GetCompletedWrites()))
+            return false;
+
+    //Read, the first fragment carries the transfer length
+        offset = 0;
+        count = 0;
+        bool done = false;
+        while (!done)
+        {
+            int length = request_fragment(&stream, count, reply);
+            CipUsint type = (CipUsint) (reply[0] >> 6);
+            int header_length = (first == type) ? 5 : 1;
+            if ((length <= header_length) || (length > max_fragment_length) || ((reply[0] & 0x3F) != count)
+                || (acknowledge == type) || ((0 == offset) != (first == type))
+                || (0 != memcmp(reply + header_length, produced + offset, (size_t) (length - header_length))))
+                return false;
+            if ((first == type) && (sizeof(produced) != (reply[1] | (reply[2] << 8) | (reply[3] << 16) | (reply[4] << 24))))
+                return false;
+            offset += length - header_length;
+            done = (last == type);
+            count = (CipUsint) ((count + 1) & CIP_Connection_Fragmentation::kFragmentCountMask);
+        }
+        if (sizeof(produced) != offset)
+            return false;
+
+    //Past the end and restarted
+        request_fragment(&stream, count, reply);
+        if ((acknowledge != (reply[0] >> 6)) || (kCipGeneralStatusCodeServiceFragmentationSequenceNotInProgress != reply[1]))
+            return false;
+        request_fragment(&stream, 0, reply);
+        if ((first != (reply[0] >> 6)) || (produced[0] != reply[5]))
+            return false;
+
+    //No data point for the direction
+        stream.Open(consumed, sizeof(consumed), nullptr, 0, max_fragment_length);
+        request_fragment(&stream, 0, reply);
+        if (kCipGeneralStatusCodeObjectDoesNotExist != reply[1])
+            return false;
+
+    //Data points are registered per connection point
+        CipByte * data;
+        CipUdint length;
+        if ((kCipStatusOk != CIP_Connection_Fragmentation::ConfigureDataPoint(0x80, consumed, sizeof(consumed)).status)
+            || !CIP_Connection_Fragmentation::FindDataPoint(0x80, &data, &length) || (consumed != data)
+            || CIP_Connection_Fragmentation::FindDataPoint(0x81, &data, &length))
+            return false;
+        CIP_Connection_Fragmentation::ClearDataPoints();
+
+    return !CIP_Connection_Fragmentation::FindDataPoint(0x80, &data, &length);
+}
+
 int main()
 {
 	CIP_Connection::Init();
@@ -117,6 +245,9 @@ int main()
     if ( !test_instance_services() )
         return -1;
 
+    if ( !test_fragmentation() )
+        return -1;
+
 	CIP_Connection::Shut();
 
 	return 0;
@@ -6,9 +6,48 @@
 
 #include "CIP_ConnectionManager.hpp"
 #include <cstring>
+#include "cip/CIP_AppConnType.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "../../connection/network/NET_Endianconv.hpp"
+#include "../../connection/network/NET_NetworkHandler.hpp"
+#include "../../connection/network/NET_BufferPool.hpp"
+#include "../../connection/network/NET_IoShards.hpp"
+#include "../../connection/network/NET_VirtualAdapters.hpp"
+#include "OpENer_Interface.hpp"
 
-std::map<CipUdint, const CIP_ConnectionManager *> *CIP_ConnectionManager::active_connections_set;
+CIP_ConnectionManager * CIP_ConnectionManager::active_connections[OPENER_CIP_NUM_CONNECTIONS];
+CipUint CIP_ConnectionManager::number_of_active_connections = 0;
+CIP_ConnectionManager * CIP_ConnectionManager::free_connections[OPENER_CIP_NUM_CONNECTIONS];
+CipUint CIP_ConnectionManager::number_of_free_connections = 0;
+std::recursive_mutex CIP_ConnectionManager::connection_lock;
 CipUdint CIP_ConnectionManager::g_incarnation_id;
+MicroSeconds CIP_ConnectionManager::g_max_forward_open_time = 0;
+CIP_ConnectionManager * CIP_ConnectionManager::connection_id_table[kConnectionIdTableSize];
+CIP_ConnectionManager * CIP_ConnectionManager::watchdog_wheel[OPENER_WATCHDOG_WHEEL_SLOTS];
+CipUdint CIP_ConnectionManager::watchdog_tick = 0;
+MilliSeconds CIP_ConnectionManager::watchdog_elapsed_time = 0;
+
+/* UDP port of implicit (I/O) messages */
+static const CipUint kOpENerEipIoUdpPort = 0x08AE;
+
+/* fixed part of the requests, up to and including the connection path size */
+static const CipUint kForwardOpenHeaderLength = 36;
+static const CipUint kLargeForwardOpenHeaderLength = 40;
+static const CipUint kForwardCloseHeaderLength = 10;
+
+/* frame overhead around the connection data: item count, sequenced address
+ * item and data item header of I/O frames, additionally the encapsulation
+ * header, interface handle and timeout of explicit messages */
+static const CipUint kIoFrameHeaderLength = 18;
+
+/* item count, sequenced address item and data item header of a received I/O frame */
+static const int kReceivedIoFrameHeaderLength = 18;
+static const CipUint kSequencedAddressItemLength = 8;
+static const CipUint kExplicitFrameHeaderLength = ENCAPSULATION_HEADER_LENGTH + 24;
+
+/* the additional status words of an error reply have to outlive the service call,
+ * the reply is assembled on the thread that executed it */
+static thread_local CipUint g_additional_status[2];
 
 /** @brief Generate a new connection Id utilizing the Incarnation Id as
  * described in the EIP specs.
@@ -20,7 +59,11 @@ CipUdint CIP_ConnectionManager::g_incarnation_id;
 CipUdint CIP_ConnectionManager::GetConnectionId (void)
 {
     static CipUdint connection_id = 18;
-    connection_id++;
+    //skip the ids whose table slot is taken, so open connections are found by their id in one step
+    do
+    {
+        connection_id++;
+    } while (nullptr != connection_id_table[connection_id & (kConnectionIdTableSize - 1)]);
     return (g_incarnation_id | (connection_id & 0x0000FFFF));
 }
 
@@ -33,12 +76,45 @@ CipStatus CIP_ConnectionManager::Init ()
         class_id = kCipConnectionManagerClassCode;
         class_name = "Connection Manager";
         revision = 1;
-        max_instances = 1;
+        max_instances = 1 + OPENER_CIP_NUM_CONNECTIONS;
         maximum_id_number_class_attributes = 8;
         maximum_id_number_instance_attributes = 13;
 
         CIP_ConnectionManager *instance = new CIP_ConnectionManager();
-        object_Set.emplace(object_Set.size(), instance);
+        AddClassInstance(instance, 0);
+        instance->ClearConnectionData();
+        instance->Open_requests = 0;
+        instance->Open_format_rejects = 0;
+        instance->Open_resource_rejects = 0;
+        instance->Open_other_rejects = 0;
+        instance->Close_requests = 0;
+        instance->Close_format_requests = 0;
+        instance->Close_other_requests = 0;
+        instance->Connection_timeouts = 0;
+
+        //Connection records are allocated once, opening a connection only takes
+        //one off the free stack. They are not reachable as CIP instances.
+        for (CipUint i = 0; i < OPENER_CIP_NUM_CONNECTIONS; i++)
+        {
+            CIP_ConnectionManager *record = new CIP_ConnectionManager();
+            record->ClearConnectionData();
+            free_connections[OPENER_CIP_NUM_CONNECTIONS - 1 - i] = record;
+        }
+        number_of_free_connections = OPENER_CIP_NUM_CONNECTIONS;
+        number_of_active_connections = 0;
+
+        CIP_AppConnType::InitializeIoConnectionData();
+
+        //Services are served by the class instance
+        classServicesProperties.emplace(kConnMgrServiceGetAttributeSingle  , CipServiceProperties_t{ "GetAttributeSingle"  });
+        classServicesProperties.emplace(kConnMgrServiceSetAttributeSingle  , CipServiceProperties_t{ "SetAttributeSingle"  });
+        classServicesProperties.emplace(kConnMgrServiceForwardClose        , CipServiceProperties_t{ "ForwardClose"        });
+        classServicesProperties.emplace(kConnMgrServiceUnconnectedSend     , CipServiceProperties_t{ "UnconnectedSend"     });
+        classServicesProperties.emplace(kConnMgrServiceForwardOpen         , CipServiceProperties_t{ "ForwardOpen"         });
+        classServicesProperties.emplace(kConnMgrServiceGetConnectionData   , CipServiceProperties_t{ "GetConnectionData"   });
+        classServicesProperties.emplace(kConnMgrServiceSearchConnectionData, CipServiceProperties_t{ "SearchConnectionData"});
+        classServicesProperties.emplace(kConnMgrServiceGetConnectionOwner  , CipServiceProperties_t{ "GetConnectionOwner"  });
+        classServicesProperties.emplace(kConnMgrServiceLargeForwardOpen    , CipServiceProperties_t{ "LargeForwardOpen"    });
 
         //g_incarnation_id = ((CipUdint) unique_connection_id) << 16;
         stat.status = kCipStatusOk;
@@ -58,6 +134,307 @@ CipStatus CIP_ConnectionManager::Shut()
     return stat;
 }
 
+void CIP_ConnectionManager::ClearConnectionData()
+{
+    priority_timetick = 0;
+    timeout_ticks = 0;
+    connection_serial_number = 0;
+    originator_vendor_id = 0;
+    originator_serial_number = 0;
+    adapter = 0;
+    connection_timeout_multiplier = 0;
+    o_to_t_requested_packet_interval = 0;
+    o_to_t_network_connection_parameter = 0;
+    t_to_o_requested_packet_interval = 0;
+    t_to_o_network_connection_parameter = 0;
+    o_to_t_connection_size = 0;
+    t_to_o_connection_size = 0;
+    transport_type_trigger = 0;
+    connection_path_size = 0;
+    memset(&electronic_key, 0, sizeof(electronic_key));
+    memset(&connection_path, 0, sizeof(connection_path));
+    consuming_instance = nullptr;
+    producing_instance = nullptr;
+    eip_level_sequence_count_producing = 0;
+    eip_level_sequence_count_consuming = 0;
+    sequence_count_producing = 0;
+    sequence_count_consuming = 0;
+    eip_first_level_sequence_count_received = false;
+    duplicate_packets = 0;
+    late_packets = 0;
+    missed_packets = 0;
+    explicit_reply = nullptr;
+    explicit_reply_length = 0;
+    run_idle_header = 0;
+    transmission_trigger_timer = 0;
+    watchdog_timeout_ticks = 0;
+    watchdog_deadline = 0;
+    watchdog_next = nullptr;
+    watchdog_link = nullptr;
+    production_inhibit_time = 0;
+    production_inhibit_timer = 0;
+    correct_originator_to_target_size = 0;
+    correct_target_to_originator_size = 0;
+    memset(&originator_address, 0, sizeof(originator_address));
+    memset(&remote_address, 0, sizeof(remote_address));
+}
+
+CIP_ConnectionManager * CIP_ConnectionManager::FindConnection(CipUint connection_serial_number,
+                                                              CipUint originator_vendor_id,
+                                                              CipUdint originator_serial_number)
+{
+    for (CipUint i = 0; i < number_of_active_connections; i++)
+    {
+        CIP_ConnectionManager * connection = active_connections[i];
+        if ((connection->connection_serial_number == connection_serial_number)
+            && (connection->originator_vendor_id == originator_vendor_id)
+            && (connection->originator_serial_number == originator_serial_number)
+            && (connection->adapter == NET_VirtualAdapters::GetCurrentAdapter()))
+        {
+            return connection;
+        }
+    }
+    return nullptr;
+}
+
+CIP_ConnectionManager * CIP_ConnectionManager::FindConnectionById(CipUdint connection_id)
+{
+    CIP_ConnectionManager * connection = connection_id_table[connection_id & (kConnectionIdTableSize - 1)];
+    if ((nullptr != connection) && (connection->consuming_instance->CIP_consumed_connection_id == connection_id))
+    {
+        return connection;
+    }
+    return nullptr;
+}
+
+void CIP_ConnectionManager::CloseConnection(CIP_ConnectionManager * connection)
+{
+    CipUint i;
+    for (i = 0; i < number_of_active_connections; i++)
+    {
+        if (active_connections[i] == connection)
+        {
+            break;
+        }
+    }
+    if (i == number_of_active_connections)
+    {
+        return;
+    }
+
+    //the I/O shards must not see the connection half closed
+    Lock();
+    connection->StopWatchdog();
+    if (nullptr != connection->consuming_instance)
+    {
+        connection_id_table[connection->consuming_instance->CIP_consumed_connection_id & (kConnectionIdTableSize - 1)] = nullptr;
+    }
+    NET_BufferPool::Release(NET_BufferPool::kBufferClassExplicit, connection->explicit_reply);
+
+    CIP_Connection *connection_object = (nullptr != connection->producing_instance)
+                                        ? connection->producing_instance : connection->consuming_instance;
+    if ((nullptr != connection_object) && (CIP_Connection::kConnectionTypeIo == connection_object->Instance_type))
+    {
+        if (kRoutingTypeMulticastConnection == (connection->t_to_o_network_connection_parameter & kNetworkConnectionParameterTypeMask))
+        {
+            CIP_AppConnType::DetachMulticastConsumer(connection);
+        }
+        CIP_AppConnType::ReleaseIoConnection(connection);
+    }
+
+    if (connection->producing_instance != connection->consuming_instance)
+    {
+        CIP_Connection::ReleaseConnection(connection->producing_instance);
+    }
+    CIP_Connection::ReleaseConnection(connection->consuming_instance);
+    connection->ClearConnectionData();
+
+    //order of the open connections does not matter, fill the gap with the last one
+    active_connections[i] = active_connections[--number_of_active_connections];
+    active_connections[number_of_active_connections] = nullptr;
+    free_connections[number_of_free_connections++] = connection;
+    Unlock();
+}
+
+void CIP_ConnectionManager::Lock()
+{
+    connection_lock.lock();
+    NET_IoShards::LockAll();
+}
+
+void CIP_ConnectionManager::Unlock()
+{
+    NET_IoShards::UnlockAll();
+    connection_lock.unlock();
+}
+
+CipUint CIP_ConnectionManager::GetNumberOfFreeConnections()
+{
+    return number_of_free_connections;
+}
+
+void CIP_ConnectionManager::StartWatchdog()
+{
+    CIP_ConnectionManager **slot = &watchdog_wheel[watchdog_deadline % OPENER_WATCHDOG_WHEEL_SLOTS];
+
+    watchdog_next = *slot;
+    if (nullptr != watchdog_next)
+    {
+        watchdog_next->watchdog_link = &watchdog_next;
+    }
+    watchdog_link = slot;
+    *slot = this;
+}
+
+void CIP_ConnectionManager::StopWatchdog()
+{
+    if (nullptr == watchdog_link)
+    {
+        return;
+    }
+
+    *watchdog_link = watchdog_next;
+    if (nullptr != watchdog_next)
+    {
+        watchdog_next->watchdog_link = watchdog_link;
+    }
+    watchdog_next = nullptr;
+    watchdog_link = nullptr;
+}
+
+void CIP_ConnectionManager::ManageConnections(MilliSeconds elapsed_time)
+{
+    ProducePointToPointFrames(elapsed_time);
+
+    watchdog_elapsed_time += elapsed_time;
+    MilliSeconds ticks = watchdog_elapsed_time / kOpENerTimerTickInMilliSeconds;
+    watchdog_elapsed_time %= kOpENerTimerTickInMilliSeconds;
+
+    //after a long stall the clock is set forward first, then every slot is visited once
+    if (ticks > OPENER_WATCHDOG_WHEEL_SLOTS)
+    {
+        watchdog_tick += (CipUdint) ticks;
+        for (CipUint slot = 0; slot < OPENER_WATCHDOG_WHEEL_SLOTS; slot++)
+        {
+            ExpireWatchdogSlot(slot);
+        }
+        return;
+    }
+
+    while (0 < ticks--)
+    {
+        watchdog_tick++;
+        ExpireWatchdogSlot(watchdog_tick % OPENER_WATCHDOG_WHEEL_SLOTS);
+    }
+}
+
+void CIP_ConnectionManager::ProducePointToPointFrames(MilliSeconds elapsed_time)
+{
+    int entered_adapter = NET_VirtualAdapters::GetCurrentAdapter();
+
+    for (CipUint i = 0; i < number_of_active_connections; i++)
+    {
+        CIP_ConnectionManager *connection = active_connections[i];
+        CIP_Connection *producer = connection->producing_instance;
+
+        //multicast connections share the frames of their producer
+        if ((nullptr == producer) || (CIP_Connection::kConnectionTypeIo != producer->Instance_type)
+            || (CIP_Connection::kConnectionStateEstablished != producer->State)
+            || (kRoutingTypeMulticastConnection == (connection->t_to_o_network_connection_parameter & kNetworkConnectionParameterTypeMask)))
+        {
+            continue;
+        }
+
+        connection->transmission_trigger_timer -= (CipDint) elapsed_time;
+        if (0 >= connection->transmission_trigger_timer)
+        {
+            /* reload with the T->O RPI, keep the phase if we were late */
+            CipDint period = (CipDint) (connection->t_to_o_requested_packet_interval / 1000);
+            connection->transmission_trigger_timer += period;
+            if (0 >= connection->transmission_trigger_timer)
+            {
+                connection->transmission_trigger_timer = period;
+            }
+
+            //the frame carries the assembly data of the adapter
+            NET_VirtualAdapters::Enter(connection->adapter);
+            if (kCipStatusOk != CIP_AppConnType::ProduceIoFrame(connection, connection->connection_path.connection_point[1]).status)
+            {
+                OPENER_TRACE_ERR("sending frame of connection 0x%x failed\n", (unsigned int) producer->CIP_produced_connection_id);
+            }
+        }
+    }
+    NET_VirtualAdapters::Enter(entered_adapter);
+}
+
+void CIP_ConnectionManager::ExpireWatchdogSlot(CipUint slot)
+{
+    CIP_ConnectionManager *connection = watchdog_wheel[slot];
+    watchdog_wheel[slot] = nullptr;
+
+    while (nullptr != connection)
+    {
+        CIP_ConnectionManager *next = connection->watchdog_next;
+        connection->watchdog_next = nullptr;
+        connection->watchdog_link = nullptr;
+
+        //rearmed connections are only moved on to the slot of their new deadline
+        if (0 < (CipDint) (connection->watchdog_deadline - watchdog_tick))
+        {
+            connection->StartWatchdog();
+        }
+        else
+        {
+            connection->HandleWatchdogTimeout();
+        }
+        connection = next;
+    }
+}
+
+void CIP_ConnectionManager::HandleWatchdogTimeout()
+{
+    ((CIP_ConnectionManager *) object_Set[0])->Connection_timeouts++;
+
+    CIP_Connection::WatchdogTimeoutAction action = consuming_instance->Watchdog_timeout_action;
+    if (CIP_Connection::kConnectionTypeIo != consuming_instance->Instance_type)
+    {
+        //explicit connections are always deleted
+        action = CIP_Connection::kWatchdogTimeoutActionAutoDelete;
+    }
+
+    OPENER_TRACE_INFO("connection manager: connection with serial %u timed out, action %d\n",
+                      (unsigned int) connection_serial_number, (int) action);
+
+    switch (action)
+    {
+        case CIP_Connection::kWatchdogTimeoutActionTransitionToTimedOut:
+            //the record is kept until the originator closes it, nothing is produced or consumed
+            if (kRoutingTypeMulticastConnection == (t_to_o_network_connection_parameter & kNetworkConnectionParameterTypeMask))
+            {
+                CIP_AppConnType::DetachMulticastConsumer(this);
+            }
+            consuming_instance->State = CIP_Connection::kConnectionStateTimedOut;
+            if (nullptr != producing_instance)
+            {
+                producing_instance->State = CIP_Connection::kConnectionStateTimedOut;
+            }
+            break;
+
+        case CIP_Connection::kWatchdogTimeoutActionAutoReset:
+            //wait for the originator again, any sequence number is taken as new
+            eip_first_level_sequence_count_received = false;
+            RearmWatchdog();
+            StartWatchdog();
+            break;
+
+        case CIP_Connection::kWatchdogTimeoutActionAutoDelete:
+        case CIP_Connection::kWatchdogTimeoutActionDeferredDelete: //only DeviceNet defers the deletion
+        default:
+            CloseConnection(this);
+            break;
+    }
+}
+
 CipStatus CIP_ConnectionManager::ForwardClose(CipMessageRouterRequest_t* message_router_request,
                                               CipMessageRouterResponse_t* message_router_response)
 {
@@ -73,27 +450,45 @@ CipStatus CIP_ConnectionManager::ForwardClose(CipMessageRouterRequest_t* message
         CipEpath ConnectionPath;     //padded epath indicate route to remote target device
     }forwardCloseRequestParams_t;
 
-    forwardCloseRequestParams_t *forwardCloseArgs;
-    forwardCloseArgs = (forwardCloseRequestParams_t*)&message_router_request->request_data[0];
-
     //sucessfull if conn triad matches an existing connection parameters
-    //todo: free structures
-    CipStatus stat;
-    stat.status = kCipGeneralStatusCodeSuccess;
+    //if no match, no conn is released and target shall return an errror with gen status code 0x01 and extended status 0x0107
+    // (target conn not found) unless device detercted an improper conn path. Conn path size may be ignored.
+    CipStatus stat(kCipGeneralStatusCodeSuccess);
 
+    Close_requests++;
 
-    //if no match, no conn is released and target shall return an errror with gen status code 0x01 and extended status 0x0107
-    // (target conn not found) unless device detercted an improper conn path. Conn path size may be ignored, but improper conn path
-    // mismatch may cause service to be unsucessful and return error regardless of a conn triad match
+    if (message_router_request->request_data.size() < kForwardCloseHeaderLength)
+    {
+        Close_format_requests++;
+        message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+        message_router_response->reserved = 0;
+        message_router_response->general_status = kCipGeneralStatusCodeNotEnoughData;
+        message_router_response->size_additional_status = 0;
+        message_router_response->response_data.clear();
+        stat.status = kCipGeneralStatusCodeNotEnoughData;
+        return stat;
+    }
 
-    //improper format
-    // conn_path_size < conn_path -> return gen status 0x15 (too much data in service request)
-    // conn_path_size > conn_path -> return gen status 0x13 (not enough data in service request)
+    CipUsint *message = &message_router_request->request_data[0];
+    NET_Endianconv::MoveMessageNOctets(2, message); //priority/time tick and timeout ticks are not used
+    CipUint serial_number = NET_Endianconv::GetIntFromMessage(message);
+    CipUint vendor_id = NET_Endianconv::GetIntFromMessage(message);
+    CipUdint originator_serial_number = NET_Endianconv::GetDintFromMessage(message);
 
-    //conn_path mismatch
-    // mismatch between conn_path value received and sent in originating conn_request, return gen status 0x01
-    //   and extended of 0x316 (error in forward close service connection path mismatch ) or 0x0315 (invalid segment in connection path)
+    CIP_ConnectionManager *connection = FindConnection(serial_number, vendor_id, originator_serial_number);
+    if (nullptr == connection)
+    {
+        Close_other_requests++;
+        OPENER_TRACE_INFO("connection manager: forward close, no connection with serial %u\n", (unsigned int) serial_number);
+        AssembleForwardOpenErrorResponse(message_router_request, message_router_response,
+                                         kCipGeneralStatusCodeConnectionFailure,
+                                         kConnMgrStatusCodeErrorConnectionNotFoundAtTargetApplication);
+        stat.status = kCipGeneralStatusCodeConnectionFailure;
+        stat.extended_status = kConnMgrStatusCodeErrorConnectionNotFoundAtTargetApplication;
+        return stat;
+    }
 
+    CloseConnection(connection);
 
     typedef struct
     {
@@ -102,23 +497,23 @@ CipStatus CIP_ConnectionManager::ForwardClose(CipMessageRouterRequest_t* message
         CipUdint OriginatorSerialNumber;
         CipUsint ApplicationReplySize;
         CipUsint Reserved;
-        std::vector<CipUsint> ApplicationReply;
     } forwardCloseResponseParamsSuccessful_t;
 
-    typedef struct
-    {
-        CipUint  ConnectionSerialNumber;
-        CipUint  OriginatorVendorID;
-        CipUdint OriginatorSerialNumber;
-        CipUsint RemainingPathSize;
-        CipUsint Reserved;
-    } forwardCloseResponseParamsUnsuccessful_t;
-
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+    message_router_response->size_additional_status = 0;
+    message_router_response->response_data.resize(10);
 
+    message = &message_router_response->response_data[0];
+    NET_Endianconv::AddIntToMessage(serial_number, message);
+    NET_Endianconv::AddIntToMessage(vendor_id, message);
+    NET_Endianconv::AddDintToMessage(originator_serial_number, message);
+    NET_Endianconv::AddSintToMessage(0, message); //no application reply
+    NET_Endianconv::AddSintToMessage(0, message); //reserved
     return stat;
 }
 
-
 /**
   * Used to send messages between nodes without a proper established connection
   * UCMM of each node send the message forward requesting other Unconnected Send
@@ -164,26 +559,836 @@ CipStatus CIP_ConnectionManager::UnconnectedSend(CipMessageRouterRequest_t* mess
 CipStatus CIP_ConnectionManager::ForwardOpen(CipMessageRouterRequest_t* message_router_request,
                                              CipMessageRouterResponse_t* message_router_response)
 {
-    typedef union
+    return HandleForwardOpen(message_router_request, message_router_response, false);
+}
+
+CipStatus CIP_ConnectionManager::HandleForwardOpen(CipMessageRouterRequest_t* message_router_request,
+                                                   CipMessageRouterResponse_t* message_router_response,
+                                                   bool large_forward_open)
+{
+    MicroSeconds start_time = NET_NetworkHandler::GetMicroSeconds();
+    CipUint header_length = large_forward_open ? kLargeForwardOpenHeaderLength : kForwardOpenHeaderLength;
+    CipUsint general_status = kCipGeneralStatusCodeSuccess;
+    CipUint extended_error = 0;
+    CipUint path_error_offset = 0;
+
+    Open_requests++;
+
+    if (message_router_request->request_data.size() < header_length)
     {
-        CipUint val;
-        struct
+        Open_format_rejects++;
+        AssembleForwardOpenErrorResponse(message_router_request, message_router_response,
+                                         kCipGeneralStatusCodeNotEnoughData, 0);
+        return CipStatus(kCipGeneralStatusCodeNotEnoughData);
+    }
+
+    CipUsint *message = &message_router_request->request_data[10];
+    CipUint serial_number = NET_Endianconv::GetIntFromMessage(message);
+    CipUint vendor_id = NET_Endianconv::GetIntFromMessage(message);
+    CipUdint originator_serial_number = NET_Endianconv::GetDintFromMessage(message);
+
+    if (nullptr != FindConnection(serial_number, vendor_id, originator_serial_number))
+    {
+        general_status = kCipGeneralStatusCodeConnectionFailure;
+        extended_error = kConnMgrStatusCodeErrorConnectionInUse;
+        Open_other_rejects++;
+    }
+    else if (0 == number_of_free_connections)
+    {
+        general_status = kCipGeneralStatusCodeConnectionFailure;
+        extended_error = kConnMgrStatusCodeErrorNoMoreConnectionsAvailable;
+        Open_resource_rejects++;
+    }
+
+    if (kCipGeneralStatusCodeSuccess != general_status)
+    {
+        OPENER_TRACE_INFO("connection manager: forward open of serial %u rejected, 0x%x\n",
+                          (unsigned int) serial_number, (unsigned int) extended_error);
+        AssembleForwardOpenErrorResponse(message_router_request, message_router_response, general_status, extended_error);
+        return CipStatus(general_status, extended_error);
+    }
+
+    CIP_ConnectionManager *connection = free_connections[--number_of_free_connections];
+    connection->adapter = (CipUint) NET_VirtualAdapters::GetCurrentAdapter();
+
+    message = &message_router_request->request_data[0];
+    connection->priority_timetick = NET_Endianconv::GetSintFromMessage(message);
+    connection->timeout_ticks = NET_Endianconv::GetSintFromMessage(message);
+    NET_Endianconv::MoveMessageNOctets(4, message); //O->T connection id is chosen by the target
+    CipUdint t_to_o_connection_id = NET_Endianconv::GetDintFromMessage(message);
+    connection->connection_serial_number = NET_Endianconv::GetIntFromMessage(message);
+    connection->originator_vendor_id = NET_Endianconv::GetIntFromMessage(message);
+    connection->originator_serial_number = NET_Endianconv::GetDintFromMessage(message);
+    connection->connection_timeout_multiplier = NET_Endianconv::GetSintFromMessage(message);
+    NET_Endianconv::MoveMessageNOctets(3, message); //reserved
+
+    //Both formats are kept in the 16 bit layout, the connection size is kept apart
+    connection->o_to_t_requested_packet_interval = NET_Endianconv::GetDintFromMessage(message);
+    if (large_forward_open)
+    {
+        CipUdint parameter = NET_Endianconv::GetDintFromMessage(message);
+        connection->o_to_t_network_connection_parameter = (CipUint) (parameter >> 16);
+        connection->o_to_t_connection_size = (CipUint) (parameter & 0xFFFF);
+    }
+    else
+    {
+        connection->o_to_t_network_connection_parameter = NET_Endianconv::GetIntFromMessage(message);
+        connection->o_to_t_connection_size = (CipUint) (connection->o_to_t_network_connection_parameter & 0x01FF);
+    }
+
+    connection->t_to_o_requested_packet_interval = NET_Endianconv::GetDintFromMessage(message);
+    if (large_forward_open)
+    {
+        CipUdint parameter = NET_Endianconv::GetDintFromMessage(message);
+        connection->t_to_o_network_connection_parameter = (CipUint) (parameter >> 16);
+        connection->t_to_o_connection_size = (CipUint) (parameter & 0xFFFF);
+    }
+    else
+    {
+        connection->t_to_o_network_connection_parameter = NET_Endianconv::GetIntFromMessage(message);
+        connection->t_to_o_connection_size = (CipUint) (connection->t_to_o_network_connection_parameter & 0x01FF);
+    }
+
+    connection->transport_type_trigger = NET_Endianconv::GetSintFromMessage(message);
+    connection->connection_path_size = NET_Endianconv::GetSintFromMessage(message);
+
+    CipUint path_length = (CipUint) (message_router_request->request_data.size() - header_length);
+    if ((CipUint) (2 * connection->connection_path_size) > path_length)
+    {
+        general_status = kCipGeneralStatusCodeNotEnoughData;
+    }
+    else if ((CipUint) (2 * connection->connection_path_size) < path_length)
+    {
+        general_status = kCipGeneralStatusCodeTooMuchData;
+    }
+    else
+    {
+        general_status = connection->ParseConnectionPath(message, path_length, &extended_error, &path_error_offset);
+    }
+
+    if (kCipGeneralStatusCodeSuccess == general_status)
+    {
+        general_status = connection->CheckConnectionSizes(&extended_error);
+    }
+
+    if (kCipGeneralStatusCodeSuccess == general_status)
+    {
+        CIP_RequestContext *context = message_router_request->context;
+        general_status = connection->EstablishConnection(t_to_o_connection_id,
+                                                         (nullptr != context) ? context->GetPeerAddress() : nullptr,
+                                                         &extended_error);
+    }
+
+    if (kCipGeneralStatusCodeSuccess != general_status)
+    {
+        if ((kConnMgrStatusCodeErrorNoMoreConnectionsAvailable == extended_error)
+            || (kConnMgrStatusCodeTargetObjectOutOfConnections == extended_error))
+        {
+            Open_resource_rejects++;
+        }
+        else if (kCipGeneralStatusCodeConnectionFailure == general_status)
+        {
+            Open_other_rejects++;
+        }
+        else
         {
-            CipUint redundantOwner :1;
-            CipUint connectionType :2;
-            CipUint reserved       :1;
-            CipUint priority       :2;
-            CipUint fixedOrVariable:1;
-            CipUint connectionSize :8;
-        }bitfield_u;
-    }forwardOpenParams_t;
+            Open_format_rejects++;
+        }
+        CipUint additional_status = 0;
+        if (kConnMgrStatusCodeErrorInvalidOToTConnectionSize == extended_error)
+        {
+            additional_status = connection->correct_originator_to_target_size;
+        }
+        else if (kConnMgrStatusCodeErrorInvalidTToOConnectionSize == extended_error)
+        {
+            additional_status = connection->correct_target_to_originator_size;
+        }
+        else if (kConnMgrStatusCodeErrorInvalidSegmentTypeInPath == extended_error)
+        {
+            additional_status = path_error_offset;
+        }
+        connection->ClearConnectionData();
+        free_connections[number_of_free_connections++] = connection;
 
-    forwardOpenParams_t *forwardOpenArgs;
-    forwardOpenArgs = (forwardOpenParams_t*)&message_router_request->request_data[0];
+        OPENER_TRACE_INFO("connection manager: forward open of serial %u failed, 0x%x 0x%x\n",
+                          (unsigned int) serial_number, (unsigned int) general_status, (unsigned int) extended_error);
+        AssembleForwardOpenErrorResponse(message_router_request, message_router_response, general_status, extended_error,
+                                         additional_status);
+        return CipStatus(general_status, extended_error);
+    }
 
-    CipStatus stat;
-    stat.status = kCipGeneralStatusCodeSuccess;
-    return stat;
+    Lock();
+    active_connections[number_of_active_connections++] = connection;
+
+    //only the consuming direction is watched, a null O->T connection has nothing to time out
+    if (nullptr != connection->consuming_instance)
+    {
+        connection_id_table[connection->consuming_instance->CIP_consumed_connection_id & (kConnectionIdTableSize - 1)] = connection;
+        connection->RearmWatchdog();
+        connection->StartWatchdog();
+    }
+    Unlock();
+
+    typedef struct
+    {
+        CipUdint O_to_T_ConnectionID;
+        CipUdint T_to_O_ConnectionID;
+        CipUint  ConnectionSerialNumber;
+        CipUint  OriginatorVendorID;
+        CipUdint OriginatorSerialNumber;
+        CipUdint O_to_T_API;
+        CipUdint T_to_O_API;
+        CipUsint ApplicationReplySize;
+        CipUsint Reserved;
+    } forwardOpenResponseParamsSuccessful_t;
+
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+    message_router_response->size_additional_status = 0;
+    message_router_response->response_data.resize(26);
+
+    message = &message_router_response->response_data[0];
+    NET_Endianconv::AddDintToMessage((nullptr != connection->consuming_instance)
+                                     ? connection->consuming_instance->CIP_consumed_connection_id : 0, message);
+    NET_Endianconv::AddDintToMessage((nullptr != connection->producing_instance)
+                                     ? connection->producing_instance->CIP_produced_connection_id : 0, message);
+    NET_Endianconv::AddIntToMessage(connection->connection_serial_number, message);
+    NET_Endianconv::AddIntToMessage(connection->originator_vendor_id, message);
+    NET_Endianconv::AddDintToMessage(connection->originator_serial_number, message);
+    //the requested packet intervals are granted unchanged
+    NET_Endianconv::AddDintToMessage(connection->o_to_t_requested_packet_interval, message);
+    NET_Endianconv::AddDintToMessage(connection->t_to_o_requested_packet_interval, message);
+    NET_Endianconv::AddSintToMessage(0, message); //no application reply
+    NET_Endianconv::AddSintToMessage(0, message); //reserved
+
+    MicroSeconds setup_time = NET_NetworkHandler::GetMicroSeconds() - start_time;
+    if (setup_time > g_max_forward_open_time)
+    {
+        g_max_forward_open_time = setup_time;
+        OPENER_TRACE_INFO("connection manager: longest forward open so far took %llu us\n", setup_time);
+    }
+    return CipStatus(kCipGeneralStatusCodeSuccess);
+}
+
+CipUint CIP_ConnectionManager::GetPathSegmentLength(const CipUsint * segment, CipUint remaining_length)
+{
+    switch (*segment)
+    {
+        case 0x34: return 10;
+        case 0x20:
+        case 0x24:
+        case 0x2C:
+        case 0x43: return 2;
+        case 0x21:
+        case 0x25:
+        case 0x2D: return 4;
+        //the data follows the word count
+        case 0x80: return (2 > remaining_length) ? 2 : (CipUint) (2 + 2 * segment[1]);
+        default:   return 0;
+    }
+}
+
+CipUsint CIP_ConnectionManager::ParseConnectionPath(CipUsint * message, CipUint remaining_length, CipUint * extended_error,
+                                                    CipUint * error_offset)
+{
+    CipUsint *start = message;
+    CipUsint *end = message + remaining_length;
+    //with a null O->T connection the only connection point is the produced one
+    int connection_point_index = (0 == (o_to_t_network_connection_parameter & kNetworkConnectionParameterTypeMask)) ? 1 : 0;
+
+    *extended_error = kConnMgrStatusCodeErrorInvalidSegmentTypeInPath;
+
+    while (message < end)
+    {
+        CipUdint value;
+        CipUint segment_length = GetPathSegmentLength(message, (CipUint) (end - message));
+
+        *error_offset = (CipUint) ((message - start) / 2);
+        if (0 == segment_length)
+        {
+            OPENER_TRACE_WARN("connection manager: unsupported segment 0x%x in connection path\n", (unsigned int) *message);
+            return kCipGeneralStatusCodeConnectionFailure;
+        }
+        if ((CipUint) (end - message) < segment_length)
+        {
+            OPENER_TRACE_WARN("connection manager: segment 0x%x cut off in connection path\n", (unsigned int) *message);
+            return kCipGeneralStatusCodeConnectionFailure;
+        }
+
+        switch (*message)
+        {
+            case 0x34: //electronic key segment
+                NET_Endianconv::MoveMessageNOctets(1, message);
+                electronic_key.key_format = NET_Endianconv::GetSintFromMessage(message);
+                electronic_key.data.fields_t.vendor_id = NET_Endianconv::GetIntFromMessage(message);
+                electronic_key.data.fields_t.device_type = NET_Endianconv::GetIntFromMessage(message);
+                electronic_key.data.fields_t.product_code = NET_Endianconv::GetIntFromMessage(message);
+                electronic_key.data.fields_t.major_revision = NET_Endianconv::GetSintFromMessage(message);
+                electronic_key.data.fields_t.minor_revision = NET_Endianconv::GetSintFromMessage(message);
+                {
+                    CipStatus key_status = electronic_key.validate_key();
+                    if (kCipGeneralStatusCodeSuccess != key_status.status)
+                    {
+                        *extended_error = (CipUint) key_status.extended_status;
+                        return kCipGeneralStatusCodeConnectionFailure;
+                    }
+                }
+                break;
+
+            case 0x20: //8 bit class id
+                NET_Endianconv::MoveMessageNOctets(1, message);
+                connection_path.class_id = NET_Endianconv::GetSintFromMessage(message);
+                break;
+            case 0x21: //16 bit class id
+                NET_Endianconv::MoveMessageNOctets(2, message);
+                connection_path.class_id = NET_Endianconv::GetIntFromMessage(message);
+                break;
+
+            case 0x24: //8 bit instance id, the configuration point
+                NET_Endianconv::MoveMessageNOctets(1, message);
+                connection_path.connection_point[2] = NET_Endianconv::GetSintFromMessage(message);
+                break;
+            case 0x25: //16 bit instance id
+                NET_Endianconv::MoveMessageNOctets(2, message);
+                connection_path.connection_point[2] = NET_Endianconv::GetIntFromMessage(message);
+                break;
+
+            case 0x2C: //8 bit connection point, consumed one first
+            case 0x2D: //16 bit connection point
+                if (0x2C == *message)
+                {
+                    NET_Endianconv::MoveMessageNOctets(1, message);
+                    value = NET_Endianconv::GetSintFromMessage(message);
+                }
+                else
+                {
+                    NET_Endianconv::MoveMessageNOctets(2, message);
+                    value = NET_Endianconv::GetIntFromMessage(message);
+                }
+                if (1 < connection_point_index)
+                {
+                    return kCipGeneralStatusCodeConnectionFailure;
+                }
+                connection_path.connection_point[connection_point_index++] = value;
+                break;
+
+            case 0x43: //network segment, production inhibit time in milliseconds
+                NET_Endianconv::MoveMessageNOctets(1, message);
+                production_inhibit_time = NET_Endianconv::GetSintFromMessage(message);
+                break;
+
+            case 0x80: //simple data segment, configuration data
+                NET_Endianconv::MoveMessageNOctets(1, message);
+                value = NET_Endianconv::GetSintFromMessage(message);
+                connection_path.data_segment = (CipUsint) value;
+                NET_Endianconv::MoveMessageNOctets((int) (2 * value), message);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (0 == connection_path.class_id)
+    {
+        *error_offset = (CipUint) ((end - start) / 2);
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+
+    *extended_error = 0;
+    return kCipGeneralStatusCodeSuccess;
+}
+
+CipStatus CIP_ConnectionManager::HandleReceivedConnectedData(CipUsint * data, int data_length,
+                                                             struct sockaddr_in * from_address)
+{
+    if (kReceivedIoFrameHeaderLength > data_length)
+    {
+        return kCipStatusError;
+    }
+
+    CipUsint *message = data;
+    CipUint item_count = NET_Endianconv::GetIntFromMessage(message);
+    CipUint address_item_type = NET_Endianconv::GetIntFromMessage(message);
+    CipUint address_item_length = NET_Endianconv::GetIntFromMessage(message);
+    CipUdint connection_id = NET_Endianconv::GetDintFromMessage(message);
+    CipUdint sequence_number = NET_Endianconv::GetDintFromMessage(message);
+    CipUint data_item_type = NET_Endianconv::GetIntFromMessage(message);
+    CipUint data_item_length = NET_Endianconv::GetIntFromMessage(message);
+
+    if ((2 > item_count)
+        || (CIP_CommonPacket::kCipItemIdSequencedAddressItem != address_item_type)
+        || (kSequencedAddressItemLength != address_item_length)
+        || (CIP_CommonPacket::kCipItemIdConnectedDataItem != data_item_type)
+        || (data_length < kReceivedIoFrameHeaderLength + data_item_length))
+    {
+        return kCipStatusError;
+    }
+
+    CIP_ConnectionManager *connection = FindConnectionById(connection_id);
+    if ((nullptr == connection) || (CIP_Connection::kConnectionTypeIo != connection->consuming_instance->Instance_type)
+        || (from_address->sin_addr.s_addr != connection->originator_address.sin_addr.s_addr)
+        || (CIP_Connection::kConnectionStateEstablished != connection->consuming_instance->State))
+    {
+        return kCipStatusError;
+    }
+
+    //EIP level: drop repeated and reordered frames, count the skipped ones
+    if (connection->eip_first_level_sequence_count_received)
+    {
+        if (sequence_number == connection->eip_level_sequence_count_consuming)
+        {
+            connection->duplicate_packets++;
+            return kCipStatusOk;
+        }
+        if (!CIP_Connection::IsNewerSequenceNumber(sequence_number, connection->eip_level_sequence_count_consuming))
+        {
+            connection->late_packets++;
+            return kCipStatusOk;
+        }
+        connection->missed_packets += sequence_number - connection->eip_level_sequence_count_consuming - 1;
+    }
+    connection->eip_level_sequence_count_consuming = sequence_number;
+
+    //the originator is alive, even if its data did not change
+    connection->RearmWatchdog();
+
+    CIP_Connection::ConnectionTriggerType_t trigger;
+    trigger.val = connection->transport_type_trigger;
+    if (CIP_Connection::kConnectionTriggerTransportClass1 == trigger.bitfield_u.transport_class)
+    {
+        if (2 > data_item_length)
+        {
+            return kCipStatusError;
+        }
+        CipUint sequence_count = NET_Endianconv::GetIntFromMessage(message);
+        data_item_length -= 2;
+
+        //class 1 data is only new if its sequence count moved on
+        if (connection->eip_first_level_sequence_count_received
+            && CIP_Connection::check_for_duplicate(connection->sequence_count_consuming, sequence_count))
+        {
+            return kCipStatusOk;
+        }
+        connection->sequence_count_consuming = sequence_count;
+    }
+    connection->eip_first_level_sequence_count_received = true;
+
+    if (kOpENerConsumedDataHasRunIdleHeader)
+    {
+        if (4 > data_item_length)
+        {
+            return kCipStatusError;
+        }
+        CipUdint run_idle_header = NET_Endianconv::GetDintFromMessage(message);
+        data_item_length -= 4;
+        if (run_idle_header != connection->run_idle_header)
+        {
+            connection->run_idle_header = run_idle_header;
+            OpENer_Interface::RunIdleChanged(run_idle_header);
+        }
+    }
+
+    //heartbeat connections carry no data
+    if (0 == data_item_length)
+    {
+        return kCipStatusOk;
+    }
+
+    const CIP_Assembly *assembly = CIP_Assembly::GetInstance(connection->connection_path.connection_point[0]);
+    if (nullptr == assembly)
+    {
+        return kCipStatusError;
+    }
+    return assembly->NotifyAssemblyConnectedDataReceived(message, data_item_length);
+}
+
+CipUsint CIP_ConnectionManager::CheckConnectionSizes(CipUint * extended_error)
+{
+    CIP_Connection::ConnectionTriggerType_t trigger;
+    trigger.val = transport_type_trigger;
+    bool io_connection = (kCipAssemblyClassCode == connection_path.class_id)
+                         && !CIP_Connection::IsFragmentedTransportClass(trigger.bitfield_u.transport_class);
+    CipUdint buffer_size = NET_BufferPool::GetBufferSize(io_connection ? NET_BufferPool::kBufferClassIo
+                                                                       : NET_BufferPool::kBufferClassExplicit);
+    CipUint header_length = io_connection ? kIoFrameHeaderLength : kExplicitFrameHeaderLength;
+    CipUdint max_connection_size = (buffer_size > header_length) ? buffer_size - header_length : 0;
+    if (max_connection_size > 0xFFFF)
+    {
+        max_connection_size = 0xFFFF;
+    }
+
+    correct_originator_to_target_size = o_to_t_connection_size;
+    correct_target_to_originator_size = t_to_o_connection_size;
+
+    if (io_connection)
+    {
+        CipUint sequence_count_length =
+            (CIP_Connection::kConnectionTriggerTransportClass1 == trigger.bitfield_u.transport_class) ? 2 : 0;
+        const CIP_Assembly *assembly;
+
+        //heartbeat connections carry no data, their size is not checked
+        if ((0 != (o_to_t_network_connection_parameter & kNetworkConnectionParameterTypeMask))
+            && (nullptr != (assembly = CIP_Assembly::GetInstance(connection_path.connection_point[0])))
+            && (0 != assembly->GetAssemblyData()->length))
+        {
+            correct_originator_to_target_size = (CipUint) (assembly->GetAssemblyData()->length + sequence_count_length
+                                                           + (kOpENerConsumedDataHasRunIdleHeader ? 4 : 0));
+        }
+        if ((0 != (t_to_o_network_connection_parameter & kNetworkConnectionParameterTypeMask))
+            && (nullptr != (assembly = CIP_Assembly::GetInstance(connection_path.connection_point[1])))
+            && (0 != assembly->GetAssemblyData()->length))
+        {
+            correct_target_to_originator_size = (CipUint) (assembly->GetAssemblyData()->length + sequence_count_length
+                                                           + (kOpENerProducedDataHasRunIdleHeader ? 4 : 0));
+        }
+    }
+
+    if (correct_originator_to_target_size > max_connection_size)
+    {
+        correct_originator_to_target_size = (CipUint) max_connection_size;
+    }
+    if (correct_target_to_originator_size > max_connection_size)
+    {
+        correct_target_to_originator_size = (CipUint) max_connection_size;
+    }
+
+    if (correct_originator_to_target_size != o_to_t_connection_size)
+    {
+        *extended_error = kConnMgrStatusCodeErrorInvalidOToTConnectionSize;
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+    if (correct_target_to_originator_size != t_to_o_connection_size)
+    {
+        *extended_error = kConnMgrStatusCodeErrorInvalidTToOConnectionSize;
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+    return kCipGeneralStatusCodeSuccess;
+}
+
+CipUsint CIP_ConnectionManager::EstablishConnection(CipUdint t_to_o_connection_id, const struct sockaddr_in * originator,
+                                                    CipUint * extended_error)
+{
+    CipUint o_to_t_type = (CipUint) (o_to_t_network_connection_parameter & kNetworkConnectionParameterTypeMask);
+    CipUint t_to_o_type = (CipUint) (t_to_o_network_connection_parameter & kNetworkConnectionParameterTypeMask);
+    CIP_Connection::ConnectionTriggerType_t trigger;
+    trigger.val = transport_type_trigger;
+
+    //the watchdog expires after the O->T RPI times the timeout multiplier, plus
+    //one tick as the current tick is already partly over
+    //multipliers above 7 are reserved
+    CipUint multiplier_shift = (CipUint) (2 + ((7 < connection_timeout_multiplier) ? 7 : connection_timeout_multiplier));
+    unsigned long long timeout = ((unsigned long long) o_to_t_requested_packet_interval) << multiplier_shift;
+    watchdog_timeout_ticks = (CipUdint) ((timeout + 1000 * kOpENerTimerTickInMilliSeconds - 1)
+                                         / (1000 * kOpENerTimerTickInMilliSeconds)) + 1;
+
+    //fragmented connections stream assembly data over explicit frames
+    bool fragmented = CIP_Connection::IsFragmentedTransportClass(trigger.bitfield_u.transport_class);
+    CipByte *consumed_data = nullptr;
+    CipByte *produced_data = nullptr;
+    CipUdint consumed_length = 0;
+    CipUdint produced_length = 0;
+    if (fragmented)
+    {
+        bool has_consumed_data = FindFragmentedDataPoint(connection_path.connection_point[0], &consumed_data, &consumed_length);
+        bool has_produced_data = FindFragmentedDataPoint(connection_path.connection_point[1], &produced_data, &produced_length);
+        if ((kCipAssemblyClassCode != connection_path.class_id) || !(has_consumed_data || has_produced_data))
+        {
+            *extended_error = kConnMgrStatusCodeInconsistentApplicationPathCombo;
+            return kCipGeneralStatusCodeConnectionFailure;
+        }
+    }
+
+    if ((kCipMessageRouterClassCode == connection_path.class_id) || fragmented)
+    {
+        if (!fragmented && (CIP_Connection::kConnectionTriggerTransportClass3 != trigger.bitfield_u.transport_class))
+        {
+            *extended_error = kConnMgrStatusCodeErrorTransportTriggerNotSupported;
+            return kCipGeneralStatusCodeConnectionFailure;
+        }
+
+        CIP_Connection *explicit_connection = CIP_Connection::AllocateConnection();
+        if (nullptr == explicit_connection)
+        {
+            *extended_error = kConnMgrStatusCodeErrorNoMoreConnectionsAvailable;
+            return kCipGeneralStatusCodeConnectionFailure;
+        }
+
+        //a retransmitted request is answered from the reply kept in here
+        explicit_reply = NET_BufferPool::Allocate(NET_BufferPool::kBufferClassExplicit);
+        if (nullptr == explicit_reply)
+        {
+            CIP_Connection::ReleaseConnection(explicit_connection);
+            *extended_error = kConnMgrStatusCodeErrorNoMoreConnectionsAvailable;
+            return kCipGeneralStatusCodeConnectionFailure;
+        }
+
+        explicit_connection->Instance_type = CIP_Connection::kConnectionTypeExplicit;
+        explicit_connection->TransportClass_trigger.val = transport_type_trigger;
+        explicit_connection->CIP_consumed_connection_id = GetConnectionId();
+        explicit_connection->CIP_produced_connection_id = t_to_o_connection_id;
+        explicit_connection->Consumed_connection_size = o_to_t_connection_size;
+        explicit_connection->Produced_connection_size = t_to_o_connection_size;
+        explicit_connection->Expected_packet_rate = (CipUint) (o_to_t_requested_packet_interval / 1000);
+        explicit_connection->Connection_timeout_multiplier = connection_timeout_multiplier;
+        if (fragmented)
+        {
+            //a fragment has to fit the T->O connection size besides its sequence count
+            explicit_connection->Fragmentation.Open(consumed_data, consumed_length, produced_data, produced_length,
+                                                    (CipUint) ((2 < t_to_o_connection_size) ? t_to_o_connection_size - 2 : 0));
+        }
+        explicit_connection->State = CIP_Connection::kConnectionStateEstablished;
+
+        consuming_instance = explicit_connection;
+        producing_instance = explicit_connection;
+        return kCipGeneralStatusCodeSuccess;
+    }
+
+    if (kCipAssemblyClassCode != connection_path.class_id)
+    {
+        *extended_error = kConnMgrStatusCodeInconsistentApplicationPathCombo;
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+
+    if ((kRoutingTypePointToPointConnection != o_to_t_type) && (0 != o_to_t_type))
+    {
+        //consuming multicast data is not supported
+        *extended_error = kConnMgrStatusCodeErrorInvalidOToTConnectionType;
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+    if ((kNetworkConnectionParameterTypeMask == t_to_o_type) || ((0 == o_to_t_type) && (0 == t_to_o_type)))
+    {
+        *extended_error = kConnMgrStatusCodeErrorInvalidTToOConnectionType;
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+
+    if (kCipStatusOk != CIP_AppConnType::GetIoConnectionForConnectionData(this, extended_error).status)
+    {
+        return kCipGeneralStatusCodeConnectionFailure;
+    }
+
+    CipUsint general_status = kCipGeneralStatusCodeSuccess;
+    *extended_error = kConnMgrStatusCodeErrorNoMoreConnectionsAvailable;
+
+    if (0 != o_to_t_type)
+    {
+        consuming_instance = CIP_Connection::AllocateConnection();
+        if (nullptr == consuming_instance)
+        {
+            general_status = kCipGeneralStatusCodeConnectionFailure;
+        }
+        else
+        {
+            consuming_instance->Instance_type = CIP_Connection::kConnectionTypeIo;
+            consuming_instance->TransportClass_trigger.val = transport_type_trigger;
+            consuming_instance->CIP_consumed_connection_id = GetConnectionId();
+            consuming_instance->Consumed_connection_size = o_to_t_connection_size;
+            consuming_instance->Expected_packet_rate = (CipUint) (o_to_t_requested_packet_interval / 1000);
+            consuming_instance->Connection_timeout_multiplier = connection_timeout_multiplier;
+            consuming_instance->Watchdog_timeout_action = CIP_Connection::kWatchdogTimeoutActionAutoDelete;
+        }
+    }
+
+    if ((kCipGeneralStatusCodeSuccess == general_status) && (0 != t_to_o_type))
+    {
+        producing_instance = CIP_Connection::AllocateConnection();
+        if (nullptr == producing_instance)
+        {
+            general_status = kCipGeneralStatusCodeConnectionFailure;
+        }
+        else
+        {
+            producing_instance->Instance_type = CIP_Connection::kConnectionTypeIo;
+            producing_instance->TransportClass_trigger.val = transport_type_trigger;
+            //multicast frames are addressed by a target chosen id
+            producing_instance->CIP_produced_connection_id = (kRoutingTypeMulticastConnection == t_to_o_type)
+                                                             ? GetConnectionId() : t_to_o_connection_id;
+            producing_instance->Produced_connection_size = t_to_o_connection_size;
+            producing_instance->Expected_packet_rate = (CipUint) (t_to_o_requested_packet_interval / 1000);
+            producing_instance->Production_inhibit_time = production_inhibit_time;
+            producing_instance->Connection_timeout_multiplier = connection_timeout_multiplier;
+            //the first point-to-point frame goes out with the next timer tick
+            transmission_trigger_timer = 0;
+        }
+    }
+
+    if ((kCipGeneralStatusCodeSuccess == general_status) && (kCipStatusOk != OpenCommunicationChannels(originator).status))
+    {
+        general_status = kCipGeneralStatusCodeConnectionFailure;
+    }
+
+    if ((kCipGeneralStatusCodeSuccess == general_status) && (kRoutingTypeMulticastConnection == t_to_o_type)
+        && (nullptr == CIP_AppConnType::AttachMulticastConsumer(this)))
+    {
+        general_status = kCipGeneralStatusCodeConnectionFailure;
+    }
+
+    if (kCipGeneralStatusCodeSuccess != general_status)
+    {
+        CIP_AppConnType::ReleaseIoConnection(this);
+        CIP_Connection::ReleaseConnection(consuming_instance);
+        CIP_Connection::ReleaseConnection(producing_instance);
+        consuming_instance = nullptr;
+        producing_instance = nullptr;
+        return general_status;
+    }
+
+    if (nullptr != consuming_instance)
+    {
+        consuming_instance->State = CIP_Connection::kConnectionStateEstablished;
+    }
+    if (nullptr != producing_instance)
+    {
+        producing_instance->State = CIP_Connection::kConnectionStateEstablished;
+    }
+    *extended_error = 0;
+    return kCipGeneralStatusCodeSuccess;
+}
+
+bool CIP_ConnectionManager::FindFragmentedDataPoint(CipUdint connection_point, CipByte ** data, CipUdint * length)
+{
+    if (0 == connection_point)
+    {
+        return false;
+    }
+    if (CIP_Connection_Fragmentation::FindDataPoint(connection_point, data, length))
+    {
+        return true;
+    }
+
+    const CIP_Assembly *assembly = CIP_Assembly::GetInstance(connection_point);
+    if (nullptr == assembly)
+    {
+        return false;
+    }
+    *data = assembly->GetAssemblyData()->data;
+    *length = assembly->GetAssemblyData()->length;
+    return true;
+}
+
+CipStatus CIP_ConnectionManager::OpenCommunicationChannels(const struct sockaddr_in * originator)
+{
+    int socket;
+    bool point_to_point_producer = (nullptr != producing_instance)
+        && (kRoutingTypeMulticastConnection != (t_to_o_network_connection_parameter & kNetworkConnectionParameterTypeMask));
+
+    if ((nullptr == originator) && ((nullptr != consuming_instance) || point_to_point_producer))
+    {
+        OPENER_TRACE_ERR("connection manager: originator of the request is unknown\n");
+        return kCipStatusError;
+    }
+
+    if (nullptr != consuming_instance)
+    {
+        originator_address.sin_family = AF_INET;
+        //bound to the interface, I/O frames are not taken by other sockets on the port, e.g. of a local scanner
+        originator_address.sin_addr.s_addr = CIP_TCPIP_Interface::interface_configuration_.ip_address;
+        originator_address.sin_port = NET_Connection::endian_htons(kOpENerEipIoUdpPort);
+
+        //the frames are received by the I/O shard owning the connection id, no socket of its own
+        if (!NET_IoShards::IsActive())
+        {
+            socket = NET_NetworkHandler::CreateUdpSocket(kUdpCommuncationDirectionConsuming, (struct sockaddr *) &originator_address);
+            if (kEipInvalidSocket == socket)
+            {
+                OPENER_TRACE_ERR("connection manager: cannot create consuming UDP socket\n");
+                return kCipStatusError;
+            }
+            consuming_instance->netConn->SetSocketHandle(socket);
+        }
+        //consumed frames are accepted from the originator only
+        originator_address.sin_addr.s_addr = originator->sin_addr.s_addr;
+        consuming_instance->netConn->originator_address = (struct sockaddr *) &originator_address;
+    }
+
+    if (nullptr != producing_instance)
+    {
+        remote_address.sin_family = AF_INET;
+        remote_address.sin_port = NET_Connection::endian_htons(kOpENerEipIoUdpPort);
+        if (!point_to_point_producer)
+        {
+            remote_address.sin_addr.s_addr = CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address;
+            if (nullptr != CIP_AppConnType::GetExistingProducerMulticastConnection(adapter, connection_path.connection_point[1]))
+            {
+                //the frames are sent by the control master of the shared producer
+                return kCipStatusOk;
+            }
+        }
+        else
+        {
+            remote_address.sin_addr.s_addr = originator->sin_addr.s_addr;
+        }
+
+        socket = NET_NetworkHandler::CreateUdpSocket(kUdpCommuncationDirectionProducing, (struct sockaddr *) &remote_address);
+        if (kEipInvalidSocket == socket)
+        {
+            OPENER_TRACE_ERR("connection manager: cannot create producing UDP socket\n");
+            return kCipStatusError;
+        }
+        producing_instance->netConn->SetSocketHandle(socket);
+        producing_instance->netConn->remote_address = (struct sockaddr *) &remote_address;
+        //a shared multicast producer keeps the priority of the connection that opened it
+        producing_instance->netConn->SetTrafficClass(GetProducingTrafficClass());
+    }
+    return kCipStatusOk;
+}
+
+NET_Connection::TrafficClass_e CIP_ConnectionManager::GetProducingTrafficClass() const
+{
+    switch ((t_to_o_network_connection_parameter & kNetworkConnectionParameterPriorityMask) >> 10)
+    {
+        case kConnMgrForwardOpenPriorityUrgent:    return NET_Connection::kTrafficUrgent;
+        case kConnMgrForwardOpenPriorityScheduled: return NET_Connection::kTrafficScheduled;
+        case kConnMgrForwardOpenPriorityHigh:      return NET_Connection::kTrafficHigh;
+        default:                                   return NET_Connection::kTrafficLow;
+    }
+}
+
+void CIP_ConnectionManager::AssembleForwardOpenErrorResponse(CipMessageRouterRequest_t* message_router_request,
+                                                             CipMessageRouterResponse_t* message_router_response,
+                                                             CipUsint general_status, CipUint extended_status,
+                                                             CipUint additional_status)
+{
+    typedef struct
+    {
+        CipUint  ConnectionSerialNumber;
+        CipUint  OriginatorVendorID;
+        CipUdint OriginatorSerialNumber;
+        CipUsint RemainingPathSize;
+        CipUsint Reserved;
+    } forwardOpenResponseParamsUnsuccessful_t;
+
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->general_status = general_status;
+    if (0 != extended_status)
+    {
+        g_additional_status[0] = extended_status;
+        g_additional_status[1] = additional_status;
+        message_router_response->size_additional_status =
+            ((kConnMgrStatusCodeErrorInvalidOToTConnectionSize == extended_status)
+             || (kConnMgrStatusCodeErrorInvalidTToOConnectionSize == extended_status)
+             || (kConnMgrStatusCodeErrorInvalidSegmentTypeInPath == extended_status)) ? 2 : 1;
+        message_router_response->additional_status = g_additional_status;
+    }
+    else
+    {
+        message_router_response->size_additional_status = 0;
+    }
+
+    //the connection triad is echoed unchanged, it sits at the same offset in all requests
+    message_router_response->response_data.resize(10);
+    if (message_router_request->request_data.size() >= 18)
+    {
+        memcpy(&message_router_response->response_data[0], &message_router_request->request_data[10], 8);
+    }
+    else
+    {
+        memset(&message_router_response->response_data[0], 0, 8);
+    }
+    message_router_response->response_data[8] = 0; //remaining path size
+    message_router_response->response_data[9] = 0; //reserved
 }
 
 CipStatus CIP_ConnectionManager::GetConnectionData(CipMessageRouterRequest_t* message_router_request,
@@ -278,29 +1483,44 @@ CipStatus CIP_ConnectionManager::GetConnectionOwner(CipMessageRouterRequest_t* m
 CipStatus CIP_ConnectionManager::LargeForwardOpen(CipMessageRouterRequest_t* message_router_request,
                                                   CipMessageRouterResponse_t* message_router_response)
 {
-    typedef union
+    //Same as Forward_Open, with 32 bit network connection parameters allowing 16 bit connection sizes
+    return HandleForwardOpen(message_router_request, message_router_response, true);
+}
+
+
+CipStatus CIP_ConnectionManager::GetAttributeSingle(CipMessageRouterRequest_t* message_router_request,
+                                                    CipMessageRouterResponse_t* message_router_response)
+{
+    const CipUint *counter;
+    switch (message_router_request->request_path.attribute_number)
     {
-        CipUdint val;
-        struct
-        {
-            CipUdint redundantOwner :1 ;
-            CipUdint connectionType :2 ;
-            CipUdint reserved       :1 ;
-            CipUdint priority       :2 ;
-            CipUdint fixedOrVariable:1 ;
-            CipUdint reserved2      :9 ;
-            CipUdint connectionSize :16;
-        }bitfield_u;
-    }largeForwardOpenParams_t;
+        case 1: counter = &Open_requests; break;
+        case 2: counter = &Open_format_rejects; break;
+        case 3: counter = &Open_resource_rejects; break;
+        case 4: counter = &Open_other_rejects; break;
+        case 5: counter = &Close_requests; break;
+        case 6: counter = &Close_format_requests; break;
+        case 7: counter = &Close_other_requests; break;
+        case 8: counter = &Connection_timeouts; break;
+        default: counter = nullptr; break;
+    }
 
-    largeForwardOpenParams_t *largeForwardOpenArgs;
-    largeForwardOpenArgs = (largeForwardOpenParams_t*)&message_router_request->request_data[0];
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->size_additional_status = 0;
+    message_router_response->response_data.clear();
 
-    CipStatus stat;
-    stat.status = kCipGeneralStatusCodeSuccess;
-    return stat;
-}
+    if (nullptr == counter)
+    {
+        message_router_response->general_status = kCipGeneralStatusCodeAttributeNotSupported;
+        return CipStatus(kCipGeneralStatusCodeSuccess);
+    }
 
+    message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+    message_router_response->response_data.push_back((CipUsint) (*counter & 0xFF));
+    message_router_response->response_data.push_back((CipUsint) (*counter >> 8));
+    return CipStatus(kCipGeneralStatusCodeSuccess);
+}
 
 void * CIP_ConnectionManager::retrieveAttribute(CipUsint attributeNumber)
 {
@@ -309,6 +1529,27 @@ void * CIP_ConnectionManager::retrieveAttribute(CipUsint attributeNumber)
 
 CipStatus CIP_ConnectionManager::retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
 {
-	CipStatus stat;
-	return stat;
-}
\ No newline at end of file
+    //services may be executed by an explicit message worker
+    Lock();
+    CipStatus status = ExecuteService(serviceNumber, req, resp);
+    Unlock();
+    return status;
+}
+
+CipStatus CIP_ConnectionManager::ExecuteService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
+{
+    switch (serviceNumber)
+    {
+        case kConnMgrServiceGetAttributeSingle  : return this->GetAttributeSingle(req, resp);
+        case kConnMgrServiceSetAttributeSingle  : return this->SetAttributeSingle(req, resp);
+        case kConnMgrServiceForwardClose        : return this->ForwardClose(req, resp);
+        case kConnMgrServiceUnconnectedSend     : return this->UnconnectedSend(req, resp);
+        case kConnMgrServiceForwardOpen         : return this->ForwardOpen(req, resp);
+        case kConnMgrServiceGetConnectionData   : return this->GetConnectionData(req, resp);
+        case kConnMgrServiceSearchConnectionData: return this->SearchConnectionData(req, resp);
+        case kConnMgrServiceGetConnectionOwner  : return this->GetConnectionOwner(req, resp);
+        case kConnMgrServiceLargeForwardOpen    : return this->LargeForwardOpen(req, resp);
+        default:
+            return CipStatus(kCipGeneralStatusCodeServiceNotSupported);
+    }
+}
@@ -6,8 +6,8 @@
 #ifndef CIP_CLASSES_CONNECTIONMANAGER_H
 #define CIP_CLASSES_CONNECTIONMANAGER_H
 
+#include <mutex>
 
-#include <map>
 #include <cip/CIP_Objects/CIP_0005_Connection/CIP_Connection.hpp>
 #include <cip/CIP_ElectronicKey.hpp>
 #include <cip/CIP_Segment.hpp>
@@ -19,6 +19,12 @@
 
 class CIP_ConnectionManager;
 
+/** @brief Smallest power of two not below value, for table sizes taken from the configuration */
+constexpr CipUdint NextPowerOfTwo(CipUdint value, CipUdint power = 1)
+{
+    return (power >= value) ? power : NextPowerOfTwo(value, 2 * power);
+}
+
 class CIP_ConnectionManager :   public CIP_Object_template<CIP_ConnectionManager>
 {
 
@@ -26,9 +32,6 @@ public:
     static CipStatus Init();
     static CipStatus Shut();
 
-    CipMessageRouterRequest_t  g_message_router_request;
-    CipMessageRouterResponse_t g_message_router_response;
-
     /**
  * @brief Sets the routing type of a connection, either
  * - Point-to-point connections (unicast)
@@ -75,6 +78,7 @@ public:
         kConnMgrServiceSetAttributeAll      = 0x02,
         kConnMgrServiceGetAttributeSingle   = 0x0E,
         kConnMgrServiceSetAttributeSingle   = 0x10,
+        kConnMgrServiceForwardClose         = 0x4E,
         kConnMgrServiceUnconnectedSend      = 0x52,
         kConnMgrServiceForwardOpen          = 0x54,
         kConnMgrServiceGetConnectionData    = 0x56,
@@ -84,11 +88,22 @@ public:
         kConnMgrServiceLargeForwardOpen     = 0x5B,
     } ConnectionManagerServiceCodes_e;
 
-    static std::map<CipUdint, const CIP_ConnectionManager *> * active_connections_set;
+    /** @brief Mask of the connection type in a network connection parameter */
+    static const CipUint kNetworkConnectionParameterTypeMask = 0x6000;
+
+    /** @brief Mask of the priority in a network connection parameter, see forwardOpenPriority_e */
+    static const CipUint kNetworkConnectionParameterPriorityMask = 0x0C00;
+
+    /** @brief Open connections, packed at the front of the array */
+    static CIP_ConnectionManager * active_connections[OPENER_CIP_NUM_CONNECTIONS];
+    static CipUint number_of_active_connections;
 
     /** @brief Holds the connection ID's "incarnation ID" in the upper 16 bits */
     static CipUdint g_incarnation_id;
 
+    /** @brief Longest time spent processing a Forward_Open request in microseconds */
+    static MicroSeconds g_max_forward_open_time;
+
     /* Beginning of instance info */
     /** The data needed for handling connections. This data is strongly related to
      * the connection object defined in the CIP-specification. However the full
@@ -123,13 +138,17 @@ public:
     CipUint connection_serial_number;
     CipUint originator_vendor_id;
     CipUdint originator_serial_number;
+    CipUint adapter; /**< virtual adapter the connection has been opened on, see NET_VirtualAdapters */
     CipUint connection_timeout_multiplier;
     CipUdint o_to_t_requested_packet_interval;
     CipUint o_to_t_network_connection_parameter;
     CipUdint t_to_o_requested_packet_interval;
     CipUint t_to_o_network_connection_parameter;
+    CipUint o_to_t_connection_size;
+    CipUint t_to_o_connection_size;
+    CipUsint transport_type_trigger;
     CipUsint connection_path_size;
-    CIP_Segment electronic_key;
+    CIP_ElectronicKey electronic_key;
     CipConnectionPath connection_path; // padded EPATH
     //todo: check with connection LinkObject link_object;
 
@@ -151,8 +170,42 @@ public:
     // sequence Count for Class 1 Producing Connections
     CipUint sequence_count_consuming;
 
+    /* the consuming sequence counts are only valid after the first frame */
+    CipBool eip_first_level_sequence_count_received;
+
+    /** @brief Consuming path counters, for spotting network problems
+     *
+     * duplicate_packets counts frames with the last sequence number again,
+     * late_packets frames with an older one and missed_packets the sequence
+     * numbers skipped in gaps. None of them is copied into the assembly.
+     */
+    CipUdint duplicate_packets;
+    CipUdint late_packets;
+    CipUdint missed_packets;
+
+    /** @brief Last reply of a class 3 connection, resent for a retransmitted request
+     *
+     * The encoded reply after the encapsulation header, sequence_count_consuming
+     * holds the sequence count it answered.
+     */
+    CipUsint * explicit_reply;
+    CipUint explicit_reply_length;
+
+    /** @brief Run/idle header of the last consumed frame, reported to the application when it changes */
+    CipUdint run_idle_header;
+
     CipDint transmission_trigger_timer;
-    CipDint inactivity_watchdog_timer;
+
+    /** @brief Inactivity watchdog of the consuming direction
+     *
+     * The watchdog expires at watchdog_deadline, counted in timer ticks.
+     * Rearming only moves the deadline, the connection stays in its wheel slot
+     * and is moved on when the slot comes around.
+     */
+    CipUdint watchdog_timeout_ticks;
+    CipUdint watchdog_deadline;
+    CIP_ConnectionManager * watchdog_next;
+    CIP_ConnectionManager ** watchdog_link; // the pointer pointing to this record, nullptr if not in the wheel
 
     /** @brief Minimal time between the production of two application triggered
    * or change of state triggered I/O connection messages
@@ -167,6 +220,74 @@ public:
     CipUint correct_originator_to_target_size;
     CipUint correct_target_to_originator_size;
 
+    /** @brief Storage for the addresses the connection sockets point to */
+    struct sockaddr_in originator_address;
+    struct sockaddr_in remote_address;
+
+    /** @brief Find an open connection by its connection triad
+     *
+     * Only the connections of the virtual adapter entered are searched.
+     *
+     * @return the connection record, nullptr if no connection matches
+     */
+    static CIP_ConnectionManager * FindConnection(CipUint connection_serial_number, CipUint originator_vendor_id,
+                                                  CipUdint originator_serial_number);
+
+    /** @brief Find an open connection by the connection id its originator sends with
+     *
+     * @return the connection record, nullptr if no connection consumes this id
+     */
+    static CIP_ConnectionManager * FindConnectionById(CipUdint connection_id);
+
+    /** @brief Close a connection and return its record and connection objects to the pools
+     *
+     * @param connection the connection record, has to be open
+     */
+    static void CloseConnection(CIP_ConnectionManager * connection);
+
+    /** @brief Number of connection records left for new connections */
+    static CipUint GetNumberOfFreeConnections();
+
+    /** @brief Handle an I/O frame received on a consuming socket
+     *
+     * Duplicated and stale frames are dropped by their 32 bit EIP sequence
+     * number, class 1 data already consumed by its 16 bit CIP sequence count,
+     * both before any data is copied into the assembly.
+     *
+     * @param data the received frame, starting with the item count
+     * @param data_length length of the frame
+     * @param from_address the sender, has to be the originator of the connection
+     * @return kCipStatusOk if the frame belongs to an open connection,
+     *      kCipStatusError if it is malformed or unknown
+     */
+    static CipStatus HandleReceivedConnectedData(CipUsint * data, int data_length, struct sockaddr_in * from_address);
+
+    /** @brief Reload the inactivity watchdog, called on every valid consumed packet */
+    void RearmWatchdog()
+    {
+        watchdog_deadline = watchdog_tick + watchdog_timeout_ticks;
+    }
+
+    /** @brief Produce the due point-to-point frames, advance the watchdog timer wheel and time out the expired connections
+     *
+     * The configured watchdog timeout action of each expired connection is
+     * executed and counted in the Connection_timeouts attribute. Multicast
+     * frames are produced by CIP_AppConnType::ManageMulticastProducers.
+     *
+     * @param elapsed_time milliseconds since the last call
+     */
+    static void ManageConnections(MilliSeconds elapsed_time);
+
+    /** @brief Take the lock of the open connections, nested calls of a thread only count
+     *
+     * Held by the control thread while it manages and feeds the connections
+     * and by every connection manager service, so a service executed by an
+     * explicit message worker never sees a connection half opened or closed.
+     * The I/O shards are locked along with it.
+     */
+    static void Lock();
+    static void Unlock();
+
 
     /* public functions */
     CipStatus ForwardClose(CipMessageRouterRequest_t* message_router_request,
@@ -190,11 +311,125 @@ public:
     CipStatus LargeForwardOpen(CipMessageRouterRequest_t* message_router_request,
                                CipMessageRouterResponse_t* message_router_response);
 
+    /** @brief Read one of the connection counters, attributes 1 to 8 */
+    CipStatus GetAttributeSingle(CipMessageRouterRequest_t* message_router_request,
+                                 CipMessageRouterResponse_t* message_router_response);
+
 private:
 
+    static CIP_ConnectionManager * free_connections[OPENER_CIP_NUM_CONNECTIONS];
+    static CipUint number_of_free_connections;
+    static std::recursive_mutex connection_lock;
+
+    /** @brief Open connections by the low bits of their consumed connection id
+     *
+     * Connection ids are handed out so that no two open connections share a
+     * slot, a power of two of at least twice the number of connections.
+     */
+    static const CipUdint kConnectionIdTableSize = NextPowerOfTwo(2 * OPENER_CIP_NUM_CONNECTIONS);
+    static CIP_ConnectionManager * connection_id_table[kConnectionIdTableSize];
+    static_assert(kConnectionIdTableSize <= 0x10000, "connection ids carry a 16 bit counter");
+
+    /** @brief Timer wheel of the connection watchdogs, one slot per timer tick */
+    static CIP_ConnectionManager * watchdog_wheel[OPENER_WATCHDOG_WHEEL_SLOTS];
+    static CipUdint watchdog_tick;
+    static MilliSeconds watchdog_elapsed_time;
+
+    /** @brief Put the connection into the wheel slot of its deadline */
+    void StartWatchdog();
+
+    /** @brief Take the connection out of the timer wheel */
+    void StopWatchdog();
+
+    /** @brief Move on the rearmed connections of a wheel slot and time out the others */
+    static void ExpireWatchdogSlot(CipUint slot);
+
+    /** @brief Execute the watchdog timeout action of the connection */
+    void HandleWatchdogTimeout();
+
+    /** @brief Advance the transmission trigger timers and send a frame for each due point-to-point T->O connection */
+    static void ProducePointToPointFrames(MilliSeconds elapsed_time);
 
     static CipUdint GetConnectionId (void);
 
+    void ClearConnectionData();
+
+    /** @brief Common handling of Forward_Open and Large_Forward_Open
+     *
+     * @param large_forward_open true if the network connection parameters are 32 bit wide
+     */
+    CipStatus HandleForwardOpen(CipMessageRouterRequest_t* message_router_request,
+                                CipMessageRouterResponse_t* message_router_response,
+                                bool large_forward_open);
+
+    /** @brief Parse the connection path of a Forward_Open request into the connection record
+     *
+     * @param message pointer to the first path segment
+     * @param remaining_length number of request bytes left from message on
+     * @param extended_error set to the connection manager status code on error
+     * @param error_offset set to the word offset of the segment in error
+     * @return general status code of the check
+     */
+    CipUsint ParseConnectionPath(CipUsint * message, CipUint remaining_length, CipUint * extended_error,
+                                 CipUint * error_offset);
+
+    /** @brief Length of a supported connection path segment in bytes, 0 if the segment type is not supported */
+    static CipUint GetPathSegmentLength(const CipUsint * segment, CipUint remaining_length);
+
+    /** @brief Set up the connection objects of an explicit or I/O connection
+     *
+     * @param t_to_o_connection_id connection id the originator picked for T->O
+     * @param originator address of the originator of the Forward_Open, nullptr if unknown
+     * @param extended_error set to the connection manager status code on error
+     * @return general status code of the setup
+     */
+    CipUsint EstablishConnection(CipUdint t_to_o_connection_id, const struct sockaddr_in * originator,
+                                 CipUint * extended_error);
+
+    /** @brief Find the storage a fragmented connection streams for a connection point
+     *
+     * A data point configured with CIP_Connection_Fragmentation::ConfigureDataPoint
+     * comes first, else the data of the assembly instance is used.
+     * @return true if the connection point has storage, data and length are set then
+     */
+    static bool FindFragmentedDataPoint(CipUdint connection_point, CipByte ** data, CipUdint * length);
+
+    /** @brief Create the UDP sockets of an I/O connection
+     *
+     * @param originator address of the originator of the Forward_Open, the
+     *  consumed frames are accepted from and point to point frames are sent to it
+     * @return kCipStatusOk, kCipStatusError if a socket could not be created
+     */
+    CipStatus OpenCommunicationChannels(const struct sockaddr_in * originator);
+
+    /** @brief Traffic class of the produced frames, from the T->O priority of the Forward_Open
+     *
+     * The producing socket is marked with the DSCP the QoS object keeps for it.
+     */
+    NET_Connection::TrafficClass_e GetProducingTrafficClass() const;
+
+    /** @brief Check the requested connection sizes against the frame buffers and the assemblies
+     *
+     * I/O connections have to match the size of their assemblies, heartbeat
+     * connections excepted. Fragmented connections to an assembly are bounded
+     * by the explicit frame buffers only. The expected sizes are stored in the correct_*_size
+     * members for the error reply.
+     *
+     * @param extended_error set to the size error code on failure
+     * @return general status of the check
+     */
+    CipUsint CheckConnectionSizes(CipUint * extended_error);
+
+    /** @brief Assemble the reply of a failed Forward_Open
+     *
+     * @param additional_status appended to the additional status of a connection size error,
+     *  the correct size, or of a path segment error, the word offset of the segment
+     */
+    static void AssembleForwardOpenErrorResponse(CipMessageRouterRequest_t* message_router_request,
+                                                 CipMessageRouterResponse_t* message_router_response,
+                                                 CipUsint general_status, CipUint extended_status,
+                                                 CipUint additional_status = 0);
+
     typedef enum
     {
         kConnMgrForwardOpenSizeFixed    = 0,
@@ -255,5 +490,8 @@ private:
 private:
     void * retrieveAttribute(CipUsint attributeNumber);
     CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
+
+    /** @brief Dispatch a service, the connection lock is held */
+    CipStatus ExecuteService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
 };
 #endif // OPENER_CIP_CONNECTION_H
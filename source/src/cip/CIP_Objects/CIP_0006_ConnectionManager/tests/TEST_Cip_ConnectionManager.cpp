@@ -0,0 +1,1335 @@
+//
+// Created by Gabriel Ferreira (@gabrielcarvfer)
+//
+
+#include "TEST_Cip_ConnectionManager.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <cip/ciptypes.hpp>
+#include <opener_user_conf.hpp>
+#include "cip/connection/network/NET_NetworkHandler.hpp"
+#include "cip/connection/network/NET_Endianconv.hpp"
+#include "cip/connection/CIP_RequestContext.hpp"
+#include "utils/staticmemory.hpp"
+#include "utils/iolatency.hpp"
+
+#define NUMBER_OF_SCANNERS 100
+#define NUMBER_OF_RECONNECTS 50
+#define MAX_SETUP_TIME_US 2000
+#define IO_RPI_US 10000
+#define FRAMES_PER_PAYLOAD 1000
+#define EXPLICIT_REQUESTS 100000
+#define FRAGMENTED_TRANSFER_SIZE (1024 * 1024)
+#define FRAGMENTED_CONNECTION_SIZE 4000
+#define PARAMETER_DATA_POINT 0x80
+#define SOAK_CYCLES 2000
+#define SOAK_REQUESTS_PER_CYCLE 10
+
+#ifndef OPENER_STATIC_MEMORY
+//The library only replaces the allocation functions in the static memory profile, the soak test counts them anyway
+void * operator new(size_t size)
+{
+    StaticMemory::NotifyAllocation(size);
+    void * memory = malloc(size ? size : 1);
+    if (nullptr == memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void * operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void * memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void * memory) noexcept
+{
+    free(memory);
+}
+#endif
+
+static void push_uint(std::vector<CipUsint> * data, CipUint value)
+{
+    data->push_back((CipUsint) (value & 0xFF));
+    data->push_back((CipUsint) (value >> 8));
+}
+
+static void push_udint(std::vector<CipUsint> * data, CipUdint value)
+{
+    push_uint(data, (CipUint) (value & 0xFFFF));
+    push_uint(data, (CipUint) (value >> 16));
+}
+
+// Class 3 connection to the message router, keyed to this device
+static void build_forward_open(CipMessageRouterRequest_t * req, CipUint serial, bool large,
+                               CipUint key_vendor = OPENER_DEVICE_VENDOR_ID,
+                               CipUint key_device_type = OPENER_DEVICE_TYPE,
+                               CipUsint key_major_revision = OPENER_DEVICE_MAJOR_REVISION)
+{
+    req->service = large ? CIP_ConnectionManager::kConnMgrServiceLargeForwardOpen
+                         : CIP_ConnectionManager::kConnMgrServiceForwardOpen;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A); // priority/time tick
+    req->request_data.push_back(0x0E); // timeout ticks
+    push_udint(&req->request_data, 0);          // O->T id, chosen by the target
+    push_udint(&req->request_data, 0x1000 + serial); // T->O id
+    push_uint(&req->request_data, serial);     // connection serial number
+    push_uint(&req->request_data, 0x1234);     // originator vendor id
+    push_udint(&req->request_data, 0xCAFE);    // originator serial number
+    req->request_data.push_back(2);            // timeout multiplier
+    req->request_data.insert(req->request_data.end(), 3, 0);
+    push_udint(&req->request_data, 500000);    // O->T RPI
+    if (large)
+        push_udint(&req->request_data, 0x43000000 | 504);
+    else
+        push_uint(&req->request_data, 0x4300 | 504);
+    push_udint(&req->request_data, 500000);    // T->O RPI
+    if (large)
+        push_udint(&req->request_data, 0x43000000 | 504);
+    else
+        push_uint(&req->request_data, 0x4300 | 504);
+    req->request_data.push_back(0xA3);         // server, application triggered, class 3
+    req->request_data.push_back(7);            // path size in words
+
+    req->request_data.push_back(0x34);         // electronic key
+    req->request_data.push_back(4);
+    push_uint(&req->request_data, key_vendor);
+    push_uint(&req->request_data, key_device_type);
+    push_uint(&req->request_data, OPENER_DEVICE_PRODUCT_CODE);
+    req->request_data.push_back(key_major_revision);
+    req->request_data.push_back(OPENER_DEVICE_MINOR_REVISION);
+    req->request_data.push_back(0x20);         // message router class
+    req->request_data.push_back(0x02);
+    req->request_data.push_back(0x24);         // instance 1
+    req->request_data.push_back(0x01);
+}
+
+// Input only connection with a multicast T->O connection, which is produced
+// without a TCP peer and can be received on the loopback interface
+static void build_large_forward_open_io(CipMessageRouterRequest_t * req, CipUint serial, CipUint t_to_o_size,
+                                        CipUsint input_assembly, CipUsint config_assembly)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceLargeForwardOpen;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_udint(&req->request_data, 0);
+    push_udint(&req->request_data, 0);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(2);
+    req->request_data.insert(req->request_data.end(), 3, 0);
+    push_udint(&req->request_data, IO_RPI_US);       // O->T RPI
+    push_udint(&req->request_data, 0);               // null O->T connection
+    push_udint(&req->request_data, IO_RPI_US);       // T->O RPI
+    push_udint(&req->request_data, ((CipUdint) CIP_ConnectionManager::kRoutingTypeMulticastConnection << 16) | t_to_o_size);
+    req->request_data.push_back(0x01);               // cyclic, class 1
+    req->request_data.push_back(3);                  // path size in words
+    req->request_data.push_back(0x20);               // assembly class
+    req->request_data.push_back(0x04);
+    req->request_data.push_back(0x24);               // configuration instance
+    req->request_data.push_back(config_assembly);
+    req->request_data.push_back(0x2C);               // produced connection point
+    req->request_data.push_back(input_assembly);
+}
+
+// Exclusive owner connection, class 1 point to point in both directions
+static void build_large_forward_open_owner(CipMessageRouterRequest_t * req, CipUint serial, CipUint o_to_t_size,
+                                           CipUint t_to_o_size, CipUsint output_assembly,
+                                           CipUsint input_assembly, CipUsint config_assembly)
+{
+    build_large_forward_open_io(req, serial, t_to_o_size, input_assembly, config_assembly);
+    CipUdint o_to_t_parameter = ((CipUdint) CIP_ConnectionManager::kRoutingTypePointToPointConnection << 16) | o_to_t_size;
+    CipUdint t_to_o_parameter = ((CipUdint) CIP_ConnectionManager::kRoutingTypePointToPointConnection << 16) | t_to_o_size;
+    for (int i = 0; i < 4; i++)
+    {
+        req->request_data[26 + i] = (CipUsint) (o_to_t_parameter >> (8 * i));
+        req->request_data[34 + i] = (CipUsint) (t_to_o_parameter >> (8 * i));
+    }
+    req->request_data[39] = 4;                       // path size in words
+    req->request_data.pop_back();
+    req->request_data.pop_back();
+    req->request_data.push_back(0x2C);               // consumed connection point
+    req->request_data.push_back(output_assembly);
+    req->request_data.push_back(0x2C);               // produced connection point
+    req->request_data.push_back(input_assembly);
+}
+
+// Class 1 frame with a run idle header, as sent by the originator
+static int build_io_frame(CipUsint * frame, CipUdint connection_id, CipUdint sequence_number,
+                          CipUint sequence_count, const CipByte * data, CipUint data_length)
+{
+    std::vector<CipUsint> message;
+    push_uint(&message, 2);
+    push_uint(&message, CIP_CommonPacket::kCipItemIdSequencedAddressItem);
+    push_uint(&message, 8);
+    push_udint(&message, connection_id);
+    push_udint(&message, sequence_number);
+    push_uint(&message, CIP_CommonPacket::kCipItemIdConnectedDataItem);
+    push_uint(&message, (CipUint) (data_length + 6));
+    push_uint(&message, sequence_count);
+    push_udint(&message, 1); // run
+    message.insert(message.end(), data, data + data_length);
+    memcpy(frame, &message[0], message.size());
+    return (int) message.size();
+}
+
+// Get_Attribute_Single of a connection manager counter, sent over a class 3
+// connection (connected address item) or unconnected (null address item)
+static CipUint build_get_counter_packet(CipUsint * packet, bool connected, CipUdint connection_id,
+                                        CipUint sequence_count, CipUsint attribute)
+{
+    std::vector<CipUsint> data;
+    push_uint(&data, 2);
+    if (connected)
+    {
+        push_uint(&data, CIP_CommonPacket::kCipItemIdConnectionAddress);
+        push_uint(&data, 4);
+        push_udint(&data, connection_id);
+        push_uint(&data, CIP_CommonPacket::kCipItemIdConnectedDataItem);
+        push_uint(&data, 10);
+        push_uint(&data, sequence_count);
+    }
+    else
+    {
+        push_uint(&data, CIP_CommonPacket::kCipItemIdNullAddress);
+        push_uint(&data, 0);
+        push_uint(&data, CIP_CommonPacket::kCipItemIdUnconnectedDataItem);
+        push_uint(&data, 8);
+    }
+    const CipUsint request[] = { 0x0E, 0x03, 0x20, 0x06, 0x24, 0x01, 0x30, attribute };
+    data.insert(data.end(), request, request + sizeof(request));
+    memcpy(packet, data.data(), data.size());
+    return (CipUint) data.size();
+}
+
+// Class 5 connection streaming a data point in both directions
+static void build_fragmented_forward_open(CipMessageRouterRequest_t * req, CipUint serial, CipUsint data_point)
+{
+    build_forward_open(req, serial, true);
+    req->request_data.resize(38);
+    req->request_data[26] = (CipUsint) (FRAGMENTED_CONNECTION_SIZE & 0xFF);
+    req->request_data[27] = (CipUsint) (FRAGMENTED_CONNECTION_SIZE >> 8);
+    req->request_data[34] = (CipUsint) (FRAGMENTED_CONNECTION_SIZE & 0xFF);
+    req->request_data[35] = (CipUsint) (FRAGMENTED_CONNECTION_SIZE >> 8);
+    req->request_data.push_back(0xA5);         // server, application triggered, class 5
+    req->request_data.push_back(4);            // path size in words
+    req->request_data.push_back(0x20);         // assembly class
+    req->request_data.push_back(0x04);
+    req->request_data.push_back(0x24);         // configuration instance
+    req->request_data.push_back(0x01);
+    req->request_data.push_back(0x2C);         // consumed connection point
+    req->request_data.push_back(data_point);
+    req->request_data.push_back(0x2C);         // produced connection point
+    req->request_data.push_back(data_point);
+}
+
+static void put_uint(CipUsint *& message, CipUint value)
+{
+    *message++ = (CipUsint) (value & 0xFF);
+    *message++ = (CipUsint) (value >> 8);
+}
+
+static void put_udint(CipUsint *& message, CipUdint value)
+{
+    put_uint(message, (CipUint) (value & 0xFFFF));
+    put_uint(message, (CipUint) (value >> 16));
+}
+
+// Encapsulation header in front of data_length bytes of command data
+static CipUsint * put_encapsulation_header(CipUsint * frame, CipUint command, CipUdint session_handle, CipUint data_length)
+{
+    CipUsint *message = frame;
+    put_uint(message, command);
+    put_uint(message, data_length);
+    put_udint(message, session_handle);
+    put_udint(message, 0);                     // status
+    memset(message, 0, 12);                    // sender context and options
+    return message + 12;
+}
+
+// SendUnitData with one fragment, a first fragment is preceded by the transfer length
+static CipUint build_fragment_frame(CipUsint * frame, CipUdint session_handle, CipUdint connection_id,
+                                    CipUint sequence_count, CipUsint fragment_header, CipUdint transfer_length,
+                                    const CipByte * data, CipUint data_length)
+{
+    bool first = (CIP_Connection_Fragmentation::kFragmentTypeFirst == (fragment_header >> 6));
+    CipUint fragment_length = (CipUint) (1 + (first ? 4 : 0) + data_length);
+    CipUsint *message = put_encapsulation_header(frame, 0x70, session_handle, (CipUint) (22 + fragment_length));
+    put_udint(message, 0);                     // interface handle
+    put_uint(message, 0);                      // timeout
+    put_uint(message, 2);
+    put_uint(message, CIP_CommonPacket::kCipItemIdConnectionAddress);
+    put_uint(message, 4);
+    put_udint(message, connection_id);
+    put_uint(message, CIP_CommonPacket::kCipItemIdConnectedDataItem);
+    put_uint(message, (CipUint) (2 + fragment_length));
+    put_uint(message, sequence_count);
+    *message++ = fragment_header;
+    if (first)
+        put_udint(message, transfer_length);
+    memcpy(message, data, data_length);
+    return (CipUint) (ENCAPSULATION_HEADER_LENGTH + 22 + fragment_length);
+}
+
+static bool receive_frame(int socket, CipUsint * frame, CipUint * frame_length)
+{
+    if (ENCAPSULATION_HEADER_LENGTH != recv(socket, (char *) frame, ENCAPSULATION_HEADER_LENGTH, MSG_WAITALL))
+        return false;
+    CipUint data_length = (CipUint) (frame[2] | (frame[3] << 8));
+    if ((0 != data_length) && (data_length != recv(socket, (char *) frame + ENCAPSULATION_HEADER_LENGTH, data_length, MSG_WAITALL)))
+        return false;
+    *frame_length = (CipUint) (ENCAPSULATION_HEADER_LENGTH + data_length);
+    return true;
+}
+
+// The context requests are handled in, as the network handler owns one
+static CIP_RequestContext * begin_request(int socket)
+{
+    static CipUsint buffer[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    static CIP_RequestContext context;
+    if (nullptr == context.buffer)
+        context.Init(buffer, sizeof(buffer));
+    context.Begin(socket, nullptr);
+    return &context;
+}
+
+// The originator sends a frame, the target handles it as the network handler
+// does and the originator receives the reply
+static int exchange(NET_Connection * originator, NET_Connection * target, const CipUsint * frame,
+                    CipUint frame_length, CipUsint * reply)
+{
+    CIP_RequestContext * context = begin_request(target->GetSocketHandle());
+    CipUsint * buffer = context->buffer;
+    CipUint length;
+    int remaining_bytes;
+
+    if ((frame_length != originator->SendData((void *) frame, frame_length))
+        || !receive_frame(target->GetSocketHandle(), buffer, &length))
+        return -1;
+    int reply_length = NET_EthIP_Encap::HandleReceivedExplictTcpData(context, length, &remaining_bytes);
+    if ((0 >= reply_length) || (reply_length != target->SendData(buffer, (CipUdint) reply_length))
+        || !receive_frame(originator->GetSocketHandle(), reply, &length))
+        return -1;
+    return length;
+}
+
+// SendRRData with an unconnected request to instance 1 of a class
+static CipUint build_rr_data_frame(CipUsint * frame, CipUdint session_handle, CipUsint service, CipUsint class_id,
+                                   const std::vector<CipUsint> & request_data)
+{
+    CipUint request_length = (CipUint) (6 + request_data.size());
+    CipUsint *message = put_encapsulation_header(frame, 0x6F, session_handle, (CipUint) (16 + request_length));
+    put_udint(message, 0);                     // interface handle
+    put_uint(message, 0);                      // timeout
+    put_uint(message, 2);
+    put_uint(message, CIP_CommonPacket::kCipItemIdNullAddress);
+    put_uint(message, 0);
+    put_uint(message, CIP_CommonPacket::kCipItemIdUnconnectedDataItem);
+    put_uint(message, request_length);
+    *message++ = service;
+    *message++ = 2;                            // path size in words
+    *message++ = 0x20;
+    *message++ = class_id;
+    *message++ = 0x24;
+    *message++ = 0x01;
+    memcpy(message, request_data.data(), request_data.size());
+    return (CipUint) (ENCAPSULATION_HEADER_LENGTH + 16 + request_length);
+}
+
+static void build_forward_close(CipMessageRouterRequest_t * req, CipUint serial)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceForwardClose;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(0);
+    req->request_data.push_back(0);
+}
+
+static CipStatus forward_open(CIP_ConnectionManager * manager, CipMessageRouterRequest_t * req,
+                              CipMessageRouterResponse_t * resp)
+{
+    return manager->InstanceServices(req->service, req, resp);
+}
+
+bool test_forward_open(CIP_ConnectionManager * manager)
+{
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipStatus stat;
+
+    //Open a class 3 connection and check the reply
+        build_forward_open(&req, 1, false);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeSuccess || resp.response_data.size() != 26)
+            return false;
+        if (resp.response_data[0] == 0 && resp.response_data[1] == 0) // O->T connection id
+            return false;
+
+    //Same connection triad again
+        stat = forward_open(manager, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeConnectionFailure
+            || stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorConnectionInUse)
+            return false;
+
+    //Electronic key mismatches
+        build_forward_open(&req, 2, false, OPENER_DEVICE_VENDOR_ID + 1);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorVendorIdOrProductcodeError)
+            return false;
+
+        build_forward_open(&req, 2, false, OPENER_DEVICE_VENDOR_ID, OPENER_DEVICE_TYPE + 1);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorDeviceTypeError)
+            return false;
+
+        build_forward_open(&req, 2, false, OPENER_DEVICE_VENDOR_ID, OPENER_DEVICE_TYPE, OPENER_DEVICE_MAJOR_REVISION + 1);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorRevisionMismatch)
+            return false;
+
+    //Large forward open
+        build_forward_open(&req, 2, true);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeSuccess)
+            return false;
+
+    //Truncated request
+        build_forward_open(&req, 3, false);
+        req.request_data.resize(20);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeNotEnoughData)
+            return false;
+
+    //Close an unknown and the open connections
+        build_forward_close(&req, 3);
+        stat = manager->InstanceServices(req.service, &req, &resp);
+        if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorConnectionNotFoundAtTargetApplication)
+            return false;
+
+        for (CipUint serial = 1; serial <= 2; serial++)
+        {
+            build_forward_close(&req, serial);
+            stat = manager->InstanceServices(req.service, &req, &resp);
+            if (stat.status != kCipGeneralStatusCodeSuccess)
+                return false;
+        }
+
+    return (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+// A connection path cut off inside a segment is rejected with the word offset
+// of the segment, two byte segments can only be cut off by an odd path length
+bool test_truncated_path(CIP_ConnectionManager * manager)
+{
+    const std::vector<CipUsint> word_segments[] = {
+        { 0x34, 4, 0x01, 0x00, 0x0C, 0x00, 0x01, 0x00 }, // electronic key without its revision
+        { 0x21, 0x00 },
+        { 0x25, 0x00 },
+        { 0x2D, 0x00 },
+        { 0x80, 2, 0x00, 0x00 }                          // one of two data words
+    };
+    const CipUsint byte_segments[] = { 0x20, 0x24, 0x2C, 0x43 };
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipStatus stat;
+
+    for (const std::vector<CipUsint> & segment : word_segments)
+    {
+        build_forward_open(&req, 30, false);
+        req.request_data.resize(36);
+        req.request_data.push_back(0x20);      // message router class
+        req.request_data.push_back(0x02);
+        req.request_data.insert(req.request_data.end(), segment.begin(), segment.end());
+        req.request_data[35] = (CipUsint) ((req.request_data.size() - 36) / 2);
+        stat = forward_open(manager, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeConnectionFailure
+            || stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorInvalidSegmentTypeInPath
+            || resp.size_additional_status != 2 || resp.additional_status[1] != 1)
+            return false;
+    }
+
+    for (CipUsint segment : byte_segments)
+    {
+        build_forward_open(&req, 30, false);
+        req.request_data.resize(36);
+        req.request_data.push_back(0x20);
+        req.request_data.push_back(0x02);
+        req.request_data.push_back(segment);
+        req.request_data[35] = 1;
+        stat = forward_open(manager, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeTooMuchData)
+            return false;
+    }
+
+    return CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS;
+}
+
+bool test_pool_exhaustion(CIP_ConnectionManager * manager)
+{
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipStatus stat;
+
+    for (CipUint serial = 1; serial <= OPENER_CIP_NUM_CONNECTIONS; serial++)
+    {
+        build_forward_open(&req, serial, false);
+        if (forward_open(manager, &req, &resp).status != kCipGeneralStatusCodeSuccess)
+            return false;
+    }
+
+    build_forward_open(&req, OPENER_CIP_NUM_CONNECTIONS + 1, false);
+    stat = forward_open(manager, &req, &resp);
+    if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorNoMoreConnectionsAvailable
+        || resp.size_additional_status != 1)
+        return false;
+
+    for (CipUint serial = 1; serial <= OPENER_CIP_NUM_CONNECTIONS; serial++)
+    {
+        build_forward_close(&req, serial);
+        manager->InstanceServices(req.service, &req, &resp);
+    }
+
+    return CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS;
+}
+
+// All scanners try to reconnect at once after a network glitch, those beyond
+// the pool are rejected. The time of every Forward_Open has to stay bounded.
+bool test_reconnect_storm(CIP_ConnectionManager * manager)
+{
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    MicroSeconds max_time = 0;
+    CipUdint opened = 0;
+    CipUdint heap_allocations = CIP_Connection::GetHeapAllocations() + CIP_ConnectionManager::GetHeapAllocations();
+
+    for (int round = 0; round < NUMBER_OF_RECONNECTS; round++)
+    {
+        for (CipUint scanner = 1; scanner <= NUMBER_OF_SCANNERS; scanner++)
+        {
+            build_forward_open(&req, scanner, false);
+            MicroSeconds start = NET_NetworkHandler::GetMicroSeconds();
+            CipStatus stat = forward_open(manager, &req, &resp);
+            MicroSeconds elapsed = NET_NetworkHandler::GetMicroSeconds() - start;
+            if (elapsed > max_time)
+                max_time = elapsed;
+
+            if (stat.status == kCipGeneralStatusCodeSuccess)
+                opened++;
+            else if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorNoMoreConnectionsAvailable)
+                return false;
+        }
+
+        //glitch, every connection is dropped
+        for (CipUint scanner = 1; scanner <= NUMBER_OF_SCANNERS; scanner++)
+        {
+            build_forward_close(&req, scanner);
+            manager->InstanceServices(req.service, &req, &resp);
+        }
+    }
+
+    //connection objects and records come from the pools and class slabs set up by Init
+    heap_allocations = CIP_Connection::GetHeapAllocations() + CIP_ConnectionManager::GetHeapAllocations()
+                       - heap_allocations;
+
+    return (opened == (CipUdint) NUMBER_OF_RECONNECTS * OPENER_CIP_NUM_CONNECTIONS)
+           && (max_time < MAX_SETUP_TIME_US)
+           && (0 == heap_allocations)
+           && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+bool test_connection_sizes(CIP_ConnectionManager * manager)
+{
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipStatus stat;
+    CipUint max_size = (CipUint) (NET_BufferPool::GetBufferSize(NET_BufferPool::kBufferClassExplicit)
+                                  - ENCAPSULATION_HEADER_LENGTH - 24);
+
+    //Explicit connection larger than the explicit frame buffers
+        build_forward_open(&req, 1, true);
+        req.request_data[26] = 0x00; // O->T connection size 0x4000
+        req.request_data[27] = 0x40;
+        stat = manager->InstanceServices(req.service, &req, &resp);
+        if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorInvalidOToTConnectionSize
+            || resp.size_additional_status != 2 || resp.additional_status[1] != max_size)
+            return false;
+
+    //4 KB explicit connection
+        build_forward_open(&req, 1, true);
+        req.request_data[26] = 0xA0; // O->T and T->O connection size 4000
+        req.request_data[27] = 0x0F;
+        req.request_data[34] = 0xA0;
+        req.request_data[35] = 0x0F;
+        stat = manager->InstanceServices(req.service, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeSuccess)
+            return false;
+
+        build_forward_close(&req, 1);
+        manager->InstanceServices(req.service, &req, &resp);
+
+    return CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS;
+}
+
+// Large assemblies are produced end to end: opened with a Large_Forward_Open,
+// sent by the multicast producer and received on the loopback interface
+bool test_large_assemblies(CIP_ConnectionManager * manager)
+{
+    static CipByte input_data[3][4000];
+    const CipUint payload_sizes[3] = { 500, 1500, 4000 };
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipStatus stat;
+
+    CIP_Assembly::Init();
+    CIP_Assembly::Create(nullptr, 0); // configuration assembly, instance 1
+    for (int i = 0; i < 3; i++)
+    {
+        for (CipUint j = 0; j < payload_sizes[i]; j++)
+            input_data[i][j] = (CipByte) (i + j);
+        CIP_Assembly::Create(input_data[i], payload_sizes[i]); // instances 2 to 4
+    }
+
+    CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address = htonl(INADDR_LOOPBACK);
+    CIP_TCPIP_Interface::g_time_to_live_value = 1;
+
+    static struct sockaddr_in receiver_storage;
+    struct sockaddr_in * receiver_address = &receiver_storage;
+    memset(receiver_address, 0, sizeof(struct sockaddr_in));
+    receiver_address->sin_family = AF_INET;
+    receiver_address->sin_port = htons(0x08AE);
+    receiver_address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    NET_Connection receiver;
+    struct timeval receive_timeout = { 1, 0 };
+    receiver.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    receiver.SetSocketOpt(SOL_SOCKET, SO_REUSEADDR, 1);
+    setsockopt(receiver.GetSocketHandle(), SOL_SOCKET, SO_RCVTIMEO, (char *) &receive_timeout, sizeof(receive_timeout));
+    if (0 != receiver.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) receiver_address))
+        return false;
+
+    static CipUsint frame[4096 + 64];
+    struct sockaddr_in from_address;
+
+    for (int i = 0; i < 3; i++)
+    {
+        CipUint serial = (CipUint) (10 + i);
+        //input only points are told apart by their O->T point, which is null here
+        CIP_AppConnType::ConfigureInputOnlyConnectionPoint(0, 0, 2 + i, 1);
+
+        //The connection size has to match the assembly, the correct one is reported
+        build_large_forward_open_io(&req, serial, (CipUint) (payload_sizes[i] + 1), (CipUsint) (2 + i), 1);
+        stat = manager->InstanceServices(req.service, &req, &resp);
+        if (stat.extended_status != CIP_ConnectionManager::kConnMgrStatusCodeErrorInvalidTToOConnectionSize
+            || resp.size_additional_status != 2 || resp.additional_status[1] != payload_sizes[i] + 2)
+            return false;
+
+        build_large_forward_open_io(&req, serial, (CipUint) (payload_sizes[i] + 2), (CipUsint) (2 + i), 1);
+        stat = manager->InstanceServices(req.service, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeSuccess)
+            return false;
+
+        for (int j = 0; j < FRAMES_PER_PAYLOAD; j++)
+        {
+            CIP_AppConnType::ManageMulticastProducers(IO_RPI_US / 1000);
+            int received_size = receiver.RecvDataFrom(frame, sizeof(frame), (struct sockaddr *) &from_address);
+
+            // item count, sequenced address item, data item header and sequence count precede the data
+            if (received_size != 20 + payload_sizes[i] || 0 != memcmp(&frame[20], input_data[i], payload_sizes[i]))
+                return false;
+        }
+
+        build_forward_close(&req, serial);
+        manager->InstanceServices(req.service, &req, &resp);
+    }
+
+    return (NET_BufferPool::GetNumberOfFreeBuffers(NET_BufferPool::kBufferClassIo) == OPENER_IO_FRAME_BUFFERS)
+           && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+// Consumers of the same input assembly share one multicast producer, which is
+// produced at the fastest RPI and handed over when its control master closes
+bool test_multicast_producer(CIP_ConnectionManager * manager)
+{
+    const CipUdint rpis[2] = { 2 * IO_RPI_US, IO_RPI_US };
+    CIP_ConnectionManager * consumers[2];
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipStatus stat;
+
+    CIP_AppConnType::ConfigureInputOnlyConnectionPoint(0, 0, 2, 1);
+    for (int i = 0; i < 2; i++)
+    {
+        CipUint serial = (CipUint) (20 + i);
+        build_large_forward_open_io(&req, serial, 500 + 2, 2, 1);
+        for (int j = 0; j < 4; j++)
+            req.request_data[30 + j] = (CipUsint) (rpis[i] >> (8 * j)); // T->O RPI
+        stat = manager->InstanceServices(req.service, &req, &resp);
+        if (stat.status != kCipGeneralStatusCodeSuccess)
+            return false;
+        consumers[i] = CIP_ConnectionManager::FindConnection(serial, 0x1234, 0xCAFE);
+        if (nullptr == consumers[i])
+            return false;
+    }
+
+    CIP_AppConnType::MulticastProducer * producer = CIP_AppConnType::GetMulticastProducer(0, 2);
+    if (nullptr == producer || producer->number_of_consumers != 2 || producer->control_master != consumers[0]
+        || producer->requested_packet_interval != IO_RPI_US
+        || consumers[0]->producing_instance->CIP_produced_connection_id
+           != consumers[1]->producing_instance->CIP_produced_connection_id)
+        return false;
+
+    //Attaching twice does not add a consumer
+    if (CIP_AppConnType::AttachMulticastConsumer(consumers[1]) != producer || producer->number_of_consumers != 2)
+        return false;
+
+    //The second consumer takes over production and its sequence count goes on
+    CipUdint sequence_count = consumers[0]->eip_level_sequence_count_producing;
+    build_forward_close(&req, 20);
+    stat = manager->InstanceServices(req.service, &req, &resp);
+    if (stat.status != kCipGeneralStatusCodeSuccess || producer->number_of_consumers != 1
+        || producer->control_master != consumers[1]
+        || consumers[1]->eip_level_sequence_count_producing != sequence_count)
+        return false;
+
+    //The producer is freed with its last consumer
+    build_forward_close(&req, 21);
+    stat = manager->InstanceServices(req.service, &req, &resp);
+    if (stat.status != kCipGeneralStatusCodeSuccess || nullptr != CIP_AppConnType::GetMulticastProducer(0, 2))
+        return false;
+
+    return (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+// The originator's address is taken from its TCP connection, open one on the loopback interface
+static bool connect_originator(NET_Connection * listener, NET_Connection * originator, NET_Connection * target,
+                               CipMessageRouterRequest_t * req)
+{
+    static struct sockaddr_in listener_storage;
+    struct sockaddr_in * listener_address = &listener_storage;
+    memset(listener_address, 0, sizeof(struct sockaddr_in));
+    listener_address->sin_family = AF_INET;
+    listener_address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(struct sockaddr_in);
+
+    listener->InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    originator->InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if ((0 != listener->BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) listener_address))
+        || (0 != listener->Listen(1))
+        || (0 != getsockname(listener->GetSocketHandle(), (struct sockaddr *) listener_address, &address_length))
+        || (0 != connect(originator->GetSocketHandle(), (struct sockaddr *) listener_address, address_length)))
+        return false;
+
+    target->SetSocketHandle(accept(listener->GetSocketHandle(), nullptr, nullptr));
+    //Forward_Opens are handled as received from the originator
+    req->context = begin_request(target->GetSocketHandle());
+    return true;
+}
+
+// Frames are fed to the consuming path as received from the originator on the loopback interface
+bool test_consuming_sequence(CIP_ConnectionManager * manager)
+{
+    static CipByte output_data[8];
+    static CipByte input_data[8];
+    const CipByte frame_data[3][8] = { { 1, 1, 1, 1, 1, 1, 1, 1 }, { 2, 2, 2, 2, 2, 2, 2, 2 }, { 3, 3, 3, 3, 3, 3, 3, 3 } };
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipUsint frame[64];
+    int frame_length;
+
+    NET_Connection listener, originator, target;
+    if (!connect_originator(&listener, &originator, &target, &req))
+        return false;
+
+    CipUsint output_assembly = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(output_data, sizeof(output_data));
+    CIP_Assembly::Create(input_data, sizeof(input_data));
+    CIP_AppConnType::ConfigureExclusiveOwnerConnectionPoint(0, output_assembly, output_assembly + 1, 1);
+
+    build_large_forward_open_owner(&req, 20, sizeof(output_data) + 6, sizeof(input_data) + 2,
+                                   output_assembly, output_assembly + 1, 1);
+    if (manager->InstanceServices(req.service, &req, &resp).status != kCipGeneralStatusCodeSuccess)
+        return false;
+    CIP_ConnectionManager * connection = CIP_ConnectionManager::FindConnection(20, 0x1234, 0xCAFE);
+    CipUdint connection_id = connection->consuming_instance->CIP_consumed_connection_id;
+
+    struct sockaddr_in from_address = connection->originator_address;
+    IoLatency::Reset();
+    IoLatency::Enable(true);
+
+    //New data, counted from close to the 32 and 16 bit wraparound, received a microsecond ago
+        frame_length = build_io_frame(frame, connection_id, 0xFFFFFFFE, 0xFFFF, frame_data[0], 8);
+        IoLatency::MarkReceived(IoLatency::Now() - 1000);
+        if (kCipStatusOk != CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address).status
+            || 0 != memcmp(output_data, frame_data[0], 8) || 1 != connection->run_idle_header)
+            return false;
+
+    //Repeated and older frames are dropped, they do not reach the assembly probe
+        frame_length = build_io_frame(frame, connection_id, 0xFFFFFFFE, 0, frame_data[1], 8);
+        IoLatency::MarkReceived(IoLatency::Now());
+        CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+        frame_length = build_io_frame(frame, connection_id, 0xFFFFFFFD, 0, frame_data[1], 8);
+        CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+        IoLatency::MarkReceived(0);
+        if (1 != connection->duplicate_packets || 1 != connection->late_packets
+            || 0 != memcmp(output_data, frame_data[0], 8))
+            return false;
+
+        const LatencyHistogram & consume = IoLatency::GetHistogram(IoLatency::kProbeConsume);
+        if ((1 != consume.GetCount()) || (1000 > consume.GetMin()))
+            return false;
+        IoLatency::Enable(false);
+
+    //A new frame with data already consumed is not copied
+        frame_length = build_io_frame(frame, connection_id, 0xFFFFFFFF, 0xFFFF, frame_data[1], 8);
+        CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+        if (0 != memcmp(output_data, frame_data[0], 8))
+            return false;
+
+    //Frames 0 to 2 got lost, both sequence counts wrap around
+        frame_length = build_io_frame(frame, connection_id, 3, 0, frame_data[2], 8);
+        CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+        if (3 != connection->missed_packets || 0 != memcmp(output_data, frame_data[2], 8))
+            return false;
+
+    //Unknown connections and other senders are ignored
+        frame_length = build_io_frame(frame, connection_id + 1, 4, 1, frame_data[1], 8);
+        if (kCipStatusOk == CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address).status)
+            return false;
+        from_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1);
+        frame_length = build_io_frame(frame, connection_id, 4, 1, frame_data[1], 8);
+        if (kCipStatusOk == CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address).status
+            || 0 != memcmp(output_data, frame_data[2], 8))
+            return false;
+
+    build_forward_close(&req, 20);
+    manager->InstanceServices(req.service, &req, &resp);
+
+    return (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+// Point to point T->O frames are produced at the RPI and sent to the originator on the loopback interface
+bool test_point_to_point_producer(CIP_ConnectionManager * manager)
+{
+    static CipByte input_data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+
+    NET_Connection listener, originator, target;
+    if (!connect_originator(&listener, &originator, &target, &req))
+        return false;
+
+    static struct sockaddr_in receiver_storage;
+    struct sockaddr_in * receiver_address = &receiver_storage;
+    memset(receiver_address, 0, sizeof(struct sockaddr_in));
+    receiver_address->sin_family = AF_INET;
+    receiver_address->sin_port = htons(0x08AE);
+    receiver_address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    NET_Connection receiver;
+    struct timeval receive_timeout = { 1, 0 };
+    receiver.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    receiver.SetSocketOpt(SOL_SOCKET, SO_REUSEADDR, 1);
+    setsockopt(receiver.GetSocketHandle(), SOL_SOCKET, SO_RCVTIMEO, (char *) &receive_timeout, sizeof(receive_timeout));
+    if (0 != receiver.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) receiver_address))
+        return false;
+
+    CipUsint input_assembly = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(input_data, sizeof(input_data));
+    CIP_AppConnType::ConfigureInputOnlyConnectionPoint(0, 0, input_assembly, 1);
+
+    build_large_forward_open_io(&req, 30, sizeof(input_data) + 2, input_assembly, 1);
+    CipUdint t_to_o_parameter = ((CipUdint) CIP_ConnectionManager::kRoutingTypePointToPointConnection << 16)
+                                | (sizeof(input_data) + 2);
+    for (int i = 0; i < 4; i++)
+        req.request_data[34 + i] = (CipUsint) (t_to_o_parameter >> (8 * i));
+    if (manager->InstanceServices(req.service, &req, &resp).status != kCipGeneralStatusCodeSuccess)
+        return false;
+    CIP_ConnectionManager * connection = CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE);
+    CipUdint connection_id = connection->producing_instance->CIP_produced_connection_id;
+    IoLatency::Reset();
+    IoLatency::Enable(true);
+
+    //One frame per RPI, the EtherNet/IP sequence number counts them, both are timed by the produce probes
+    bool produced = true;
+    for (CipUdint sequence_number = 1; sequence_number <= 2; sequence_number++)
+    {
+        CIP_ConnectionManager::ManageConnections(IO_RPI_US / 1000);
+
+        CipUsint frame[64];
+        CipUsint * frame_runner = frame;
+        int frame_length = (int) recv(receiver.GetSocketHandle(), frame, sizeof(frame), 0);
+        produced = produced && (20 + (int) sizeof(input_data) == frame_length)
+                   && (2 == NET_Endianconv::GetIntFromMessage(frame_runner))
+                   && (CIP_CommonPacket::kCipItemIdSequencedAddressItem == NET_Endianconv::GetIntFromMessage(frame_runner))
+                   && (8 == NET_Endianconv::GetIntFromMessage(frame_runner))
+                   && (connection_id == NET_Endianconv::GetDintFromMessage(frame_runner))
+                   && (sequence_number == NET_Endianconv::GetDintFromMessage(frame_runner))
+                   && (0 == memcmp(frame + 20, input_data, sizeof(input_data)));
+    }
+    produced = produced && (2 == IoLatency::GetHistogram(IoLatency::kProbeProduce).GetCount())
+               && (1 == IoLatency::GetHistogram(IoLatency::kProbeProducedInterval).GetCount());
+    IoLatency::Enable(false);
+
+    build_forward_close(&req, 30);
+    manager->InstanceServices(req.service, &req, &resp);
+
+    return produced && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+// The watchdog is driven tick by tick, as the network handler does
+bool test_watchdog(CIP_ConnectionManager * manager)
+{
+    static CipByte output_data[8];
+    static CipByte input_data[8];
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipUsint frame[64];
+    int frame_length;
+    //the O->T RPI times 16 for the requested timeout multiplier of 2, plus the started tick
+    const int timeout_ticks = (16 * IO_RPI_US) / (1000 * kOpENerTimerTickInMilliSeconds) + 1;
+
+    NET_Connection listener, originator, target;
+    if (!connect_originator(&listener, &originator, &target, &req))
+        return false;
+
+    CipUsint output_assembly = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(output_data, sizeof(output_data));
+    CIP_Assembly::Create(input_data, sizeof(input_data));
+    CIP_AppConnType::ConfigureExclusiveOwnerConnectionPoint(0, output_assembly, output_assembly + 1, 1);
+    build_large_forward_open_owner(&req, 30, sizeof(output_data) + 6, sizeof(input_data) + 2,
+                                   output_assembly, output_assembly + 1, 1);
+
+    CipUint timeouts = manager->Connection_timeouts;
+
+    //Auto delete: kept alive by its frames, closed once they stop
+        if (manager->InstanceServices(req.service, &req, &resp).status != kCipGeneralStatusCodeSuccess)
+            return false;
+        CIP_ConnectionManager * connection = CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE);
+        struct sockaddr_in from_address = connection->originator_address;
+        CipUdint connection_id = connection->consuming_instance->CIP_consumed_connection_id;
+
+        for (CipUint i = 1; i <= 10 * timeout_ticks; i++)
+        {
+            if (0 == i % (timeout_ticks - 1))
+            {
+                frame_length = build_io_frame(frame, connection_id, i, i, output_data, 8);
+                CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+            }
+            CIP_ConnectionManager::ManageConnections(kOpENerTimerTickInMilliSeconds);
+        }
+        if (nullptr == CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE))
+            return false;
+
+        for (int i = 0; i < timeout_ticks; i++)
+            CIP_ConnectionManager::ManageConnections(kOpENerTimerTickInMilliSeconds);
+        if ((nullptr != CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE))
+            || (timeouts + 1 != manager->Connection_timeouts))
+            return false;
+
+    //Auto reset: stays open and accepts the originator again
+        manager->InstanceServices(req.service, &req, &resp);
+        connection = CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE);
+        connection->consuming_instance->Watchdog_timeout_action = CIP_Connection::kWatchdogTimeoutActionAutoReset;
+        connection_id = connection->consuming_instance->CIP_consumed_connection_id;
+        frame_length = build_io_frame(frame, connection_id, 1000, 1000, output_data, 8);
+        CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+
+        for (int i = 0; i < timeout_ticks; i++)
+            CIP_ConnectionManager::ManageConnections(kOpENerTimerTickInMilliSeconds);
+        frame_length = build_io_frame(frame, connection_id, 1, 1, output_data, 8);
+        CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address);
+        if ((connection != CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE))
+            || (timeouts + 2 != manager->Connection_timeouts) || (1 != connection->eip_level_sequence_count_consuming))
+            return false;
+
+    //A stalled handler catches up in one call
+        CIP_ConnectionManager::ManageConnections(60000);
+        if (timeouts + 3 != manager->Connection_timeouts)
+            return false;
+
+    //Transition to timed out: kept until the originator closes it, frames are ignored
+        connection->consuming_instance->Watchdog_timeout_action = CIP_Connection::kWatchdogTimeoutActionTransitionToTimedOut;
+        for (int i = 0; i < timeout_ticks; i++)
+            CIP_ConnectionManager::ManageConnections(kOpENerTimerTickInMilliSeconds);
+        frame_length = build_io_frame(frame, connection_id, 2, 2, output_data, 8);
+        if ((connection != CIP_ConnectionManager::FindConnection(30, 0x1234, 0xCAFE))
+            || (CIP_Connection::kConnectionStateTimedOut != connection->consuming_instance->State)
+            || (kCipStatusOk == CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address).status)
+            || (timeouts + 4 != manager->Connection_timeouts))
+            return false;
+
+        build_forward_close(&req, 30);
+        manager->InstanceServices(req.service, &req, &resp);
+    
+    //Nothing left in the wheel
+        CIP_ConnectionManager::ManageConnections(60000);
+
+    return (timeouts + 4 == manager->Connection_timeouts)
+           && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+// Class 3 requests are routed by connection id, a retransmitted request is
+// answered from the last reply without running the service again
+bool test_class3(CIP_ConnectionManager * manager)
+{
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    CipUsint packet[64];
+    CipUsint reply[600];
+    CipUsint first_reply[600];
+    EncapsulationData data;
+    data.current_communication_buffer_position = packet;
+    CIP_RequestContext * context = begin_request(kEipInvalidSocket);
+
+    CIP_MessageRouter::RegisterCIPClass((void*)CIP_ConnectionManager::GetClass(), CIP_ConnectionManager::class_id);
+
+    build_forward_open(&req, 40, false);
+    if (forward_open(manager, &req, &resp).status != kCipGeneralStatusCodeSuccess)
+        return false;
+    CipUdint connection_id = CIP_ConnectionManager::FindConnection(40, 0x1234, 0xCAFE)->consuming_instance->CIP_consumed_connection_id;
+    if (CIP_ConnectionManager::FindConnection(40, 0x1234, 0xCAFE) != CIP_ConnectionManager::FindConnectionById(connection_id))
+        return false;
+
+    //Connection_timeouts read over the connection
+        data.data_length = build_get_counter_packet(packet, true, connection_id, 1, 8);
+        int first_length = CIP_CommonPacket::NotifyConnectedCommonPacketFormat(context, &data, first_reply);
+        if ((first_length < 2) || (first_reply[first_length - 2] != (manager->Connection_timeouts & 0xFF))
+            || (first_reply[first_length - 1] != (manager->Connection_timeouts >> 8)))
+            return false;
+
+    //The retransmission gets the first reply, not the changed counter
+        manager->Connection_timeouts++;
+        int length = CIP_CommonPacket::NotifyConnectedCommonPacketFormat(context, &data, reply);
+        if ((length != first_length) || (0 != memcmp(reply, first_reply, (size_t) length)))
+            return false;
+
+        data.data_length = build_get_counter_packet(packet, true, connection_id, 2, 8);
+        length = CIP_CommonPacket::NotifyConnectedCommonPacketFormat(context, &data, reply);
+        manager->Connection_timeouts--;
+        if ((length != first_length) || (reply[length - 2] != ((manager->Connection_timeouts + 1) & 0xFF)))
+            return false;
+
+    //Unknown connection id
+        data.data_length = build_get_counter_packet(packet, true, connection_id + 1, 3, 8);
+        if (kCipStatusError != CIP_CommonPacket::NotifyConnectedCommonPacketFormat(context, &data, reply))
+            return false;
+
+    //Many requests in a row, connected and unconnected
+        for (CipUdint i = 0; i < EXPLICIT_REQUESTS; i++)
+        {
+            data.data_length = build_get_counter_packet(packet, true, connection_id, (CipUint) (i + 10), 1);
+            if (0 >= CIP_CommonPacket::NotifyConnectedCommonPacketFormat(context, &data, reply))
+                return false;
+        }
+
+        for (CipUdint i = 0; i < EXPLICIT_REQUESTS; i++)
+        {
+            data.data_length = build_get_counter_packet(packet, false, 0, 0, 1);
+            if (0 >= CIP_CommonPacket::NotifyCommonPacketFormat(context, &data, reply))
+                return false;
+        }
+
+    build_forward_close(&req, 40);
+    manager->InstanceServices(req.service, &req, &resp);
+
+    return (nullptr == CIP_ConnectionManager::FindConnectionById(connection_id))
+           && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (NET_BufferPool::GetNumberOfFreeBuffers(NET_BufferPool::kBufferClassExplicit) == OPENER_EXPLICIT_FRAME_BUFFERS);
+}
+
+// A 1 MB parameter set is written to a data point and read back over a class 5
+// connection, one fragment per SendUnitData on a loopback TCP connection
+bool test_fragmented_transfer(CIP_ConnectionManager * manager)
+{
+    static CipByte device_parameters[FRAGMENTED_TRANSFER_SIZE];
+    static CipByte parameters[FRAGMENTED_TRANSFER_SIZE];
+    static CipByte uploaded_parameters[FRAGMENTED_TRANSFER_SIZE];
+    static CipUsint frame[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    static CipUsint reply[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    //reply frame: encapsulation header, connected reply header and the fragment header
+    const int reply_header_length = ENCAPSULATION_HEADER_LENGTH + 22 + 1;
+    const CipUint max_fragment_data = FRAGMENTED_CONNECTION_SIZE - 2 - 1;
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+    int reply_length;
+
+    for (CipUdint i = 0; i < FRAGMENTED_TRANSFER_SIZE; i++)
+        parameters[i] = (CipByte) (i ^ (i >> 8));
+    CIP_Connection_Fragmentation::ConfigureDataPoint(PARAMETER_DATA_POINT, device_parameters, sizeof(device_parameters));
+
+    NET_Connection listener, originator, target;
+    NET_EthIP_Encap::EncapsulationInit();
+    if (!connect_originator(&listener, &originator, &target, &req))
+        return false;
+
+    //Register a session
+        CipUsint *message = put_encapsulation_header(frame, 0x65, 0, 4);
+        put_uint(message, 1);
+        put_uint(message, 0);
+        if (ENCAPSULATION_HEADER_LENGTH + 4 != exchange(&originator, &target, frame, ENCAPSULATION_HEADER_LENGTH + 4, reply))
+            return false;
+        CipUdint session_handle = (CipUdint) (reply[4] | (reply[5] << 8) | (reply[6] << 16) | (reply[7] << 24));
+
+        build_fragmented_forward_open(&req, 50, PARAMETER_DATA_POINT);
+        if (manager->InstanceServices(req.service, &req, &resp).status != kCipGeneralStatusCodeSuccess)
+            return false;
+        CIP_ConnectionManager *connection = CIP_ConnectionManager::FindConnection(50, 0x1234, 0xCAFE);
+        CipUdint connection_id = connection->consuming_instance->CIP_consumed_connection_id;
+        CipUint sequence_count = 1;
+
+    //Write, each fragment is acknowledged
+        CipUdint offset = 0;
+        CipUsint count = 0;
+        CipUint frame_length = 0;
+        while (offset < FRAGMENTED_TRANSFER_SIZE)
+        {
+            CipUint length = (CipUint) ((0 == offset) ? max_fragment_data - 4 : max_fragment_data);
+            if (FRAGMENTED_TRANSFER_SIZE - offset < length)
+                length = (CipUint) (FRAGMENTED_TRANSFER_SIZE - offset);
+            CipUsint type = (0 == offset) ? CIP_Connection_Fragmentation::kFragmentTypeFirst
+                : ((offset + length == FRAGMENTED_TRANSFER_SIZE) ? CIP_Connection_Fragmentation::kFragmentTypeLast
+                                                                   : CIP_Connection_Fragmentation::kFragmentTypeMiddle);
+            frame_length = build_fragment_frame(frame, session_handle, connection_id, sequence_count++,
+                                                (CipUsint) ((type << 6) | count), FRAGMENTED_TRANSFER_SIZE,
+                                                parameters + offset, length);
+            reply_length = exchange(&originator, &target, frame, frame_length, reply);
+            if ((reply_header_length + 1 != reply_length)
+                || (reply[reply_header_length - 1] != ((CIP_Connection_Fragmentation::kFragmentTypeAcknowledge << 6) | count))
+                || (kCipGeneralStatusCodeSuccess != reply[reply_header_length]))
+                return false;
+            offset += length;
+            count = (CipUsint) ((count + 1) & CIP_Connection_Fragmentation::kFragmentCountMask);
+        }
+
+        if ((0 != memcmp(device_parameters, parameters, FRAGMENTED_TRANSFER_SIZE))
+            || (1 != connection->consuming_instance->Fragmentation.GetCompletedWrites()))
+            return false;
+
+    //A retransmitted fragment is answered again, but not written again
+        if ((reply_header_length + 1 != exchange(&originator, &target, frame, frame_length, reply))
+            || (1 != connection->consuming_instance->Fragmentation.GetCompletedWrites()))
+            return false;
+
+    //Read back, each acknowledge asks for the next fragment
+        offset = 0;
+        count = 0;
+        bool done = false;
+        while (!done)
+        {
+            frame_length = build_fragment_frame(frame, session_handle, connection_id, sequence_count++,
+                                                (CipUsint) ((CIP_Connection_Fragmentation::kFragmentTypeAcknowledge << 6) | count),
+                                                0, nullptr, 0);
+            reply_length = exchange(&originator, &target, frame, frame_length, reply);
+            CipUsint type = (CipUsint) (reply[reply_header_length - 1] >> 6);
+            int data_start = reply_header_length + ((CIP_Connection_Fragmentation::kFragmentTypeFirst == type) ? 4 : 0);
+            if ((reply_length < data_start) || (CIP_Connection_Fragmentation::kFragmentTypeAcknowledge == type)
+                || (offset + (reply_length - data_start) > FRAGMENTED_TRANSFER_SIZE))
+                return false;
+            memcpy(uploaded_parameters + offset, reply + data_start, (size_t) (reply_length - data_start));
+            offset += reply_length - data_start;
+            done = (CIP_Connection_Fragmentation::kFragmentTypeLast == type);
+            count = (CipUsint) ((count + 1) & CIP_Connection_Fragmentation::kFragmentCountMask);
+        }
+
+        if ((FRAGMENTED_TRANSFER_SIZE != offset) || (0 != memcmp(uploaded_parameters, parameters, FRAGMENTED_TRANSFER_SIZE)))
+            return false;
+
+    build_forward_close(&req, 50);
+    manager->InstanceServices(req.service, &req, &resp);
+    CIP_Connection_Fragmentation::ClearDataPoints();
+
+    return (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (NET_BufferPool::GetNumberOfFreeBuffers(NET_BufferPool::kBufferClassExplicit) == OPENER_EXPLICIT_FRAME_BUFFERS);
+}
+
+// The stack runs for a while once it is up: sessions, class 3 and I/O connections
+// are opened and closed over and over, requests and frames flow in between.
+// None of it may allocate from the heap.
+bool test_static_memory_soak(CIP_ConnectionManager * manager)
+{
+    static CipByte output_data[8];
+    static CipByte input_data[8];
+    static CipUsint open_explicit_frame[128], close_explicit_frame[64], open_io_frame[128], close_io_frame[64];
+    static CipUsint get_frame[64], unconnected_get_frame[64];
+    static CipUsint reply[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    //general status of a SendRRData reply: encapsulation header, command specific data, items, reply service
+    const int general_status_offset = ENCAPSULATION_HEADER_LENGTH + 16 + 2;
+    CipMessageRouterRequest_t req;
+    CipUsint frame[64];
+    CipUdint requests = 0, frames = 0;
+
+    NET_Connection listener, originator, target;
+    NET_EthIP_Encap::EncapsulationInit();
+    if (!connect_originator(&listener, &originator, &target, &req))
+        return false;
+
+    CipUsint output_assembly = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(output_data, sizeof(output_data));
+    CIP_Assembly::Create(input_data, sizeof(input_data));
+    CIP_AppConnType::ConfigureExclusiveOwnerConnectionPoint(0, output_assembly, output_assembly + 1, 1);
+
+    //All frames are built up front, the loop only patches ids and sequence counts
+        CipUsint *message = put_encapsulation_header(frame, 0x65, 0, 4);
+        put_uint(message, 1);
+        put_uint(message, 0);
+        if (ENCAPSULATION_HEADER_LENGTH + 4 != exchange(&originator, &target, frame, ENCAPSULATION_HEADER_LENGTH + 4, reply))
+            return false;
+        CipUdint session_handle = (CipUdint) (reply[4] | (reply[5] << 8) | (reply[6] << 16) | (reply[7] << 24));
+
+        build_forward_open(&req, 60, false);
+        CipUint open_explicit_length = build_rr_data_frame(open_explicit_frame, session_handle, req.service,
+                                                           (CipUsint) CIP_ConnectionManager::class_id, req.request_data);
+        build_forward_close(&req, 60);
+        CipUint close_explicit_length = build_rr_data_frame(close_explicit_frame, session_handle, req.service,
+                                                            (CipUsint) CIP_ConnectionManager::class_id, req.request_data);
+        build_large_forward_open_owner(&req, 61, sizeof(output_data) + 6, sizeof(input_data) + 2,
+                                       output_assembly, output_assembly + 1, 1);
+        CipUint open_io_length = build_rr_data_frame(open_io_frame, session_handle, req.service,
+                                                     (CipUsint) CIP_ConnectionManager::class_id, req.request_data);
+        build_forward_close(&req, 61);
+        CipUint close_io_length = build_rr_data_frame(close_io_frame, session_handle, req.service,
+                                                      (CipUsint) CIP_ConnectionManager::class_id, req.request_data);
+
+        //SendUnitData of a Get_Attribute_Single, the connection id is at 6 and the sequence count at 14
+        CipUsint *get_packet = get_frame + ENCAPSULATION_HEADER_LENGTH + 6;
+        CipUint get_packet_length = build_get_counter_packet(get_packet, true, 0, 0, 1);
+        message = put_encapsulation_header(get_frame, 0x70, session_handle, (CipUint) (6 + get_packet_length));
+        put_udint(message, 0);
+        put_uint(message, 0);
+        CipUint get_length = (CipUint) (ENCAPSULATION_HEADER_LENGTH + 6 + get_packet_length);
+
+        const CipUsint attribute[] = { 0x30, 0x01 };
+        std::vector<CipUsint> attribute_path(attribute, attribute + sizeof(attribute));
+        CipUint unconnected_get_length = build_rr_data_frame(unconnected_get_frame, session_handle, 0x0E,
+                                                             (CipUsint) CIP_ConnectionManager::class_id, attribute_path);
+        unconnected_get_frame[ENCAPSULATION_HEADER_LENGTH + 17] = 3; // path size with the attribute
+
+        //I/O frame, the connection id is at 6, the sequence number at 10 and the sequence count at 18
+        int frame_length = build_io_frame(frame, 0, 0, 0, output_data, sizeof(output_data));
+
+    CipUdint sequence = 0;
+    for (CipUdint cycle = 0; cycle <= SOAK_CYCLES; cycle++)
+    {
+        //the first cycle warms up, anything sized on first use is allocated by then
+        if (1 == cycle)
+            StaticMemory::Seal();
+
+        if ((general_status_offset >= exchange(&originator, &target, open_explicit_frame, open_explicit_length, reply))
+            || (kCipGeneralStatusCodeSuccess != reply[general_status_offset])
+            || (general_status_offset >= exchange(&originator, &target, open_io_frame, open_io_length, reply))
+            || (kCipGeneralStatusCodeSuccess != reply[general_status_offset]))
+            break;
+        CipUdint explicit_id = CIP_ConnectionManager::FindConnection(60, 0x1234, 0xCAFE)->consuming_instance->CIP_consumed_connection_id;
+        CIP_ConnectionManager * io_connection = CIP_ConnectionManager::FindConnection(61, 0x1234, 0xCAFE);
+        CipUdint io_id = io_connection->consuming_instance->CIP_consumed_connection_id;
+        struct sockaddr_in from_address = io_connection->originator_address;
+
+        for (CipUint i = 0; i < SOAK_REQUESTS_PER_CYCLE; i++)
+        {
+            sequence++;
+            message = get_packet + 6;
+            put_udint(message, explicit_id);
+            message = get_packet + 14;
+            put_uint(message, (CipUint) sequence);
+            if ((0 >= exchange(&originator, &target, get_frame, get_length, reply))
+                || (general_status_offset >= exchange(&originator, &target, unconnected_get_frame, unconnected_get_length, reply))
+                || (kCipGeneralStatusCodeSuccess != reply[general_status_offset]))
+                break;
+            requests += 2;
+
+            message = frame + 6;
+            put_udint(message, io_id);
+            put_udint(message, sequence);
+            message = frame + 18;
+            put_uint(message, (CipUint) sequence);
+            if (kCipStatusOk != CIP_ConnectionManager::HandleReceivedConnectedData(frame, frame_length, &from_address).status)
+                break;
+            frames++;
+            CIP_ConnectionManager::ManageConnections(kOpENerTimerTickInMilliSeconds);
+        }
+
+        if ((general_status_offset >= exchange(&originator, &target, close_explicit_frame, close_explicit_length, reply))
+            || (general_status_offset >= exchange(&originator, &target, close_io_frame, close_io_length, reply)))
+            break;
+    }
+    StaticMemory::Unseal();
+    CipUdint allocations = StaticMemory::GetSealedAllocations();
+
+    return (0 == allocations)
+           && (requests == 2 * (SOAK_CYCLES + 1) * SOAK_REQUESTS_PER_CYCLE)
+           && (frames == (SOAK_CYCLES + 1) * SOAK_REQUESTS_PER_CYCLE)
+           && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS)
+           && (CIP_Connection::GetNumberOfFreeConnections() == CIP_CONNECTION_POOL_SIZE);
+}
+
+int main()
+{
+    CIP_Connection::Init();
+    CIP_ConnectionManager::Init();
+
+    CIP_ConnectionManager * manager = (CIP_ConnectionManager*)CIP_ConnectionManager::GetInstance(0);
+
+    if ( !test_forward_open(manager) )
+        return -1;
+
+    if ( !test_truncated_path(manager) )
+        return -1;
+
+    if ( !test_pool_exhaustion(manager) )
+        return -1;
+
+    if ( !test_reconnect_storm(manager) )
+        return -1;
+
+    if ( !test_connection_sizes(manager) )
+        return -1;
+
+    if ( !test_large_assemblies(manager) )
+        return -1;
+
+    if ( !test_multicast_producer(manager) )
+        return -1;
+
+    if ( !test_consuming_sequence(manager) )
+        return -1;
+
+    if ( !test_point_to_point_producer(manager) )
+        return -1;
+
+    if ( !test_watchdog(manager) )
+        return -1;
+
+    if ( !test_class3(manager) )
+        return -1;
+
+    if ( !test_fragmented_transfer(manager) )
+        return -1;
+
+    if ( !test_static_memory_soak(manager) )
+        return -1;
+
+    CIP_ConnectionManager::Shut();
+    CIP_Connection::Shut();
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+//
+// Created by Gabriel Ferreira (@gabrielcarvfer)
+//
+
+#ifndef OPENERMAIN_TEST_CIP_CONNECTIONMANAGER_H
+#define OPENERMAIN_TEST_CIP_CONNECTIONMANAGER_H
+
+
+#include "cip/CIP_Objects/CIP_0005_Connection/CIP_Connection.hpp"
+#include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "cip/CIP_Objects/CIP_0004_Assembly/CIP_Assembly.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/CIP_AppConnType.hpp"
+#include "cip/connection/network/NET_BufferPool.hpp"
+#include "cip/CIP_Objects/CIP_0002_MessageRouter/CIP_MessageRouter.hpp"
+#include "cip/connection/CIP_CommonPacket.hpp"
+
+
+
+#endif //OPENERMAIN_TEST_CIP_CONNECTIONMANAGER_H
@@ -0,0 +1,139 @@
+//
+// QoS object, the DSCP values the I/O and explicit messages are marked with
+//
+
+#include "CIP_QoS.hpp"
+
+CipStatus CIP_QoS::Init()
+{
+    CipStatus stat;
+    if (number_of_instances == 0)
+    {
+        revision = 1;
+        class_name = "QoS";
+        class_id = kCipQoSClassCode;
+
+        CIP_QoS * instance = new CIP_QoS();
+        for (int i = 0; i < NET_Connection::kNumberOfTrafficClasses; i++)
+        {
+            instance->Dscp[i] = NET_Connection::GetDscp((NET_Connection::TrafficClass_e) i);
+        }
+
+        instance->instAttrInfo.emplace(4, CipAttrInfo_t{kCipUsint, sizeof(CipUsint), kAttrFlagSetAndGetAble, "DSCPUrgent"   } );
+        instance->instAttrInfo.emplace(5, CipAttrInfo_t{kCipUsint, sizeof(CipUsint), kAttrFlagSetAndGetAble, "DSCPScheduled"} );
+        instance->instAttrInfo.emplace(6, CipAttrInfo_t{kCipUsint, sizeof(CipUsint), kAttrFlagSetAndGetAble, "DSCPHigh"     } );
+        instance->instAttrInfo.emplace(7, CipAttrInfo_t{kCipUsint, sizeof(CipUsint), kAttrFlagSetAndGetAble, "DSCPLow"      } );
+        instance->instAttrInfo.emplace(8, CipAttrInfo_t{kCipUsint, sizeof(CipUsint), kAttrFlagSetAndGetAble, "DSCPExplicit" } );
+
+        instance->classServicesProperties.emplace(kQoSServiceGetAttributeSingle, CipServiceProperties_t{ "GetAttributeSingle" });
+        instance->classServicesProperties.emplace(kQoSServiceSetAttributeSingle, CipServiceProperties_t{ "SetAttributeSingle" });
+
+        //there is a single set of values, it is served by the class instance as in the Ethernet Link
+        AddClassInstance(instance, 0);
+
+        stat.status = kCipStatusOk;
+    }
+    else
+    {
+        stat.status = kCipStatusError;
+    }
+
+    return stat;
+}
+
+CipStatus CIP_QoS::Shut()
+{
+    return kCipGeneralStatusCodeSuccess;
+}
+
+NET_Connection::TrafficClass_e CIP_QoS::GetTrafficClass(CipUsint attribute_number)
+{
+    switch (attribute_number)
+    {
+        case 4: return NET_Connection::kTrafficUrgent;
+        case 5: return NET_Connection::kTrafficScheduled;
+        case 6: return NET_Connection::kTrafficHigh;
+        case 7: return NET_Connection::kTrafficLow;
+        case 8: return NET_Connection::kTrafficExplicit;
+        default: return NET_Connection::kTrafficUnmarked;
+    }
+}
+
+void * CIP_QoS::retrieveAttribute(CipUsint attributeNumber)
+{
+    NET_Connection::TrafficClass_e traffic_class = GetTrafficClass(attributeNumber);
+    if ((this->id == 0) && (NET_Connection::kTrafficUnmarked != traffic_class))
+    {
+        return &this->Dscp[traffic_class];
+    }
+    return nullptr;
+}
+
+CipStatus CIP_QoS::retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
+{
+    switch (serviceNumber)
+    {
+        case kQoSServiceGetAttributeSingle: return this->GetAttributeSingleQoS(req, resp);
+        case kQoSServiceSetAttributeSingle: return this->SetAttributeSingleQoS(req, resp);
+        default:
+            return CipStatus(kCipGeneralStatusCodeServiceNotSupported);
+    }
+}
+
+CipStatus CIP_QoS::GetAttributeSingleQoS(CipMessageRouterRequest_t* message_router_request,
+                                         CipMessageRouterResponse_t* message_router_response)
+{
+    CipUsint * dscp = (CipUsint *) retrieveAttribute(message_router_request->request_path.attribute_number);
+
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->size_additional_status = 0;
+    message_router_response->response_data.clear();
+
+    if (nullptr == dscp)
+    {
+        message_router_response->general_status = kCipGeneralStatusCodeAttributeNotSupported;
+        return kCipGeneralStatusCodeSuccess;
+    }
+    message_router_response->response_data.push_back(*dscp);
+    message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+    return kCipGeneralStatusCodeSuccess;
+}
+
+CipStatus CIP_QoS::SetAttributeSingleQoS(CipMessageRouterRequest_t* message_router_request,
+                                         CipMessageRouterResponse_t* message_router_response)
+{
+    CipUsint attribute_number = message_router_request->request_path.attribute_number;
+    CipUsint * dscp = (CipUsint *) retrieveAttribute(attribute_number);
+    const std::vector<CipUsint> & data = message_router_request->request_data;
+
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->size_additional_status = 0;
+    message_router_response->response_data.clear();
+
+    if (nullptr == dscp)
+    {
+        message_router_response->general_status = kCipGeneralStatusCodeAttributeNotSupported;
+    }
+    else if (data.empty())
+    {
+        message_router_response->general_status = kCipGeneralStatusCodeNotEnoughData;
+    }
+    else if (1 < data.size())
+    {
+        message_router_response->general_status = kCipGeneralStatusCodeTooMuchData;
+    }
+    else if (kQoSMaximumDscp < data[0])
+    {
+        message_router_response->general_status = kCipGeneralStatusCodeInvalidAttributeValue;
+    }
+    else
+    {
+        *dscp = data[0];
+        NET_Connection::SetDscp(GetTrafficClass(attribute_number), data[0]);
+        OPENER_TRACE_INFO("QoS: attribute %d set to DSCP %d\n", attribute_number, data[0]);
+        message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+    }
+    return kCipGeneralStatusCodeSuccess;
+}
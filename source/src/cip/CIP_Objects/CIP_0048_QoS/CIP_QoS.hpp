@@ -0,0 +1,58 @@
+//
+// QoS object, the DSCP values the I/O and explicit messages are marked with
+//
+
+#ifndef CIP_CLASSES_QOS_H
+#define CIP_CLASSES_QOS_H
+
+#include "../../ciptypes.hpp"
+#include "cip/CIP_Objects/template/CIP_Object_template.hpp"
+#include "../../connection/network/NET_Connection.hpp"
+
+/**
+ * @brief CIP_QoS keeps the DSCP values of the traffic classes, Vol 2 Chapter 5-7
+ *
+ * The attributes 4 to 8 hold the DSCP of the urgent, scheduled, high and low
+ * priority I/O frames and of the explicit messages. A Set_Attribute_Single is
+ * handed to NET_Connection::SetDscp, sockets opened from then on are marked
+ * with the new value, open connections keep theirs until they are reopened.
+ * A producing I/O socket gets the class of the T->O priority of its
+ * Forward_Open, see CIP_ConnectionManager::GetProducingTrafficClass.
+ *
+ * 802.1Q tagging and the PTP event and general values are not supported.
+ */
+class CIP_QoS : public CIP_Object_template<CIP_QoS>
+{
+public:
+    /** @brief Initialize the QoS object with the DSCP values in use */
+    static CipStatus Init();
+    static CipStatus Shut();
+
+    typedef enum {
+        kQoSServiceGetAttributeSingle = 0x0E,
+        kQoSServiceSetAttributeSingle = 0x10
+    } qos_services_e;
+
+    /** @brief Largest DSCP, it has six bits */
+    static const CipUsint kQoSMaximumDscp = 63;
+
+private:
+    //Methods
+    /** @brief Traffic class of a DSCP attribute, kTrafficUnmarked if there is none */
+    static NET_Connection::TrafficClass_e GetTrafficClass(CipUsint attribute_number);
+
+    CipStatus GetAttributeSingleQoS(CipMessageRouterRequest_t* message_router_request,
+                                    CipMessageRouterResponse_t* message_router_response);
+
+    /** @brief Set_Attribute_Single of a DSCP attribute, values above kQoSMaximumDscp are rejected */
+    CipStatus SetAttributeSingleQoS(CipMessageRouterRequest_t* message_router_request,
+                                    CipMessageRouterResponse_t* message_router_response);
+
+    //Instance attributes, indexed by NET_Connection::TrafficClass_e
+    CipUsint Dscp[NET_Connection::kNumberOfTrafficClasses];
+
+    void * retrieveAttribute(CipUsint attributeNumber);
+    CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
+};
+
+#endif /* CIP_CLASSES_QOS_H*/
@@ -0,0 +1,83 @@
+//
+// Tests of the QoS object
+//
+
+#include "TEST_Cip_QoS.hpp"
+#include <cip/ciptypes.hpp>
+#include <cip/ciperror.hpp>
+
+static CipStatus request(CIP_QoS * qos, CipUsint service, CipUsint attribute, const std::vector<CipUsint> & data,
+                         CipMessageRouterResponse_t * resp)
+{
+    CipMessageRouterRequest_t req;
+    req.service = service;
+    req.request_path.attribute_number = attribute;
+    req.request_data = data;
+    return qos->InstanceServices(service, &req, resp);
+}
+
+// The DSCP attributes start with the values of the specification
+bool test_default_dscp(CIP_QoS * qos)
+{
+    const CipUsint defaults[5] = { 55, 47, 43, 31, 27 };
+    CipMessageRouterResponse_t resp;
+
+    for (CipUsint attribute = 4; attribute <= 8; attribute++)
+    {
+        request(qos, CIP_QoS::kQoSServiceGetAttributeSingle, attribute, {}, &resp);
+        if ((kCipGeneralStatusCodeSuccess != resp.general_status) || (1 != resp.response_data.size())
+            || (defaults[attribute - 4] != resp.response_data[0]))
+            return false;
+    }
+
+    request(qos, CIP_QoS::kQoSServiceGetAttributeSingle, 1, {}, &resp);
+    return (kCipGeneralStatusCodeAttributeNotSupported == resp.general_status) && (0x8E == resp.reply_service);
+}
+
+// A DSCP that is set marks the sockets opened from then on, values beyond six bits are rejected
+bool test_set_dscp(CIP_QoS * qos)
+{
+    CipMessageRouterResponse_t resp;
+
+    request(qos, CIP_QoS::kQoSServiceSetAttributeSingle, 8, { 64 }, &resp);
+    if ((kCipGeneralStatusCodeInvalidAttributeValue != resp.general_status)
+        || (27 != NET_Connection::GetDscp(NET_Connection::kTrafficExplicit)))
+        return false;
+
+    request(qos, CIP_QoS::kQoSServiceSetAttributeSingle, 8, { 10, 0 }, &resp);
+    if (kCipGeneralStatusCodeTooMuchData != resp.general_status)
+        return false;
+
+    request(qos, CIP_QoS::kQoSServiceSetAttributeSingle, 8, { 40 }, &resp);
+    if ((kCipGeneralStatusCodeSuccess != resp.general_status)
+        || (40 != NET_Connection::GetDscp(NET_Connection::kTrafficExplicit)))
+        return false;
+
+    NET_Connection session;
+    session.InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    session.ApplyProfile(NET_Connection::kSocketTcpSession);
+    int type_of_service = 0;
+    socklen_t option_length = sizeof(type_of_service);
+    getsockopt(session.GetSocketHandle(), IPPROTO_IP, IP_TOS, (char *) &type_of_service, &option_length);
+
+    request(qos, CIP_QoS::kQoSServiceGetAttributeSingle, 8, {}, &resp);
+    bool replied = (1 == resp.response_data.size()) && (40 == resp.response_data[0]);
+    request(qos, CIP_QoS::kQoSServiceSetAttributeSingle, 8, { 27 }, &resp);
+    return replied && ((40 << 2) == type_of_service);
+}
+
+int main()
+{
+    CIP_QoS::Init();
+    CIP_QoS * qos = (CIP_QoS*)CIP_QoS::GetInstance(0);
+    if (nullptr == qos)
+        return -1;
+
+    if ( !test_default_dscp(qos) )
+        return -1;
+
+    if ( !test_set_dscp(qos) )
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+//
+// Tests of the QoS object
+//
+
+#ifndef OPENERMAIN_TEST_CIP_QOS_H
+#define OPENERMAIN_TEST_CIP_QOS_H
+
+#include "cip/CIP_Objects/CIP_0048_QoS/CIP_QoS.hpp"
+
+#endif //OPENERMAIN_TEST_CIP_QOS_H
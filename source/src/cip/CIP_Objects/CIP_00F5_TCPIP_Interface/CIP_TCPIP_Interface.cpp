@@ -9,6 +9,7 @@
 #include "../../ciptypes.hpp"
 #include "CIP_TCPIP_Interface.hpp"
 #include "../../connection/network/NET_Connection.hpp"
+#include "../../connection/network/NET_LinkMonitor.hpp"
 
 #undef WIN
 #if defined(_WIN32) || defined(WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
@@ -24,12 +25,6 @@
     
 
 	#pragma comment(lib, "iphlpapi.lib")
-#elif __linux__
-    #include <netdb.h>
-    #include <ifaddrs.h>
-    #include <net/if.h>
-    #include <sys/ioctl.h>
-
 #endif
 
 //Defines
@@ -57,6 +52,23 @@ CipStatus CIP_TCPIP_Interface::ConfigureNetworkInterface(const char* ip_address,
     return kCipGeneralStatusCodeSuccess;
 }
 
+void CIP_TCPIP_Interface::ConfigureInterfaceAddress(CipUdint ip_address, CipUdint network_mask)
+{
+    interface_configuration_.ip_address = ip_address;
+    interface_configuration_.network_mask = network_mask;
+    if (INADDR_ANY == ip_address)
+    {
+        return;
+    }
+
+    // see CIP spec 3-5.3 for multicast address algorithm, as in ConfigureNetworkInterface
+    CipUdint host_id = NET_Connection::endian_ntohl(ip_address) & ~NET_Connection::endian_ntohl(network_mask);
+    host_id -= 1;
+    host_id &= 0x3ff;
+
+    g_multicast_configuration.starting_multicast_address = htonl(ntohl(inet_addr("239.192.1.0")) + (host_id << 5));
+}
+
 void CIP_TCPIP_Interface::ConfigureDomainName(CipString * domain_name)
 {
     if (nullptr != interface_configuration.domain_name.string)
@@ -146,7 +158,7 @@ CipStatus CIP_TCPIP_Interface::Init()
 
         //Class optional attributes (4-7) from Vol 1 Chapter 4
 
-        object_Set.emplace (instance->id, instance);
+        AddClassInstance(instance, instance->id);
         
         //Setup instance attributes
         //Instance attributes
@@ -193,7 +205,7 @@ CipStatus CIP_TCPIP_Interface::Create()
     instance->interface_configuration = {0, 0, 0, 0, 0, {0, nullptr,}};
     //instance->host_name
 
-    object_Set.emplace(instance->id, instance);
+    AddClassInstance(instance, instance->id);
 
     CipStatus stat;
     stat.status = kCipGeneralStatusCodeSuccess;
@@ -322,6 +334,14 @@ int GetInterfacesList(ip_interface **interface_ptr);
 //Scan for avaible tcpip interfaces
 CipStatus CIP_TCPIP_Interface::ScanInterfaces()
 {
+#ifdef __linux__
+    //the link monitor reads the interface and keeps following it
+    if (NET_LinkMonitor::IsActive())
+    {
+        return kCipGeneralStatusCodeSuccess;
+    }
+    return NET_LinkMonitor::Start(nullptr);
+#else
     ip_interface ** interfaces = (ip_interface**)calloc(1,sizeof(ip_interface*));
 
     //Get interfaces list
@@ -341,6 +361,7 @@ CipStatus CIP_TCPIP_Interface::ScanInterfaces()
     delete[] *interfaces;
     free(interfaces);
 	return kCipGeneralStatusCodeSuccess;
+#endif
 }
 
 #undef WIN
@@ -463,97 +484,6 @@ CipStatus CIP_TCPIP_Interface::ScanInterfaces()
         WSACleanup();
         return nNumInterfaces;
     }
-#elif __linux__
-int GetInterfacesList(ip_interface **interface_ptr)
-{
-    struct ifaddrs *ifaddr, *ifa;
-    int family, s, i;
-    char host[NI_MAXHOST];
-
-    if (getifaddrs(&ifaddr) == -1)
-    {
-        perror("getifaddrs");
-        exit(EXIT_FAILURE);
-    }
-
-    /* Walk through linked list, maintaining head pointer so we
-       can free list later */
-    for (ifa = ifaddr, i = 0; ifa != nullptr; ifa = ifa->ifa_next, i++)
-    {
-        if (ifa->ifa_addr == nullptr)
-            continue;
-    }
-
-    *interface_ptr = new ip_interface[i]();
-
-    for (ifa = ifaddr, i = 0; ifa != nullptr; ifa = ifa->ifa_next, i++)
-    {
-        if (ifa->ifa_addr == nullptr || ((family = ifa->ifa_addr->sa_family) != AF_INET))
-            continue;
-
-            s = getnameinfo(
-                            ifa->ifa_addr,
-                            sizeof(struct sockaddr_in),
-                            host,
-                            NI_MAXHOST,
-                            nullptr,
-                            0,
-                            NI_NUMERICHOST
-                            );
-            if (s != 0)
-            {
-                //printf("getnameinfo() failed: %s\n", gai_strerror(s));
-                exit(EXIT_FAILURE);
-            }
-
-            int fd;
-            unsigned char *mac_ptr = nullptr;
-            char mac[18];
-            struct ifreq ifr;
-
-            memset(&ifr, 0, sizeof(ifr));
-            memset(&mac[0],0,13);
-
-            fd = socket(AF_INET, SOCK_DGRAM, 0);
-
-            ifr.ifr_addr.sa_family = AF_INET;
-            strncpy(ifr.ifr_name , ifa->ifa_name , IFNAMSIZ-1);
-
-            ioctl(fd, SIOCGIFHWADDR, &ifr);
-            mac_ptr = (unsigned char *)ifr.ifr_hwaddr.sa_data;
-            sprintf(&mac[0], "%.2X:%.2X:%.2X:%.2X:%.2X:%.2X", mac_ptr[0], mac_ptr[1], mac_ptr[2], mac_ptr[3], mac_ptr[4], mac_ptr[5]);
-
-            printf("%s\t%s\tmac:<%s>\taddress: <%s>\n", ifa->ifa_name, "AF_INET", mac, host);
-
-            //Mark tcp/ip interface version
-        (*interface_ptr)[i].v4 = true;
-
-        //Copy ip address
-        strcpy(&((*interface_ptr)[i].ipv4.ip)[0], host);
-
-        //Copy MAC address
-        strcpy(&((*interface_ptr)[i].mac)[0], mac);
-
-        //Copy broadcast ip
-        inet_ntop( AF_INET, ifa->ifa_ifu.ifu_broadaddr, &((*interface_ptr)[i].ipv4.bcast_ip)[0], INET_ADDRSTRLEN);
-
-        //Copy netmask
-        inet_ntop( AF_INET,ifa->ifa_netmask, &((*interface_ptr)[i].ipv4.netmask)[0], INET_ADDRSTRLEN);
-
-        //Copy flags
-        u_long nFlags = (u_long) ifr.ifr_flags;
-        (*interface_ptr)[i].up       = (bool) nFlags & IFF_UP;
-        (*interface_ptr)[i].p2p      = (bool) nFlags & IFF_POINTOPOINT;
-        (*interface_ptr)[i].loopback = (bool) nFlags & IFF_LOOPBACK;
-        (*interface_ptr)[i].bcast    = (bool) nFlags & IFF_BROADCAST;
-        (*interface_ptr)[i].mcast    = (bool) nFlags & IFF_MULTICAST;
-
-
-    }
-
-    freeifaddrs(ifaddr);
-    return i;
-}
 #endif
 
 void * CIP_TCPIP_Interface::retrieveAttribute(CipUsint attributeNumber)
@@ -137,8 +137,21 @@ public:
  * Currently we implement it non set-able and with the default value of 1.
  */
     static CipUsint g_time_to_live_value;
+
+    /** @brief Follow the interface the stack runs on, see NET_LinkMonitor
+     *
+     * Called after the network handler is initialized. The address, network
+     * mask, physical address and link state are read once and then updated
+     * on each change the kernel reports.
+     */
     static CipStatus ScanInterfaces();
 
+    /** @brief Set the address and network mask of attribute 5, the multicast addresses are calculated again
+     *
+     * Both in network byte order, INADDR_ANY while the interface has no address.
+     */
+    static void ConfigureInterfaceAddress(CipUdint ip_address, CipUdint network_mask);
+
 private:
     //Instance attributes
     instance_status_t status;
@@ -5,11 +5,57 @@
  ******************************************************************************/
 #include <cstring>
 #include "CIP_EthernetIP_Link.hpp"
+#include "utils/netstatistics.hpp"
+
+static void AddDintToResponse(CipUdint value, std::vector<CipUsint> *response_data)
+{
+    response_data->push_back((CipUsint) value);
+    response_data->push_back((CipUsint) (value >> 8));
+    response_data->push_back((CipUsint) (value >> 16));
+    response_data->push_back((CipUsint) (value >> 24));
+}
 
 
 void CIP_EthernetIP_Link::ConfigureMacAddress(const CipUsint* mac_address)
 {
-    memcpy(&g_ethernet_link.physical_address, mac_address, sizeof(g_ethernet_link.physical_address));
+    CIP_EthernetIP_Link * instance = (CIP_EthernetIP_Link *) GetInstance(0);
+    if (nullptr != instance)
+    {
+        memcpy(&instance->g_ethernet_link.physical_address, mac_address, sizeof(instance->g_ethernet_link.physical_address));
+    }
+}
+
+void CIP_EthernetIP_Link::ConfigureLinkState(bool link_active, CipUdint interface_speed, bool full_duplex,
+                                             bool auto_negotiation)
+{
+    CIP_EthernetIP_Link * instance = (CIP_EthernetIP_Link *) GetInstance(0);
+    if (nullptr == instance)
+    {
+        return;
+    }
+
+    interface_flags_t flags;
+    flags.value = 0;
+    flags.bitfield_u.link_status = link_active ? interface_flag_linkStatus_active : interface_flag_linkStatus_inactive;
+    flags.bitfield_u.duplex = full_duplex ? interface_flag_duplex_full : interface_flag_duplex_half;
+    if (0 == interface_speed)
+    {
+        //nothing negotiated is known, e.g. of a virtual link
+        flags.bitfield_u.negotiation_status = link_active ? interface_flag_negotiationStatus_autoFailed
+                                                          : interface_flag_negotiationStatus_autoInProgress;
+    }
+    else if (!auto_negotiation)
+    {
+        flags.bitfield_u.negotiation_status = interface_flag_negotiationStatus_autoNotAttempted;
+    }
+    else
+    {
+        flags.bitfield_u.negotiation_status = link_active ? interface_flag_negotiationStatus_autoSucceded
+                                                          : interface_flag_negotiationStatus_autoInProgress;
+    }
+
+    instance->g_ethernet_link.interface_speed = interface_speed;
+    instance->g_ethernet_link.interface_flags = flags.value;
 }
 
 CipStatus CIP_EthernetIP_Link::Init()
@@ -34,6 +80,14 @@ CipStatus CIP_EthernetIP_Link::Init()
         instance->instAttrInfo.emplace(1, CipAttrInfo_t{kCipUdint , sizeof(CipUdint)    , kAttrFlagGetableSingleAndAll, "InterfaceSpeed" } );
         instance->instAttrInfo.emplace(2, CipAttrInfo_t{kCipDword , sizeof(CipDword)    , kAttrFlagGetableSingleAndAll, "InterfaceFlags" } );
         instance->instAttrInfo.emplace(3, CipAttrInfo_t{kCip6Usint, sizeof(CipByteArray), kAttrFlagGetableSingleAndAll, "PhysicalAddress"} );
+        instance->instAttrInfo.emplace(4, CipAttrInfo_t{kCipAny   , sizeof(interface_counters_t), kAttrFlagGetableSingleAndAll, "InterfaceCounters"} );
+        instance->instAttrInfo.emplace(5, CipAttrInfo_t{kCipAny   , sizeof(media_counters_t)    , kAttrFlagGetableSingleAndAll, "MediaCounters"} );
+
+        instance->classServicesProperties.emplace(kEthLinkServiceGetAttributeSingle, CipServiceProperties_t{ "GetAttributeSingle" });
+        instance->classServicesProperties.emplace(kEthLinkServiceGetAndClear       , CipServiceProperties_t{ "GetAndClear"        });
+
+        //there is a single link, it is served by the class instance as in the Connection Manager
+        AddClassInstance(instance, 0);
 
         stat.status = kCipStatusOk;
     }
@@ -59,6 +113,8 @@ void * CIP_EthernetIP_Link::retrieveAttribute (CipUsint attributeNumber)
             case 1: return &this->g_ethernet_link.interface_speed;
             case 2: return &this->g_ethernet_link.interface_flags;
             case 3: return &this->g_ethernet_link.physical_address;
+            case 4: return &this->Interface_counters;
+            case 5: return &this->Media_counters;
             default: return nullptr;
         }
     }
@@ -67,6 +123,80 @@ void * CIP_EthernetIP_Link::retrieveAttribute (CipUsint attributeNumber)
 
 CipStatus CIP_EthernetIP_Link::retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
 {
-	CipStatus stat;
-	return stat;
+    switch (serviceNumber)
+    {
+        case kEthLinkServiceGetAttributeSingle: return this->GetAttributeSingleEthernetLink(req, resp, false);
+        case kEthLinkServiceGetAndClear       : return this->GetAttributeSingleEthernetLink(req, resp, true);
+        default:
+            return CipStatus(kCipGeneralStatusCodeServiceNotSupported);
+    }
+}
+
+CipStatus CIP_EthernetIP_Link::GetAttributeSingleEthernetLink(CipMessageRouterRequest_t* message_router_request,
+                                                              CipMessageRouterResponse_t* message_router_response, bool clear)
+{
+    CipUsint attribute_number = message_router_request->request_path.attribute_number;
+
+    message_router_response->reply_service = (CipUsint) (0x80 | message_router_request->service);
+    message_router_response->reserved = 0;
+    message_router_response->size_additional_status = 0;
+    message_router_response->response_data.clear();
+    message_router_response->general_status = kCipGeneralStatusCodeSuccess;
+
+    switch (attribute_number)
+    {
+        case 1:
+        case 2:
+        case 3:
+            if (clear)
+            {
+                message_router_response->general_status = kCipGeneralStatusCodeAttributeNotSupported;
+                break;
+            }
+            if (3 == attribute_number)
+            {
+                message_router_response->response_data.insert(message_router_response->response_data.end(),
+                                                              g_ethernet_link.physical_address,
+                                                              g_ethernet_link.physical_address + sizeof(g_ethernet_link.physical_address));
+            }
+            else
+            {
+                AddDintToResponse((1 == attribute_number) ? g_ethernet_link.interface_speed : g_ethernet_link.interface_flags,
+                                  &message_router_response->response_data);
+            }
+            break;
+
+        case 4:
+        {
+            static_assert(sizeof(interface_counters_t) == sizeof(CipUdint) * NetStatistics::kNumberOfInterfaceCounters,
+                          "interface counters out of sync");
+            CipUdint counters[NetStatistics::kNumberOfInterfaceCounters];
+            NetStatistics::GetInterfaceCounters(counters, clear);
+            memcpy(&Interface_counters, counters, sizeof(Interface_counters));
+            for (CipUdint counter : counters)
+            {
+                AddDintToResponse(counter, &message_router_response->response_data);
+            }
+            break;
+        }
+
+        case 5:
+        {
+            static_assert(sizeof(media_counters_t) == sizeof(CipUdint) * NetStatistics::kNumberOfMediaCounters,
+                          "media counters out of sync");
+            CipUdint counters[NetStatistics::kNumberOfMediaCounters];
+            NetStatistics::GetMediaCounters(counters, clear);
+            memcpy(&Media_counters, counters, sizeof(Media_counters));
+            for (CipUdint counter : counters)
+            {
+                AddDintToResponse(counter, &message_router_response->response_data);
+            }
+            break;
+        }
+
+        default:
+            message_router_response->general_status = kCipGeneralStatusCodeAttributeNotSupported;
+            break;
+    }
+    return CipStatus(kCipGeneralStatusCodeSuccess);
 }
\ No newline at end of file
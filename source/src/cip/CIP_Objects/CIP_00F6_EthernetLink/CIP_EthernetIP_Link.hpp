@@ -18,6 +18,24 @@ public:
     static CipStatus Init();
     static CipStatus Shut();
     CIP_TCPIP_Interface * associatedInterface;
+
+    typedef enum {
+        kEthLinkServiceGetAttributeSingle = 0x0E,
+        kEthLinkServiceGetAndClear        = 0x4C
+    } ethernet_link_services_e;
+
+    /** @brief Set the physical address, attribute 3 */
+    static void ConfigureMacAddress(const CipUsint* mac_address);
+
+    /** @brief Set the speed and the flags of the link, attributes 1 and 2
+     *
+     * The flags are composed first and stored as a whole, a concurrent read
+     * sees either the old or the new word.
+     *
+     * @param interface_speed in Mbps, 0 if it is not known
+     * @param auto_negotiation false if the speed and duplex are forced, the negotiation is reported not attempted
+     */
+    static void ConfigureLinkState(bool link_active, CipUdint interface_speed, bool full_duplex, bool auto_negotiation);
 private:
     //Definitions
     typedef struct
@@ -34,10 +52,10 @@ private:
         {
             CipUdint link_status:1;
             CipUdint duplex:1; //1 if full, 0 if half
-            CipUdint negotiation_status:2;
+            CipUdint negotiation_status:3;
             CipUdint manual_setting_requires_reset:1;
             CipUdint local_hardware_fault:1;
-            CipUdint reserved:26;
+            CipUdint reserved:25;
         }bitfield_u;
     }interface_flags_t;
 
@@ -124,7 +142,12 @@ private:
     } ethip_control_bits_e;
 
     //Methods
-    void ConfigureMacAddress(const CipUsint* mac_address);
+    /** @brief Get_Attribute_Single and Get_and_Clear, the counters (attributes 4 and 5) are taken from NetStatistics
+     *
+     *  Get_and_Clear is only supported by the counter attributes, it replies the counts and clears them.
+     */
+    CipStatus GetAttributeSingleEthernetLink(CipMessageRouterRequest_t* message_router_request,
+                                             CipMessageRouterResponse_t* message_router_response, bool clear);
 
 
     //Instance attributes
@@ -0,0 +1,194 @@
+//
+// Tests of the Ethernet Link object
+//
+
+#include "TEST_Cip_EthernetLink.hpp"
+#include <iostream>
+#include <cstring>
+#include <poll.h>
+#include <net/if.h>
+#include <linux/rtnetlink.h>
+#include <cip/ciptypes.hpp>
+#include <cip/ciperror.hpp>
+
+static CipUdint get_dint(const std::vector<CipUsint> & data, unsigned int offset)
+{
+    return (CipUdint) data[offset] | ((CipUdint) data[offset + 1] << 8) | ((CipUdint) data[offset + 2] << 16)
+           | ((CipUdint) data[offset + 3] << 24);
+}
+
+static CipStatus request(CIP_EthernetIP_Link * link, CipUsint service, CipUsint attribute,
+                         CipMessageRouterResponse_t * resp)
+{
+    CipMessageRouterRequest_t req;
+    req.service = service;
+    req.request_path.attribute_number = attribute;
+    return link->InstanceServices(service, &req, resp);
+}
+
+// The interface counters are replied in the order of the specification, Get_and_Clear starts them over
+bool test_interface_counters(CIP_EthernetIP_Link * link)
+{
+    CipMessageRouterResponse_t resp;
+
+    NetStatistics::Reset();
+    NetStatistics::Count(NetStatistics::kInOctets, 1500);
+    NetStatistics::Count(NetStatistics::kInUcastPackets, 3);
+    NetStatistics::Count(NetStatistics::kOutErrors);
+
+    if (kCipGeneralStatusCodeSuccess != request(link, 0x0E, 4, &resp).status
+        || kCipGeneralStatusCodeSuccess != resp.general_status || 44 != resp.response_data.size()
+        || 1500 != get_dint(resp.response_data, 0) || 3 != get_dint(resp.response_data, 4)
+        || 1 != get_dint(resp.response_data, 40))
+        return false;
+
+    request(link, CIP_EthernetIP_Link::kEthLinkServiceGetAndClear, 4, &resp);
+    if ((0xCC != resp.reply_service) || 1500 != get_dint(resp.response_data, 0))
+        return false;
+
+    NetStatistics::Count(NetStatistics::kInUcastPackets);
+    request(link, 0x0E, 4, &resp);
+    return (0 == get_dint(resp.response_data, 0)) && (1 == get_dint(resp.response_data, 4));
+}
+
+bool test_media_counters(CIP_EthernetIP_Link * link)
+{
+    CipMessageRouterResponse_t resp;
+
+    request(link, CIP_EthernetIP_Link::kEthLinkServiceGetAndClear, 5, &resp);
+    if (kCipGeneralStatusCodeSuccess != resp.general_status || 48 != resp.response_data.size())
+        return false;
+
+    //only the counters can be cleared
+    request(link, CIP_EthernetIP_Link::kEthLinkServiceGetAndClear, 1, &resp);
+    if (kCipGeneralStatusCodeAttributeNotSupported != resp.general_status)
+        return false;
+
+    request(link, 0x0E, 1, &resp);
+    return (kCipGeneralStatusCodeSuccess == resp.general_status) && (100 == get_dint(resp.response_data, 0));
+}
+
+// The flags are composed from the state of the link, the negotiation status takes bits 2 to 4
+bool test_link_state(CIP_EthernetIP_Link * link)
+{
+    CipMessageRouterResponse_t resp;
+
+    CIP_EthernetIP_Link::ConfigureLinkState(false, 1000, false, false);
+    request(link, 0x0E, 2, &resp);
+    if (0x10 != get_dint(resp.response_data, 0))
+        return false;
+    request(link, 0x0E, 1, &resp);
+    if (1000 != get_dint(resp.response_data, 0))
+        return false;
+
+    CIP_EthernetIP_Link::ConfigureLinkState(true, 100, true, true);
+    request(link, 0x0E, 2, &resp);
+    return 0xF == get_dint(resp.response_data, 0);
+}
+
+// An rtnetlink message with a body and one attribute
+static int netlink_message(CipByte * buffer, CipUint type, const void * body, size_t body_length,
+                           CipUint attribute_type, const void * attribute, size_t attribute_length)
+{
+    memset(buffer, 0, 256);
+    struct nlmsghdr * header = (struct nlmsghdr *) buffer;
+    header->nlmsg_type = type;
+    header->nlmsg_len = NLMSG_LENGTH(NLMSG_ALIGN(body_length) + RTA_SPACE(attribute_length));
+    memcpy(NLMSG_DATA(header), body, body_length);
+    struct rtattr * rta = (struct rtattr *) ((CipByte *) NLMSG_DATA(header) + NLMSG_ALIGN(body_length));
+    rta->rta_type = attribute_type;
+    rta->rta_len = RTA_LENGTH(attribute_length);
+    memcpy(RTA_DATA(rta), attribute, attribute_length);
+    return (int) header->nlmsg_len;
+}
+
+static int address_message(CipByte * buffer, CipUint type, int index, const char * address, CipUsint prefix_length)
+{
+    struct ifaddrmsg message;
+    memset(&message, 0, sizeof(message));
+    message.ifa_family = AF_INET;
+    message.ifa_prefixlen = prefix_length;
+    message.ifa_index = (unsigned int) index;
+    CipUdint local_address = inet_addr(address);
+    return netlink_message(buffer, type, &message, sizeof(message), IFA_LOCAL, &local_address, sizeof(local_address));
+}
+
+// The loopback interface is read when the monitor starts, the changes the kernel reports are applied as they come
+bool test_link_monitor(CIP_EthernetIP_Link * link)
+{
+    CipMessageRouterResponse_t resp;
+    CIP_TCPIP_Interface::interface_configuration_.ip_address = inet_addr("127.0.0.1");
+    NET_IoBackend::Init();
+    if (kCipStatusOk != NET_LinkMonitor::Start("lo").status)
+        return false;
+
+    //the dumps are received as the network handler does, nothing blocks in Start
+    for (int i = 0; NET_LinkMonitor::IsDumping() && (i < 100); i++)
+    {
+        struct pollfd readable = { NET_LinkMonitor::GetSocket(), POLLIN, 0 };
+        poll(&readable, 1, 10);
+        NET_LinkMonitor::ReceiveEvents();
+    }
+    if (NET_LinkMonitor::IsDumping() || ((int) if_nametoindex("lo") != NET_LinkMonitor::GetInterfaceIndex())
+        || (inet_addr("255.0.0.0") != CIP_TCPIP_Interface::interface_configuration_.network_mask))
+        return false;
+    request(link, 0x0E, 2, &resp);
+    if (1 != (get_dint(resp.response_data, 0) & 1))
+        return false;
+    //the loopback has no link settings, its speed is unknown
+    request(link, 0x0E, 1, &resp);
+    if (0 != get_dint(resp.response_data, 0))
+        return false;
+
+    CipByte buffer[256];
+    int index = NET_LinkMonitor::GetInterfaceIndex();
+    struct ifinfomsg link_message;
+    memset(&link_message, 0, sizeof(link_message));
+    link_message.ifi_index = index;
+    link_message.ifi_flags = IFF_UP;
+    const CipUsint mac_address[6] = { 0x02, 0x00, 0x5E, 0x10, 0x00, 0x01 };
+    NET_LinkMonitor::HandleMessages(buffer, netlink_message(buffer, RTM_NEWLINK, &link_message, sizeof(link_message),
+                                                            IFLA_ADDRESS, mac_address, sizeof(mac_address)));
+    request(link, 0x0E, 2, &resp);
+    if (0 != (get_dint(resp.response_data, 0) & 1))
+        return false;
+    request(link, 0x0E, 3, &resp);
+    if ((6 != resp.response_data.size()) || (0 != memcmp(resp.response_data.data(), mac_address, 6)))
+        return false;
+
+    //the address moves, other interfaces are left alone
+    NET_LinkMonitor::HandleMessages(buffer, address_message(buffer, RTM_DELADDR, index, "127.0.0.1", 8));
+    if (INADDR_ANY != CIP_TCPIP_Interface::interface_configuration_.ip_address)
+        return false;
+    NET_LinkMonitor::HandleMessages(buffer, address_message(buffer, RTM_NEWADDR, index + 100, "10.9.9.9", 16));
+    NET_LinkMonitor::HandleMessages(buffer, address_message(buffer, RTM_NEWADDR, index, "10.1.2.3", 24));
+    bool moved = (inet_addr("10.1.2.3") == CIP_TCPIP_Interface::interface_configuration_.ip_address)
+                 && (inet_addr("255.255.255.0") == CIP_TCPIP_Interface::interface_configuration_.network_mask)
+                 && (inet_addr("239.192.1.64") == CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address);
+
+    NET_LinkMonitor::Stop();
+    NET_IoBackend::Finish();
+    return moved && !NET_LinkMonitor::IsActive();
+}
+
+int main()
+{
+    CIP_EthernetIP_Link::Init();
+    CIP_EthernetIP_Link * link = (CIP_EthernetIP_Link*)CIP_EthernetIP_Link::GetInstance(0);
+    if (nullptr == link)
+        return -1;
+
+    if ( !test_interface_counters(link) )
+        return -1;
+
+    if ( !test_media_counters(link) )
+        return -1;
+
+    if ( !test_link_state(link) )
+        return -1;
+
+    if ( !test_link_monitor(link) )
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+//
+// Tests of the Ethernet Link object
+//
+
+#ifndef OPENERMAIN_TEST_CIP_ETHERNETLINK_H
+#define OPENERMAIN_TEST_CIP_ETHERNETLINK_H
+
+#include "cip/CIP_Objects/CIP_00F6_EthernetLink/CIP_EthernetIP_Link.hpp"
+#include "utils/netstatistics.hpp"
+#include "cip/connection/network/NET_IoBackend.hpp"
+#include "cip/connection/network/NET_LinkMonitor.hpp"
+
+#endif //OPENERMAIN_TEST_CIP_ETHERNETLINK_H
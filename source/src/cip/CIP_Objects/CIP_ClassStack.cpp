@@ -10,6 +10,7 @@
 //#include "CIP_000A_AnalogInput/CIP_Analog_Input_Point.hpp"
 #include "CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
 #include "CIP_00F6_EthernetLink/CIP_EthernetIP_Link.hpp"
+#include "CIP_0048_QoS/CIP_QoS.hpp"
 
 //#include "CIP_0003_DeviceNET/CIP_DeviceNetLink.hpp"
 
@@ -25,7 +26,7 @@ int CIP_ClassStack::InitObjects()
         //init CIP Identity object and return object ID in case of failure
         if (CIP_Identity::Init().status != kCipStatusOk)
             return CIP_Identity::class_id;
-        CIP_MessageRouter::RegisterCIPClass((void*)CIP_Identity::GetClass(),CIP_Identity::class_id);
+        CIP_MessageRouter::RegisterCIPClass((void*)CIP_Identity::GetClass(),CIP_Identity::class_id,true);
     #endif
 
     #ifdef CIP_CLASSES_DEVICENET_H
@@ -49,7 +50,7 @@ int CIP_ClassStack::InitObjects()
     #ifdef CIP_CLASSES_CONNECTIONMANAGER_H
         if (CIP_ConnectionManager::Init().status != kCipStatusOk)
             return CIP_ConnectionManager::class_id;
-        CIP_MessageRouter::RegisterCIPClass((void*)CIP_ConnectionManager::GetClass(),CIP_ConnectionManager::class_id);
+        CIP_MessageRouter::RegisterCIPClass((void*)CIP_ConnectionManager::GetClass(),CIP_ConnectionManager::class_id,true);
     #endif
 
     #ifdef CIP_CLASSES_ANALOGINPUTPOINT_H
@@ -70,6 +71,12 @@ int CIP_ClassStack::InitObjects()
         CIP_MessageRouter::RegisterCIPClass((void*)CIP_EthernetIP_Link::GetClass(),CIP_EthernetIP_Link::class_id);
     #endif
 
+    #ifdef CIP_CLASSES_QOS_H
+        if (CIP_QoS::Init().status != kCipStatusOk)
+            return CIP_QoS::class_id;
+        CIP_MessageRouter::RegisterCIPClass((void*)CIP_QoS::GetClass(),CIP_QoS::class_id);
+    #endif
+
     return kCipStatusOk;
 }
 
@@ -114,6 +121,11 @@ int CIP_ClassStack::ShutObjects()
             return CIP_EthernetIP_Link::class_id;
     #endif
 
+    #ifdef CIP_CLASSES_QOS_H
+        if (CIP_QoS::Shut().status != kCipStatusOk)
+            return CIP_QoS::class_id;
+    #endif
+
     #ifdef CIP_CLASSES_MESSAGEROUTER_H
         if (CIP_MessageRouter::Shut().status != kCipStatusOk)
             return CIP_MessageRouter::class_id;
@@ -19,6 +19,8 @@ case kCipTcpIpInterfaceClassCode: \
 return Y((CIP_TCPIP_Interface *) this)->X; \
 case kCipEthernetLinkClassCode: \
 return Y((CIP_EthernetIP_Link *) this)->X; \
+case kCipQoSClassCode: \
+return Y((CIP_QoS *) this)->X; \
 /*case kCipAnalogInputPointClassCode: \
 return Y((CIP_AnalogInputPoint *) this)->X; \*/
 
@@ -35,6 +37,16 @@ const CIP_Object_glue * CIP_Object_glue::GetInstance(CipUdint this_number)
     }
 }
 
+CipUdint CIP_Object_glue::GetNumberOfInstances()
+{
+    switch (this->classId)
+    {
+        SWITCH_OBJECTS_X(GetNumberOfInstances())
+        default:
+            return 0;
+    }
+}
+
 void* CIP_Object_glue::retrieveAttribute( CipUsint attributeNumber)
 {
     switch (this->classId)
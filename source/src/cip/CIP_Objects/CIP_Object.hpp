@@ -17,6 +17,7 @@
 //#include "CIP_000A_AnalogInput/CIP_Analog_Input_Point.hpp"
 #include "CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
 #include "CIP_00F6_EthernetLink/CIP_EthernetIP_Link.hpp"
+#include "CIP_0048_QoS/CIP_QoS.hpp"
 
 class CIP_Object_glue;
 
@@ -28,6 +29,7 @@ class CIP_Object_glue: public CIP_Object_template<CIP_Object_glue>
     CipStatus InstanceServices(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
     CIP_Attribute GetCipAttribute(CipUsint attribute_number);
     const CIP_Object_glue * GetInstance(CipUdint instance_number);
+    CipUdint GetNumberOfInstances();
 
         void * retrieveAttribute(CipUsint attributeNumber);
         CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
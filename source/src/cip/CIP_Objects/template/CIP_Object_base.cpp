@@ -4,6 +4,7 @@
 
 #include <cip/connection/network/NET_Endianconv.hpp>
 #include "CIP_Object_base.h"
+#include <cstring>
 
 
 int CIP_Object_base::EncodeData (CipUsint cip_type, void *data, std::vector<CipUsint> *message)
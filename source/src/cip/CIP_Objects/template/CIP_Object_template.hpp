@@ -8,7 +8,9 @@
 
 #include "CIP_Object_base.h"
 #include <map>
+#include <vector>
 #include <string>
+#include <cstddef>
 
 typedef struct
 {
@@ -31,9 +33,15 @@ template <class T>
 class CIP_Object_template : public CIP_Object_base
 {
     public:
+        /** @brief Look up a registered instance, out of range numbers and holes give nullptr
+         *
+         * Lookups never register or allocate anything, whatever number is asked for.
+         */
         static const T * GetInstance(CipUdint instance_number);
         static const T * GetClass();
         static CipUdint GetNumberOfInstances();
+
+        /** @brief Instance number an instance is registered at, -1 if it is not registered */
         static CipDint  GetInstanceNumber(const T * instance);
         static bool AddClassInstance(T * instance, CipDint position);
         static bool RemoveClassInstance(T * instance);
@@ -44,6 +52,26 @@ class CIP_Object_template : public CIP_Object_base
         CIP_Object_template();
         virtual ~CIP_Object_template();
 
+        /** @brief Allocate an instance from the class slab
+         *
+         * The slab holds max_instances instances and is allocated with the first
+         * instance, so max_instances has to be set before. Freed instances are kept
+         * in a free list and handed out again. Only when the slab is exhausted the
+         * instance is allocated from the heap. An instance in the slab takes the
+         * number of its chunk as id.
+         */
+        static void * operator new(size_t size);
+
+        /** @brief Return an instance to the class slab, or to the heap if it came from there */
+        static void operator delete(void * instance);
+
+        /** @brief Number of heap allocations made for instances of the class
+         *
+         * The slab itself is the first one, every further one is an instance that did
+         * not fit into the slab. It does not grow after Init if max_instances is right.
+         */
+        static CipUdint GetHeapAllocations();
+
         //CIP class/object attributes
 		static CipUint class_id;
         static std::string class_name;
@@ -181,10 +209,22 @@ class CIP_Object_template : public CIP_Object_base
     //Instance stuff
     CipUint id;
     protected:
+        //Position in object_Set, kept by AddClassInstance and RemoveClassInstance
+        CipDint instance_number;
 
         //Class stuff
         static T * class_ptr;
-        static std::map<CipUdint, const T *> object_Set;
+        //Instances indexed by instance number, holes are nullptr
+        static std::vector<const T *> object_Set;
+        static CipUdint registered_instances;
+
+        //Slab of max_instances fixed size chunks, free chunks are linked through their first bytes
+        static CipUsint * slab;
+        static CipUint slab_capacity;
+        static CipUint slab_used;
+        static void * free_instances;
+        static CipUdint heap_allocations;
+        static size_t SlabChunkSize();
 		virtual void * retrieveAttribute(CipUsint attributeNumber) = 0;
 		virtual CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp) = 0;
 
@@ -9,6 +9,8 @@
 //#include "../../CIP_Common.hpp"
 #include "../../../opener_user_conf.hpp"
 #include <utility>
+#include <stdexcept>
+#include <new>
 #include <ciptypes.hpp>
 #include "../../ciptypes.hpp"
 
@@ -22,7 +24,13 @@ template<class T> CipUdint    CIP_Object_template<T>::optional_attribute_list =
 template<class T> CipUdint    CIP_Object_template<T>::optional_service_list = 0;
 template<class T> CipUint     CIP_Object_template<T>::maximum_id_number_class_attributes = 0;
 template<class T> CipUint     CIP_Object_template<T>::maximum_id_number_instance_attributes = 0;
-template<class T> std::map<CipUdint, const T *> CIP_Object_template<T>::object_Set;
+template<class T> std::vector<const T *> CIP_Object_template<T>::object_Set;
+template<class T> CipUdint    CIP_Object_template<T>::registered_instances = 0;
+template<class T> CipUsint *  CIP_Object_template<T>::slab = nullptr;
+template<class T> CipUint     CIP_Object_template<T>::slab_capacity = 0;
+template<class T> CipUint     CIP_Object_template<T>::slab_used = 0;
+template<class T> void *      CIP_Object_template<T>::free_instances = nullptr;
+template<class T> CipUdint    CIP_Object_template<T>::heap_allocations = 0;
 
 template<class T> std::map<CipUsint, CipAttrInfo_t> CIP_Object_template<T>::classAttrInfo;
 template<class T> std::map<CipUsint, CipServiceProperties_t>   CIP_Object_template<T>::classServicesProperties;
@@ -35,7 +43,17 @@ CIP_Object_template<T>::CIP_Object_template()
 {
     if (number_of_instances < max_instances)
     {
-        id = number_of_instances;
+        //an instance in the slab is numbered by its chunk, so a freed id comes back with the chunk
+        const CipUsint * chunk = (const CipUsint *) this;
+        if ((nullptr != slab) && (chunk >= slab) && (chunk < slab + slab_capacity * SlabChunkSize()))
+        {
+            id = (CipUint) ((chunk - slab) / SlabChunkSize());
+        }
+        else
+        {
+            id = number_of_instances;
+        }
+        instance_number = -1;
         classId = class_id;
         number_of_instances++;
     }
@@ -48,13 +66,79 @@ CIP_Object_template<T>::CIP_Object_template()
 template <class T>
 CIP_Object_template<T>::~CIP_Object_template()
 {
+    //only live instances count against max_instances
+    number_of_instances--;
+}
+
+template <class T>
+size_t CIP_Object_template<T>::SlabChunkSize()
+{
+    const size_t alignment = alignof(std::max_align_t);
+    return (sizeof(T) + alignment - 1) & ~(alignment - 1);
+}
+
+template <class T>
+void * CIP_Object_template<T>::operator new(size_t size)
+{
+    //Derived types larger than T do not fit into a chunk
+    if (size <= sizeof(T))
+    {
+        if (nullptr != free_instances)
+        {
+            void * instance = free_instances;
+            free_instances = *(void **) instance;
+            return instance;
+        }
 
+        if (nullptr == slab)
+        {
+            slab_capacity = max_instances;
+            slab = (CipUsint *) ::operator new(slab_capacity * SlabChunkSize());
+            slab_used = 0;
+            heap_allocations++;
+        }
+
+        if (slab_used < slab_capacity)
+        {
+            return slab + (slab_used++) * SlabChunkSize();
+        }
+        OPENER_TRACE_WARN("%s: slab of %d instances exhausted\n", class_name.c_str(), slab_capacity);
+    }
+
+    heap_allocations++;
+    return ::operator new(size);
+}
+
+template <class T>
+void CIP_Object_template<T>::operator delete(void * instance)
+{
+    if (nullptr == instance)
+    {
+        return;
+    }
+
+    CipUsint * chunk = (CipUsint *) instance;
+    if ((nullptr != slab) && (chunk >= slab) && (chunk < slab + slab_capacity * SlabChunkSize()))
+    {
+        *(void **) instance = free_instances;
+        free_instances = instance;
+    }
+    else
+    {
+        ::operator delete(instance);
+    }
+}
+
+template <class T>
+CipUdint CIP_Object_template<T>::GetHeapAllocations()
+{
+    return heap_allocations;
 }
 
 template <class T>
 const T * CIP_Object_template<T>::GetInstance(CipUdint instance_number)
 {
-    if (object_Set.size() >= instance_number)
+    if (instance_number < object_Set.size())
         return object_Set[instance_number];
     else
         return nullptr;
@@ -69,71 +153,77 @@ const T  * CIP_Object_template<T>::GetClass()
 template <class T>
 CipUdint CIP_Object_template<T>::GetNumberOfInstances()
 {
-    return (CipUdint)object_Set.size();
+    return registered_instances;
 }
 
 template <class T>
 CipDint CIP_Object_template<T>::GetInstanceNumber(const T  * instance)
 {
-    for (auto it = object_Set.begin(); it != object_Set.end(); it++)
+    if ((nullptr == instance) || (-1 == instance->instance_number))
     {
-        if (it->second == instance)
-        {
-            object_Set.erase(it);
-            return it->first;
-        }
+        return -1;
     }
-    return -1;
+    return instance->instance_number;
 }
 
 template <class T>
 bool CIP_Object_template<T>::AddClassInstance(T  * instance, CipDint position)
 {
-    if (instance == nullptr)
+    if ((instance == nullptr) || (-1 != instance->instance_number))
     {
         return false;
     }
     //If passed position is -1, then search first free position
     if (position == -1)
     {
-		unsigned i;
-        for ( i = 1; i < object_Set.size(); i++)
+        CipUdint i;
+        for (i = 1; i < object_Set.size(); i++)
         {
-            auto it = object_Set.find(i);
-            if (it == object_Set.end())
+            if (nullptr == object_Set[i])
                 break;
         }
         position = i;
     }
 
-    //Emplace instance
-    object_Set.emplace(position,instance);
+    //The vector is sized for max_instances once, so registering does not reallocate
+    if (object_Set.capacity() < max_instances)
+    {
+        object_Set.reserve(max_instances);
+    }
+    if ((CipUdint) position >= object_Set.size())
+    {
+        object_Set.resize(position + 1, nullptr);
+    }
+    else if (nullptr != object_Set[position])
+    {
+        return false;
+    }
 
-    //Check if instance was added correctly
-    auto it = object_Set.find(position);
-    return (it != object_Set.end());
+    object_Set[position] = instance;
+    instance->instance_number = position;
+    registered_instances++;
+    return true;
 }
 
 template <class T>
 bool CIP_Object_template<T>::RemoveClassInstance(T  * instance)
 {
-    for (auto it = object_Set.begin(); it != object_Set.end(); it++)
+    CipDint position = GetInstanceNumber(instance);
+    if (-1 == position)
     {
-        if (it->second == instance)
-        {
-            object_Set.erase(it);
-            return true;
-        }
+        return false;
     }
-    return false;
+    return RemoveClassInstance((CipUdint) position);
 }
 
 template <class T>
 bool CIP_Object_template<T>::RemoveClassInstance(CipUdint position)
 {
-    if ( object_Set.find(position) != object_Set.end() )
+    if ((position < object_Set.size()) && (nullptr != object_Set[position]))
     {
-        object_Set.erase (position);
+        ((T *) object_Set[position])->instance_number = -1;
+        object_Set[position] = nullptr;
+        registered_instances--;
         return true;
     }
     else
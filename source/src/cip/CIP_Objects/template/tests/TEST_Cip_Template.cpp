@@ -5,8 +5,12 @@
 #include "TEST_Cip_Template.hpp"
 
 #include <functional>
+#include <random>
 #include <ciptypes.hpp>
 
+#define NUMBER_OF_LOOKUP_INSTANCES 1000
+#define NUMBER_OF_LOOKUPS 10000
+
 CipUint TEST_Cip_Template1::vendor_id_;
 CipUint TEST_Cip_Template1::device_type_;
 CipUint TEST_Cip_Template1::product_code_;
@@ -199,6 +203,161 @@ CipStatus TEST_Cip_Template2::Create()
 	return stat;
 }
 
+void * TEST_Cip_Template3::retrieveAttribute(CipUsint attributeNumber)
+{
+	return nullptr;
+}
+
+CipStatus TEST_Cip_Template3::retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
+{
+	CipStatus stat;
+	stat.status = kCipGeneralStatusCodeServiceNotSupported;
+	stat.extended_status = 0;
+	return stat;
+}
+
+CipStatus TEST_Cip_Template3::Init()
+{
+	CipStatus stat;
+
+	class_id = 3;
+	class_name = "Temp3";
+	revision = 1;
+	max_instances = 4;
+
+	AddClassInstance(new TEST_Cip_Template3(), 0);
+
+	stat.status = kCipGeneralStatusCodeSuccess;
+	stat.extended_status = 0;
+	return stat;
+}
+
+bool test_slab()
+{
+	TEST_Cip_Template3::Init();
+	const TEST_Cip_Template3 * class_instance = TEST_Cip_Template3::GetClass();
+
+	//The remaining instances are carved out of the slab allocated with the class instance
+	TEST_Cip_Template3 * instances[3];
+	for (CipUint i = 0; i < 3; i++)
+	{
+		instances[i] = new TEST_Cip_Template3();
+		if (!TEST_Cip_Template3::AddClassInstance(instances[i], instances[i]->id))
+			return false;
+	}
+	if ((TEST_Cip_Template3::GetHeapAllocations() != 1) || (TEST_Cip_Template3::GetNumberOfInstances() != 4))
+		return false;
+	const char * slab = (const char *) class_instance;
+	size_t stride = (size_t) ((const char *) instances[0] - slab);
+	if ((stride < sizeof(TEST_Cip_Template3)) || (stride >= sizeof(TEST_Cip_Template3) + alignof(std::max_align_t)))
+		return false;
+	for (CipUint i = 0; i < 3; i++)
+	{
+		if ((const char *) instances[i] != slab + (i + 1) * stride)
+			return false;
+	}
+
+	//Lookups beyond the registered instances fail without registering anything
+	if ((TEST_Cip_Template3::GetInstance(1000) != nullptr) || (TEST_Cip_Template3::GetNumberOfInstances() != 4))
+		return false;
+
+	//A freed instance is handed out again with its chunk and its id
+	CipUint freed_id = instances[1]->id;
+	TEST_Cip_Template3::RemoveClassInstance(instances[1]);
+	delete instances[1];
+	TEST_Cip_Template3 * reused = new TEST_Cip_Template3();
+	if ((reused != instances[1]) || (reused->id != freed_id) || (TEST_Cip_Template3::GetHeapAllocations() != 1))
+		return false;
+
+	//Beyond max_instances the constructor fails, only beyond the slab the heap is used
+	try
+	{
+		new TEST_Cip_Template3();
+		return false;
+	}
+	catch (std::range_error &)
+	{
+	}
+	bool heap_used = (TEST_Cip_Template3::GetHeapAllocations() == 2);
+
+	//The failed instance did not keep a live count, the freed chunk is handed out again
+	delete reused;
+	TEST_Cip_Template3 * again = new TEST_Cip_Template3();
+	bool chunk_reused = (again == instances[1]);
+	delete again;
+	return heap_used && chunk_reused;
+}
+
+void * TEST_Cip_Template4::retrieveAttribute(CipUsint attributeNumber)
+{
+	return nullptr;
+}
+
+CipStatus TEST_Cip_Template4::retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp)
+{
+	CipStatus stat;
+	stat.status = kCipGeneralStatusCodeServiceNotSupported;
+	stat.extended_status = 0;
+	return stat;
+}
+
+CipStatus TEST_Cip_Template4::Init()
+{
+	CipStatus stat;
+
+	class_id = 4;
+	class_name = "Temp4";
+	revision = 1;
+	max_instances = NUMBER_OF_LOOKUP_INSTANCES;
+
+	for (CipUint i = 0; i < NUMBER_OF_LOOKUP_INSTANCES; i++)
+	{
+		TEST_Cip_Template4 * instance = new TEST_Cip_Template4();
+		AddClassInstance(instance, instance->id);
+	}
+
+	stat.status = kCipGeneralStatusCodeSuccess;
+	stat.extended_status = 0;
+	return stat;
+}
+
+// Random lookups from a misbehaving client, half of them for instances that do
+// not exist. Misses must not register anything.
+bool test_instance_lookup()
+{
+	TEST_Cip_Template4::Init();
+
+	std::mt19937 generator(4);
+	std::uniform_int_distribution<CipUdint> valid(0, NUMBER_OF_LOOKUP_INSTANCES - 1);
+	std::uniform_int_distribution<CipUdint> invalid(NUMBER_OF_LOOKUP_INSTANCES, 0xFFFFFFFF);
+	std::vector<CipUdint> instance_numbers;
+	for (CipUdint i = 0; i < NUMBER_OF_LOOKUPS; i++)
+	{
+		instance_numbers.push_back((i & 1) ? invalid(generator) : valid(generator));
+	}
+
+	CipUdint found = 0, mapped = 0;
+	for (CipUdint instance_number : instance_numbers)
+	{
+		const TEST_Cip_Template4 * instance = TEST_Cip_Template4::GetInstance(instance_number);
+		if (nullptr != instance)
+		{
+			found++;
+			if (TEST_Cip_Template4::GetInstanceNumber(instance) == (CipDint) instance_number)
+				mapped++;
+		}
+	}
+	//Removed instances are neither found nor mapped any more
+	TEST_Cip_Template4 * removed = (TEST_Cip_Template4 *) TEST_Cip_Template4::GetInstance(1);
+	if (!TEST_Cip_Template4::RemoveClassInstance(removed)
+		|| (TEST_Cip_Template4::GetInstance(1) != nullptr) || (TEST_Cip_Template4::GetInstanceNumber(removed) != -1)
+		|| !TEST_Cip_Template4::AddClassInstance(removed, -1) || (TEST_Cip_Template4::GetInstanceNumber(removed) != 1))
+		return false;
+
+	return (found == NUMBER_OF_LOOKUPS / 2) && (mapped == found)
+		   && (TEST_Cip_Template4::GetNumberOfInstances() == NUMBER_OF_LOOKUP_INSTANCES);
+}
+
 int main()
 {
 	int index1 = -1, index2 = -1;
@@ -209,6 +368,12 @@ int main()
 	TEST_Cip_Template1 * temp1 = (TEST_Cip_Template1 *)TEST_Cip_Template1::GetInstance(index1);
 	TEST_Cip_Template2 * temp2 = (TEST_Cip_Template2 *)TEST_Cip_Template2::GetInstance(index2);
 
+	if (!test_slab())
+		return -1;
+
+	if (!test_instance_lookup())
+		return -1;
+
 
 	//Test values
 	/*if (0 != *(CipUdint*)(temp1->GetCipAttribute(6)->getData()))//serial number
@@ -45,5 +45,23 @@ public:
 	CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
 };
 
+class TEST_Cip_Template3 : public CIP_Object_template<TEST_Cip_Template3>
+{
+public:
+	static CipStatus Init();
+
+	void * retrieveAttribute(CipUsint attributeNumber);
+	CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
+};
+
+class TEST_Cip_Template4 : public CIP_Object_template<TEST_Cip_Template4>
+{
+public:
+	static CipStatus Init();
+
+	void * retrieveAttribute(CipUsint attributeNumber);
+	CipStatus retrieveService(CipUsint serviceNumber, CipMessageRouterRequest_t *req, CipMessageRouterResponse_t *resp);
+};
+
 
 #endif //OPENERMAIN_TEST_CIP_Template_H
@@ -297,6 +297,8 @@ typedef struct
 
 
 
+class CIP_RequestContext;
+
 /** @brief CIP Message Router Request
  *
  */
@@ -306,6 +308,7 @@ typedef struct
     CipUsint request_path_size;
     CipEpath request_path;
     std::vector<CipUsint> request_data;
+    CIP_RequestContext* context = nullptr; /**< the explicit message being handled, its session and originator */
 } CipMessageRouterRequest_t;
 
 /** @brief CIP Message Router Response
@@ -387,6 +390,7 @@ typedef enum
     kCipConnectionClassCode        = 0x05,
     kCipConnectionManagerClassCode = 0x06,
     kCipAnalogInputPointClassCode  = 0x0A,
+    kCipQoSClassCode               = 0x48,
     kCipTcpIpInterfaceClassCode    = 0xF5,
     kCipEthernetLinkClassCode      = 0xF6,
 
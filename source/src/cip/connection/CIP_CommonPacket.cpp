@@ -3,23 +3,24 @@
  * All rights reserved. 
  *
  ******************************************************************************/
+#include <cstring>
 #include <cip/CIP_Objects/CIP_0005_Connection/CIP_Connection.hpp>
 #include <cip/ciptypes.hpp>
 #include "CIP_CommonPacket.hpp"
+#include "CIP_RequestContext.hpp"
 #include "../CIP_Common.hpp"
 #include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
 #include "../CIP_Objects/CIP_0002_MessageRouter/CIP_MessageRouter.hpp"
 #include "network/NET_Endianconv.hpp"
+#include "network/NET_BufferPool.hpp"
+#include "network/ethIP/NET_EthIP_Encap.hpp"
 #include "network/ethIP/eip_endianconv.hpp"
 
-//Static variables
-CIP_CommonPacket::PacketFormat CIP_CommonPacket::common_packet_data;
-
-
 //Methods
 
-int CIP_CommonPacket::NotifyCommonPacketFormat(EncapsulationData* recv_data, CipUsint* reply_buffer)
+int CIP_CommonPacket::NotifyCommonPacketFormat(CIP_RequestContext* context, EncapsulationData* recv_data, CipUsint* reply_buffer)
 {
+    PacketFormat & common_packet_data = context->common_packet;
     CipStatus return_value;
     return_value.status = kCipStatusError;
 
@@ -50,74 +51,119 @@ int CIP_CommonPacket::NotifyCommonPacketFormat(EncapsulationData* recv_data, Cip
     }
 
     // unconnected data item received
-    return_value = CIP_MessageRouter::NotifyMR(common_packet_data.data_item.data, common_packet_data.data_item.length);
+    return_value = CIP_MessageRouter::NotifyMR(context, common_packet_data.data_item.data, common_packet_data.data_item.length);
     if (return_value.status == kCipStatusError)
     {
         return return_value.extended_status;
     }
 
-    return_value.extended_status = (CipUdint) AssembleLinearMessage(&CIP_MessageRouter::g_message_router_response, &common_packet_data, reply_buffer);
+    return_value.extended_status = (CipUdint) AssembleLinearMessage(&context->response, &common_packet_data, reply_buffer);
     return return_value.extended_status;
 
 }
 
-int CIP_CommonPacket::NotifyConnectedCommonPacketFormat(EncapsulationData* recv_data, CipUsint* reply_buffer)
+int CIP_CommonPacket::NotifyConnectedCommonPacketFormat(CIP_RequestContext* context, EncapsulationData* recv_data, CipUsint* reply_buffer)
 {
+    PacketFormat & common_packet_data = context->common_packet;
 
     CipStatus return_value = CreateCommonPacketFormatStructure(recv_data->current_communication_buffer_position, recv_data->data_length, &common_packet_data);
 
-    if (kCipStatusError == return_value.status)
+    if (kCipGeneralStatusCodeSuccess != return_value.status)
     {
         OPENER_TRACE_ERR("notifyConnectedCPF: error from createCPFstructure\n");
-        return return_value.status;
+        return kCipStatusError;
     }
 
-    // For connected explicit messages status always has to be 0
-    return_value.status = kCipStatusError;
-
     // check if ConnectedAddressItem received, otherwise it is no connected message and should not be here
     if (common_packet_data.address_item.type_id != kCipItemIdConnectionAddress)
     {
         OPENER_TRACE_ERR("notifyConnectedCPF: got something besides the expected CIP_ITEM_ID_nullptr\n");
-        return return_value.status;
+        return kCipStatusError;
+    }
+
+    if ((common_packet_data.data_item.type_id != kCipItemIdConnectedDataItem) || (2 > common_packet_data.data_item.length))
+    {
+        /* wrong data item detected*/
+        OPENER_TRACE_ERR("notifyConnectedCPF: got something besides the expected CIP_ITEM_ID_UNCONNECTEDMESSAGE\n");
+        return kCipStatusError;
     }
 
     // ConnectedAddressItem item
-    CIP_ConnectionManager* connection_manager_object;//todo:fix = CIP_ConnectionManager::GetConnectionManagerObject(common_packet_data.address_item.data.connection_identifier);
-    if (nullptr == connection_manager_object)
+    CIP_ConnectionManager* connection_manager_object =
+        CIP_ConnectionManager::FindConnectionById(common_packet_data.address_item.data.connection_identifier);
+    if ((nullptr == connection_manager_object)
+        || (CIP_Connection::kConnectionTypeExplicit != connection_manager_object->consuming_instance->Instance_type)
+        || (CIP_Connection::kConnectionStateEstablished != connection_manager_object->consuming_instance->State))
     {
         OPENER_TRACE_ERR("notifyConnectedCPF: connection with given ID could not be found\n");
-        return return_value.status;
+        return kCipStatusError;
     }
 
     // reset the watchdog timer
-    connection_manager_object->inactivity_watchdog_timer = (connection_manager_object->o_to_t_requested_packet_interval / 1000)
-            << (2 + connection_manager_object->connection_timeout_multiplier);
-
-    //TODO check connection id  and sequence count
-    if (common_packet_data.data_item.type_id != kCipItemIdConnectedDataItem)
-    {
-        /* wrong data item detected*/
-        OPENER_TRACE_ERR("notifyConnectedCPF: got something besides the expected CIP_ITEM_ID_UNCONNECTEDMESSAGE\n");
-        return return_value.status;
-    }
+    connection_manager_object->RearmWatchdog();
 
     // connected data item received
     CipUsint* pnBuf = common_packet_data.data_item.data;
-    common_packet_data.address_item.data.sequence_number = (CipUdint)NET_Endianconv::GetIntFromMessage(pnBuf);
-    return_value = CIP_MessageRouter::NotifyMR(pnBuf, common_packet_data.data_item.length - 2);
+    CipUint sequence_count = NET_Endianconv::GetIntFromMessage(pnBuf);
+
+    // the reply is encoded behind the encapsulation header of an explicit buffer, and cached in one
+    CipUdint cache_size = NET_BufferPool::GetBufferSize(NET_BufferPool::kBufferClassExplicit);
+    CipUdint reply_buffer_size = cache_size - ENCAPSULATION_HEADER_LENGTH;
 
-    if (return_value.status != kCipStatusError)
+    // a retransmitted request is answered with the reply sent before, the service is not executed again
+    if (connection_manager_object->eip_first_level_sequence_count_received
+        && (sequence_count == connection_manager_object->sequence_count_consuming))
     {
-        CIP_Connection * connection_object =
-                connection_manager_object->producing_instance->id == common_packet_data.address_item.data.connection_identifier
-                ? connection_manager_object->producing_instance : connection_manager_object->consuming_instance;
+        if (connection_manager_object->explicit_reply_length > reply_buffer_size)
+        {
+            OPENER_TRACE_ERR("notifyConnectedCPF: cached reply does not fit the reply buffer\n");
+            return kCipStatusError;
+        }
+        memcpy(reply_buffer, connection_manager_object->explicit_reply,
+               connection_manager_object->explicit_reply_length);
+        return connection_manager_object->explicit_reply_length;
+    }
 
-        common_packet_data.address_item.data.connection_identifier = connection_object->CIP_produced_connection_id;
-        return_value = AssembleLinearMessage(&CIP_MessageRouter::g_message_router_response, &common_packet_data, reply_buffer);
+    int reply_length;
+    CIP_Connection *connection = connection_manager_object->consuming_instance;
+    if (CIP_Connection::IsFragmentedTransportClass(connection->TransportClass_trigger.bitfield_u.transport_class))
+    {
+        //the fragment stream encodes its reply right behind the headers
+        int fragment_length = connection->Fragmentation.HandleFragment(
+            pnBuf, (CipUint) (common_packet_data.data_item.length - 2), reply_buffer + kConnectedReplyHeaderLength);
+        if (0 > fragment_length)
+        {
+            return kCipStatusError;
+        }
+        reply_length = EncodeConnectedReplyHeader(connection_manager_object->producing_instance->CIP_produced_connection_id,
+                                                  sequence_count, (CipUint) fragment_length, reply_buffer);
+    }
+    else
+    {
+        return_value = CIP_MessageRouter::NotifyMR(context, pnBuf, common_packet_data.data_item.length - 2);
+        if (kCipGeneralStatusCodeSuccess != return_value.status)
+        {
+            return kCipStatusError;
+        }
+
+        common_packet_data.address_item.data.connection_identifier = connection_manager_object->producing_instance->CIP_produced_connection_id;
+        common_packet_data.address_item.data.sequence_number = sequence_count;
+        reply_length = AssembleLinearMessage(&context->response, &common_packet_data, reply_buffer);
     }
 
-    return return_value.status;
+    if (0 < reply_length)
+    {
+        if ((CipUdint) reply_length > cache_size)
+        {
+            OPENER_TRACE_ERR("notifyConnectedCPF: reply does not fit the reply cache\n");
+            return kCipStatusError;
+        }
+        memcpy(connection_manager_object->explicit_reply, reply_buffer, (size_t) reply_length);
+        connection_manager_object->explicit_reply_length = (CipUint) reply_length;
+        connection_manager_object->sequence_count_consuming = sequence_count;
+        connection_manager_object->eip_first_level_sequence_count_received = true;
+    }
+    return reply_length;
 }
 
 /**
@@ -225,7 +271,7 @@ CipStatus CIP_CommonPacket::CreateCommonPacketFormatStructure(
  *
  * @return The new size of the message frame after encoding
  */
-int CIP_CommonPacket::EncodeNullAddressItem(CipUsint* message, int size)
+int CIP_CommonPacket::EncodeNullAddressItem(CipUsint*& message, int size)
 {
     // null address item -> address length set to 0
     size += NET_Endianconv::AddIntToMessage(kCipItemIdNullAddress, message);
@@ -242,7 +288,7 @@ int CIP_CommonPacket::EncodeNullAddressItem(CipUsint* message, int size)
  *
  * @return The new size of the message frame after encoding
  */
-int CIP_CommonPacket::EncodeConnectedAddressItem(CipUsint* message, PacketFormat* common_packet_format_data_item, int size)
+int CIP_CommonPacket::EncodeConnectedAddressItem(CipUsint*& message, PacketFormat* common_packet_format_data_item, int size)
 {
     // connected data item -> address length set to 4 and copy ConnectionIdentifier
     size += NET_Endianconv::AddIntToMessage(kCipItemIdConnectionAddress, message);
@@ -254,7 +300,7 @@ int CIP_CommonPacket::EncodeConnectedAddressItem(CipUsint* message, PacketFormat
 // TODO: Add doxygen documentation
 // sequenced address item -> address length set to 8 and copy ConnectionIdentifier and SequenceNumber
 // sequence number?????
-int CIP_CommonPacket::EncodeSequencedAddressItem(CipUsint* message, PacketFormat* common_packet_format_data_item, int size)
+int CIP_CommonPacket::EncodeSequencedAddressItem(CipUsint*& message, PacketFormat* common_packet_format_data_item, int size)
 {
     // sequenced address item -> address length set to 8 and copy ConnectionIdentifier and SequenceNumber
     size += NET_Endianconv::AddIntToMessage(kCipItemIdSequencedAddressItem, message);
@@ -273,7 +319,7 @@ int CIP_CommonPacket::EncodeSequencedAddressItem(CipUsint* message, PacketFormat
  *
  * @return The new size of the message frame after encoding
  */
-int CIP_CommonPacket::EncodeItemCount(PacketFormat* common_packet_format_data_item, CipUsint* message, int size)
+int CIP_CommonPacket::EncodeItemCount(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size)
 {
     size += NET_Endianconv::AddIntToMessage(common_packet_format_data_item->item_count, message); // item count
     return size;
@@ -288,7 +334,7 @@ int CIP_CommonPacket::EncodeItemCount(PacketFormat* common_packet_format_data_it
  *
  * @return The new size of the message frame after encoding
  */
-int CIP_CommonPacket::EncodeDataItemType(PacketFormat* common_packet_format_data_item, CipUsint* message, int size)
+int CIP_CommonPacket::EncodeDataItemType(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size)
 {
     size += NET_Endianconv::AddIntToMessage(common_packet_format_data_item->data_item.type_id, message);
     return size;
@@ -303,7 +349,7 @@ int CIP_CommonPacket::EncodeDataItemType(PacketFormat* common_packet_format_data
  *
  * @return The new size of the message frame after encoding
  */
-int CIP_CommonPacket::EncodeDataItemLength(PacketFormat* common_packet_format_data_item, CipUsint* message, int size)
+int CIP_CommonPacket::EncodeDataItemLength(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size)
 {
     size += NET_Endianconv::AddIntToMessage(common_packet_format_data_item->data_item.length, message);
     return size;
@@ -318,7 +364,7 @@ int CIP_CommonPacket::EncodeDataItemLength(PacketFormat* common_packet_format_da
  *
  * @return The new size of the message frame after encoding
  */
-int CIP_CommonPacket::EncodeDataItemData(PacketFormat* common_packet_format_data_item, CipUsint* message, int size)
+int CIP_CommonPacket::EncodeDataItemData(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size)
 {
     for (int i = 0; i < common_packet_format_data_item->data_item.length; i++)
     {
@@ -327,44 +373,44 @@ int CIP_CommonPacket::EncodeDataItemData(PacketFormat* common_packet_format_data
     return size;
 }
 
-int CIP_CommonPacket::EncodeConnectedDataItemLength(CipMessageRouterResponse_t* message_router_response, CipUsint* message, int size)
+int CIP_CommonPacket::EncodeConnectedDataItemLength(CipMessageRouterResponse_t* message_router_response, CipUsint*& message, int size)
 {//todo:recheck
-    size += NET_Endianconv::AddIntToMessage((CipUint)(message_router_response->size_additional_status + 4 + 2 + (2 * message_router_response->size_additional_status)), message);
+    size += NET_Endianconv::AddIntToMessage((CipUint)(message_router_response->response_data.size() + 4 + 2 + (2 * message_router_response->size_additional_status)), message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeSequenceNumber(int size, const PacketFormat* common_packet_format_data_item, CipUsint* message)
+int CIP_CommonPacket::EncodeSequenceNumber(int size, const PacketFormat* common_packet_format_data_item, CipUsint*& message)
 {
     // 2 bytes
     size += NET_Endianconv::AddIntToMessage((CipUint)common_packet_format_data_item->address_item.data.sequence_number, message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeReplyService(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response)
+int CIP_CommonPacket::EncodeReplyService(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response)
 {
     size += NET_Endianconv::AddSintToMessage(message_router_response->reply_service, message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeReservedFieldOfLengthByte(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response)
+int CIP_CommonPacket::EncodeReservedFieldOfLengthByte(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response)
 {
     size += NET_Endianconv::AddSintToMessage(message_router_response->reserved, message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeGeneralStatus(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response)
+int CIP_CommonPacket::EncodeGeneralStatus(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response)
 {
     size += NET_Endianconv::AddSintToMessage(message_router_response->general_status, message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeExtendedStatusLength(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response)
+int CIP_CommonPacket::EncodeExtendedStatusLength(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response)
 {
     size += NET_Endianconv::AddSintToMessage(message_router_response->size_additional_status, message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeExtendedStatusDataItems(int size, CipMessageRouterResponse_t* message_router_response, CipUsint* message)
+int CIP_CommonPacket::EncodeExtendedStatusDataItems(int size, CipMessageRouterResponse_t* message_router_response, CipUsint*& message)
 {
     for (int i = 0; i < message_router_response->size_additional_status; i++)
         size += NET_Endianconv::AddIntToMessage(message_router_response->additional_status[i], message);
@@ -372,7 +418,7 @@ int CIP_CommonPacket::EncodeExtendedStatusDataItems(int size, CipMessageRouterRe
     return size;
 }
 
-int CIP_CommonPacket::EncodeExtendedStatus(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response)
+int CIP_CommonPacket::EncodeExtendedStatus(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response)
 {
     size = EncodeExtendedStatusLength(size, message, message_router_response);
     size = EncodeExtendedStatusDataItems(size, message_router_response, message);
@@ -380,24 +426,25 @@ int CIP_CommonPacket::EncodeExtendedStatus(int size, CipUsint* message, CipMessa
     return size;
 }
 
-int CIP_CommonPacket::EncodeUnconnectedDataItemLength(int size, CipMessageRouterResponse_t* message_router_response, CipUsint* message)
+int CIP_CommonPacket::EncodeUnconnectedDataItemLength(int size, CipMessageRouterResponse_t* message_router_response, CipUsint*& message)
 {
     // Unconnected Item //todo:recheck
-    size += NET_Endianconv::AddIntToMessage((CipUint)(message_router_response->size_additional_status + 4 + (2 * message_router_response->size_additional_status)), message);
+    size += NET_Endianconv::AddIntToMessage((CipUint)(message_router_response->response_data.size() + 4 + (2 * message_router_response->size_additional_status)), message);
     return size;
 }
 
-int CIP_CommonPacket::EncodeMessageRouterResponseData(int size, CipMessageRouterResponse_t* message_router_response, CipUsint* message)
+int CIP_CommonPacket::EncodeMessageRouterResponseData(int size, CipMessageRouterResponse_t* message_router_response, CipUsint*& message)
 {
-    //todo:recheck
-    for (int i = 0; i < message_router_response->size_additional_status; i++)
+    if (!message_router_response->response_data.empty())
     {
-        size += NET_Endianconv::AddSintToMessage((message_router_response->additional_status)[i], &*message);
+        memcpy(message, &message_router_response->response_data[0], message_router_response->response_data.size());
+        message += message_router_response->response_data.size();
+        size += (int) message_router_response->response_data.size();
     }
     return size;
 }
 
-int CIP_CommonPacket::EncodeSockaddrInfoItemTypeId(int size, int item_type, PacketFormat* common_packet_format_data_item, CipUsint* message)
+int CIP_CommonPacket::EncodeSockaddrInfoItemTypeId(int size, int item_type, PacketFormat* common_packet_format_data_item, CipUsint*& message)
 {
     OPENER_ASSERT(item_type == 0 || item_type == 1);
     size += NET_Endianconv::AddIntToMessage(common_packet_format_data_item->address_info_item[item_type].type_id, message);
@@ -405,7 +452,7 @@ int CIP_CommonPacket::EncodeSockaddrInfoItemTypeId(int size, int item_type, Pack
     return size;
 }
 
-int CIP_CommonPacket::EncodeSockaddrInfoLength(int size, int j, PacketFormat* common_packet_format_data_item, CipUsint* message)
+int CIP_CommonPacket::EncodeSockaddrInfoLength(int size, int j, PacketFormat* common_packet_format_data_item, CipUsint*& message)
 {
     size += NET_Endianconv::AddIntToMessage(common_packet_format_data_item->address_info_item[j].length, message);
     return size;
@@ -463,7 +510,7 @@ int CIP_CommonPacket::AssembleLinearMessage(CipMessageRouterResponse_t* message_
             {
                 //Connected Item
                 message_size = EncodeConnectedDataItemLength(message_router_response, message, message_size);
-                message_size = EncodeSequenceNumber(message_size, &common_packet_data, message);
+                message_size = EncodeSequenceNumber(message_size, common_packet_format_data_item, message);
 
             }
             else
@@ -512,7 +559,22 @@ int CIP_CommonPacket::AssembleLinearMessage(CipMessageRouterResponse_t* message_
     }
     return message_size;
 }
+int CIP_CommonPacket::EncodeConnectedReplyHeader(CipUdint connection_id, CipUint sequence_count,
+                                                 CipUint data_length, CipUsint* message)
+{
+    NET_Endianconv::AddDintToMessage(0, message);
+    NET_Endianconv::AddIntToMessage(0, message);
+    NET_Endianconv::AddIntToMessage(2, message);
+    NET_Endianconv::AddIntToMessage(kCipItemIdConnectionAddress, message);
+    NET_Endianconv::AddIntToMessage(4, message);
+    NET_Endianconv::AddDintToMessage(connection_id, message);
+    NET_Endianconv::AddIntToMessage(kCipItemIdConnectedDataItem, message);
+    NET_Endianconv::AddIntToMessage((CipUint) (data_length + 2), message);
+    NET_Endianconv::AddIntToMessage(sequence_count, message);
+    return kConnectedReplyHeaderLength + data_length;
+}
+
 int CIP_CommonPacket::AssembleIOMessage(PacketFormat* common_packet_format_data_item, CipUsint* message)
 {
-    return AssembleLinearMessage(0, common_packet_format_data_item, (CipUsint*)CIP_Common::message_data_reply_buffer[0]);
+    return AssembleLinearMessage(nullptr, common_packet_format_data_item, message);
 }
@@ -10,6 +10,7 @@
 #include "network/ethIP/NET_EthIP_Encap.hpp"
 #include "network/deviceNet/NET_DeviceNetEncapsulation.h"
 
+class CIP_RequestContext;
 
 /** @ingroup ENCAP
  * @brief CPF is Common Packet Format
@@ -82,22 +83,24 @@ public:
  * Parse the CPF data from a received unconnected explicit message and
  * hand the data on to the message router 
  *
+ * @param  context the message being handled, the CPF items are parsed into it
  * @param  recv_data pointer to the encapsulation structure with the received message
  * @param  reply_buffer reply buffer
  * @return number of bytes to be sent back. < 0 if nothing should be sent
  */
-    static int NotifyCommonPacketFormat (EncapsulationData *recv_data, CipUsint *reply_buffer);
+    static int NotifyCommonPacketFormat (CIP_RequestContext *context, EncapsulationData *recv_data, CipUsint *reply_buffer);
 
 /** @ingroup ENCAP
  * Parse the CPF data from a received connected explicit message, check
  * the connection status, update any timers, and hand the data on to 
  * the message router 
  *
+ * @param  context the message being handled, the CPF items are parsed into it
  * @param  recv_data pointer to the encapsulation structure with the received message
  * @param  reply_buffer reply buffer
  * @return number of bytes to be sent back. < 0 if nothing should be sent
  */
-    static int NotifyConnectedCommonPacketFormat (EncapsulationData *recv_data, CipUsint *reply_buffer);
+    static int NotifyConnectedCommonPacketFormat (CIP_RequestContext *context, EncapsulationData *recv_data, CipUsint *reply_buffer);
 
 /** @ingroup ENCAP
  *  Create CPF structure out of the received data.
@@ -130,32 +133,35 @@ public:
  */
    static  int AssembleLinearMessage (CipMessageRouterResponse_t *message_router_response, PacketFormat *common_packet_format_data_item, CipUsint *message);
 
-/** @ingroup ENCAP
- * @brief Data storage for the any CPF data
- * Currently we are single threaded and need only one CPF at the time.
- * For future extensions towards multithreading maybe more CPF data items may be necessary
- */
-   static PacketFormat common_packet_data; /**< CPF global data items */
+    /** @brief Interface handle, timeout, item count, connected address item,
+     * connected data item header and sequence count of a connected reply */
+    static const int kConnectedReplyHeaderLength = 22;
+
+    /** @brief Encode the headers of a connected reply in front of data_length bytes of data
+     *
+     * @return length of the whole reply
+     */
+    static int EncodeConnectedReplyHeader(CipUdint connection_id, CipUint sequence_count, CipUint data_length, CipUsint* message);
 private:
-    static int EncodeSockaddrInfoLength(int size, int j, PacketFormat* common_packet_format_data_item, CipUsint* message);
-    static int EncodeSockaddrInfoItemTypeId(int size, int item_type, PacketFormat* common_packet_format_data_item, CipUsint* message);
-    static int EncodeMessageRouterResponseData(int size, CipMessageRouterResponse_t* message_router_response, CipUsint* message);
-    static int EncodeUnconnectedDataItemLength(int size, CipMessageRouterResponse_t* message_router_response, CipUsint* message);
-    static int EncodeExtendedStatus(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response);
-    static int EncodeDataItemData(PacketFormat* common_packet_format_data_item, CipUsint* message, int size);
-    static int EncodeConnectedDataItemLength(CipMessageRouterResponse_t* message_router_response, CipUsint* message, int size);
-    static int EncodeSequenceNumber(int size, const PacketFormat* common_packet_format_data_item, CipUsint* message);
-    static int EncodeReplyService(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response);
-    static int EncodeReservedFieldOfLengthByte(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response);
-    static int EncodeGeneralStatus(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response);
-    static int EncodeExtendedStatusLength(int size, CipUsint* message, CipMessageRouterResponse_t* message_router_response);
-    static int EncodeExtendedStatusDataItems(int size, CipMessageRouterResponse_t* message_router_response, CipUsint* message);
-    static int EncodeNullAddressItem(CipUsint* message, int size);
-    static int EncodeConnectedAddressItem(CipUsint* message, PacketFormat* common_packet_format_data_item, int size);
-    static int EncodeSequencedAddressItem(CipUsint* message, PacketFormat* common_packet_format_data_item, int size);
-    static int EncodeItemCount(PacketFormat* common_packet_format_data_item, CipUsint* message, int size);
-    static int EncodeDataItemType(PacketFormat* common_packet_format_data_item, CipUsint* message, int size);
-    static int EncodeDataItemLength(PacketFormat* common_packet_format_data_item, CipUsint* message, int size);
+    static int EncodeSockaddrInfoLength(int size, int j, PacketFormat* common_packet_format_data_item, CipUsint*& message);
+    static int EncodeSockaddrInfoItemTypeId(int size, int item_type, PacketFormat* common_packet_format_data_item, CipUsint*& message);
+    static int EncodeMessageRouterResponseData(int size, CipMessageRouterResponse_t* message_router_response, CipUsint*& message);
+    static int EncodeUnconnectedDataItemLength(int size, CipMessageRouterResponse_t* message_router_response, CipUsint*& message);
+    static int EncodeExtendedStatus(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response);
+    static int EncodeDataItemData(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size);
+    static int EncodeConnectedDataItemLength(CipMessageRouterResponse_t* message_router_response, CipUsint*& message, int size);
+    static int EncodeSequenceNumber(int size, const PacketFormat* common_packet_format_data_item, CipUsint*& message);
+    static int EncodeReplyService(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response);
+    static int EncodeReservedFieldOfLengthByte(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response);
+    static int EncodeGeneralStatus(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response);
+    static int EncodeExtendedStatusLength(int size, CipUsint*& message, CipMessageRouterResponse_t* message_router_response);
+    static int EncodeExtendedStatusDataItems(int size, CipMessageRouterResponse_t* message_router_response, CipUsint*& message);
+    static int EncodeNullAddressItem(CipUsint*& message, int size);
+    static int EncodeConnectedAddressItem(CipUsint*& message, PacketFormat* common_packet_format_data_item, int size);
+    static int EncodeSequencedAddressItem(CipUsint*& message, PacketFormat* common_packet_format_data_item, int size);
+    static int EncodeItemCount(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size);
+    static int EncodeDataItemType(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size);
+    static int EncodeDataItemLength(PacketFormat* common_packet_format_data_item, CipUsint*& message, int size);
 
 };
 #endif /* OPENER_CPF_H_ */
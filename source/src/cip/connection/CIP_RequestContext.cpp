@@ -0,0 +1,55 @@
+//
+// State of one explicit message while it is handled
+//
+
+#include <cerrno>
+#include <cstring>
+#include "../../trace.hpp"
+#include "../../opener_user_conf.hpp"
+#include "CIP_RequestContext.hpp"
+
+CIP_RequestContext::CIP_RequestContext()
+{
+    buffer = nullptr;
+    buffer_size = 0;
+    socket = -1;
+    session_handle = 0;
+    memset(&peer_address, 0, sizeof(peer_address));
+    peer_address_known = false;
+    request.context = this;
+}
+
+void CIP_RequestContext::Init(CipUsint* receive_buffer, CipUdint receive_buffer_size)
+{
+    buffer = receive_buffer;
+    buffer_size = receive_buffer_size;
+    request.request_data.reserve(OPENER_EXPLICIT_FRAME_BUFFER_SIZE);
+    response.response_data.reserve(OPENER_EXPLICIT_FRAME_BUFFER_SIZE);
+    response.reserved = 0; /* reserved for future use -> set to zero */
+}
+
+void CIP_RequestContext::Begin(int receive_socket, const struct sockaddr_in* sender_address)
+{
+    socket = receive_socket;
+    session_handle = 0;
+    peer_address_known = (nullptr != sender_address);
+    if (peer_address_known)
+    {
+        peer_address = *sender_address;
+    }
+}
+
+const struct sockaddr_in* CIP_RequestContext::GetPeerAddress()
+{
+    if (!peer_address_known)
+    {
+        socklen_t peer_address_length = sizeof(peer_address);
+        if (0 > getpeername(socket, (struct sockaddr *) &peer_address, &peer_address_length))
+        {
+            OPENER_TRACE_ERR("networkhandler: could not get peername: %s\n", strerror(errno));
+            return nullptr;
+        }
+        peer_address_known = true;
+    }
+    return &peer_address;
+}
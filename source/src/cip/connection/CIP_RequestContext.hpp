@@ -0,0 +1,59 @@
+//
+// State of one explicit message while it is handled
+//
+
+#ifndef OPENER_CIP_REQUESTCONTEXT_H
+#define OPENER_CIP_REQUESTCONTEXT_H
+
+#include "../ciptypes.hpp"
+#include "CIP_CommonPacket.hpp"
+#include "network/ethIP/NET_EthIP_Includes.h"
+
+/** @ingroup ENCAP
+ * @brief Everything the encapsulation layer, the common packet format and the
+ * message router need to know about the explicit message being handled
+ *
+ * The context is handed down from the network handler through
+ * HandleReceivedExplictTcpData, NotifyCommonPacketFormat and NotifyMR, a
+ * service finds it in CipMessageRouterRequest_t::context. Each thread handling
+ * explicit messages owns a context of its own, nothing of a request is kept in
+ * globals.
+ */
+class CIP_RequestContext
+{
+public:
+    CipUsint* buffer;       /**< the received message, the reply is encoded into the same buffer */
+    CipUdint buffer_size;
+    int socket;             /**< the socket the message has been received on */
+    CipUdint session_handle; /**< the registered session of the message, 0 if it has none */
+
+    CIP_CommonPacket::PacketFormat common_packet; /**< common packet format items of the message, reused for the reply */
+    CipMessageRouterRequest_t request;
+    CipMessageRouterResponse_t response;
+
+    CIP_RequestContext();
+
+    /** @brief Bind the buffer messages are received into, request and response
+     *  are sized for the largest explicit message, so handling one never allocates
+     */
+    void Init(CipUsint* buffer, CipUdint buffer_size);
+
+    /** @brief Start handling a message received on the given socket
+     *
+     * @param peer_address the sender of the message, nullptr if it is looked up
+     *  from the socket on demand, e.g. for a TCP connection
+     */
+    void Begin(int socket, const struct sockaddr_in* peer_address);
+
+    /** @brief The originator of the message
+     *
+     * @return nullptr if it cannot be determined
+     */
+    const struct sockaddr_in* GetPeerAddress();
+
+private:
+    struct sockaddr_in peer_address;
+    bool peer_address_known;
+};
+
+#endif //OPENER_CIP_REQUESTCONTEXT_H
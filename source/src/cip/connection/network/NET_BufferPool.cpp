@@ -0,0 +1,134 @@
+//
+// Created by Gabriel Ferreira (@gabrielcarvfer)
+//
+
+#include <cstring>
+#include "../../../trace.hpp"
+#include "NET_BufferPool.hpp"
+
+//Static variables
+alignas(8) CipUsint NET_BufferPool::arena[OPENER_FRAME_BUFFER_ARENA_SIZE];
+NET_BufferPool::Slab NET_BufferPool::slabs[kBufferClassCount] = {
+        { OPENER_EXPLICIT_FRAME_BUFFER_SIZE, OPENER_EXPLICIT_FRAME_BUFFERS, 0, nullptr },
+        { OPENER_IO_FRAME_BUFFER_SIZE      , OPENER_IO_FRAME_BUFFERS      , 0, nullptr }
+};
+bool NET_BufferPool::laid_out = false;
+
+//Methods
+CipStatus NET_BufferPool::Configure(BufferClass buffer_class, CipUdint buffer_size, CipUint number_of_buffers)
+{
+    if ((kBufferClassCount <= buffer_class) || (0 == buffer_size) || InUse())
+    {
+        return kCipStatusError;
+    }
+
+    //buffers are kept 8 byte aligned, the free list pointer is stored inside them
+    buffer_size = (buffer_size + 7) & ~((CipUdint) 7);
+
+    unsigned long long required_size = (unsigned long long) buffer_size * number_of_buffers;
+    for (int i = 0; i < kBufferClassCount; i++)
+    {
+        if (i != buffer_class)
+        {
+            required_size += (unsigned long long) slabs[i].buffer_size * slabs[i].number_of_buffers;
+        }
+    }
+    if (OPENER_FRAME_BUFFER_ARENA_SIZE < required_size)
+    {
+        OPENER_TRACE_WARN("buffer pool: %u buffers of %u bytes do not fit into the arena\n",
+                          (unsigned int) number_of_buffers, (unsigned int) buffer_size);
+        return kCipStatusError;
+    }
+
+    slabs[buffer_class].buffer_size = buffer_size;
+    slabs[buffer_class].number_of_buffers = number_of_buffers;
+    LayOut();
+    return kCipStatusOk;
+}
+
+CipUsint* NET_BufferPool::Allocate(BufferClass buffer_class)
+{
+    if (!laid_out)
+    {
+        LayOut();
+    }
+
+    Slab* slab = &slabs[buffer_class];
+    if (nullptr == slab->free_list)
+    {
+        OPENER_TRACE_WARN("buffer pool: no free buffer of class %d\n", (int) buffer_class);
+        return nullptr;
+    }
+
+    CipUsint* buffer = slab->free_list;
+    memcpy(&slab->free_list, buffer, sizeof(CipUsint*));
+    slab->number_of_free_buffers--;
+    return buffer;
+}
+
+void NET_BufferPool::Release(BufferClass buffer_class, CipUsint* buffer)
+{
+    if (nullptr == buffer)
+    {
+        return;
+    }
+
+    Slab* slab = &slabs[buffer_class];
+    memcpy(buffer, &slab->free_list, sizeof(CipUsint*));
+    slab->free_list = buffer;
+    slab->number_of_free_buffers++;
+}
+
+CipUdint NET_BufferPool::GetBufferSize(BufferClass buffer_class)
+{
+    return slabs[buffer_class].buffer_size;
+}
+
+CipUint NET_BufferPool::GetNumberOfFreeBuffers(BufferClass buffer_class)
+{
+    if (!laid_out)
+    {
+        LayOut();
+    }
+    return slabs[buffer_class].number_of_free_buffers;
+}
+
+bool NET_BufferPool::InUse()
+{
+    if (!laid_out)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < kBufferClassCount; i++)
+    {
+        if (slabs[i].number_of_free_buffers != slabs[i].number_of_buffers)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void NET_BufferPool::LayOut()
+{
+    CipUsint* runner = arena;
+
+    for (int i = 0; i < kBufferClassCount; i++)
+    {
+        Slab* slab = &slabs[i];
+        slab->free_list = nullptr;
+        slab->number_of_free_buffers = slab->number_of_buffers;
+
+        //chain the buffers back to front, so the first one is handed out first
+        CipUsint* buffer = runner + (unsigned long) slab->buffer_size * slab->number_of_buffers;
+        for (CipUint j = 0; j < slab->number_of_buffers; j++)
+        {
+            buffer -= slab->buffer_size;
+            memcpy(buffer, &slab->free_list, sizeof(CipUsint*));
+            slab->free_list = buffer;
+        }
+        runner += (unsigned long) slab->buffer_size * slab->number_of_buffers;
+    }
+    laid_out = true;
+}
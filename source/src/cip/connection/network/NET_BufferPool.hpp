@@ -0,0 +1,69 @@
+//
+// Created by Gabriel Ferreira (@gabrielcarvfer)
+//
+
+#ifndef OPENER_NET_BUFFERPOOL_H
+#define OPENER_NET_BUFFERPOOL_H
+
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+
+/**
+ * @brief NET_BufferPool hands out the frame buffers used to receive and send messages
+ *
+ * Every connection class has its own slab of equally sized buffers, carved out of one
+ * static arena. The size and number of buffers of each class can be changed at runtime
+ * with Configure, as long as no buffer is in use and the arena is large enough.
+ * Allocating and releasing a buffer only pops or pushes a free list.
+ */
+class NET_BufferPool
+{
+    public:
+        typedef enum
+        {
+            kBufferClassExplicit = 0, /**< encapsulated explicit messages */
+            kBufferClassIo,           /**< implicit I/O frames */
+            kBufferClassCount
+        } BufferClass;
+
+        /** @brief Change the size and number of the buffers of one class
+         *
+         * @param buffer_class the class to change
+         * @param buffer_size size of each buffer in bytes
+         * @param number_of_buffers number of buffers of this class
+         * @return kCipStatusOk on success, kCipStatusError if a buffer is in use or
+         *      the arena is too small for the new layout, the old layout is kept then
+         */
+        static CipStatus Configure(BufferClass buffer_class, CipUdint buffer_size, CipUint number_of_buffers);
+
+        /** @brief Take a buffer of the given class
+         *
+         * @return the buffer, nullptr if the class has no free buffer left
+         */
+        static CipUsint* Allocate(BufferClass buffer_class);
+
+        /** @brief Give a buffer back to its class, nullptr is ignored
+         */
+        static void Release(BufferClass buffer_class, CipUsint* buffer);
+
+        static CipUdint GetBufferSize(BufferClass buffer_class);
+        static CipUint GetNumberOfFreeBuffers(BufferClass buffer_class);
+
+    private:
+        typedef struct
+        {
+            CipUdint buffer_size;
+            CipUint number_of_buffers;
+            CipUint number_of_free_buffers;
+            CipUsint* free_list; /**< the first bytes of a free buffer point to the next one */
+        } Slab;
+
+        static CipUsint arena[OPENER_FRAME_BUFFER_ARENA_SIZE];
+        static Slab slabs[kBufferClassCount];
+        static bool laid_out;
+
+        static bool InUse();
+        static void LayOut();
+};
+
+#endif //OPENER_NET_BUFFERPOOL_H
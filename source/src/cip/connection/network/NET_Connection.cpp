@@ -11,9 +11,21 @@
 
 #include "../../../trace.hpp"
 #include "NET_Connection.hpp"
+#include "NET_IoBackend.hpp"
 
 //Static variables
-fd_set NET_Connection::select_set[2];
+fd_set NET_Connection::select_set[4];
+
+//explicit messages go out right away, I/O frames are marked as the QoS object does by default
+NET_Connection::SocketProfile_t NET_Connection::profiles[kNumberOfSocketKinds] = {
+    { true,  false, 0, 0, kTrafficExplicit,  -1, 0 }, //kSocketTcpListener
+    { true,  true,  0, 0, kTrafficExplicit,   3, 0 }, //kSocketTcpSession
+    { false, false, 0, 0, kTrafficUnmarked,  -1, 0 }, //kSocketIoConsumer
+    { false, false, 0, 0, kTrafficScheduled,  5, 0 }  //kSocketIoProducer
+};
+
+//DSCP defaults of the QoS object: urgent, scheduled, high, low, explicit
+CipUsint NET_Connection::dscp_values[kNumberOfTrafficClasses] = { 55, 47, 43, 31, 27 };
 std::map <int, NET_Connection*> NET_Connection::socket_to_conn_map;
 
 //Methods
@@ -22,10 +34,13 @@ void NET_Connection::InitSelects()
     // clear the master an temp sets
     FD_ZERO(&select_set[kMasterSet]);
     FD_ZERO(&select_set[kReadSet]);
+    FD_ZERO(&select_set[kWriteMasterSet]);
+    FD_ZERO(&select_set[kWriteSet]);
 }
 void NET_Connection::SelectCopy()
 {
     select_set[kReadSet] = select_set[kMasterSet];
+    select_set[kWriteSet] = select_set[kWriteMasterSet];
 }
 int NET_Connection::SelectSet(int socket_handle, int select_set_option)
 {
@@ -50,7 +65,8 @@ int NET_Connection::SelectSelect(int socket_handle, int select_set_option, struc
 {
     //if(CheckSelectSet(select_set_option) & CheckSocketHandle(socket_handle))
     {
-        return select(socket_handle, &select_set[select_set_option], 0, 0, time);
+        //sockets waiting to be written are reported along with the readable ones
+        return select(socket_handle, &select_set[select_set_option], &select_set[kWriteSet], 0, time);
     }
     return INVALID_INPUTS;
 }
@@ -65,6 +81,11 @@ int NET_Connection::SelectRemove(int socket_handle, int select_set_option)
     return INVALID_INPUTS;
 }
 
+void NET_Connection::SelectZero(int select_set_option)
+{
+    FD_ZERO(&select_set[select_set_option]);
+}
+
 
 
 
@@ -72,9 +93,6 @@ NET_Connection::~NET_Connection ()
 {
     if (sock != INVALID_SOCKET_HANDLE)
         CloseSocket();
-
-    delete remote_address;
-    delete originator_address;
 }
 
 int NET_Connection::InitSocket(CipUdint family, CipUdint type, CipUdint protocol)
@@ -89,6 +107,121 @@ int NET_Connection::InitSocket(CipUdint family, CipUdint type, CipUdint protocol
         return sock;
 }
 
+void NET_Connection::SetProfile(SocketKind_e kind, const SocketProfile_t & profile)
+{
+    if (kNumberOfSocketKinds > kind)
+    {
+        profiles[kind] = profile;
+    }
+}
+
+const NET_Connection::SocketProfile_t * NET_Connection::GetProfile(SocketKind_e kind)
+{
+    return (kNumberOfSocketKinds > kind) ? &profiles[kind] : nullptr;
+}
+
+void NET_Connection::SetDscp(TrafficClass_e traffic_class, CipUsint dscp)
+{
+    if (kNumberOfTrafficClasses > traffic_class)
+    {
+        dscp_values[traffic_class] = (CipUsint) (dscp & 0x3F);
+    }
+}
+
+CipUsint NET_Connection::GetDscp(TrafficClass_e traffic_class)
+{
+    return (kNumberOfTrafficClasses > traffic_class) ? dscp_values[traffic_class] : 0;
+}
+
+int NET_Connection::ApplyProfile(int socket_handle, SocketKind_e kind)
+{
+    //borrowed only, the socket stays open
+    NET_Connection connection;
+    connection.SetSocketHandle(socket_handle);
+    int result = connection.ApplyProfile(kind);
+    connection.SetSocketHandle(INVALID_SOCKET_HANDLE);
+    return result;
+}
+
+void NET_Connection::QuickAck(int socket_handle)
+{
+#ifdef TCP_QUICKACK
+    if (profiles[kSocketTcpSession].quick_ack)
+    {
+        CipUdint option_value = 1;
+        setsockopt(socket_handle, IPPROTO_TCP, TCP_QUICKACK, (char *) &option_value, sizeof(option_value));
+    }
+#else
+    (void) socket_handle;
+#endif
+}
+
+int NET_Connection::ApplyProfile(SocketKind_e kind)
+{
+    const SocketProfile_t * profile = GetProfile(kind);
+    if (nullptr == profile)
+    {
+        return INVALID_INPUTS;
+    }
+    bool tcp = (kSocketTcpListener == kind) || (kSocketTcpSession == kind);
+    int result = 0;
+
+    if (tcp && profile->no_delay && (-1 == SetSocketOpt(IPPROTO_TCP, TCP_NODELAY, 1)))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set TCP_NODELAY on fd %d\n", sock);
+        result = -1;
+    }
+#ifdef TCP_QUICKACK
+    if (tcp && profile->quick_ack && (-1 == SetSocketOpt(IPPROTO_TCP, TCP_QUICKACK, 1)))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set TCP_QUICKACK on fd %d\n", sock);
+        result = -1;
+    }
+#endif
+    //set on the listener before listen() the buffers size the window scale of the sessions
+    if ((0 != profile->receive_buffer) && (-1 == SetSocketOpt(SOL_SOCKET, SO_RCVBUF, profile->receive_buffer)))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set SO_RCVBUF on fd %d\n", sock);
+        result = -1;
+    }
+    if ((0 != profile->send_buffer) && (-1 == SetSocketOpt(SOL_SOCKET, SO_SNDBUF, profile->send_buffer)))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set SO_SNDBUF on fd %d\n", sock);
+        result = -1;
+    }
+    if (-1 == SetTrafficClass(profile->traffic_class))
+    {
+        result = -1;
+    }
+#ifdef SO_PRIORITY
+    if ((0 <= profile->priority) && (-1 == SetSocketOpt(SOL_SOCKET, SO_PRIORITY, (CipUdint) profile->priority)))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set SO_PRIORITY on fd %d\n", sock);
+        result = -1;
+    }
+#endif
+#ifdef SO_BUSY_POLL
+    if ((0 != profile->busy_poll) && (-1 == SetSocketOpt(SOL_SOCKET, SO_BUSY_POLL, profile->busy_poll)))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set SO_BUSY_POLL on fd %d\n", sock);
+        result = -1;
+    }
+#endif
+    return result;
+}
+
+int NET_Connection::SetTrafficClass(TrafficClass_e traffic_class)
+{
+    //the DSCP takes the upper six bits of the former type of service octet
+    if ((kNumberOfTrafficClasses > traffic_class)
+        && (-1 == SetSocketOpt(IPPROTO_IP, IP_TOS, (CipUdint) (dscp_values[traffic_class] << 2))))
+    {
+        OPENER_TRACE_WARN("networkhandler: cannot set IP_TOS on fd %d\n", sock);
+        return -1;
+    }
+    return 0;
+}
+
 int NET_Connection::SetSocketOpt(CipUdint type, CipUdint reuse, CipUdint val)
 {
         this->type = type;
@@ -123,20 +256,18 @@ void NET_Connection::CloseSocket()
         OPENER_TRACE_INFO("networkhandler: closing socket %d\n", sock);
         if (-1 != sock)
         {
-            //Check if socket is still registered
-            if (socket_to_conn_map.find(sock) != socket_to_conn_map.end())
-            {
-                FD_CLR(sock, &select_set[kMasterSet]);
+            //Sockets handed over with SetSocketHandle are not registered, close them as well
+            NET_IoBackend::Unwatch(sock);
 #ifdef WIN
 
-                closesocket ( sock);
+            closesocket ( sock);
 #elif __linux__
-                shutdown(sock, SHUT_RDWR);
-                close(sock);
+            shutdown(sock, SHUT_RDWR);
+            close(sock);
 #endif
 
-                socket_to_conn_map.erase (sock);
-            }
+            socket_to_conn_map.erase (sock);
+
             //Set socket val to -1
             sock = -1;
         }
@@ -164,13 +295,12 @@ int NET_Connection::RecvData (void *data_ptr, CipUdint size)
 
 int NET_Connection::SendDataTo(void * data_ptr, CipUdint size, struct sockaddr * destination)
 {
-    return sendto( sock, (char*)data_ptr, size, 0, destination, sizeof(sockaddr*));
+    return sendto( sock, (char*)data_ptr, size, 0, destination, sizeof(struct sockaddr_in));
 }
 
 int NET_Connection::RecvDataFrom (void *data_ptr, CipUdint size, struct sockaddr *source)
 {
-    //int size_sock = sizeof(sockaddr*);
-    socklen_t socklen;
+    socklen_t socklen = sizeof(struct sockaddr_in);
     return recvfrom( sock, (char*)data_ptr, size, 0, source, &socklen);
 }
 
@@ -19,13 +19,66 @@ class NET_Connection
 {
     public:
         //Class stuff
-        typedef enum { kMasterSet, kReadSet } SelectSets;
+        /** @brief sockets watched for reading and found readable, sockets waiting to be written and found writable */
+        typedef enum { kMasterSet, kReadSet, kWriteMasterSet, kWriteSet } SelectSets;
         static void InitSelects();
         static void SelectCopy();
         static int SelectSet    (int socket_handle, int select_set_option);
         static int SelectIsSet  (int socket_handle, int select_set_option);
         static int SelectSelect (int socket_handle, int select_set_option, struct timeval * time);
         static int SelectRemove (int socket_handle, int select_set_option);
+        static void SelectZero  (int select_set_option);
+
+        /** @brief The kinds of sockets the stack opens, each is tuned with a profile of its own */
+        typedef enum
+        {
+            kSocketTcpListener = 0, /**< accepted sessions inherit most of its options */
+            kSocketTcpSession,      /**< a TCP connection carrying explicit messages */
+            kSocketIoConsumer,      /**< receives the O->T frames of I/O connections */
+            kSocketIoProducer,      /**< sends the T->O frames of I/O connections */
+            kNumberOfSocketKinds
+        } SocketKind_e;
+
+        /** @brief Traffic classes of the EtherNet/IP QoS object, a socket is marked with the DSCP of its class */
+        typedef enum
+        {
+            kTrafficUrgent = 0,
+            kTrafficScheduled,
+            kTrafficHigh,
+            kTrafficLow,
+            kTrafficExplicit,
+            kNumberOfTrafficClasses,
+            kTrafficUnmarked = kNumberOfTrafficClasses /**< IP_TOS is left alone */
+        } TrafficClass_e;
+
+        /** @brief Socket options applied to every socket of a kind, see SetProfile */
+        typedef struct
+        {
+            bool no_delay;            /**< TCP_NODELAY, replies are not held back by Nagle */
+            bool quick_ack;           /**< TCP_QUICKACK, set again after every receive as the kernel drops it */
+            CipUdint receive_buffer;  /**< SO_RCVBUF in bytes, 0 keeps the default */
+            CipUdint send_buffer;     /**< SO_SNDBUF in bytes, 0 keeps the default */
+            TrafficClass_e traffic_class; /**< IP_TOS carries the DSCP of this class */
+            int priority;             /**< SO_PRIORITY of the queueing discipline, -1 keeps the default */
+            CipUdint busy_poll;       /**< SO_BUSY_POLL in us spent polling the device on receive, 0 is off */
+        } SocketProfile_t;
+
+        /** @brief Change the profile of a kind of sockets, sockets opened before keep the old one */
+        static void SetProfile(SocketKind_e kind, const SocketProfile_t & profile);
+        static const SocketProfile_t * GetProfile(SocketKind_e kind);
+
+        /** @brief Change the DSCP a traffic class is marked with, the QoS object defaults are used else */
+        static void SetDscp(TrafficClass_e traffic_class, CipUsint dscp);
+        static CipUsint GetDscp(TrafficClass_e traffic_class);
+
+        /** @brief Tune a socket not owned by a NET_Connection with the profile of its kind
+         *
+         * @return 0 on success, -1 if an option could not be set, the others are set anyway
+         */
+        static int ApplyProfile(int socket_handle, SocketKind_e kind);
+
+        /** @brief Ask for the next ACK of a TCP session right away, if its profile wants it */
+        static void QuickAck(int socket_handle);
 
         //Instance stuff
         typedef enum
@@ -56,6 +109,18 @@ class NET_Connection
 
         int InitSocket(CipUdint family, CipUdint type, CipUdint protocol);
         int SetSocketOpt(CipUdint type, CipUdint reuse, CipUdint val);
+
+        /** @brief Tune the socket with the profile of its kind through SetSocketOpt
+         *
+         * @return 0 on success, -1 if an option could not be set, the others are set anyway
+         */
+        int ApplyProfile(SocketKind_e kind);
+
+        /** @brief Mark the packets of the socket with the DSCP of a traffic class, kTrafficUnmarked leaves IP_TOS alone
+         *
+         * @return 0 on success, -1 if IP_TOS could not be set
+         */
+        int SetTrafficClass(TrafficClass_e traffic_class);
         int BindSocket(int address_option, struct sockaddr * address);
         int Listen(int max_num_connections);
 
@@ -71,6 +136,8 @@ class NET_Connection
 
     static std::map <int, NET_Connection*> socket_to_conn_map;
 
+    // The addresses are not owned by the connection, they have to outlive it
+
     // socket address for produce
     struct sockaddr *remote_address;
 
@@ -90,7 +157,9 @@ class NET_Connection
 
 
     private:
-        static fd_set select_set[]; //0-master_socket 1-read_socket
+        static fd_set select_set[]; //0-master_socket 1-read_socket 2-write_master_socket 3-write_socket
+        static SocketProfile_t profiles[kNumberOfSocketKinds];
+        static CipUsint dscp_values[kNumberOfTrafficClasses];
 
         CipUdint type;
         CipUdint reuse;
@@ -13,9 +13,10 @@ NET_Endianconv::OpENerEndianess NET_Endianconv::g_opENer_platform_endianess;
  *   @param buffer pointer where data should be read.
  *   @return EIP_UINT8 data value
  */
-CipUsint NET_Endianconv::GetSintFromMessage(CipUsint* buffer)
+CipUsint NET_Endianconv::GetSintFromMessage(CipUsint *&buffer)
 {
     CipUint data = buffer[0];
+    buffer += 1;
     return (CipUsint) data;
 }
 
@@ -26,10 +27,11 @@ CipUsint NET_Endianconv::GetSintFromMessage(CipUsint* buffer)
  *   @param buffer pointer where data should be reed.
  *   @return EIP_UINT16 data value
  */
-CipUint NET_Endianconv::GetIntFromMessage(CipUsint* buffer)
+CipUint NET_Endianconv::GetIntFromMessage(CipUsint *&buffer)
 {
     CipUint data = *(CipUint*)buffer; // for Little endian only
     // = buffer[0] | buffer[1] << 8;
+    buffer += 2;
     return data;
 }
 
@@ -38,10 +40,11 @@ CipUint NET_Endianconv::GetIntFromMessage(CipUsint* buffer)
  *   @param buffer pointer where data should be reed.
  *   @return EIP_UNÍT32 value
  */
-CipUdint NET_Endianconv::GetDintFromMessage(CipUsint* buffer)
+CipUdint NET_Endianconv::GetDintFromMessage(CipUsint *&buffer)
 {
     CipUdint data = *(CipUdint*)buffer; // for Little endian only
     //buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
+    buffer += 4;
     return data;
 }
 
@@ -50,9 +53,10 @@ CipUdint NET_Endianconv::GetDintFromMessage(CipUsint* buffer)
  * @param data value to be written
  * @param buffer pointer where data should be written.
  */
-int NET_Endianconv::AddSintToMessage(CipUsint data, CipUsint* buffer)
+int NET_Endianconv::AddSintToMessage(CipUsint data, CipUsint *&buffer)
 {
     buffer[0] = (unsigned char)data;
+    buffer += 1;
     return 1;
 }
 
@@ -61,11 +65,12 @@ int NET_Endianconv::AddSintToMessage(CipUsint data, CipUsint* buffer)
  * @param data value to be written
  * @param buffer pointer where data should be written.
  */
-int NET_Endianconv::AddIntToMessage(CipUint data, CipUsint* buffer)
+int NET_Endianconv::AddIntToMessage(CipUint data, CipUsint *&buffer)
 {
     *(CipUint*)buffer = data; //for Little endian only
     //buffer[0] = (unsigned char)data;
     //bugger[1] = (unsigned char)(data >> 8);
+    buffer += 2;
     return 2;
 }
 
@@ -74,9 +79,10 @@ int NET_Endianconv::AddIntToMessage(CipUint data, CipUsint* buffer)
  * @param data value to be written
  * @param buffer pointer where data should be written.
  */
-int NET_Endianconv::AddDintToMessage(CipUdint data, CipUsint* buffer)
+int NET_Endianconv::AddDintToMessage(CipUdint data, CipUsint *&buffer)
 {
     *(CipUdint*)buffer = data; //for Little endian only
+    buffer += 4;
 
     /*
     unsigned char* p = *buffer;
@@ -94,7 +100,7 @@ int NET_Endianconv::AddDintToMessage(CipUdint data, CipUsint* buffer)
  *   @param pa_buf pointer where data should be reed.
  *   @return CipUlint value
  */
-CipUlint NET_Endianconv::GetLintFromMessage(CipUsint* buffer)
+CipUlint NET_Endianconv::GetLintFromMessage(CipUsint *&buffer)
 {
     CipUsint* buffer_address = buffer;
     CipUlint data = ((((CipUlint)buffer_address[0]) << 56)
@@ -106,7 +112,7 @@ CipUlint NET_Endianconv::GetLintFromMessage(CipUsint* buffer)
         + ((((CipUlint)buffer_address[5]) << 16) & 0x0000000000FF0000)
         + ((((CipUlint)buffer_address[6]) << 8) & 0x000000000000FF00)
         + (((CipUlint)buffer_address[7]) & 0x00000000000000FF);
-    (*buffer) += 8;
+    buffer += 8;
     return data;
 }
 
@@ -115,7 +121,7 @@ CipUlint NET_Endianconv::GetLintFromMessage(CipUsint* buffer)
  * @param data value to be written
  * @param buffer pointer where data should be written.
  */
-int NET_Endianconv::AddLintToMessage(CipUlint data, CipUsint* buffer)
+int NET_Endianconv::AddLintToMessage(CipUlint data, CipUsint *&buffer)
 {
     CipUsint* buffer_address = buffer;
     buffer_address[0] = (CipUsint)(data >> 56) & 0xFF;
@@ -126,7 +132,7 @@ int NET_Endianconv::AddLintToMessage(CipUlint data, CipUsint* buffer)
     buffer_address[5] = (CipUsint)(data >> 16) & 0xFF;
     buffer_address[6] = (CipUsint)(data >> 8) & 0xFF;
     buffer_address[7] = (CipUsint)(data)&0xFF;
-    (*buffer) += 8;
+    buffer += 8;
     return 8;
 }
 
@@ -162,7 +168,7 @@ int NET_Endianconv::GetEndianess()
     return g_opENer_platform_endianess;
 }
 
-void NET_Endianconv::MoveMessageNOctets(int amount_of_bytes_moved, CipOctet* message_runner)
+void NET_Endianconv::MoveMessageNOctets(int amount_of_bytes_moved, CipOctet *&message_runner)
 {
     (message_runner) += amount_of_bytes_moved;
 }
@@ -173,7 +179,7 @@ int NET_Endianconv::FillNextNMessageOctetsWith(CipOctet value, unsigned int amou
     return amount_of_bytes_written;
 }
 
-int NET_Endianconv::FillNextNMessageOctetsWithValueAndMoveToNextPosition(CipOctet value, unsigned int amount_of_filled_bytes, CipOctet* message)
+int NET_Endianconv::FillNextNMessageOctetsWithValueAndMoveToNextPosition(CipOctet value, unsigned int amount_of_filled_bytes, CipOctet *&message)
 {
     FillNextNMessageOctetsWith(value, amount_of_filled_bytes, message);
     MoveMessageNOctets(amount_of_filled_bytes, message);
@@ -0,0 +1,313 @@
+//
+// Explicit message workers: SendRRData requests executed off the control thread
+//
+
+#include <cerrno>
+#include <cstring>
+#include "../../../trace.hpp"
+#include "utils/staticmemory.hpp"
+#include "ethIP/NET_EthIP_Encap.hpp"
+#include "NET_IoBackend.hpp"
+#include "NET_NetworkHandler.hpp"
+#include "NET_TcpSendQueues.hpp"
+#include "NET_ExplicitWorkers.hpp"
+#include "NET_VirtualAdapters.hpp"
+
+//the workers are compiled in with -DOpENer_EXPLICIT_WORKERS=ON, see process_options
+#if defined(OPENER_WITH_EXPLICIT_WORKERS) && defined(__linux__) && !defined(WIN)
+#include <unistd.h>
+#include <sys/eventfd.h>
+#else
+#undef OPENER_WITH_EXPLICIT_WORKERS
+#endif
+
+//Static variables
+NET_ExplicitWorkers::Slot_t NET_ExplicitWorkers::slots[OPENER_EXPLICIT_WORKER_SLOTS];
+bool NET_ExplicitWorkers::session_busy[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+CIP_RequestContext NET_ExplicitWorkers::contexts[OPENER_EXPLICIT_WORKERS];
+std::thread NET_ExplicitWorkers::workers[OPENER_EXPLICIT_WORKERS];
+int NET_ExplicitWorkers::number_of_workers = 0;
+CipUdint NET_ExplicitWorkers::next_sequence = 0;
+CipUdint NET_ExplicitWorkers::rejected_requests = 0;
+int NET_ExplicitWorkers::wake_socket = kEipInvalidSocket;
+std::mutex NET_ExplicitWorkers::lock;
+std::condition_variable NET_ExplicitWorkers::work_available;
+std::atomic<bool> NET_ExplicitWorkers::running(false);
+
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+static CipUsint slot_buffers[OPENER_EXPLICIT_WORKER_SLOTS][OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+#endif
+
+CipStatus NET_ExplicitWorkers::Start(int workers_to_start)
+{
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+    //only the control thread switches between virtual adapters
+    if ((0 != number_of_workers) || (0 >= workers_to_start) || (OPENER_EXPLICIT_WORKERS < workers_to_start)
+        || NET_VirtualAdapters::IsActive())
+    {
+        return kCipStatusError;
+    }
+    //creating a thread allocates
+    if (StaticMemory::IsSealed())
+    {
+        OPENER_TRACE_ERR("networkhandler: explicit workers have to be started before the heap is sealed\n");
+        return kCipStatusError;
+    }
+
+    wake_socket = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (kEipInvalidSocket == wake_socket)
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot create the explicit worker wake up: %s\n", strerror(errno));
+        return kCipStatusError;
+    }
+    NET_IoBackend::Watch(wake_socket, NET_IoBackend::kWatchReadable);
+    if (wake_socket > NET_NetworkHandler::highest_socket_handle)
+    {
+        NET_NetworkHandler::highest_socket_handle = wake_socket;
+    }
+
+    memset(slots, 0, sizeof(slots));
+    memset(session_busy, 0, sizeof(session_busy));
+    rejected_requests = 0;
+    //sized for the largest request here, a worker has no buffer of its own, it works in the slot it takes, see Run
+    for (int i = 0; i < workers_to_start; i++)
+    {
+        contexts[i].Init(nullptr, sizeof(slot_buffers[0]));
+    }
+
+    running = true;
+    for (number_of_workers = 0; number_of_workers < workers_to_start; number_of_workers++)
+    {
+        workers[number_of_workers] = std::thread(Run, number_of_workers);
+    }
+    OPENER_TRACE_STATE("networkhandler: %d explicit message workers started\n", number_of_workers);
+    return kCipStatusOk;
+#else
+    (void) workers_to_start;
+    OPENER_TRACE_ERR("networkhandler: explicit message workers are not built in on this platform\n");
+    return kCipStatusError;
+#endif
+}
+
+void NET_ExplicitWorkers::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    work_available.notify_all();
+    for (int i = 0; i < number_of_workers; i++)
+    {
+        if (workers[i].joinable())
+        {
+            workers[i].join();
+        }
+    }
+    number_of_workers = 0;
+
+    if (kEipInvalidSocket != wake_socket)
+    {
+        NET_IoBackend::Unwatch(wake_socket);
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+        close(wake_socket);
+#endif
+        wake_socket = kEipInvalidSocket;
+    }
+    memset(slots, 0, sizeof(slots));
+}
+
+bool NET_ExplicitWorkers::IsActive()
+{
+    return running.load(std::memory_order_relaxed);
+}
+
+int NET_ExplicitWorkers::GetNumberOfWorkers()
+{
+    return number_of_workers;
+}
+
+int NET_ExplicitWorkers::GetWakeSocket()
+{
+    return wake_socket;
+}
+
+CipUdint NET_ExplicitWorkers::GetNumberOfRejectedRequests()
+{
+    return rejected_requests;
+}
+
+bool NET_ExplicitWorkers::Submit(int socket, CipUdint session_handle, const CipUsint* frame, CipUdint frame_length)
+{
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+    if ((0 == session_handle) || (OPENER_NUMBER_OF_SUPPORTED_SESSIONS < session_handle)
+        || (sizeof(slot_buffers[0]) < frame_length))
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        int free_slot = -1;
+        for (int i = 0; (i < OPENER_EXPLICIT_WORKER_SLOTS) && (0 > free_slot); i++)
+        {
+            if (kSlotFree == slots[i].state)
+            {
+                free_slot = i;
+            }
+        }
+        if (0 > free_slot)
+        {
+            rejected_requests++;
+            return false;
+        }
+
+        memcpy(slot_buffers[free_slot], frame, frame_length);
+        slots[free_slot].socket = socket;
+        slots[free_slot].session_handle = session_handle;
+        slots[free_slot].sequence = next_sequence++;
+        slots[free_slot].frame_length = frame_length;
+        slots[free_slot].cancelled = false;
+        slots[free_slot].state = kSlotQueued;
+    }
+    //the connection is not read from while the replies it waits for would not fit its send queue
+    NET_TcpSendQueues::Reserve(socket);
+    work_available.notify_one();
+    return true;
+#else
+    (void) socket;
+    (void) session_handle;
+    (void) frame;
+    (void) frame_length;
+    return false;
+#endif
+}
+
+void NET_ExplicitWorkers::CancelSocket(int socket)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < OPENER_EXPLICIT_WORKER_SLOTS; i++)
+    {
+        if ((kSlotFree == slots[i].state) || (socket != slots[i].socket))
+        {
+            continue;
+        }
+        if (kSlotQueued == slots[i].state)
+        {
+            slots[i].state = kSlotFree;
+        }
+        else
+        {
+            //the socket number may be taken by the next connection before the reply is sent
+            slots[i].cancelled = true;
+        }
+    }
+}
+
+void NET_ExplicitWorkers::SendReplies()
+{
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+    uint64_t completions;
+    if (sizeof(completions) != read(wake_socket, &completions, sizeof(completions)))
+    {
+        //nothing completed since the last call
+        return;
+    }
+
+    //only the control thread frees completed slots, they stay put while their reply is sent
+    for (;;)
+    {
+        int slot;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            slot = TakeReply();
+        }
+        if (0 > slot)
+        {
+            break;
+        }
+        int socket = slots[slot].socket;
+        bool broken = false;
+        if (!slots[slot].cancelled)
+        {
+            NET_TcpSendQueues::Release(socket);
+            broken = (0 < slots[slot].frame_length)
+                     && !NET_NetworkHandler::SendTcpReply(socket, slot_buffers[slot], (int) slots[slot].frame_length);
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            slots[slot].state = kSlotFree;
+        }
+        if (broken)
+        {
+            NET_NetworkHandler::CloseTcpSocket(socket);
+        }
+    }
+#endif
+}
+
+int NET_ExplicitWorkers::TakeRequest()
+{
+    int oldest = -1;
+    for (int i = 0; i < OPENER_EXPLICIT_WORKER_SLOTS; i++)
+    {
+        //a session waits for its request in progress
+        if ((kSlotQueued == slots[i].state) && !session_busy[slots[i].session_handle - 1]
+            && ((0 > oldest) || (0 > (CipDint) (slots[i].sequence - slots[oldest].sequence))))
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+int NET_ExplicitWorkers::TakeReply()
+{
+    int oldest = -1;
+    for (int i = 0; i < OPENER_EXPLICIT_WORKER_SLOTS; i++)
+    {
+        if ((kSlotDone == slots[i].state)
+            && ((0 > oldest) || (0 > (CipDint) (slots[i].sequence - slots[oldest].sequence))))
+        {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void NET_ExplicitWorkers::Run(int worker)
+{
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+    CIP_RequestContext *context = &contexts[worker];
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        int slot = TakeRequest();
+        if (0 > slot)
+        {
+            work_available.wait(guard);
+            continue;
+        }
+        Slot_t *request = &slots[slot];
+        request->state = kSlotRunning;
+        session_busy[request->session_handle - 1] = true;
+        guard.unlock();
+
+        context->buffer = slot_buffers[slot];
+        context->Begin(request->socket, nullptr);
+        int reply_length = NET_EthIP_Encap::HandleQueuedSendRequestResponseData(context, request->frame_length);
+
+        guard.lock();
+        request->frame_length = (CipUdint) ((0 < reply_length) ? reply_length : 0);
+        request->state = kSlotDone;
+        session_busy[request->session_handle - 1] = false;
+        uint64_t completion = 1;
+        if (sizeof(completion) != write(wake_socket, &completion, sizeof(completion)))
+        {
+            OPENER_TRACE_ERR("networkhandler: cannot wake up the network handler: %s\n", strerror(errno));
+        }
+    }
+#else
+    (void) worker;
+#endif
+}
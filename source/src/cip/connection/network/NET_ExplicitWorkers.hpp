@@ -0,0 +1,129 @@
+//
+// Explicit message workers: SendRRData requests executed off the control thread
+//
+
+#ifndef OPENER_NET_EXPLICITWORKERS_H
+#define OPENER_NET_EXPLICITWORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+#include "../CIP_RequestContext.hpp"
+
+/**
+ * @brief NET_ExplicitWorkers executes the SendRRData requests of the sessions on a pool of worker threads
+ *
+ * While the workers run, the control thread copies a SendRRData request of a
+ * registered session into a free request slot, see Submit, instead of handing
+ * it to the message router. A worker takes the oldest waiting request whose
+ * session has none in progress, so the requests of a session are executed one
+ * after the other in the order they have been received, while a slow service
+ * of one session does not hold up the others. The worker encodes the reply
+ * into the slot and wakes the control thread up, which sends the replies of a
+ * session in order, see SendReplies.
+ *
+ * The control thread keeps the I/O, the watchdogs and the class 3 connected
+ * messages, it never waits for a service of an application object. The
+ * message router executes the services of the classes not registered as
+ * thread safe with CIP_ConnectionManager::Lock held, see
+ * CIP_MessageRouter::thread_safe_classes, so they are never run by two
+ * threads at a time.
+ *
+ * The number of slots is bounded by OPENER_EXPLICIT_WORKER_SLOTS. A request
+ * finding all of them taken is answered right away with the encapsulation
+ * status insufficient memory.
+ *
+ * Workers are started after the network handler is initialized and before
+ * the heap is sealed, see OpENer_Interface::OpENer_Initialize.
+ */
+class NET_ExplicitWorkers
+{
+    public:
+        /** @brief Start the given number of workers, at most OPENER_EXPLICIT_WORKERS
+         *
+         * @return kCipStatusError if they cannot be started or the heap is sealed
+         *  already, the requests stay on the control thread then
+         */
+        static CipStatus Start(int number_of_workers);
+
+        /** @brief Stop the workers, replies not sent yet are dropped */
+        static void Stop();
+
+        static bool IsActive();
+        static int GetNumberOfWorkers();
+
+        /** @brief Queue a SendRRData request for the workers
+         *
+         * @param socket the TCP connection of the session, the reply is sent on it
+         * @param session_handle the registered session of the request
+         * @param frame the encapsulated request, header included
+         * @param frame_length length of the request
+         * @return false if all request slots are taken
+         */
+        static bool Submit(int socket, CipUdint session_handle, const CipUsint* frame, CipUdint frame_length);
+
+        /** @brief Send the replies the workers have completed, called by the control thread */
+        static void SendReplies();
+
+        /** @brief Drop the requests of a TCP connection about to be closed
+         *
+         * A request in progress is completed, its reply is not sent.
+         */
+        static void CancelSocket(int socket);
+
+        /** @brief The socket the control thread watches to learn about completed replies, -1 if not started */
+        static int GetWakeSocket();
+
+        /** @brief Number of requests answered with insufficient memory since the start */
+        static CipUdint GetNumberOfRejectedRequests();
+
+    private:
+        typedef enum
+        {
+            kSlotFree = 0,
+            kSlotQueued,
+            kSlotRunning,
+            kSlotDone
+        } SlotState_e;
+
+        typedef struct
+        {
+            SlotState_e state;
+            int socket;
+            CipUdint session_handle;
+            CipUdint sequence;     /**< order the requests have been submitted in */
+            CipUdint frame_length; /**< of the request, of the reply once done, 0 if there is none */
+            bool cancelled;
+        } Slot_t;
+
+        static Slot_t slots[OPENER_EXPLICIT_WORKER_SLOTS];
+        static bool session_busy[OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+        static CIP_RequestContext contexts[OPENER_EXPLICIT_WORKERS];
+        static std::thread workers[OPENER_EXPLICIT_WORKERS];
+        static int number_of_workers;
+        static CipUdint next_sequence;
+        static CipUdint rejected_requests;
+        static int wake_socket;
+        static std::mutex lock;
+        static std::condition_variable work_available;
+        static std::atomic<bool> running;
+
+        /** @brief Oldest queued request whose session is idle, the lock is held
+         *
+         * @return index of its slot, -1 if there is none
+         */
+        static int TakeRequest();
+
+        /** @brief Oldest completed reply, the lock is held
+         *
+         * @return index of its slot, -1 if there is none
+         */
+        static int TakeReply();
+
+        static void Run(int worker);
+};
+
+#endif //OPENER_NET_EXPLICITWORKERS_H
@@ -0,0 +1,989 @@
+//
+// Readiness and I/O backends of the network handler
+//
+
+#include <cerrno>
+#include <cstring>
+#include "../../../trace.hpp"
+#include "utils/netstatistics.hpp"
+#include "NET_Connection.hpp"
+#include "NET_IoBackend.hpp"
+
+#if defined(__linux__) && !defined(WIN)
+#define OPENER_WITH_EPOLL
+#include <unistd.h>
+#include <sys/epoll.h>
+#endif
+
+//io_uring support is compiled in with -DOpENer_IO_URING=ON if the kernel headers know all the requests used, see process_options
+#if defined(OPENER_WITH_EPOLL) && defined(OPENER_WITH_IO_URING)
+#include <csignal>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#else
+#undef OPENER_WITH_IO_URING
+#endif
+
+#if defined(OPENER_NETWORK_BACKEND_IO_URING)
+#define OPENER_DEFAULT_NETWORK_BACKEND kBackendIoUring
+#elif defined(OPENER_NETWORK_BACKEND_EPOLL)
+#define OPENER_DEFAULT_NETWORK_BACKEND kBackendEpoll
+#else
+#define OPENER_DEFAULT_NETWORK_BACKEND kBackendSelect
+#endif
+
+//Static variables
+NET_IoBackend::Backend_e NET_IoBackend::requested_backend = NET_IoBackend::OPENER_DEFAULT_NETWORK_BACKEND;
+NET_IoBackend::Backend_e NET_IoBackend::backend = NET_IoBackend::OPENER_DEFAULT_NETWORK_BACKEND;
+bool NET_IoBackend::initialized = false;
+
+static const char* const kBackendNames[NET_IoBackend::kNumberOfBackends] = { "select", "epoll", "io_uring" };
+
+//sockets not reported readable for now, see SetInterest
+static fd_set paused_sockets;
+static int number_of_paused_sockets = 0;
+
+#ifdef OPENER_WITH_EPOLL
+static const int kEpollEvents = 64;
+static int epoll_handle = -1;
+#endif
+
+#ifdef OPENER_WITH_IO_URING
+//user_data of a request: operation, generation of the socket and the socket or send slot
+typedef enum
+{
+    kOperationPoll = 1,
+    kOperationPollWrite,
+    kOperationAccept,
+    kOperationReceive,
+    kOperationSend,
+    kOperationCancel
+} Operation_e;
+
+typedef struct
+{
+    bool watched;
+    bool armed;            //a request is in the ring or about to be
+    bool write_armed;      //a poll for writing is in the ring
+    NET_IoBackend::Watch_e kind;
+    CipUdint generation;   //completions of an older generation are stale
+} WatchedSocket_t;
+
+typedef struct
+{
+    int socket;
+    CipUint buffer_id;
+    CipUdint length;
+} ReceivedFrame_t;
+
+typedef struct
+{
+    int listener;
+    int socket;
+} AcceptedSocket_t;
+
+typedef struct
+{
+    struct msghdr message;
+    struct iovec data_vector;
+    struct sockaddr_in destination;
+    int socket;
+    int connection;
+    CipUdint length;
+    CipUsint data[OPENER_IO_FRAME_BUFFER_SIZE];
+} SendSlot_t;
+
+static const CipUint kReceiveBufferGroup = 0;
+static const int kMaxAcceptedSockets = 16;
+
+static int ring_handle = -1;
+static void* ring_memory = MAP_FAILED;
+static size_t ring_memory_size;
+static struct io_uring_sqe* submission_entries = (struct io_uring_sqe*) MAP_FAILED;
+static size_t submission_entries_size;
+
+static unsigned* submission_head;
+static unsigned* submission_tail;
+static unsigned submission_mask;
+static unsigned number_of_submission_entries;
+static unsigned local_submission_tail;   //entries up to here have been prepared
+static unsigned* completion_head;
+static unsigned* completion_tail;
+static unsigned completion_mask;
+static struct io_uring_cqe* completion_entries;
+
+//the buffer ring has to be page aligned, its tail overlays the first entry
+alignas(4096) static struct io_uring_buf receive_ring[OPENER_IO_URING_RECEIVE_BUFFERS];
+alignas(64) static CipUsint receive_buffers[OPENER_IO_URING_RECEIVE_BUFFERS][OPENER_IO_URING_RECEIVE_BUFFER_SIZE];
+static CipUint receive_ring_tail;
+static struct msghdr receive_message;   //layout of the received buffers, name and control space only
+
+static WatchedSocket_t watched_sockets[FD_SETSIZE];
+static int sockets_to_arm[FD_SETSIZE];
+static int number_of_sockets_to_arm;
+
+static ReceivedFrame_t received_frames[OPENER_IO_URING_RECEIVE_BUFFERS];
+static int number_of_received_frames;
+static AcceptedSocket_t accepted_sockets[kMaxAcceptedSockets];
+static int number_of_accepted_sockets;
+
+static SendSlot_t send_slots[OPENER_IO_URING_SEND_SLOTS];
+static int free_send_slots[OPENER_IO_URING_SEND_SLOTS];
+static int number_of_free_send_slots;
+static int queued_sends[OPENER_IO_URING_SEND_SLOTS];
+static int number_of_queued_sends;
+
+static __u64 GetUserData(Operation_e operation, CipUdint generation, int socket)
+{
+    return ((__u64) operation << 56) | ((__u64) (generation & 0xFFFFFF) << 32) | (CipUdint) socket;
+}
+
+static int EnterRing(unsigned min_complete, unsigned flags, void* argument, size_t argument_size)
+{
+    __atomic_store_n(submission_tail, local_submission_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = local_submission_tail - __atomic_load_n(submission_head, __ATOMIC_ACQUIRE);
+    return (int) syscall(__NR_io_uring_enter, ring_handle, to_submit, min_complete, flags, argument, argument_size);
+}
+
+static unsigned GetFreeSubmissionEntries()
+{
+    return number_of_submission_entries - (local_submission_tail - __atomic_load_n(submission_head, __ATOMIC_ACQUIRE));
+}
+
+static struct io_uring_sqe* GetSubmissionEntry()
+{
+    if (0 == GetFreeSubmissionEntries())
+    {
+        //the ring is full, hand it over to the kernel first
+        EnterRing(0, 0, nullptr, 0);
+        if (0 == GetFreeSubmissionEntries())
+        {
+            return nullptr;
+        }
+    }
+    struct io_uring_sqe* entry = &submission_entries[local_submission_tail & submission_mask];
+    local_submission_tail++;
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+static void ReturnReceiveBuffer(CipUint buffer_id)
+{
+    //only the fields of the entry, the ring tail overlays the reserved one
+    struct io_uring_buf* entry = &receive_ring[receive_ring_tail & (OPENER_IO_URING_RECEIVE_BUFFERS - 1)];
+    entry->addr = (__u64) (uintptr_t) receive_buffers[buffer_id];
+    entry->len = OPENER_IO_URING_RECEIVE_BUFFER_SIZE;
+    entry->bid = buffer_id;
+    receive_ring_tail++;
+    __atomic_store_n(&((struct io_uring_buf_ring*) receive_ring)->tail, receive_ring_tail, __ATOMIC_RELEASE);
+}
+
+static bool ArmSocket(int socket)
+{
+    WatchedSocket_t* watched = &watched_sockets[socket];
+    struct io_uring_sqe* entry = GetSubmissionEntry();
+    if (nullptr == entry)
+    {
+        return false;
+    }
+
+    entry->fd = socket;
+    switch (watched->kind)
+    {
+        case NET_IoBackend::kWatchListener:
+            entry->opcode = IORING_OP_ACCEPT;
+            entry->ioprio = IORING_ACCEPT_MULTISHOT;
+            entry->user_data = GetUserData(kOperationAccept, watched->generation, socket);
+            break;
+        case NET_IoBackend::kWatchDatagrams:
+            entry->opcode = IORING_OP_RECVMSG;
+            entry->addr = (__u64) (uintptr_t) &receive_message;
+            entry->len = 1;
+            entry->ioprio = IORING_RECV_MULTISHOT;
+            entry->flags = IOSQE_BUFFER_SELECT;
+            entry->buf_group = kReceiveBufferGroup;
+            entry->user_data = GetUserData(kOperationReceive, watched->generation, socket);
+            break;
+        default:
+            //one shot, rearmed once handled, so data left in the socket is reported again
+            entry->opcode = IORING_OP_POLL_ADD;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            entry->poll32_events = ((__u32) POLLIN << 16) | ((__u32) POLLIN >> 16);
+#else
+            entry->poll32_events = POLLIN;
+#endif
+            entry->user_data = GetUserData(kOperationPoll, watched->generation, socket);
+            break;
+    }
+    return true;
+}
+
+//One shot, rearmed while the socket is asked to be reported writable
+static void ArmWrite(int socket)
+{
+    struct io_uring_sqe* entry = GetSubmissionEntry();
+    if (nullptr == entry)
+    {
+        return;
+    }
+    entry->opcode = IORING_OP_POLL_ADD;
+    entry->fd = socket;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    entry->poll32_events = ((__u32) POLLOUT << 16) | ((__u32) POLLOUT >> 16);
+#else
+    entry->poll32_events = POLLOUT;
+#endif
+    entry->user_data = GetUserData(kOperationPollWrite, watched_sockets[socket].generation, socket);
+    watched_sockets[socket].write_armed = true;
+}
+
+//Arms the sockets waiting for it and chains the queued sends, they are submitted with the next enter
+static void PrepareSubmissions()
+{
+    while (0 < number_of_sockets_to_arm)
+    {
+        int socket = sockets_to_arm[number_of_sockets_to_arm - 1];
+        if (FD_ISSET(socket, &paused_sockets))
+        {
+            //armed again once reading goes on
+            watched_sockets[socket].armed = false;
+        }
+        else if (watched_sockets[socket].watched && !ArmSocket(socket))
+        {
+            break;
+        }
+        number_of_sockets_to_arm--;
+    }
+
+    //a hard link keeps the order of the frames without cancelling the rest of the chain on an error
+    int chained = number_of_queued_sends;
+    if ((unsigned) chained > GetFreeSubmissionEntries())
+    {
+        chained = (int) GetFreeSubmissionEntries();
+    }
+    for (int i = 0; i < chained; i++)
+    {
+        SendSlot_t* slot = &send_slots[queued_sends[i]];
+        struct io_uring_sqe* entry = GetSubmissionEntry();
+        entry->opcode = IORING_OP_SENDMSG;
+        entry->fd = slot->socket;
+        entry->addr = (__u64) (uintptr_t) &slot->message;
+        entry->len = 1;
+        entry->flags = (i + 1 < chained) ? IOSQE_IO_HARDLINK : 0;
+        entry->user_data = GetUserData(kOperationSend, 0, queued_sends[i]);
+    }
+    number_of_queued_sends -= chained;
+    memmove(&queued_sends[0], &queued_sends[chained], number_of_queued_sends * sizeof(queued_sends[0]));
+}
+
+static void QueueSocketToArm(int socket)
+{
+    if (!watched_sockets[socket].armed)
+    {
+        watched_sockets[socket].armed = true;
+        sockets_to_arm[number_of_sockets_to_arm++] = socket;
+    }
+}
+
+static void CompleteSend(int slot_index, int result)
+{
+    SendSlot_t* slot = &send_slots[slot_index];
+    if (result != (int) slot->length)
+    {
+        OPENER_TRACE_WARN("networkhandler: produced frame on socket %d not sent: %s\n", slot->socket,
+                          (0 > result) ? strerror(-result) : "partially sent");
+        NetStatistics::Count(NetStatistics::kOutErrors);
+        NetStatistics::CountError(NetStatistics::kEndpointConnection, slot->connection);
+    }
+    free_send_slots[number_of_free_send_slots++] = slot_index;
+}
+
+//@return 1 if the completion made its socket ready
+static int HandleCompletion(const struct io_uring_cqe* completion)
+{
+    Operation_e operation = (Operation_e) (completion->user_data >> 56);
+    CipUdint generation = (CipUdint) (completion->user_data >> 32) & 0xFFFFFF;
+    int socket = (int) (CipUdint) completion->user_data;
+    bool has_buffer = 0 != (completion->flags & IORING_CQE_F_BUFFER);
+    CipUint buffer_id = (CipUint) (completion->flags >> IORING_CQE_BUFFER_SHIFT);
+
+    if (kOperationSend == operation)
+    {
+        CompleteSend(socket, completion->res);
+        return 0;
+    }
+    if (kOperationCancel == operation)
+    {
+        return 0;
+    }
+
+    WatchedSocket_t* watched = &watched_sockets[socket];
+    if (!watched->watched || ((watched->generation & 0xFFFFFF) != generation))
+    {
+        //the socket has been unwatched since
+        if (has_buffer)
+        {
+            ReturnReceiveBuffer(buffer_id);
+        }
+        if ((kOperationAccept == operation) && (0 <= completion->res))
+        {
+            close(completion->res);
+        }
+        return 0;
+    }
+    if (kOperationPollWrite == operation)
+    {
+        watched->write_armed = false;
+        NET_Connection::SelectSet(socket, NET_Connection::kWriteSet);
+        return 1;
+    }
+    if (0 == (completion->flags & IORING_CQE_F_MORE))
+    {
+        watched->armed = false;
+        QueueSocketToArm(socket);
+    }
+
+    switch (operation)
+    {
+        case kOperationAccept:
+            if (0 > completion->res)
+            {
+                OPENER_TRACE_ERR("networkhandler: error on accept: %s\n", strerror(-completion->res));
+                return 0;
+            }
+            if (kMaxAcceptedSockets == number_of_accepted_sockets)
+            {
+                OPENER_TRACE_WARN("networkhandler: too many pending connections, closing fd %d\n", completion->res);
+                close(completion->res);
+                return 0;
+            }
+            accepted_sockets[number_of_accepted_sockets].listener = socket;
+            accepted_sockets[number_of_accepted_sockets].socket = completion->res;
+            number_of_accepted_sockets++;
+            break;
+        case kOperationReceive:
+            if (!has_buffer)
+            {
+                //-ENOBUFS: all buffers are queued, the frames wait in the socket until they are handled
+                if (-ENOBUFS != completion->res)
+                {
+                    OPENER_TRACE_ERR("networkhandler: error on recvmsg: %s\n", strerror(-completion->res));
+                }
+                return 0;
+            }
+            received_frames[number_of_received_frames].socket = socket;
+            received_frames[number_of_received_frames].buffer_id = buffer_id;
+            received_frames[number_of_received_frames].length = (CipUdint) completion->res;
+            number_of_received_frames++;
+            break;
+        default:
+            break;
+    }
+    NET_Connection::SelectSet(socket, NET_Connection::kReadSet);
+    return 1;
+}
+
+static int ReapCompletions()
+{
+    int ready_sockets = 0;
+    unsigned head = *completion_head;
+    unsigned tail = __atomic_load_n(completion_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        ready_sockets += HandleCompletion(&completion_entries[head & completion_mask]);
+    }
+    __atomic_store_n(completion_head, head, __ATOMIC_RELEASE);
+    return ready_sockets;
+}
+
+static int WaitIoUring(struct timeval* timeout)
+{
+    NET_Connection::SelectZero(NET_Connection::kReadSet);
+    NET_Connection::SelectZero(NET_Connection::kWriteSet);
+    PrepareSubmissions();
+
+    //frames and connections taken from earlier completions are still ready
+    int ready_sockets = 0;
+    for (int i = 0; i < number_of_received_frames; i++)
+    {
+        NET_Connection::SelectSet(received_frames[i].socket, NET_Connection::kReadSet);
+        ready_sockets++;
+    }
+    for (int i = 0; i < number_of_accepted_sockets; i++)
+    {
+        NET_Connection::SelectSet(accepted_sockets[i].listener, NET_Connection::kReadSet);
+        ready_sockets++;
+    }
+
+    struct __kernel_timespec wait_time = { 0, 0 };
+    struct io_uring_getevents_arg argument;
+    memset(&argument, 0, sizeof(argument));
+    argument.sigmask_sz = _NSIG / 8;
+    if (nullptr != timeout)
+    {
+        wait_time.tv_sec = timeout->tv_sec;
+        wait_time.tv_nsec = (long long) timeout->tv_usec * 1000;
+        argument.ts = (__u64) (uintptr_t) &wait_time;
+    }
+
+    int result = EnterRing((0 < ready_sockets) ? 0 : 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument,
+                           sizeof(argument));
+    if ((0 > result) && (ETIME != errno) && (EBUSY != errno))
+    {
+        return -1;
+    }
+    return ready_sockets + ReapCompletions();
+}
+
+static void DropQueued(int socket)
+{
+    for (int i = 0; i < number_of_received_frames;)
+    {
+        if (socket == received_frames[i].socket)
+        {
+            ReturnReceiveBuffer(received_frames[i].buffer_id);
+            received_frames[i] = received_frames[--number_of_received_frames];
+            continue;
+        }
+        i++;
+    }
+    for (int i = 0; i < number_of_accepted_sockets;)
+    {
+        if (socket == accepted_sockets[i].listener)
+        {
+            close(accepted_sockets[i].socket);
+            accepted_sockets[i] = accepted_sockets[--number_of_accepted_sockets];
+            continue;
+        }
+        i++;
+    }
+    for (int i = 0; i < number_of_sockets_to_arm;)
+    {
+        if (socket == sockets_to_arm[i])
+        {
+            sockets_to_arm[i] = sockets_to_arm[--number_of_sockets_to_arm];
+            continue;
+        }
+        i++;
+    }
+}
+
+static void UnwatchIoUring(int socket)
+{
+    WatchedSocket_t* watched = &watched_sockets[socket];
+    if (!watched->watched)
+    {
+        return;
+    }
+    watched->watched = false;
+    watched->armed = false;
+    watched->generation++;
+    DropQueued(socket);
+
+    //the queued sends still go out, the cancel has to be issued while the socket is open
+    PrepareSubmissions();
+    struct io_uring_sqe* entry = GetSubmissionEntry();
+    if (nullptr != entry)
+    {
+        entry->opcode = IORING_OP_ASYNC_CANCEL;
+        entry->fd = socket;
+        entry->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        entry->user_data = GetUserData(kOperationCancel, 0, socket);
+    }
+    EnterRing(0, 0, nullptr, 0);
+}
+
+static void CloseIoUring()
+{
+    for (int i = 0; i < number_of_accepted_sockets; i++)
+    {
+        close(accepted_sockets[i].socket);
+    }
+    if (MAP_FAILED != (void*) submission_entries)
+    {
+        munmap(submission_entries, submission_entries_size);
+        submission_entries = (struct io_uring_sqe*) MAP_FAILED;
+    }
+    if (MAP_FAILED != ring_memory)
+    {
+        munmap(ring_memory, ring_memory_size);
+        ring_memory = MAP_FAILED;
+    }
+    if (-1 != ring_handle)
+    {
+        close(ring_handle);
+        ring_handle = -1;
+    }
+    memset(watched_sockets, 0, sizeof(watched_sockets));
+    number_of_sockets_to_arm = 0;
+    number_of_received_frames = 0;
+    number_of_accepted_sockets = 0;
+    number_of_queued_sends = 0;
+    //without the ring the frames are sent right away
+    number_of_free_send_slots = 0;
+}
+#endif
+
+//Methods
+bool NET_IoBackend::SetBackend(Backend_e new_backend)
+{
+    switch (new_backend)
+    {
+        case kBackendSelect:
+            break;
+#ifdef OPENER_WITH_EPOLL
+        case kBackendEpoll:
+            break;
+#endif
+#ifdef OPENER_WITH_IO_URING
+        case kBackendIoUring:
+            break;
+#endif
+        default:
+            return false;
+    }
+    requested_backend = new_backend;
+    if (!initialized)
+    {
+        backend = new_backend;
+    }
+    return true;
+}
+
+NET_IoBackend::Backend_e NET_IoBackend::GetBackend()
+{
+    return backend;
+}
+
+const char* NET_IoBackend::GetName(Backend_e name_of_backend)
+{
+    return (kNumberOfBackends > name_of_backend) ? kBackendNames[name_of_backend] : "unknown";
+}
+
+CipStatus NET_IoBackend::Init()
+{
+    NET_Connection::InitSelects();
+    FD_ZERO(&paused_sockets);
+    number_of_paused_sockets = 0;
+
+    backend = requested_backend;
+    if ((kBackendIoUring == backend) && !InitIoUring())
+    {
+        OPENER_TRACE_WARN("networkhandler: io_uring is not usable, falling back to epoll\n");
+        backend = kBackendEpoll;
+    }
+    if ((kBackendEpoll == backend) && !InitEpoll())
+    {
+        OPENER_TRACE_WARN("networkhandler: epoll is not usable, falling back to select\n");
+        backend = kBackendSelect;
+    }
+    initialized = true;
+    OPENER_TRACE_STATE("networkhandler: %s backend\n", GetName(backend));
+    return kCipStatusOk;
+}
+
+void NET_IoBackend::Finish()
+{
+#ifdef OPENER_WITH_IO_URING
+    CloseIoUring();
+#endif
+#ifdef OPENER_WITH_EPOLL
+    if (-1 != epoll_handle)
+    {
+        close(epoll_handle);
+        epoll_handle = -1;
+    }
+#endif
+    initialized = false;
+    backend = requested_backend;
+}
+
+bool NET_IoBackend::InitEpoll()
+{
+#ifdef OPENER_WITH_EPOLL
+    epoll_handle = epoll_create1(EPOLL_CLOEXEC);
+    return -1 != epoll_handle;
+#else
+    return false;
+#endif
+}
+
+bool NET_IoBackend::InitIoUring()
+{
+#ifdef OPENER_WITH_IO_URING
+    struct io_uring_params parameters;
+    memset(&parameters, 0, sizeof(parameters));
+    //multishot requests may complete many times for one submission
+    parameters.flags = IORING_SETUP_CQSIZE;
+    parameters.cq_entries = 4 * OPENER_IO_URING_ENTRIES;
+
+    ring_handle = (int) syscall(__NR_io_uring_setup, OPENER_IO_URING_ENTRIES, &parameters);
+    if (-1 == ring_handle)
+    {
+        OPENER_TRACE_WARN("networkhandler: io_uring_setup failed: %s\n", strerror(errno));
+        return false;
+    }
+    if ((IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP)
+        != (parameters.features & (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP)))
+    {
+        CloseIoUring();
+        return false;
+    }
+
+    size_t submission_ring_size = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+    size_t completion_ring_size = parameters.cq_off.cqes + parameters.cq_entries * sizeof(struct io_uring_cqe);
+    ring_memory_size = (submission_ring_size > completion_ring_size) ? submission_ring_size : completion_ring_size;
+    ring_memory = mmap(nullptr, ring_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_handle,
+                       IORING_OFF_SQ_RING);
+    submission_entries_size = parameters.sq_entries * sizeof(struct io_uring_sqe);
+    submission_entries = (struct io_uring_sqe*) mmap(nullptr, submission_entries_size, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, ring_handle, IORING_OFF_SQES);
+    if ((MAP_FAILED == ring_memory) || (MAP_FAILED == (void*) submission_entries))
+    {
+        CloseIoUring();
+        return false;
+    }
+
+    CipUsint* ring = (CipUsint*) ring_memory;
+    submission_head = (unsigned*) (ring + parameters.sq_off.head);
+    submission_tail = (unsigned*) (ring + parameters.sq_off.tail);
+    submission_mask = *(unsigned*) (ring + parameters.sq_off.ring_mask);
+    number_of_submission_entries = parameters.sq_entries;
+    local_submission_tail = *submission_tail;
+    unsigned* submission_array = (unsigned*) (ring + parameters.sq_off.array);
+    for (unsigned i = 0; i < parameters.sq_entries; i++)
+    {
+        submission_array[i] = i;
+    }
+    completion_head = (unsigned*) (ring + parameters.cq_off.head);
+    completion_tail = (unsigned*) (ring + parameters.cq_off.tail);
+    completion_mask = *(unsigned*) (ring + parameters.cq_off.ring_mask);
+    completion_entries = (struct io_uring_cqe*) (ring + parameters.cq_off.cqes);
+
+    //all receive buffers are handed to the kernel, the frames are copied out of them when handled
+    static_assert(0 == (OPENER_IO_URING_RECEIVE_BUFFERS & (OPENER_IO_URING_RECEIVE_BUFFERS - 1)),
+                  "the number of receive buffers has to be a power of 2");
+    receive_ring_tail = 0;
+    ((struct io_uring_buf_ring*) receive_ring)->tail = 0;
+    for (CipUint i = 0; i < OPENER_IO_URING_RECEIVE_BUFFERS; i++)
+    {
+        ReturnReceiveBuffer(i);
+    }
+    struct io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = (__u64) (uintptr_t) receive_ring;
+    registration.ring_entries = OPENER_IO_URING_RECEIVE_BUFFERS;
+    registration.bgid = kReceiveBufferGroup;
+    if (0 != syscall(__NR_io_uring_register, ring_handle, IORING_REGISTER_PBUF_RING, &registration, 1))
+    {
+        OPENER_TRACE_WARN("networkhandler: no buffer rings: %s\n", strerror(errno));
+        CloseIoUring();
+        return false;
+    }
+
+    memset(&receive_message, 0, sizeof(receive_message));
+    receive_message.msg_namelen = sizeof(struct sockaddr_in);
+    receive_message.msg_controllen = CMSG_SPACE(sizeof(struct timespec));
+
+    number_of_free_send_slots = 0;
+    for (int i = OPENER_IO_URING_SEND_SLOTS - 1; i >= 0; i--)
+    {
+        free_send_slots[number_of_free_send_slots++] = i;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void NET_IoBackend::Watch(int socket, Watch_e kind)
+{
+    NET_Connection::SelectSet(socket, NET_Connection::kMasterSet);
+    if ((0 > socket) || (FD_SETSIZE <= socket))
+    {
+        return;
+    }
+
+#ifdef OPENER_WITH_EPOLL
+    if (kBackendEpoll == backend)
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        if (-1 == epoll_ctl(epoll_handle, EPOLL_CTL_ADD, socket, &event))
+        {
+            OPENER_TRACE_ERR("networkhandler: cannot watch fd %d: %s\n", socket, strerror(errno));
+        }
+    }
+#endif
+#ifdef OPENER_WITH_IO_URING
+    if (kBackendIoUring == backend)
+    {
+        watched_sockets[socket].watched = true;
+        watched_sockets[socket].armed = false;
+        watched_sockets[socket].write_armed = false;
+        watched_sockets[socket].kind = kind;
+        QueueSocketToArm(socket);
+    }
+#endif
+    (void) kind;
+}
+
+void NET_IoBackend::Unwatch(int socket)
+{
+    NET_Connection::SelectRemove(socket, NET_Connection::kMasterSet);
+    if ((0 > socket) || (FD_SETSIZE <= socket))
+    {
+        return;
+    }
+    SetInterest(socket, true, false);
+
+#ifdef OPENER_WITH_EPOLL
+    if ((kBackendEpoll == backend) && (-1 != epoll_handle))
+    {
+        epoll_ctl(epoll_handle, EPOLL_CTL_DEL, socket, nullptr);
+    }
+#endif
+#ifdef OPENER_WITH_IO_URING
+    if ((kBackendIoUring == backend) && (-1 != ring_handle))
+    {
+        UnwatchIoUring(socket);
+    }
+#endif
+}
+
+void NET_IoBackend::SetInterest(int socket, bool readable, bool writable)
+{
+    if ((0 > socket) || (FD_SETSIZE <= socket))
+    {
+        return;
+    }
+    bool was_readable = !FD_ISSET(socket, &paused_sockets);
+    bool was_writable = 0 != NET_Connection::SelectIsSet(socket, NET_Connection::kWriteMasterSet);
+
+#ifdef OPENER_WITH_IO_URING
+    //the write poll is one shot, it is armed again as long as the socket is to be written
+    if ((kBackendIoUring == backend) && (-1 != ring_handle) && watched_sockets[socket].watched)
+    {
+        if (readable && !was_readable)
+        {
+            FD_CLR(socket, &paused_sockets);
+            QueueSocketToArm(socket);
+        }
+        if (writable && !watched_sockets[socket].write_armed)
+        {
+            ArmWrite(socket);
+        }
+    }
+#endif
+    if ((readable == was_readable) && (writable == was_writable))
+    {
+        return;
+    }
+
+    if (readable)
+    {
+        FD_CLR(socket, &paused_sockets);
+    }
+    else
+    {
+        FD_SET(socket, &paused_sockets);
+    }
+    number_of_paused_sockets += (readable ? 0 : 1) - (was_readable ? 0 : 1);
+    if (writable)
+    {
+        NET_Connection::SelectSet(socket, NET_Connection::kWriteMasterSet);
+    }
+    else
+    {
+        NET_Connection::SelectRemove(socket, NET_Connection::kWriteMasterSet);
+        NET_Connection::SelectRemove(socket, NET_Connection::kWriteSet);
+    }
+
+#ifdef OPENER_WITH_EPOLL
+    if ((kBackendEpoll == backend) && (-1 != epoll_handle) && NET_Connection::SelectIsSet(socket, NET_Connection::kMasterSet))
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = (readable ? (uint32_t) EPOLLIN : 0) | (writable ? (uint32_t) EPOLLOUT : 0);
+        event.data.fd = socket;
+        if (-1 == epoll_ctl(epoll_handle, EPOLL_CTL_MOD, socket, &event))
+        {
+            OPENER_TRACE_ERR("networkhandler: cannot change the events of fd %d: %s\n", socket, strerror(errno));
+        }
+    }
+#endif
+}
+
+int NET_IoBackend::Wait(int number_of_sockets, struct timeval* timeout)
+{
+#ifdef OPENER_WITH_IO_URING
+    if (kBackendIoUring == backend)
+    {
+        return WaitIoUring(timeout);
+    }
+#endif
+#ifdef OPENER_WITH_EPOLL
+    if (kBackendEpoll == backend)
+    {
+        struct epoll_event events[kEpollEvents];
+        int timeout_ms = (nullptr == timeout) ? -1 : (int) (timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000);
+        int ready_sockets = epoll_wait(epoll_handle, events, kEpollEvents, timeout_ms);
+
+        NET_Connection::SelectZero(NET_Connection::kReadSet);
+        NET_Connection::SelectZero(NET_Connection::kWriteSet);
+        for (int i = 0; i < ready_sockets; i++)
+        {
+            int socket = events[i].data.fd;
+            //an error or hang up is reported to whoever handles the socket next
+            bool failed = 0 != (events[i].events & (EPOLLERR | EPOLLHUP));
+            if ((0 != (events[i].events & EPOLLIN)) || (failed && !FD_ISSET(socket, &paused_sockets)))
+            {
+                NET_Connection::SelectSet(socket, NET_Connection::kReadSet);
+            }
+            if ((0 != (events[i].events & EPOLLOUT))
+                || (failed && NET_Connection::SelectIsSet(socket, NET_Connection::kWriteMasterSet)))
+            {
+                NET_Connection::SelectSet(socket, NET_Connection::kWriteSet);
+            }
+        }
+        return ready_sockets;
+    }
+#endif
+    NET_Connection::SelectCopy();
+    if (0 < number_of_paused_sockets)
+    {
+        for (int socket = 0; socket < number_of_sockets; socket++)
+        {
+            if (FD_ISSET(socket, &paused_sockets))
+            {
+                NET_Connection::SelectRemove(socket, NET_Connection::kReadSet);
+            }
+        }
+    }
+    return NET_Connection::SelectSelect(number_of_sockets, NET_Connection::kReadSet, timeout);
+}
+
+int NET_IoBackend::Accept(int listener)
+{
+#ifdef OPENER_WITH_IO_URING
+    if (kBackendIoUring == backend)
+    {
+        for (int i = 0; i < number_of_accepted_sockets; i++)
+        {
+            if (listener == accepted_sockets[i].listener)
+            {
+                int socket = accepted_sockets[i].socket;
+                number_of_accepted_sockets--;
+                memmove(&accepted_sockets[i], &accepted_sockets[i + 1],
+                        (number_of_accepted_sockets - i) * sizeof(accepted_sockets[0]));
+                return socket;
+            }
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+#endif
+    return (int) accept(listener, nullptr, nullptr);
+}
+
+bool NET_IoBackend::IsReceiving()
+{
+    return kBackendIoUring == backend;
+}
+
+int NET_IoBackend::ReceiveQueued(int socket, CipUsint* buffer, CipUdint buffer_size, struct sockaddr_in* from_address,
+                                 CipUlint* receive_time)
+{
+    *receive_time = 0;
+#ifdef OPENER_WITH_IO_URING
+    for (int i = 0; i < number_of_received_frames; i++)
+    {
+        if (socket != received_frames[i].socket)
+        {
+            continue;
+        }
+
+        //the frames of a socket are taken in the order they have been received
+        ReceivedFrame_t frame = received_frames[i];
+        number_of_received_frames--;
+        memmove(&received_frames[i], &received_frames[i + 1], (number_of_received_frames - i) * sizeof(received_frames[0]));
+
+        //the buffer holds the recvmsg header, the name and control space of receive_message, then the payload
+        CipUsint* data = receive_buffers[frame.buffer_id];
+        struct io_uring_recvmsg_out* header = (struct io_uring_recvmsg_out*) data;
+        CipUsint* name = data + sizeof(*header);
+        CipUsint* control = name + receive_message.msg_namelen;
+        CipUsint* payload = control + receive_message.msg_controllen;
+
+        int received_size = -1;
+        if ((frame.length < (CipUdint) (payload - data)) || (0 != (header->flags & MSG_TRUNC))
+            || (buffer_size < header->payloadlen))
+        {
+            errno = EMSGSIZE;
+        }
+        else
+        {
+            memset(from_address, 0, sizeof(*from_address));
+            memcpy(from_address, name, (header->namelen < sizeof(*from_address)) ? header->namelen : sizeof(*from_address));
+
+            struct msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_control = control;
+            message.msg_controllen = header->controllen;
+            for (struct cmsghdr* control_header = CMSG_FIRSTHDR(&message); nullptr != control_header;
+                 control_header = CMSG_NXTHDR(&message, control_header))
+            {
+                if ((SOL_SOCKET == control_header->cmsg_level) && (SCM_TIMESTAMPNS == control_header->cmsg_type))
+                {
+                    struct timespec timestamp;
+                    memcpy(&timestamp, CMSG_DATA(control_header), sizeof(timestamp));
+                    *receive_time = (CipUlint) timestamp.tv_sec * 1000000000ULL + (CipUlint) timestamp.tv_nsec;
+                }
+            }
+            memcpy(buffer, payload, header->payloadlen);
+            received_size = (int) header->payloadlen;
+        }
+        ReturnReceiveBuffer(frame.buffer_id);
+        return received_size;
+    }
+#endif
+    (void) socket;
+    (void) buffer;
+    (void) buffer_size;
+    (void) from_address;
+    errno = EAGAIN;
+    return -1;
+}
+
+int NET_IoBackend::SendTo(int socket, const CipUsint* data, CipUdint length, const struct sockaddr* destination,
+                          int connection)
+{
+#ifdef OPENER_WITH_IO_URING
+    if ((kBackendIoUring == backend) && (0 < number_of_free_send_slots) && (OPENER_IO_FRAME_BUFFER_SIZE >= length))
+    {
+        int slot_index = free_send_slots[--number_of_free_send_slots];
+        SendSlot_t* slot = &send_slots[slot_index];
+        memcpy(slot->data, data, length);
+        memcpy(&slot->destination, destination, sizeof(slot->destination));
+        slot->data_vector.iov_base = slot->data;
+        slot->data_vector.iov_len = length;
+        memset(&slot->message, 0, sizeof(slot->message));
+        slot->message.msg_name = &slot->destination;
+        slot->message.msg_namelen = sizeof(slot->destination);
+        slot->message.msg_iov = &slot->data_vector;
+        slot->message.msg_iovlen = 1;
+        slot->socket = socket;
+        slot->connection = connection;
+        slot->length = length;
+        queued_sends[number_of_queued_sends++] = slot_index;
+        return (int) length;
+    }
+#endif
+    //sent right away, with io_uring if all send slots are in flight
+    (void) connection;
+    return (int) sendto(socket, (const char*) data, length, 0, destination, sizeof(struct sockaddr_in));
+}
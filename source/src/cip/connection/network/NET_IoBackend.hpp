@@ -0,0 +1,127 @@
+//
+// Readiness and I/O backends of the network handler
+//
+
+#ifndef OPENER_NET_IOBACKEND_H
+#define OPENER_NET_IOBACKEND_H
+
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+#include "ethIP/NET_EthIP_Includes.h"
+
+/**
+ * @brief NET_IoBackend waits for the sockets of the network handler
+ *
+ * Whatever the backend, the sockets found ready are marked in the read set of
+ * NET_Connection, so the handlers keep checking them with CheckSocketSet. The
+ * sockets asked to be reported writable with SetInterest are marked in its
+ * write set.
+ *
+ * - select: the master set is copied and handed to select(), as before.
+ * - epoll: level triggered, epoll_wait() marks the ready sockets.
+ * - io_uring: every socket has a request armed in the ring, all of them are
+ *   submitted and their completions reaped with one io_uring_enter() per loop.
+ *   The TCP listener is served by a multishot accept, the consuming I/O sockets
+ *   by a multishot recvmsg into a registered buffer ring, any other socket by a
+ *   poll rearmed after it has been handled. Produced frames are copied into
+ *   send slots and submitted as one chain of linked sends with the next loop.
+ *
+ * The backend is chosen at build time with OpENer_NETWORK_BACKEND and can be
+ * changed with SetBackend before the network handler is initialized. If it is
+ * not available on the running kernel the next simpler one is used.
+ */
+class NET_IoBackend
+{
+    public:
+        typedef enum
+        {
+            kBackendSelect = 0,
+            kBackendEpoll,
+            kBackendIoUring,
+            kNumberOfBackends
+        } Backend_e;
+
+        typedef enum
+        {
+            kWatchReadable = 0, /**< reported when readable */
+            kWatchListener,     /**< a TCP listener, connections are taken with Accept */
+            kWatchDatagrams     /**< a consuming I/O socket, frames are taken with ReceiveQueued */
+        } Watch_e;
+
+        /** @brief Backend to use from the next Init on, returns false if it is not built in */
+        static bool SetBackend(Backend_e backend);
+
+        /** @brief The backend in use, the one set if not initialized */
+        static Backend_e GetBackend();
+
+        static const char* GetName(Backend_e backend);
+
+        /** @brief Set up the backend set before, falling back to a simpler one if needed
+         *
+         * @return kCipStatusError if not even select is usable
+         */
+        static CipStatus Init();
+        static void Finish();
+
+        /** @brief Start watching a socket, it is added to the master set as well */
+        static void Watch(int socket, Watch_e kind);
+
+        /** @brief Stop watching a socket, has to be called before it is closed */
+        static void Unwatch(int socket);
+
+        /** @brief Change what is reported of a socket watched as readable
+         *
+         * @param readable false to stop reporting the socket readable, the data
+         *  waits in the socket until it is true again
+         * @param writable true to mark the socket in the write set once it can be written
+         */
+        static void SetInterest(int socket, bool readable, bool writable);
+
+        /** @brief Wait for ready sockets, they are marked in the read set
+         *
+         * @param number_of_sockets highest socket + 1, as for select()
+         * @param timeout longest time to wait
+         * @return number of ready sockets, -1 on error with errno set
+         */
+        static int Wait(int number_of_sockets, struct timeval* timeout);
+
+        /** @brief Take a new connection of a listener found ready
+         *
+         * @return the socket of the connection, -1 on error with errno set
+         */
+        static int Accept(int listener);
+
+        /** @brief Take the next frame a ready datagram socket has received in the ring
+         *
+         * Only the io_uring backend receives frames by itself, see IsReceiving.
+         *
+         * @param receive_time kernel receive timestamp in ns, 0 if there is none
+         * @return size of the frame, -1 on error with errno set
+         */
+        static int ReceiveQueued(int socket, CipUsint* buffer, CipUdint buffer_size, struct sockaddr_in* from_address,
+                                 CipUlint* receive_time);
+
+        /** @brief true if the frames of datagram sockets are received by the backend */
+        static bool IsReceiving();
+
+        /** @brief Send a produced frame
+         *
+         * The io_uring backend queues the frame for the next loop, errors are
+         * counted on the interface and the connection when it completes.
+         *
+         * @param connection index of the connection record, for the statistics
+         * @return the length sent or queued, -1 on error with errno set
+         */
+        static int SendTo(int socket, const CipUsint* data, CipUdint length, const struct sockaddr* destination,
+                          int connection);
+
+    private:
+        static Backend_e requested_backend;
+        static Backend_e backend;
+        static bool initialized;
+
+        static bool InitEpoll();
+        static bool InitIoUring();
+};
+
+#endif //OPENER_NET_IOBACKEND_H
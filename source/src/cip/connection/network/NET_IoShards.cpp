@@ -0,0 +1,320 @@
+//
+// I/O shards: the consuming I/O connections served by worker threads
+//
+
+#include <cerrno>
+#include <cstring>
+#include "../../../trace.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "utils/iolatency.hpp"
+#include "utils/netstatistics.hpp"
+#include "utils/staticmemory.hpp"
+#include "NET_Connection.hpp"
+#include "NET_Endianconv.hpp"
+#include "NET_NetworkHandler.hpp"
+#include "NET_IoShards.hpp"
+#include "NET_VirtualAdapters.hpp"
+
+//the shards are compiled in with -DOpENer_IO_SHARDS=ON, see process_options
+#if defined(OPENER_WITH_IO_SHARDS) && defined(__linux__) && !defined(WIN) && defined(SO_REUSEPORT)
+#include <unistd.h>
+#include <linux/filter.h>
+#else
+#undef OPENER_WITH_IO_SHARDS
+#endif
+
+//Static variables
+NET_IoShards::Shard_t NET_IoShards::shards[OPENER_IO_SHARDS];
+int NET_IoShards::number_of_shards = 0;
+int NET_IoShards::lock_depth = 0;
+std::atomic<bool> NET_IoShards::running(false);
+
+static const CipUint kOpENerEipIoUdpPort = 0x08AE;
+
+//The connection id follows item count, address item type and length in the common packet format
+static const int kConnectionIdOffset = 6;
+
+//A blocked receive returns this often to see whether the shard has been stopped
+static const int kReceiveTimeoutInMicroSeconds = 100000;
+
+#ifdef OPENER_WITH_IO_SHARDS
+static CipUsint shard_buffers[OPENER_IO_SHARDS][OPENER_IO_SHARD_BATCH][OPENER_IO_FRAME_BUFFER_SIZE];
+#endif
+
+CipStatus NET_IoShards::Start(int shards_to_start)
+{
+#ifdef OPENER_WITH_IO_SHARDS
+    //only the control thread switches between virtual adapters
+    if ((0 != number_of_shards) || (0 >= shards_to_start) || (OPENER_IO_SHARDS < shards_to_start)
+        || NET_VirtualAdapters::IsActive())
+    {
+        return kCipStatusError;
+    }
+    //creating a thread allocates
+    if (StaticMemory::IsSealed())
+    {
+        OPENER_TRACE_ERR("networkhandler: I/O shards have to be started before the heap is sealed\n");
+        return kCipStatusError;
+    }
+
+    //the index of a socket in the group is the order it has been bound in
+    for (number_of_shards = 0; number_of_shards < shards_to_start; number_of_shards++)
+    {
+        shards[number_of_shards].socket = OpenSocket();
+        if (kEipInvalidSocket == shards[number_of_shards].socket)
+        {
+            Stop();
+            return kCipStatusError;
+        }
+    }
+    if (!AttachSteering(shards[0].socket))
+    {
+        Stop();
+        return kCipStatusError;
+    }
+
+    running = true;
+    for (int i = 0; i < number_of_shards; i++)
+    {
+        shards[i].received_frames = 0;
+        shards[i].worker = std::thread(Run, i);
+    }
+    OPENER_TRACE_STATE("networkhandler: %d I/O shards started\n", number_of_shards);
+    return kCipStatusOk;
+#else
+    (void) shards_to_start;
+    OPENER_TRACE_ERR("networkhandler: I/O shards are not built in on this platform\n");
+    return kCipStatusError;
+#endif
+}
+
+void NET_IoShards::Stop()
+{
+    running = false;
+    for (int i = 0; i < number_of_shards; i++)
+    {
+        if (shards[i].worker.joinable())
+        {
+            shards[i].worker.join();
+        }
+        if (kEipInvalidSocket != shards[i].socket)
+        {
+#ifdef OPENER_WITH_IO_SHARDS
+            close(shards[i].socket);
+#endif
+            shards[i].socket = kEipInvalidSocket;
+        }
+    }
+    number_of_shards = 0;
+}
+
+bool NET_IoShards::IsActive()
+{
+    return running.load(std::memory_order_relaxed);
+}
+
+int NET_IoShards::GetNumberOfShards()
+{
+    return number_of_shards;
+}
+
+int NET_IoShards::GetShard(CipUdint connection_id)
+{
+    if (0 == number_of_shards)
+    {
+        return 0;
+    }
+    //the steering program loads the little endian id as a big endian word
+    CipUdint loaded = __builtin_bswap32(connection_id);
+    return (int) (((CipUdint) (loaded * kHashMultiplier) >> 16) % (CipUdint) number_of_shards);
+}
+
+CipUdint NET_IoShards::GetReceivedFrames(int shard)
+{
+    return ((0 <= shard) && (number_of_shards > shard)) ? shards[shard].received_frames.load(std::memory_order_relaxed) : 0;
+}
+
+void NET_IoShards::LockAll()
+{
+    if ((0 < lock_depth++) || !IsActive())
+    {
+        return;
+    }
+    for (int i = 0; i < number_of_shards; i++)
+    {
+        shards[i].lock.lock();
+    }
+}
+
+void NET_IoShards::UnlockAll()
+{
+    if ((0 < --lock_depth) || !IsActive())
+    {
+        return;
+    }
+    for (int i = number_of_shards - 1; i >= 0; i--)
+    {
+        shards[i].lock.unlock();
+    }
+}
+
+int NET_IoShards::OpenSocket()
+{
+#ifdef OPENER_WITH_IO_SHARDS
+    int new_socket = (int) socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (kEipInvalidSocket == new_socket)
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot create I/O shard socket: %s\n", strerror(errno));
+        return kEipInvalidSocket;
+    }
+
+    int option_value = 1;
+    struct timeval timeout = { 0, kReceiveTimeoutInMicroSeconds };
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = CIP_TCPIP_Interface::interface_configuration_.ip_address;
+    address.sin_port = NET_Connection::endian_htons(kOpENerEipIoUdpPort);
+
+    if ((-1 == setsockopt(new_socket, SOL_SOCKET, SO_REUSEADDR, (char *) &option_value, sizeof(option_value)))
+        || (-1 == setsockopt(new_socket, SOL_SOCKET, SO_REUSEPORT, (char *) &option_value, sizeof(option_value)))
+        || (-1 == setsockopt(new_socket, SOL_SOCKET, SO_RCVTIMEO, (char *) &timeout, sizeof(timeout)))
+        || (-1 == bind(new_socket, (struct sockaddr *) &address, sizeof(address))))
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot set up I/O shard socket: %s\n", strerror(errno));
+        close(new_socket);
+        return kEipInvalidSocket;
+    }
+#ifdef SO_TIMESTAMPNS
+    if (IoLatency::IsEnabled()
+        && (-1 == setsockopt(new_socket, SOL_SOCKET, SO_TIMESTAMPNS, (char *) &option_value, sizeof(option_value))))
+    {
+        OPENER_TRACE_WARN("networkhandler: no kernel receive timestamps on I/O shard socket %d\n", new_socket);
+    }
+#endif
+    NET_Connection::ApplyProfile(new_socket, NET_Connection::kSocketIoConsumer);
+    return new_socket;
+#else
+    return kEipInvalidSocket;
+#endif
+}
+
+bool NET_IoShards::AttachSteering(int socket)
+{
+#if defined(OPENER_WITH_IO_SHARDS) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    //A = (word at the connection id * multiplier) >> 16 % shards, the index of the socket to take the frame
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, kConnectionIdOffset),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, kHashMultiplier),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (CipUdint) number_of_shards),
+        BPF_STMT(BPF_RET | BPF_A, 0)
+    };
+    struct sock_fprog program = { (unsigned short) (sizeof(code) / sizeof(code[0])), code };
+
+    if (-1 == setsockopt(socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)))
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot steer the I/O shard sockets: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+#else
+    (void) socket;
+    return false;
+#endif
+}
+
+void NET_IoShards::Run(int shard)
+{
+#ifdef OPENER_WITH_IO_SHARDS
+    struct mmsghdr messages[OPENER_IO_SHARD_BATCH];
+    struct iovec vectors[OPENER_IO_SHARD_BATCH];
+    struct sockaddr_in from_addresses[OPENER_IO_SHARD_BATCH];
+    union
+    {
+        char data[CMSG_SPACE(sizeof(struct timespec))];
+        struct cmsghdr align;
+    } controls[OPENER_IO_SHARD_BATCH];
+
+    memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < OPENER_IO_SHARD_BATCH; i++)
+    {
+        vectors[i].iov_base = shard_buffers[shard][i];
+        vectors[i].iov_len = sizeof(shard_buffers[shard][i]);
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &from_addresses[i];
+    }
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        bool timestamps = IoLatency::IsEnabled();
+        for (int i = 0; i < OPENER_IO_SHARD_BATCH; i++)
+        {
+            messages[i].msg_hdr.msg_namelen = sizeof(from_addresses[i]);
+            messages[i].msg_hdr.msg_control = timestamps ? controls[i].data : nullptr;
+            messages[i].msg_hdr.msg_controllen = timestamps ? sizeof(controls[i].data) : 0;
+        }
+
+        //blocks for the first frame only, then takes what has queued up meanwhile
+        int received = recvmmsg(shards[shard].socket, messages, OPENER_IO_SHARD_BATCH, MSG_WAITFORONE, nullptr);
+        if (0 > received)
+        {
+            if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
+            {
+                OPENER_TRACE_ERR("networkhandler: error on I/O shard %d: %s\n", shard, strerror(errno));
+                NetStatistics::Count(NetStatistics::kInErrors);
+            }
+            continue;
+        }
+
+        shards[shard].received_frames.fetch_add((CipUdint) received, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> guard(shards[shard].lock);
+        for (int i = 0; i < received; i++)
+        {
+            CipUlint receive_time = 0;
+            for (struct cmsghdr *header = CMSG_FIRSTHDR(&messages[i].msg_hdr); timestamps && (nullptr != header);
+                 header = CMSG_NXTHDR(&messages[i].msg_hdr, header))
+            {
+                if ((SOL_SOCKET == header->cmsg_level) && (SCM_TIMESTAMPNS == header->cmsg_type))
+                {
+                    struct timespec timestamp;
+                    memcpy(&timestamp, CMSG_DATA(header), sizeof(timestamp));
+                    receive_time = (CipUlint) timestamp.tv_sec * 1000000000ULL + (CipUlint) timestamp.tv_nsec;
+                }
+            }
+            if (timestamps && (0 == receive_time))
+            {
+                receive_time = IoLatency::Now();
+            }
+            HandleFrame(shard, shard_buffers[shard][i], (int) messages[i].msg_len, &from_addresses[i], receive_time);
+        }
+    }
+#else
+    (void) shard;
+#endif
+}
+
+void NET_IoShards::HandleFrame(int shard, CipUsint* frame, int received_size, struct sockaddr_in* from_address,
+                               CipUlint receive_time)
+{
+    CIP_ConnectionManager *connection = nullptr;
+    if (kConnectionIdOffset + (int) sizeof(CipUdint) <= received_size)
+    {
+        CipUsint *message = frame + kConnectionIdOffset;
+        CipUdint connection_id = NET_Endianconv::GetDintFromMessage(message);
+
+        //a frame of another shard would race with its owner, the steering is off if this happens
+        if (GetShard(connection_id) != shard)
+        {
+            NET_NetworkHandler::CountReceivedPacket(received_size, true);
+            NetStatistics::Count(NetStatistics::kInDiscards);
+            return;
+        }
+        connection = CIP_ConnectionManager::FindConnectionById(connection_id);
+    }
+
+    // connection records are numbered from 1 on
+    NET_NetworkHandler::HandleConsumedFrame(frame, received_size, from_address, receive_time,
+                                            (nullptr != connection) ? (int) connection->id - 1 : -1);
+}
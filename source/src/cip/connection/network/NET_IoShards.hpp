@@ -0,0 +1,93 @@
+//
+// I/O shards: the consuming I/O connections served by worker threads
+//
+
+#ifndef OPENER_NET_IOSHARDS_H
+#define OPENER_NET_IOSHARDS_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+#include "ethIP/NET_EthIP_Includes.h"
+
+/**
+ * @brief NET_IoShards receives the O->T frames of the I/O connections on worker threads
+ *
+ * Each shard owns a UDP socket bound to the I/O port with SO_REUSEPORT, its
+ * receive buffers and the connections whose consumed connection id hashes to
+ * it, see GetShard. A classic BPF program attached to the socket group steers
+ * every frame to the socket of its shard by the connection id of its common
+ * packet format, so a connection is only ever served by one thread and its
+ * frames stay in order. Frames reaching the wrong shard anyway are discarded.
+ *
+ * The control thread keeps the encapsulation, explicit messaging, the
+ * connection watchdogs and the produced frames. Connections are only changed
+ * with CIP_ConnectionManager::Lock held, which takes the locks of all shards,
+ * a shard holds its own lock while it handles a batch of frames. The consumed assembly data, and the
+ * application callbacks for it, are updated on the shard threads.
+ *
+ * Shards are started after the network handler is initialized, before the
+ * first connection is opened and before the heap is sealed, see
+ * OpENer_Interface::OpENer_Initialize. Consuming sockets are not created per connection
+ * while they run.
+ */
+class NET_IoShards
+{
+    public:
+        /** @brief Start the given number of shards, at most OPENER_IO_SHARDS
+         *
+         * @return kCipStatusError if the sockets cannot be set up or the heap is
+         *  sealed already, the I/O stays on the control thread then
+         */
+        static CipStatus Start(int number_of_shards);
+
+        /** @brief Stop the shard threads and close their sockets */
+        static void Stop();
+
+        static bool IsActive();
+        static int GetNumberOfShards();
+
+        /** @brief Shard owning the connection with the given consumed connection id
+         *
+         * The same hash is computed by the steering program on the id as it is
+         * loaded from the frame, in network byte order.
+         */
+        static int GetShard(CipUdint connection_id);
+
+        /** @brief Frames a shard has taken from its socket since it was started */
+        static CipUdint GetReceivedFrames(int shard);
+
+        /** @brief Take the locks of all shards, nested calls only count
+         *
+         * Only called with the connection lock of the connection manager held,
+         * so one thread at a time gets here.
+         */
+        static void LockAll();
+        static void UnlockAll();
+
+    private:
+        typedef struct
+        {
+            std::mutex lock;
+            std::thread worker;
+            int socket;
+            std::atomic<CipUdint> received_frames;
+        } Shard_t;
+
+        static const CipUdint kHashMultiplier = 0x9E3779B1;
+
+        static Shard_t shards[OPENER_IO_SHARDS];
+        static int number_of_shards;
+        static int lock_depth;
+        static std::atomic<bool> running;
+
+        static int OpenSocket();
+        static bool AttachSteering(int socket);
+        static void Run(int shard);
+        static void HandleFrame(int shard, CipUsint* frame, int received_size, struct sockaddr_in* from_address,
+                                CipUlint receive_time);
+};
+
+#endif //OPENER_NET_IOSHARDS_H
@@ -0,0 +1,409 @@
+//
+// Link monitor: the TCP/IP Interface and the Ethernet Link follow the interface the stack runs on
+//
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include "../../../trace.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/CIP_Objects/CIP_00F6_EthernetLink/CIP_EthernetIP_Link.hpp"
+#include "NET_IoBackend.hpp"
+#include "NET_NetworkHandler.hpp"
+#include "NET_VirtualAdapters.hpp"
+#include "NET_LinkMonitor.hpp"
+
+#if defined(__linux__) && !defined(WIN)
+#define OPENER_WITH_NETLINK
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#endif
+
+//Static variables
+int NET_LinkMonitor::netlink_socket = kEipInvalidSocket;
+int NET_LinkMonitor::interface_index = 0;
+CipUdint NET_LinkMonitor::sequence_number = 0;
+int NET_LinkMonitor::dumping = 0;
+int NET_LinkMonitor::pending_dumps = 0;
+bool NET_LinkMonitor::link_active = true;
+CipUdint NET_LinkMonitor::link_speed = 0;
+bool NET_LinkMonitor::full_duplex = false;
+bool NET_LinkMonitor::auto_negotiation = false;
+
+CipStatus NET_LinkMonitor::Start(const char* interface_name)
+{
+#ifdef OPENER_WITH_NETLINK
+    if (IsActive())
+    {
+        return kCipStatusError;
+    }
+
+    interface_index = 0;
+    if (nullptr != interface_name)
+    {
+        interface_index = (int) if_nametoindex(interface_name);
+        if (0 == interface_index)
+        {
+            OPENER_TRACE_ERR("networkhandler: no interface %s to follow\n", interface_name);
+            return kCipStatusError;
+        }
+    }
+
+    netlink_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (kEipInvalidSocket == netlink_socket)
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot open a netlink socket: %s\n", strerror(errno));
+        return kCipStatusError;
+    }
+
+    //subscribed before the dumps, the changes made meanwhile wait in the socket
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+    if ((FD_SETSIZE <= netlink_socket) || (-1 == bind(netlink_socket, (struct sockaddr *) &address, sizeof(address))))
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot subscribe to the link changes: %s\n", strerror(errno));
+        Stop();
+        return kCipStatusError;
+    }
+
+    //the addresses first, they tell which interface the stack is on
+    link_active = true;
+    dumping = 0;
+    pending_dumps = kDumpAddresses | kDumpLinks;
+    if (!RequestDump())
+    {
+        Stop();
+        return kCipStatusError;
+    }
+
+    NET_IoBackend::Watch(netlink_socket, NET_IoBackend::kWatchReadable);
+    NET_NetworkHandler::highest_socket_handle = NET_NetworkHandler::GetMaxSocket(
+            NET_NetworkHandler::highest_socket_handle, netlink_socket, 0, 0);
+    OPENER_TRACE_STATE("networkhandler: following the link of interface %d\n", interface_index);
+    return kCipStatusOk;
+#else
+    OPENER_TRACE_ERR("networkhandler: the link monitor needs rtnetlink\n");
+    return kCipStatusError;
+#endif
+}
+
+void NET_LinkMonitor::Stop()
+{
+#ifdef OPENER_WITH_NETLINK
+    if (kEipInvalidSocket != netlink_socket)
+    {
+        NET_IoBackend::Unwatch(netlink_socket);
+        close(netlink_socket);
+    }
+#endif
+    netlink_socket = kEipInvalidSocket;
+    interface_index = 0;
+    dumping = 0;
+    pending_dumps = 0;
+}
+
+bool NET_LinkMonitor::IsActive()
+{
+    return kEipInvalidSocket != netlink_socket;
+}
+
+int NET_LinkMonitor::GetSocket()
+{
+    return netlink_socket;
+}
+
+int NET_LinkMonitor::GetInterfaceIndex()
+{
+    return interface_index;
+}
+
+bool NET_LinkMonitor::IsDumping()
+{
+    return (0 != dumping) || (0 != pending_dumps);
+}
+
+void NET_LinkMonitor::ReceiveEvents()
+{
+#ifdef OPENER_WITH_NETLINK
+    CipByte buffer[kReceiveBufferSize];
+    while (IsActive())
+    {
+        int received_size = (int) recv(netlink_socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (0 < received_size)
+        {
+            int ended_dump = dumping;
+            if (HandleMessages(buffer, received_size) && (kDumpAddresses == ended_dump) && (0 == interface_index))
+            {
+                OPENER_TRACE_ERR("networkhandler: cannot find the interface of the stack\n");
+                Stop();
+                return;
+            }
+        }
+        else if ((-1 == received_size) && (ENOBUFS == errno))
+        {
+            //the kernel dropped messages, maybe the end of a dump too, the state is read over
+            OPENER_TRACE_WARN("networkhandler: link changes lost, dumping the link state again\n");
+            dumping = 0;
+            pending_dumps = kDumpAddresses | kDumpLinks;
+        }
+        else
+        {
+            break;
+        }
+        if ((0 == dumping) && (0 != pending_dumps))
+        {
+            RequestDump();
+        }
+    }
+#endif
+}
+
+bool NET_LinkMonitor::HandleMessages(CipByte* buffer, int length)
+{
+    bool dump_ended = false;
+#ifdef OPENER_WITH_NETLINK
+    for (struct nlmsghdr *header = (struct nlmsghdr *) buffer; NLMSG_OK(header, (unsigned int) length);
+         header = NLMSG_NEXT(header, length))
+    {
+        switch (header->nlmsg_type)
+        {
+            case NLMSG_DONE:
+            case NLMSG_ERROR:
+                //the end of an abandoned dump does not end the one in progress
+                if ((0 != dumping) && (sequence_number == header->nlmsg_seq))
+                {
+                    dumping = 0;
+                    dump_ended = true;
+                }
+                break;
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                HandleLink(header);
+                break;
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                HandleAddress(header);
+                break;
+            default:
+                break;
+        }
+    }
+#endif
+    return dump_ended;
+}
+
+bool NET_LinkMonitor::RequestDump()
+{
+#ifdef OPENER_WITH_NETLINK
+    int dump = (0 != (pending_dumps & kDumpAddresses)) ? kDumpAddresses : kDumpLinks;
+    int request_type = (kDumpAddresses == dump) ? RTM_GETADDR : RTM_GETLINK;
+    CipByte request[NLMSG_SPACE(sizeof(struct ifinfomsg))];
+    memset(request, 0, sizeof(request));
+    struct nlmsghdr *header = (struct nlmsghdr *) request;
+    header->nlmsg_type = (__u16) request_type;
+    header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    header->nlmsg_seq = ++sequence_number;
+    if (RTM_GETADDR == request_type)
+    {
+        header->nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+        ((struct ifaddrmsg *) NLMSG_DATA(header))->ifa_family = AF_INET;
+    }
+    else
+    {
+        header->nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+        ((struct ifinfomsg *) NLMSG_DATA(header))->ifi_family = AF_UNSPEC;
+    }
+
+    if (-1 == send(netlink_socket, request, header->nlmsg_len, MSG_DONTWAIT))
+    {
+        //an abandoned dump still runs, asked for again once its end has been received
+        if ((EBUSY != errno) && (EAGAIN != errno))
+        {
+            OPENER_TRACE_ERR("networkhandler: cannot dump the link state: %s\n", strerror(errno));
+            return false;
+        }
+        return true;
+    }
+    pending_dumps &= ~dump;
+    dumping = dump;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void NET_LinkMonitor::HandleLink(struct nlmsghdr* header)
+{
+#ifdef OPENER_WITH_NETLINK
+    struct ifinfomsg *message = (struct ifinfomsg *) NLMSG_DATA(header);
+    if ((0 == interface_index) || (message->ifi_index != interface_index))
+    {
+        return;
+    }
+
+    bool active = false;
+    if (RTM_NEWLINK == header->nlmsg_type)
+    {
+        int attributes_length = (int) IFLA_PAYLOAD(header);
+        for (struct rtattr *attribute = IFLA_RTA(message); RTA_OK(attribute, attributes_length);
+             attribute = RTA_NEXT(attribute, attributes_length))
+        {
+            if ((IFLA_ADDRESS == attribute->rta_type) && (6 == RTA_PAYLOAD(attribute)))
+            {
+                CIP_EthernetIP_Link::ConfigureMacAddress((const CipUsint *) RTA_DATA(attribute));
+            }
+        }
+        active = (0 != (message->ifi_flags & IFF_UP)) && (0 != (message->ifi_flags & IFF_RUNNING));
+    }
+
+    bool changed = (active != link_active);
+    link_active = active;
+    if (active && (changed || (kDumpLinks == dumping)))
+    {
+        QueryLinkSettings();
+    }
+    if (changed)
+    {
+        OPENER_TRACE_STATE("networkhandler: link of interface %d %s\n", interface_index, active ? "up" : "down");
+    }
+    CIP_EthernetIP_Link::ConfigureLinkState(link_active, link_speed, full_duplex, auto_negotiation);
+#endif
+}
+
+void NET_LinkMonitor::HandleAddress(struct nlmsghdr* header)
+{
+#ifdef OPENER_WITH_NETLINK
+    struct ifaddrmsg *message = (struct ifaddrmsg *) NLMSG_DATA(header);
+    if (AF_INET != message->ifa_family)
+    {
+        return;
+    }
+
+    //IFA_LOCAL is the address of the interface, IFA_ADDRESS the one of the peer on point to point links
+    CipUdint address = INADDR_ANY;
+    CipUdint local_address = INADDR_ANY;
+    int attributes_length = (int) IFA_PAYLOAD(header);
+    for (struct rtattr *attribute = IFA_RTA(message); RTA_OK(attribute, attributes_length);
+         attribute = RTA_NEXT(attribute, attributes_length))
+    {
+        if ((sizeof(CipUdint) == RTA_PAYLOAD(attribute))
+            && ((IFA_ADDRESS == attribute->rta_type) || (IFA_LOCAL == attribute->rta_type)))
+        {
+            memcpy((IFA_LOCAL == attribute->rta_type) ? &local_address : &address, RTA_DATA(attribute), sizeof(CipUdint));
+        }
+    }
+    if (INADDR_ANY != local_address)
+    {
+        address = local_address;
+    }
+
+    CipUdint configured_address = CIP_TCPIP_Interface::interface_configuration_.ip_address;
+    if (0 == interface_index)
+    {
+        //the interface with the configured address, or the first one reaching beyond the host
+        if ((RTM_NEWADDR == header->nlmsg_type) && (INADDR_ANY != address)
+            && ((configured_address == address)
+                || ((INADDR_ANY == configured_address) && (RT_SCOPE_HOST != message->ifa_scope))))
+        {
+            interface_index = (int) message->ifa_index;
+        }
+        else
+        {
+            return;
+        }
+    }
+    if (((int) message->ifa_index != interface_index) || (INADDR_ANY == address))
+    {
+        return;
+    }
+
+    CipUdint network_mask = (0 == message->ifa_prefixlen) ? 0
+                            : NET_Connection::endian_htonl(0xFFFFFFFFU << (32 - message->ifa_prefixlen));
+    if (RTM_DELADDR == header->nlmsg_type)
+    {
+        if (address != configured_address)
+        {
+            return;
+        }
+        address = INADDR_ANY;
+        network_mask = 0;
+    }
+    else if ((INADDR_ANY != configured_address) && (address != configured_address))
+    {
+        //another address of the interface, an alias or one more subnet
+        return;
+    }
+    else if ((network_mask == CIP_TCPIP_Interface::interface_configuration_.network_mask)
+             && (address == configured_address))
+    {
+        return;
+    }
+
+    if (NET_VirtualAdapters::IsActive())
+    {
+        OPENER_TRACE_WARN("networkhandler: address change of interface %d left out, virtual adapters run\n",
+                          interface_index);
+        return;
+    }
+    CIP_TCPIP_Interface::ConfigureInterfaceAddress(address, network_mask);
+    OPENER_TRACE_STATE("networkhandler: interface %d has address %08x mask %08x\n", interface_index,
+                       (unsigned int) NET_Connection::endian_ntohl(address),
+                       (unsigned int) NET_Connection::endian_ntohl(network_mask));
+    if ((INADDR_ANY != configured_address) && (address != configured_address))
+    {
+        OPENER_TRACE_WARN("networkhandler: the sockets keep address %08x until the network handler is initialized again\n",
+                          (unsigned int) NET_Connection::endian_ntohl(configured_address));
+    }
+#endif
+}
+
+void NET_LinkMonitor::QueryLinkSettings()
+{
+#ifdef OPENER_WITH_NETLINK
+    struct ifreq request;
+    memset(&request, 0, sizeof(request));
+    if (nullptr == if_indextoname((unsigned int) interface_index, request.ifr_name))
+    {
+        return;
+    }
+
+    //the link mode masks follow the settings, the first request tells their size
+    __u32 query[sizeof(struct ethtool_link_settings) / sizeof(__u32) + 3 * SCHAR_MAX];
+    memset(query, 0, sizeof(query));
+    struct ethtool_link_settings *settings = (struct ethtool_link_settings *) query;
+    settings->cmd = ETHTOOL_GLINKSETTINGS;
+    request.ifr_data = (char *) query;
+
+    //virtual links such as the loopback have no settings, their speed is unknown
+    link_speed = 0;
+    full_duplex = false;
+    auto_negotiation = false;
+    int query_socket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (kEipInvalidSocket == query_socket)
+    {
+        return;
+    }
+    if ((0 == ioctl(query_socket, SIOCETHTOOL, &request)) && (0 > settings->link_mode_masks_nwords))
+    {
+        settings->link_mode_masks_nwords = (__s8) -settings->link_mode_masks_nwords;
+        settings->cmd = ETHTOOL_GLINKSETTINGS;
+        if (0 == ioctl(query_socket, SIOCETHTOOL, &request))
+        {
+            if ((CipUdint) SPEED_UNKNOWN != settings->speed)
+            {
+                link_speed = settings->speed;
+            }
+            full_duplex = (DUPLEX_FULL == settings->duplex);
+            auto_negotiation = (AUTONEG_ENABLE == settings->autoneg);
+        }
+    }
+    close(query_socket);
+#endif
+}
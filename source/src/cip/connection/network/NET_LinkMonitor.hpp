@@ -0,0 +1,104 @@
+//
+// Link monitor: the TCP/IP Interface and the Ethernet Link follow the interface the stack runs on
+//
+
+#ifndef OPENER_NET_LINKMONITOR_H
+#define OPENER_NET_LINKMONITOR_H
+
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+
+struct nlmsghdr;
+
+/**
+ * @brief NET_LinkMonitor keeps the TCP/IP Interface and Ethernet Link attributes up to date with rtnetlink
+ *
+ * Start subscribes a NETLINK_ROUTE socket to the link and IPv4 address groups
+ * and requests a dump of the present state of both. The socket is watched by
+ * the network handler like the others, the dumps are received the same way as
+ * each message the kernel sends on a change, nothing blocks. They are applied
+ * to the attributes of the interface followed:
+ *  - the address and the network mask to CIP_TCPIP_Interface::interface_configuration_,
+ *    the multicast addresses are calculated again from them,
+ *  - the physical address and the link status to the Ethernet Link. The speed
+ *    and duplex are queried once with ETHTOOL_GLINKSETTINGS when the link comes
+ *    up, nothing is polled. A link without settings, e.g. the loopback, is
+ *    reported with an unknown speed.
+ * The attributes are plain words written by the network handler thread, a
+ * read is a memory load as before.
+ *
+ * Only the attributes follow an address change: the listeners and the I/O
+ * sockets stay bound to the address the network handler has been initialized
+ * with, it has to be initialized again to serve the new one. The secondary
+ * addresses of the interface are left out unless one is the configured
+ * address, and so are address changes while virtual adapters run. The gateway
+ * and the name servers are not followed. Linux only, Start fails anywhere else.
+ */
+class NET_LinkMonitor
+{
+    public:
+        /** @brief Follow an interface, called after the network handler is initialized
+         *
+         * @param interface_name nullptr for the interface with the configured
+         *  address, or the first one with an address beyond the host if none
+         *  is configured yet, it is known once the address dump has been
+         *  received. The monitor stops if there is none.
+         * @return kCipStatusError if there is no interface of that name or netlink cannot be used
+         */
+        static CipStatus Start(const char* interface_name);
+
+        static void Stop();
+
+        static bool IsActive();
+
+        /** @brief The netlink socket, the network handler hands it to ReceiveEvents when it is readable */
+        static int GetSocket();
+
+        /** @brief Index of the interface followed, 0 while none is */
+        static int GetInterfaceIndex();
+
+        /** @brief true while a dump requested at the start or after lost messages has not been applied */
+        static bool IsDumping();
+
+        /** @brief Apply the messages waiting in the netlink socket, the state is dumped again if some were lost */
+        static void ReceiveEvents();
+
+        /** @brief Apply a buffer of rtnetlink messages
+         *
+         * @return true if it ended a dump
+         */
+        static bool HandleMessages(CipByte* buffer, int length);
+
+    private:
+        static const int kReceiveBufferSize = 16384;
+
+        typedef enum
+        {
+            kDumpAddresses = 1,
+            kDumpLinks = 2
+        } Dump_e;
+
+        static int netlink_socket;
+        static int interface_index;
+        static CipUdint sequence_number;
+        static int dumping; /**< the dump in progress, 0 if none, the link settings are queried with each link of a dump */
+        static int pending_dumps; /**< the dumps to request once the one in progress has ended, the addresses first */
+
+        //The state of the link, a speed of 0 if the settings cannot be queried
+        static bool link_active;
+        static CipUdint link_speed;
+        static bool full_duplex;
+        static bool auto_negotiation;
+
+        /** @brief Ask for the next pending dump, the replies are applied by ReceiveEvents
+         *
+         * @return false if it cannot be requested
+         */
+        static bool RequestDump();
+
+        static void HandleLink(struct nlmsghdr* header);
+        static void HandleAddress(struct nlmsghdr* header);
+        static void QueryLinkSettings();
+};
+
+#endif //OPENER_NET_LINKMONITOR_H
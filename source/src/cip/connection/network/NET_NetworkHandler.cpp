@@ -12,19 +12,34 @@
 
 //Includes
 #include <cmath>
+#include <cstring>
 #include "NET_Endianconv.hpp"
 #include "NET_NetworkHandler.hpp"
+#include "NET_IoBackend.hpp"
+#include "NET_IoShards.hpp"
+#include "NET_ExplicitWorkers.hpp"
+#include "NET_TcpSendQueues.hpp"
+#include "NET_VirtualAdapters.hpp"
+#include "NET_LinkMonitor.hpp"
 #include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/CIP_AppConnType.hpp"
+#include "utils/iolatency.hpp"
+#include "utils/netstatistics.hpp"
 
 //Static variables
-CipUsint        NET_NetworkHandler::g_ethernet_communication_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+CIP_RequestContext NET_NetworkHandler::explicit_context;
+CipUsint       *NET_NetworkHandler::g_io_communication_buffer = nullptr;
+CipUdint        NET_NetworkHandler::g_io_communication_buffer_size = 0;
 int             NET_NetworkHandler::highest_socket_handle;
-int             NET_NetworkHandler::g_current_active_tcp_socket;
 struct timeval  NET_NetworkHandler::g_time_value;
 MilliSeconds    NET_NetworkHandler::g_actual_time;
 MilliSeconds    NET_NetworkHandler::g_last_time;
 MilliSeconds    NET_NetworkHandler::g_elapsed_time;
+MilliSeconds    NET_NetworkHandler::g_statistics_snapshot_timer;
 NET_Connection *NET_NetworkHandler::netStats[3];
+NET_Connection  NET_NetworkHandler::listeners[3];
+struct sockaddr_in NET_NetworkHandler::listener_address;
+struct sockaddr_in NET_NetworkHandler::global_broadcast_address;
 
 //Methods
 CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
@@ -35,10 +50,23 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
     WSAStartup(wVersionRequested, &wsaData);
 #endif
 
-    NET_Connection::InitSelects();
+    if (kCipStatusOk != NET_IoBackend::Init().status) {
+        OPENER_TRACE_ERR("error initializing the network backend\n");
+        return kCipStatusError;
+    }
+
+    explicit_context.Init(NET_BufferPool::Allocate(NET_BufferPool::kBufferClassExplicit),
+                          NET_BufferPool::GetBufferSize(NET_BufferPool::kBufferClassExplicit));
+    g_io_communication_buffer = NET_BufferPool::Allocate(NET_BufferPool::kBufferClassIo);
+    g_io_communication_buffer_size = NET_BufferPool::GetBufferSize(NET_BufferPool::kBufferClassIo);
+    if ((nullptr == explicit_context.buffer) || (nullptr == g_io_communication_buffer)) {
+        OPENER_TRACE_ERR("error allocating the communication buffers\n");
+        return kCipStatusError;
+    }
+    NET_TcpSendQueues::Init();
 
     // create a new TCP socket
-    netStats[tcp_listener] = new NET_Connection();
+    netStats[tcp_listener] = &listeners[tcp_listener];
     if (netStats[tcp_listener]->InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP) == -1) {
         OPENER_TRACE_ERR("error allocating socket stream listener, %d\n", errno);
         return kCipStatusError;
@@ -51,16 +79,18 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
         OPENER_TRACE_ERR("error setting socket option SO_REUSEADDR on tcp_listener\n");
         return kCipStatusError;
     }
+    // before listen(), the sessions inherit the options of the listener
+    netStats[tcp_listener]->ApplyProfile(NET_Connection::kSocketTcpListener);
 
     // create a new UDP socket for broadcast
-    netStats[udp_global_bcast_listener] = new NET_Connection();
+    netStats[udp_global_bcast_listener] = &listeners[udp_global_bcast_listener];
     if (netStats[udp_global_bcast_listener]->InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP) == -1) {
         OPENER_TRACE_ERR("error allocating UDP global broadcast listener socket, %d\n", errno);
         return kCipStatusError;
     }
 
     // create a new UDP socket for unicast
-    netStats[udp_ucast_listener] = new NET_Connection();
+    netStats[udp_ucast_listener] = &listeners[udp_ucast_listener];
     if (netStats[udp_ucast_listener]->InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP) == -1) {
         OPENER_TRACE_ERR("error allocating UDP unicast listener socket, %d\n", errno);
         return kCipStatusError;
@@ -78,8 +108,8 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
         return kCipStatusError;
     }
 
-    struct sockaddr_in *my_address;
-    my_address = new struct sockaddr_in();
+    struct sockaddr_in *my_address = &listener_address;
+    memset(my_address, 0, sizeof(struct sockaddr_in));
     my_address->sin_family = AF_INET;
     my_address->sin_port = NET_Connection::endian_htons(kOpENerEthernetPort);
     my_address->sin_addr.s_addr = CIP_TCPIP_Interface::interface_configuration_.ip_address;
@@ -96,11 +126,10 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
         return kCipStatusError;
     }
 
-    struct sockaddr_in *global_broadcast_address;
-    global_broadcast_address = new struct sockaddr_in();
-    global_broadcast_address->sin_family = AF_INET;
-    global_broadcast_address->sin_port = NET_Connection::endian_htons(kOpENerEthernetPort);
-    global_broadcast_address->sin_addr.s_addr = NET_Connection::endian_htonl(INADDR_ANY);
+    memset(&global_broadcast_address, 0, sizeof(struct sockaddr_in));
+    global_broadcast_address.sin_family = AF_INET;
+    global_broadcast_address.sin_port = NET_Connection::endian_htons(kOpENerEthernetPort);
+    global_broadcast_address.sin_addr.s_addr = NET_Connection::endian_htonl(INADDR_ANY);
 
     // enable the UDP socket to receive broadcast messages
     if (netStats[udp_global_bcast_listener]->SetSocketOpt(SOL_SOCKET, SO_BROADCAST, set_socket_option) < 0) {
@@ -109,7 +138,7 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
     }
 
     if (netStats[udp_global_bcast_listener]->BindSocket(NET_Connection::kOriginatorAddress,
-                                                        (struct sockaddr *) global_broadcast_address) == -1) {
+                                                        (struct sockaddr *) &global_broadcast_address) == -1) {
         OPENER_TRACE_ERR("error with global broadcast UDP bind: %s\n", strerror(errno));
         return kCipStatusError;
     }
@@ -124,9 +153,9 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
     }
 
     // add the listener socket to the master set
-    NET_Connection::SelectSet(netStats[tcp_listener]->GetSocketHandle(), NET_Connection::kMasterSet);
-    NET_Connection::SelectSet(netStats[udp_ucast_listener]->GetSocketHandle(), NET_Connection::kMasterSet);
-    NET_Connection::SelectSet(netStats[udp_global_bcast_listener]->GetSocketHandle(), NET_Connection::kMasterSet);
+    NET_IoBackend::Watch(netStats[tcp_listener]->GetSocketHandle(), NET_IoBackend::kWatchListener);
+    NET_IoBackend::Watch(netStats[udp_ucast_listener]->GetSocketHandle(), NET_IoBackend::kWatchReadable);
+    NET_IoBackend::Watch(netStats[udp_global_bcast_listener]->GetSocketHandle(), NET_IoBackend::kWatchReadable);
 
     // keep track of the biggest file descriptor
     highest_socket_handle = GetMaxSocket(
@@ -135,40 +164,59 @@ CipStatus NET_NetworkHandler::NetworkHandlerInitialize() {
             netStats[udp_global_bcast_listener]->GetSocketHandle(),
             0);
 
+    // the media counters are read from the interface the stack is bound to
+    NetStatistics::SetInterfaceAddress(CIP_TCPIP_Interface::interface_configuration_.ip_address);
+
     g_last_time = GetMilliSeconds(); // initialize time keeping
     g_elapsed_time = 0;
+    g_statistics_snapshot_timer = 0;
 
     return kCipGeneralStatusCodeSuccess;
 }
 
 
 int NET_NetworkHandler::CheckSocketSet(int socket) {
-    if (NET_Connection::SelectIsSet(socket, NET_Connection::kReadSet) != -1) {
-        if (NET_Connection::SelectIsSet(socket, NET_Connection::kMasterSet) != -1) {
-            return 1;
+    int return_value = 0;
+    if (NET_Connection::SelectIsSet(socket, NET_Connection::kReadSet)) {
+        if (NET_Connection::SelectIsSet(socket, NET_Connection::kMasterSet)) {
+            return_value = 1;
         } else {
             OPENER_TRACE_INFO("socket: %d closed with pending message\n", socket);
         }
         NET_Connection::SelectRemove(socket, NET_Connection::kReadSet);
         // remove it from the read set so that later checks will not find it
     }
-    return 0;
+    return return_value;
 }
 
 void NET_NetworkHandler::CheckAndHandleTcpListenerSocket(void) {
     //TODO: create new connection
     int new_socket;
-    // see if this is a connection request to the TCP listener
-    if (CheckSocketSet(netStats[tcp_listener]->GetSocketHandle())) {
+    for (int adapter = 0; adapter < NET_VirtualAdapters::GetNumberOfAdapters(); adapter++) {
+        NET_Connection *listener = NET_VirtualAdapters::GetTcpListener(adapter);
+
+        // see if this is a connection request to the TCP listener
+        if (!CheckSocketSet(listener->GetSocketHandle())) {
+            continue;
+        }
         OPENER_TRACE_INFO("networkhandler: new TCP connection\n");
 
-        new_socket = accept(netStats[tcp_listener]->GetSocketHandle(), nullptr, nullptr);
+        new_socket = NET_IoBackend::Accept(listener->GetSocketHandle());
         if (new_socket == -1) {
             OPENER_TRACE_ERR("networkhandler: error on accept: %s\n", strerror(errno));
-            return;
+            continue;
         }
+        if (!NET_TcpSendQueues::Open(new_socket)) {
+            OPENER_TRACE_WARN("networkhandler: no send queue left, refusing the TCP connection on fd %d\n", new_socket);
+            NET_Connection refused;
+            refused.SetSocketHandle(new_socket);
+            refused.CloseSocket();
+            continue;
+        }
+        NET_Connection::ApplyProfile(new_socket, NET_Connection::kSocketTcpSession);
+        NET_VirtualAdapters::SetSocketAdapter(new_socket, adapter);
 
-        NET_Connection::SelectSet(new_socket, NET_Connection::kMasterSet);
+        NET_IoBackend::Watch(new_socket, NET_IoBackend::kWatchReadable);
         // add newfd to master set
         if (new_socket > highest_socket_handle) {
             highest_socket_handle = new_socket;
@@ -179,14 +227,12 @@ void NET_NetworkHandler::CheckAndHandleTcpListenerSocket(void) {
 }
 
 CipStatus NET_NetworkHandler::NetworkHandlerProcessOnce(void) {
-    NET_Connection::SelectCopy();
-
     g_time_value.tv_sec = 0;
     g_time_value.tv_usec =
             (g_elapsed_time < kOpENerTimerTickInMilliSeconds ? kOpENerTimerTickInMilliSeconds - g_elapsed_time : 0) *
             1000; // 10 ms
 
-    int ready_socket = NET_Connection::SelectSelect(highest_socket_handle + 1, NET_Connection::kReadSet, &g_time_value);
+    int ready_socket = NET_IoBackend::Wait(highest_socket_handle + 1, &g_time_value);
 
     if (ready_socket == kEipInvalidSocket) {
         if (EINTR ==
@@ -194,7 +240,8 @@ CipStatus NET_NetworkHandler::NetworkHandlerProcessOnce(void) {
         {
             return kCipGeneralStatusCodeSuccess;
         } else {
-            OPENER_TRACE_ERR("networkhandler: error with select: %s\n", strerror(errno));
+            OPENER_TRACE_ERR("networkhandler: error with %s: %s\n",
+                             NET_IoBackend::GetName(NET_IoBackend::GetBackend()), strerror(errno));
             return kCipStatusError;
         }
     }
@@ -205,17 +252,21 @@ CipStatus NET_NetworkHandler::NetworkHandlerProcessOnce(void) {
         CheckAndHandleUdpUnicastSocket();
         CheckAndHandleUdpGlobalBroadcastSocket();
         CheckAndHandleConsumingUdpSockets();
+        CheckAndHandleExplicitWorkers();
+        CheckAndHandleLinkMonitor();
+        CheckAndHandleTcpSendQueues();
 
         for (int socket = 0; socket <= highest_socket_handle; socket++) 
 		{
-            if ( CheckSocketSet(socket) )
+            // a connection whose send queue is full is not read from until it drains
+            if ( CheckSocketSet(socket) && NET_TcpSendQueues::CanReceive(socket) )
 			{
                 // if it is still checked it is a TCP receive
-                if (kCipStatusError == HandleDataOnTcpSocket(socket).status) // if error
+                NET_VirtualAdapters::Enter(NET_VirtualAdapters::GetSocketAdapter(socket));
+                if ((CipUsint) kCipStatusError == HandleDataOnTcpSocket(socket, &explicit_context).status) // status is unsigned
                 {
-                    //todo: move to CIP_ConnectionManager
-                    // CloseSocket;
-                    // CloseSession; // clean up session and close the socket
+                    // the peer is gone, clean up its session and close the socket
+                    CloseTcpSocket(socket);
                 }
             }
         }
@@ -229,12 +280,37 @@ CipStatus NET_NetworkHandler::NetworkHandlerProcessOnce(void) {
     // This should compensate the jitter of the windows timer
     if (g_elapsed_time >= kOpENerTimerTickInMilliSeconds) {
         /* call manage_connections() in connection manager every OPENER_TIMER_TICK ms */
-        //CIP_ConnectionManager::ManageConnections(g_elapsed_time);
+        // the watchdogs read what the I/O shards write on receive, the
+        // explicit message workers may open and close connections
+        CIP_ConnectionManager::Lock();
+        CIP_ConnectionManager::ManageConnections(g_elapsed_time);
+        CIP_AppConnType::ManageMulticastProducers(g_elapsed_time);
+        CIP_ConnectionManager::Unlock();
+        NET_EthIP_Encap::ManageEncapsulationMessages(g_elapsed_time);
+
+        g_statistics_snapshot_timer += g_elapsed_time;
+        if (g_statistics_snapshot_timer >= OPENER_STATISTICS_SNAPSHOT_INTERVAL) {
+            NetStatistics::PublishSnapshot();
+            g_statistics_snapshot_timer = 0;
+        }
         g_elapsed_time = 0;
     }
+    NET_VirtualAdapters::Enter(0);
     return kCipGeneralStatusCodeSuccess;
 }
 
+void NET_NetworkHandler::CloseTcpSocket(int socket) {
+    OPENER_TRACE_STATE("networkhandler: closing TCP connection on fd %d\n", socket);
+    NET_ExplicitWorkers::CancelSocket(socket);
+    NET_TcpSendQueues::Close(socket);
+    NET_EthIP_Encap::CloseSession(socket);
+    NET_VirtualAdapters::SetSocketAdapter(socket, 0);
+
+    NET_Connection peer;
+    peer.SetSocketHandle(socket);
+    peer.CloseSocket();
+}
+
 //todo:move to CIP_ConnectionManager
 /*void NET_NetworkHandler::IApp_CloseSocket_udp(int socket_handle)
 {
@@ -246,119 +322,136 @@ void NET_NetworkHandler::IApp_CloseSocket_tcp(int socket_handle)
     CloseSocket(socket_handle);
 }*/
 CipStatus NET_NetworkHandler::NetworkHandlerFinish(void) {
+    NET_ExplicitWorkers::Stop();
+    NET_IoShards::Stop();
+    NET_VirtualAdapters::Stop();
+    NET_LinkMonitor::Stop();
     netStats[tcp_listener]->CloseSocket();
     netStats[udp_ucast_listener]->CloseSocket();
     netStats[udp_global_bcast_listener]->CloseSocket();
+    NET_IoBackend::Finish();
+
+    NET_BufferPool::Release(NET_BufferPool::kBufferClassExplicit, explicit_context.buffer);
+    NET_BufferPool::Release(NET_BufferPool::kBufferClassIo, g_io_communication_buffer);
+    explicit_context.buffer = nullptr;
+    g_io_communication_buffer = nullptr;
     return kCipGeneralStatusCodeSuccess;
 }
 
 void NET_NetworkHandler::CheckAndHandleUdpGlobalBroadcastSocket(void) {
 
     struct sockaddr_in from_address;
-    socklen_t from_address_length;
 
     // see if this is an unsolicited inbound UDP message
     if (CheckSocketSet(netStats[udp_global_bcast_listener]->GetSocketHandle())) {
 
-        from_address_length = sizeof(from_address);
-
         OPENER_TRACE_STATE("networkhandler: unsolicited UDP message on EIP global broadcast socket\n");
 
         // Handle UDP broadcast messages
-        int received_size = netStats[udp_global_bcast_listener]->RecvDataFrom(&g_ethernet_communication_buffer,
-                                                                              PC_OPENER_ETHERNET_BUFFER_SIZE,
+        int received_size = netStats[udp_global_bcast_listener]->RecvDataFrom(explicit_context.buffer,
+                                                                              explicit_context.buffer_size,
                                                                               (struct sockaddr *) &from_address);
 
         if (received_size <= 0) {
             // got error
             OPENER_TRACE_ERR("networkhandler: error on recvfrom UDP global broadcast port: %s\n", strerror(errno));
+            NetStatistics::Count(NetStatistics::kInErrors);
             return;
         }
+        CountReceivedPacket(received_size, false);
 
         OPENER_TRACE_INFO("Data received on global broadcast UDP:\n");
 
-        CipUsint *receive_buffer = &g_ethernet_communication_buffer[0];
-        int remaining_bytes = 0;
-        do {
-            int reply_length = NET_EthIP_Encap::HandleReceivedExplictUdpData(
-                    netStats[udp_global_bcast_listener]->GetSocketHandle(), (struct sockaddr *) &from_address,
-                    receive_buffer, (unsigned int) received_size, &remaining_bytes, false);
-
-            receive_buffer += received_size - remaining_bytes;
-            received_size = remaining_bytes;
-
-            if (reply_length > 0) {
-                OPENER_TRACE_INFO("reply sent:\n");
-
-                // if the active socket matches a registered UDP callback, handle a UDP packet
-                if (netStats[udp_global_bcast_listener]->SendDataTo(&g_ethernet_communication_buffer,
-                                                                    (CipUdint) reply_length,
-                                                                    (struct sockaddr *) &from_address) !=
-                    reply_length) {
-                    OPENER_TRACE_INFO("networkhandler: UDP response was not fully sent\n");
-                }
+        // the replies overwrite the request, the virtual adapters are handed a copy of it
+        CipUsint *request = nullptr;
+        if (NET_VirtualAdapters::IsActive()) {
+            request = NET_BufferPool::Allocate(NET_BufferPool::kBufferClassExplicit);
+            if (nullptr != request) {
+                memcpy(request, explicit_context.buffer, (size_t) received_size);
             }
-        } while (remaining_bytes > 0);
+        }
+
+        NET_VirtualAdapters::Enter(0);
+        HandleExplicitUdpData(netStats[udp_global_bcast_listener], &from_address, received_size, false);
+
+        // each virtual adapter answers from its unicast socket, so the originator sees its address
+        for (int adapter = 1; (nullptr != request) && (adapter < NET_VirtualAdapters::GetNumberOfAdapters()); adapter++) {
+            NET_VirtualAdapters::Enter(adapter);
+            memcpy(explicit_context.buffer, request, (size_t) received_size);
+            HandleExplicitUdpData(NET_VirtualAdapters::GetUdpUnicastListener(adapter), &from_address, received_size, false);
+        }
+        NET_BufferPool::Release(NET_BufferPool::kBufferClassExplicit, request);
     }
 }
 
 void NET_NetworkHandler::CheckAndHandleUdpUnicastSocket(void) {
 
     struct sockaddr_in from_address;
-    socklen_t from_address_length;
 
-    /* see if this is an unsolicited inbound UDP message */
-    if (CheckSocketSet(netStats[udp_ucast_listener]->GetSocketHandle())) {
+    for (int adapter = 0; adapter < NET_VirtualAdapters::GetNumberOfAdapters(); adapter++) {
+        NET_Connection *unicast_listener = NET_VirtualAdapters::GetUdpUnicastListener(adapter);
 
-        from_address_length = sizeof(from_address);
+        /* see if this is an unsolicited inbound UDP message */
+        if (!CheckSocketSet(unicast_listener->GetSocketHandle())) {
+            continue;
+        }
 
         OPENER_TRACE_STATE("networkhandler: unsolicited UDP message on EIP unicast socket\n");
 
-        // Handle UDP broadcast messages
-        int recv_size = netStats[udp_ucast_listener]->RecvDataFrom(&g_ethernet_communication_buffer,
-                                                                   PC_OPENER_ETHERNET_BUFFER_SIZE,
-                                                                   (struct sockaddr *) &from_address);
-
+        int recv_size = unicast_listener->RecvDataFrom(explicit_context.buffer,
+                                                       explicit_context.buffer_size,
+                                                       (struct sockaddr *) &from_address);
 
         if (recv_size <= 0) {
             // got error
             OPENER_TRACE_ERR("networkhandler: error on recvfrom UDP unicast port: %s\n", strerror(errno));
-            return;
+            NetStatistics::Count(NetStatistics::kInErrors);
+            continue;
         }
+        CountReceivedPacket(recv_size, true);
 
         OPENER_TRACE_INFO("Data received on UDP unicast:\n");
 
-        CipUsint *receive_buffer = &g_ethernet_communication_buffer[0];
-        int remaining_bytes = 0;
-        do {
-            int reply_length = NET_EthIP_Encap::HandleReceivedExplictUdpData(
-                                                    netStats[udp_ucast_listener]->GetSocketHandle(),
-                                                    (struct sockaddr *) &from_address,
-                                                    receive_buffer,
-                                                    (unsigned int) recv_size,
-                                                    &remaining_bytes,
-                                                    true
-            );
-
-            receive_buffer += recv_size - remaining_bytes;
-            recv_size = remaining_bytes;
-
-            if (reply_length > 0) {
-                OPENER_TRACE_INFO("reply sent:\n");
-
-                // if the active socket matches a registered UDP callback, handle a UDP packet
-                if (netStats[udp_ucast_listener]->SendDataTo(&g_ethernet_communication_buffer, (CipUdint) reply_length,
-                                                             (struct sockaddr *) &from_address) != reply_length) {
-                    OPENER_TRACE_INFO("networkhandler: UDP unicast response was not fully sent\n");
-                }
-            }
-        } while (remaining_bytes > 0);
+        NET_VirtualAdapters::Enter(adapter);
+        HandleExplicitUdpData(unicast_listener, &from_address, recv_size, true);
     }
 }
 
+void NET_NetworkHandler::HandleExplicitUdpData(NET_Connection *reply_socket, struct sockaddr_in *from_address,
+                                               int received_size, bool unicast) {
+    CipUsint *receive_buffer = &explicit_context.buffer[0];
+    int remaining_bytes = 0;
+    do {
+        int reply_length = NET_EthIP_Encap::HandleReceivedExplictUdpData(
+                                                reply_socket->GetSocketHandle(),
+                                                (struct sockaddr *) from_address,
+                                                receive_buffer,
+                                                (unsigned int) received_size,
+                                                &remaining_bytes,
+                                                unicast
+        );
+
+        receive_buffer += received_size - remaining_bytes;
+        received_size = remaining_bytes;
+
+        if (reply_length > 0) {
+            OPENER_TRACE_INFO("reply sent:\n");
+
+            // if the active socket matches a registered UDP callback, handle a UDP packet
+            int sent_length = reply_socket->SendDataTo(explicit_context.buffer,
+                                                       (CipUdint) reply_length,
+                                                       (struct sockaddr *) from_address);
+            if (!CountSentPacket(sent_length, reply_length, true)) {
+                OPENER_TRACE_INFO("networkhandler: UDP response was not fully sent\n");
+            }
+        }
+    } while (remaining_bytes > 0);
+}
+
 CipStatus NET_NetworkHandler::SendUdpData(struct sockaddr *address, int socket, CipUsint *data, CipUint data_length) {
 
     int sent_length = sendto(socket, (char *) data, data_length, 0, address, sizeof(struct sockaddr));
+    CountSentPacket(sent_length, data_length, true);
 
     if (sent_length < 0) {
         OPENER_TRACE_ERR("networkhandler: error with sendto in sendUDPData: %s\n", strerror(errno));
@@ -375,9 +468,10 @@ CipStatus NET_NetworkHandler::SendUdpData(struct sockaddr *address, int socket,
     return kCipGeneralStatusCodeSuccess;
 }
 
-CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
+CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket, CIP_RequestContext *context) {
     int remaining_bytes = 0;
-    long data_sent = PC_OPENER_ETHERNET_BUFFER_SIZE;
+    CipUsint *buffer = context->buffer;
+    long data_sent = context->buffer_size;
 
     /* We will handle just one EIP packet here the rest is done by the select
    * method which will inform us if more data is available in the socket
@@ -387,7 +481,7 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
 
     /*Check how many data is here -- read the first four bytes from the connection */
     /*TODO we may have to set the socket to a non blocking socket */
-    long number_of_read_bytes = recv(socket, (char *) g_ethernet_communication_buffer, 4, 0);
+    long number_of_read_bytes = recv(socket, (char *) buffer, 4, 0);
 
     if (number_of_read_bytes == 0) {
         OPENER_TRACE_ERR("networkhandler: connection closed by client: %s\n", strerror(errno));
@@ -395,22 +489,25 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
     }
     if (number_of_read_bytes < 0) {
         OPENER_TRACE_ERR("networkhandler: error on recv: %s\n", strerror(errno));
+        NetStatistics::Count(NetStatistics::kInErrors);
         return kCipStatusError;
     }
 
     // at this place EIP stores the data length
-    CipUsint *read_buffer = &g_ethernet_communication_buffer[2];
+    CipUsint *read_buffer = &buffer[2];
     // -4 is for the 4 bytes we have already read
     size_t data_size = (size_t) (NET_Endianconv::GetIntFromMessage(read_buffer) + ENCAPSULATION_HEADER_LENGTH - 4);
     // (NOTE this advances the buffer pointer)
 
     // TODO can this be handled in a better way?
-    if ((PC_OPENER_ETHERNET_BUFFER_SIZE - 4) < data_size) {
+    if ((context->buffer_size - 4) < data_size) {
         OPENER_TRACE_ERR("too large packet received will be ignored, will drop the data\n");
+        NetStatistics::Count(NetStatistics::kInDiscards);
+        NetStatistics::CountError(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket));
 
         // Currently we will drop the whole packet
         do {
-            number_of_read_bytes = recv(socket, (char *) &g_ethernet_communication_buffer[0], data_sent, 0);
+            number_of_read_bytes = recv(socket, (char *) &buffer[0], data_sent, 0);
 
             if (number_of_read_bytes == 0) /* got error or connection closed by client */
             {
@@ -419,17 +516,18 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
             }
             if (number_of_read_bytes < 0) {
                 OPENER_TRACE_ERR("networkhandler: error on recv: %s\n", strerror(errno));
+                NetStatistics::Count(NetStatistics::kInErrors);
                 return kCipStatusError;
             }
             data_size -= number_of_read_bytes;
-            if ((data_size < PC_OPENER_ETHERNET_BUFFER_SIZE) && (data_size != 0)) {
+            if ((data_size < context->buffer_size) && (data_size != 0)) {
                 data_sent = (long) data_size;
             }
         } while (0 != data_size); /* TODO: fragile end statement */
         return kCipGeneralStatusCodeSuccess;
     }
 
-    number_of_read_bytes = recv(socket, (char *) &g_ethernet_communication_buffer[4], (int) data_size, 0);
+    number_of_read_bytes = recv(socket, (char *) &buffer[4], (int) data_size, 0);
 
     if (number_of_read_bytes == 0) /* got error or connection closed by client */
     {
@@ -438,6 +536,7 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
     }
     if (number_of_read_bytes < 0) {
         OPENER_TRACE_ERR("networkhandler: error on recv: %s\n", strerror(errno));
+        NetStatistics::Count(NetStatistics::kInErrors);
         return kCipStatusError;
     }
 
@@ -446,28 +545,29 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
         data_size += 4;
         /*TODO handle partial packets*/
         OPENER_TRACE_INFO("Data received on tcp:\n");
-
-        g_current_active_tcp_socket = socket;
-
-        number_of_read_bytes = NET_EthIP_Encap::HandleReceivedExplictTcpData(socket, g_ethernet_communication_buffer,
-                                                                             (unsigned int) data_size,
+        CountReceivedPacket((long) data_size, true);
+        // the reply may take a while, the request is acknowledged right away
+        NET_Connection::QuickAck(socket);
+        CipUlint receive_time = IoLatency::Now();
+
+        // the peer is only looked up if a service needs it
+        context->Begin(socket, nullptr);
+        number_of_read_bytes = NET_EthIP_Encap::HandleReceivedExplictTcpData(context, (unsigned int) data_size,
                                                                              &remaining_bytes);
 
-        g_current_active_tcp_socket = -1;
-
         if (remaining_bytes != 0) {
             OPENER_TRACE_WARN("Warning: received packet was to long: %d Bytes left!\n", remaining_bytes);
         }
 
-        if (number_of_read_bytes > 0) {
-            OPENER_TRACE_INFO("reply sent:\n");
+        bool reply_sent = (number_of_read_bytes <= 0) || SendTcpReply(socket, buffer, (int) number_of_read_bytes);
+        // looked up after handling, the message may have registered the session
+        NetStatistics::CountReceived(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket),
+                                     (CipUdint) data_size, IoLatency::Now() - receive_time);
 
-            data_sent = send(socket, (char *) &g_ethernet_communication_buffer[0], number_of_read_bytes, 0);
-            if (data_sent != number_of_read_bytes) {
-                OPENER_TRACE_WARN("TCP response was not fully sent\n");
-            }
+        // the connection is closed rather than its stream cut short
+        if (!reply_sent) {
+            return kCipStatusError;
         }
-
         return kCipGeneralStatusCodeSuccess;
     } else {
         // we got a fragmented packet currently we cannot handle this will
@@ -476,10 +576,38 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
         // However with typical packet sizes of EIP this should't be a big issue.
         //
         //TODO handle fragmented packets */
+        NetStatistics::Count(NetStatistics::kInDiscards);
+        NetStatistics::CountError(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket));
     }
     return kCipStatusError;
 }
 
+bool NET_NetworkHandler::SendTcpReply(int socket, CipUsint *reply, int reply_length) {
+    return NET_TcpSendQueues::Send(socket, reply, (CipUdint) reply_length);
+}
+
+void NET_NetworkHandler::CheckAndHandleTcpSendQueues(void) {
+    int broken_sockets[OPENER_TCP_SEND_QUEUES];
+    int number_of_broken_sockets = NET_TcpSendQueues::FlushWritable(broken_sockets);
+    for (int i = 0; i < number_of_broken_sockets; i++) {
+        CloseTcpSocket(broken_sockets[i]);
+    }
+}
+
+void NET_NetworkHandler::CheckAndHandleExplicitWorkers(void) {
+    // the wake up socket has to be taken out of the read set before the TCP sockets are handled
+    if (NET_ExplicitWorkers::IsActive() && CheckSocketSet(NET_ExplicitWorkers::GetWakeSocket())) {
+        NET_ExplicitWorkers::SendReplies();
+    }
+}
+
+void NET_NetworkHandler::CheckAndHandleLinkMonitor(void) {
+    // the netlink socket is taken out of the read set before the TCP sockets are handled as well
+    if (NET_LinkMonitor::IsActive() && CheckSocketSet(NET_LinkMonitor::GetSocket())) {
+        NET_LinkMonitor::ReceiveEvents();
+    }
+}
+
 /** @brief create a new UDP socket for the connection manager
  *
  * @param communciation_direction Consuming or producing port
@@ -488,13 +616,9 @@ CipStatus NET_NetworkHandler::HandleDataOnTcpSocket(int socket) {
  * @return the socket handle if successful, else -1 */
 int
 NET_NetworkHandler::CreateUdpSocket(UdpCommuncationDirection communication_direction, struct sockaddr *socket_data) {
-    struct sockaddr_in peer_address;
     struct sockaddr_in *socket_data_in = (struct sockaddr_in *) socket_data;
     int new_socket;
 
-    socklen_t peer_address_length;
-
-    peer_address_length = sizeof(struct sockaddr_in);
     // create a new UDP socket
     if ((new_socket = (int) socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1) {
         OPENER_TRACE_ERR("networkhandler: cannot create UDP socket: %s\n", strerror(errno));
@@ -518,16 +642,34 @@ NET_NetworkHandler::CreateUdpSocket(UdpCommuncationDirection communication_direc
         }
 
         OPENER_TRACE_INFO("networkhandler: bind UDP socket %d\n", new_socket);
+        NET_Connection::ApplyProfile(new_socket, NET_Connection::kSocketIoConsumer);
+
+#ifdef SO_TIMESTAMPNS
+        if (IoLatency::IsEnabled()
+            && (setsockopt(new_socket, SOL_SOCKET, SO_TIMESTAMPNS, (char *) &option_value, sizeof(option_value)) == -1)) {
+            OPENER_TRACE_WARN("networkhandler: no kernel receive timestamps on UDP socket %d\n", new_socket);
+        }
+#endif
     } else {
         // we have a producing udp socket
+        NET_Connection::ApplyProfile(new_socket, NET_Connection::kSocketIoProducer);
         if (socket_data_in->sin_addr.s_addr ==
             CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address) {
+            // multicast leaves through the configured interface, not the default route
+            struct in_addr interface_address;
+            interface_address.s_addr = CIP_TCPIP_Interface::interface_configuration_.ip_address;
+            if ((INADDR_ANY != interface_address.s_addr)
+                && (setsockopt(new_socket, IPPROTO_IP, IP_MULTICAST_IF, (char *) &interface_address,
+                               sizeof(interface_address)) < 0)) {
+                OPENER_TRACE_ERR("networkhandler: could not set the multicast interface, error: %s\n", strerror(errno));
+                return kEipInvalidSocket;
+            }
             if (1 != CIP_TCPIP_Interface::g_time_to_live_value) {
                 // we need to set a TTL value for the socket
                 if (setsockopt(new_socket, IPPROTO_IP, IP_MULTICAST_TTL,
                                (char *) &CIP_TCPIP_Interface::g_time_to_live_value,
                                sizeof(CIP_TCPIP_Interface::g_time_to_live_value)) < 0) {
-                    OPENER_TRACE_ERR("networkhandler: could not set the TTL to: %d, error: %s\n", g_time_to_live_value,
+                    OPENER_TRACE_ERR("networkhandler: could not set the TTL to: %d, error: %s\n", CIP_TCPIP_Interface::g_time_to_live_value,
                                      strerror(errno));
                     return kEipInvalidSocket;
                 }
@@ -535,18 +677,9 @@ NET_NetworkHandler::CreateUdpSocket(UdpCommuncationDirection communication_direc
         }
     }
 
-    if ((communication_direction == kUdpCommuncationDirectionConsuming) || (0 == socket_data_in->sin_addr.s_addr)) {
-        /* we have a peer to peer producer or a consuming connection*/
-        if (getpeername(g_current_active_tcp_socket, (struct sockaddr *) &peer_address, &peer_address_length) < 0) {
-            OPENER_TRACE_ERR("networkhandler: could not get peername: %s\n", strerror(errno));
-            return kEipInvalidSocket;
-        }
-        /* store the originators address */
-        socket_data_in->sin_addr.s_addr = peer_address.sin_addr.s_addr;
-    }
-
-    // add new socket to the master list
-    NET_Connection::SelectSet(new_socket, NET_Connection::kMasterSet);
+    // add new socket to the master list, the backend receives the frames of consuming ones by itself
+    NET_IoBackend::Watch(new_socket, (communication_direction == kUdpCommuncationDirectionConsuming)
+                                     ? NET_IoBackend::kWatchDatagrams : NET_IoBackend::kWatchReadable);
     if (new_socket > highest_socket_handle) {
         highest_socket_handle = new_socket;
     }
@@ -555,48 +688,149 @@ NET_NetworkHandler::CreateUdpSocket(UdpCommuncationDirection communication_direc
 
 void NET_NetworkHandler::CheckAndHandleConsumingUdpSockets(void) {
     struct sockaddr_in from_address;
-    socklen_t from_address_length;
 
     CIP_ConnectionManager *connection_manager_instance;
     CIP_Connection *current_connection_instance = nullptr;
 
+    // the I/O shards receive the frames on sockets of their own
+    if (NET_IoShards::IsActive()) {
+        return;
+    }
+
+    // the explicit message workers may open and close connections meanwhile
+    CIP_ConnectionManager::Lock();
     // see a message on one of the registered UDP sockets has been received
-    for (unsigned int i = 0; i < CIP_ConnectionManager::active_connections_set->size(); i++) {
+    for (unsigned int i = 0; i < CIP_ConnectionManager::number_of_active_connections; i++) {
 
         // do this at the beginning as the close function may can make the entry invalid
-        connection_manager_instance = (CIP_ConnectionManager *) CIP_ConnectionManager::active_connections_set->at(i);
-        current_connection_instance = (CIP_Connection *) CIP_Connection::GetInstance(
-                connection_manager_instance->connection_serial_number);
+        connection_manager_instance = CIP_ConnectionManager::active_connections[i];
+        current_connection_instance = connection_manager_instance->consuming_instance;
+
+        // explicit connections are served by the encapsulation layer
+        if ((nullptr == current_connection_instance)
+            || (CIP_Connection::kConnectionTypeIo != current_connection_instance->Instance_type)) {
+            continue;
+        }
 
         if ((-1 != current_connection_instance->netConn->GetSocketHandle(/*todo:kUdpCommuncationDirectionConsuming*/) &&
              (CheckSocketSet(
                      current_connection_instance->netConn->GetSocketHandle(/*todo:kUdpCommuncationDirectionConsuming*/))))) {
-            from_address_length = sizeof(from_address);
-            int received_size
-                    = recvfrom(
-                            current_connection_instance->netConn->GetSocketHandle(/*kUdpCommuncationDirectionConsuming*/),
-                            (char *) g_ethernet_communication_buffer,
-                            PC_OPENER_ETHERNET_BUFFER_SIZE,
-                            0,
-                            (struct sockaddr *) &from_address,
-                            &from_address_length);
+            CipUlint receive_time;
+            int received_size = ReceiveIoFrame(
+                    current_connection_instance->netConn->GetSocketHandle(/*kUdpCommuncationDirectionConsuming*/),
+                    &from_address, &receive_time);
             if (0 == received_size) {
                 OPENER_TRACE_STATE("connection closed by client\n");
                 //CIP_ConnectionManager::CloseConnection (connection_manager_instance);
                 continue;
             }
 
+            // connection records are numbered from 1 on
+            int connection = (int) connection_manager_instance->id - 1;
             if (0 > received_size) {
                 OPENER_TRACE_ERR("networkhandler: error on recv: %s\n", strerror(errno));
+                NetStatistics::Count(NetStatistics::kInErrors);
+                NetStatistics::CountError(NetStatistics::kEndpointConnection, connection);
                 //CIP_ConnectionManager::CloseConnection (connection_manager_instance);
                 continue;
             }
+            // the data goes to the assemblies of the adapter the connection is opened on
+            NET_VirtualAdapters::Enter((int) connection_manager_instance->adapter);
+            HandleConsumedFrame(g_io_communication_buffer, received_size, &from_address, receive_time, connection);
+        }
+    }
+    CIP_ConnectionManager::Unlock();
+}
+
+void NET_NetworkHandler::HandleConsumedFrame(CipUsint *frame, int received_size, struct sockaddr_in *from_address,
+                                             CipUlint receive_time, int connection) {
+    CountReceivedPacket(received_size, true);
+
+    IoLatency::MarkReceived(receive_time);
+    CipStatus status = CIP_ConnectionManager::HandleReceivedConnectedData(frame, received_size, from_address);
+    IoLatency::MarkReceived(0);
+
+    if ((CipUsint) kCipStatusError == status.status) { // status is unsigned
+        NetStatistics::Count(NetStatistics::kInDiscards);
+        NetStatistics::CountError(NetStatistics::kEndpointConnection, connection);
+    }
+    // the receive time is only known while the latency probes are enabled
+    NetStatistics::CountReceived(NetStatistics::kEndpointConnection, connection, (CipUdint) received_size,
+                                 (0 != receive_time) ? IoLatency::Now() - receive_time : 0);
+}
 
-            //CIP_ConnectionManager::HandleReceivedConnectedData(connection_manager_instance, g_ethernet_communication_buffer, received_size, &from_address);
+int NET_NetworkHandler::ReceiveIoFrame(int socket, struct sockaddr_in *from_address, CipUlint *receive_time) {
+    *receive_time = 0;
+    if (NET_IoBackend::IsReceiving()) {
+        // already received, along with the kernel timestamp if there is one
+        int received_size = NET_IoBackend::ReceiveQueued(socket, g_io_communication_buffer,
+                                                         g_io_communication_buffer_size, from_address, receive_time);
+        if (!IoLatency::IsEnabled()) {
+            *receive_time = 0;
+        } else if ((0 < received_size) && (0 == *receive_time)) {
+            *receive_time = IoLatency::Now();
         }
+        return received_size;
     }
+    if (!IoLatency::IsEnabled()) {
+        socklen_t from_address_length = sizeof(*from_address);
+        return recvfrom(socket, (char *) g_io_communication_buffer, g_io_communication_buffer_size, 0,
+                        (struct sockaddr *) from_address, &from_address_length);
+    }
+
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+    struct iovec buffer;
+    buffer.iov_base = g_io_communication_buffer;
+    buffer.iov_len = g_io_communication_buffer_size;
+
+    union {
+        char data[CMSG_SPACE(sizeof(struct timespec))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = from_address;
+    message.msg_namelen = sizeof(*from_address);
+    message.msg_iov = &buffer;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data;
+    message.msg_controllen = sizeof(control.data);
+
+    int received_size = (int) recvmsg(socket, &message, 0);
+    for (struct cmsghdr *header = CMSG_FIRSTHDR(&message); (0 < received_size) && (nullptr != header);
+         header = CMSG_NXTHDR(&message, header)) {
+        if ((SOL_SOCKET == header->cmsg_level) && (SCM_TIMESTAMPNS == header->cmsg_type)) {
+            struct timespec timestamp;
+            memcpy(&timestamp, CMSG_DATA(header), sizeof(timestamp));
+            *receive_time = (CipUlint) timestamp.tv_sec * 1000000000ULL + (CipUlint) timestamp.tv_nsec;
+        }
+    }
+#else
+    socklen_t from_address_length = sizeof(*from_address);
+    int received_size = recvfrom(socket, (char *) g_io_communication_buffer, g_io_communication_buffer_size, 0,
+                                 (struct sockaddr *) from_address, &from_address_length);
+#endif
+    if ((0 < received_size) && (0 == *receive_time)) {
+        *receive_time = IoLatency::Now();
+    }
+    return received_size;
 }
 
+bool NET_NetworkHandler::CountSentPacket(long sent_length, long length, bool unicast) {
+    if (sent_length != length) {
+        NetStatistics::Count(NetStatistics::kOutErrors);
+        return false;
+    }
+    NetStatistics::Count(NetStatistics::kOutOctets, (CipUlint) length);
+    NetStatistics::Count(unicast ? NetStatistics::kOutUcastPackets : NetStatistics::kOutNucastPackets);
+    return true;
+}
+
+void NET_NetworkHandler::CountReceivedPacket(long length, bool unicast) {
+    NetStatistics::Count(NetStatistics::kInOctets, (CipUlint) length);
+    NetStatistics::Count(unicast ? NetStatistics::kInUcastPackets : NetStatistics::kInNucastPackets);
+}
 
 int NET_NetworkHandler::GetMaxSocket(int socket1, int socket2, int socket3, int socket4) {
     if ((socket1 > socket2) & (socket1 > socket3) & (socket1 > socket4))
@@ -622,9 +856,10 @@ MicroSeconds NET_NetworkHandler::GetMicroSeconds() {
     return (MicroSeconds) (performance_counter.QuadPart * 1000000.0 / performance_frequency.QuadPart);
 
 #elif __linux__
+    // a monotonic clock is not disturbed by adjustments of the system time
     struct timespec spec;
-    clock_gettime(CLOCK_REALTIME, &spec);
-    return (MicroSeconds)round(spec.tv_nsec / 1.0e3);
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (MicroSeconds) spec.tv_sec * 1000000ULL + (MicroSeconds) (spec.tv_nsec / 1000);
 #endif
 }
 
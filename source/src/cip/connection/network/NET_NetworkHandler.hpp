@@ -19,6 +19,8 @@
 #include "../../ciptypes.hpp"
 #include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
 #include "NET_Connection.hpp"
+#include "NET_BufferPool.hpp"
+#include "../CIP_RequestContext.hpp"
 
 #include "ethIP/NET_EthIP_Includes.h"
 
@@ -28,20 +30,17 @@ class NET_NetworkHandler
 {
 
 public:
-        static CipUsint g_ethernet_communication_buffer[PC_OPENER_ETHERNET_BUFFER_SIZE]; /**< communication buffer */
+        static CIP_RequestContext explicit_context; /**< explicit messages of this thread, its buffer is taken from the buffer pool */
+        static CipUsint *g_io_communication_buffer; /**< receive buffer of the consuming I/O connections */
+        static CipUdint g_io_communication_buffer_size;
 
         static int highest_socket_handle; /**< temporary file descriptor for select() */
 
-    /** @brief This variable holds the TCP socket the received to last explicit message.
-     * It is needed for opening point to point connection to determine the peer's
-     * address.
-     */
-        static int g_current_active_tcp_socket;
-
         static struct timeval g_time_value;
         static MilliSeconds g_actual_time;
         static MilliSeconds g_last_time;
         static MilliSeconds g_elapsed_time;
+        static MilliSeconds g_statistics_snapshot_timer; /**< time since the last statistics snapshot */
 
     /** @brief Struct representing the current network status
      *typedef struct
@@ -55,32 +54,86 @@ public:
     enum {tcp_listener, udp_ucast_listener, udp_global_bcast_listener} kNetworkStatus;
     static NET_Connection *netStats[3];
 
+    //The listeners and the addresses they are bound to live as long as the stack
+    static NET_Connection listeners[3];
+    static struct sockaddr_in listener_address;
+    static struct sockaddr_in global_broadcast_address;
+
 
     /** @brief check if on one of the UDP consuming sockets data has been received and if yes handle it correctly
     */
     static void CheckAndHandleConsumingUdpSockets();
 
+    /** @brief Receive an I/O frame into the I/O buffer along with its receive time
+     *
+     *  With the I/O latency probes enabled the receive time is the kernel
+     *  timestamp of the frame (SO_TIMESTAMPNS) where available, else the time
+     *  it was read. It is 0 with the probes disabled. With the io_uring
+     *  backend the frame has already been received into its buffer ring.
+     */
+    static int ReceiveIoFrame(int socket, struct sockaddr_in* from_address, CipUlint* receive_time);
+
+    /** @brief Hand a received I/O frame to the connection manager and count it
+     *
+     *  Used by the control thread and by the I/O shards alike.
+     *
+     *  @param connection index of the connection record, for the statistics
+     */
+    static void HandleConsumedFrame(CipUsint* frame, int received_size, struct sockaddr_in* from_address,
+                                    CipUlint receive_time, int connection);
+
+    /** @brief Counts a sent packet on the interface counters
+     *
+     *  @return true if all of it has been sent, else it is counted as an error
+     */
+    static bool CountSentPacket(long sent_length, long length, bool unicast);
+
+    /** @brief Counts a received packet on the interface counters */
+    static void CountReceivedPacket(long length, bool unicast);
+
     /** @ingroup CIP_CALLBACK_API
     * @brief create a producing or consuming UDP socket
     *
     * @param communication_direction PRODCUER or CONSUMER
     * @param socket_data pointer to the address holding structure
-    *     Attention: For producing point-to-point connection the
-    *     *pa_pstAddr->sin_addr.s_addr member is set to 0 by OpENer. The network
-    *     layer of the application has to set the correct address of the
-    *     originator.
-    *     Attention: For consuming connection the network layer has to set the
-    * pa_pstAddr->sin_addr.s_addr to the correct address of the originator.
-    * FIXME add an additional parameter that can be used by the CIP stack to
-    * request the originators sockaddr_in data.
+    *     A consuming socket is bound to it, a producing one sends to it. The
+    *     connection manager fills in the originator from the context of the
+    *     Forward_Open request.
     * @return socket identifier on success
     *         -1 on error
     */
     static int CreateUdpSocket(UdpCommuncationDirection communication_direction, struct sockaddr* socket_data);
 
-    /** @brief TODO: FILL IN!
+    /** @brief Receive and handle one encapsulated message of a TCP connection, the reply is sent right away
+    *  unless the request is queued for the explicit message workers
+    *
+    * @param context the request context of the calling thread, the message is received into its buffer
     */
-    static CipStatus HandleDataOnTcpSocket(int socket);
+    static CipStatus HandleDataOnTcpSocket(int socket, CIP_RequestContext* context);
+
+    /** @brief Send the reply to an explicit message on its TCP connection, see NET_TcpSendQueues
+    *
+    * What the socket does not take right away waits in the send queue of the connection.
+    *
+    * @return false if the connection is broken or its queue is full, it has to be closed
+    */
+    static bool SendTcpReply(int socket, CipUsint* reply, int reply_length);
+
+    /** @brief Hand the queued replies to the TCP connections found writable, close the broken ones
+    */
+    static void CheckAndHandleTcpSendQueues();
+
+    /** @brief Send the replies the explicit message workers have completed, if they woke us up
+    */
+    static void CheckAndHandleExplicitWorkers();
+
+    /** @brief Apply the link and address changes the kernel reported, if the link monitor runs
+    */
+    static void CheckAndHandleLinkMonitor();
+
+    /** @brief Close a TCP connection whose peer is gone, along with its session
+    */
+    static void CloseTcpSocket(int socket);
 
     /** @ingroup CIP_CALLBACK_API
      * @brief create a producing or consuming UDP socket
@@ -93,15 +146,25 @@ public:
      */
     static CipStatus SendUdpData(struct sockaddr* address, int socket, CipUsint* data, CipUint data_length);
 
-    /** @brief Checks and processes request received via the UDP unicast socket, currently the implementation is port-specific
+    /** @brief Checks and processes request received via the UDP unicast sockets of the adapters
     */
     static void CheckAndHandleUdpUnicastSocket();
 
-    /** @brief TODO: FILL IN!
+    /** @brief Checks and processes request received via the UDP broadcast socket, all adapters answer it
     */
     static void CheckAndHandleUdpGlobalBroadcastSocket();
 
-    /** @brief handle any connection request coming in the TCP server socket.
+    /** @brief Handle the encapsulation messages of a datagram in the explicit buffer
+     *
+     * @param reply_socket the replies are sent from it, a delayed ListIdentity reply as well
+     * @param from_address originator of the datagram
+     * @param received_size length of the datagram
+     * @param unicast false for a broadcast, the ListIdentity reply is delayed then
+     */
+    static void HandleExplicitUdpData(NET_Connection* reply_socket, struct sockaddr_in* from_address, int received_size,
+                                      bool unicast);
+
+    /** @brief handle any connection request coming in the TCP server sockets of the adapters.
     */
     static void CheckAndHandleTcpListenerSocket();
 
@@ -109,6 +172,9 @@ public:
     //   static NetworkStatus g_network_status; /**< Global variable holding the current network status */
 
     /** @brief The platform independent part of network handler initialization routine
+     *
+     *  The communication buffers are taken from NET_BufferPool here, so the pool
+     *  has to be configured before.
      *
      *  @return Returns the OpENer status after the initialization routine
      */
@@ -142,15 +208,15 @@ public:
      */
         static int GetMaxSocket (int socket1, int socket2, int socket3, int socket4);
 
-    /** @brief This function shall return the current time in microseconds relative to epoch, and shall be implemented in a port specific networkhandler
+    /** @brief This function shall return the current time in microseconds from a monotonic clock, and shall be implemented in a port specific networkhandler
      *
-     *  @return Current time relative to epoch as MicroSeconds
+     *  @return Current time relative to an arbitrary fixed point as MicroSeconds
      */
         static MicroSeconds GetMicroSeconds();
 
-    /** @brief This function shall return the current time in milliseconds relative to epoch, and shall be implemented in a port specific networkhandler
+    /** @brief This function shall return the current time in milliseconds from a monotonic clock, and shall be implemented in a port specific networkhandler
      *
-     *  @return Current time relative to epoch as MilliSeconds
+     *  @return Current time relative to an arbitrary fixed point as MilliSeconds
      */
         static MilliSeconds GetMilliSeconds();
 
@@ -0,0 +1,269 @@
+//
+// Send queues of the TCP connections carrying explicit messages
+//
+
+#include <cerrno>
+#include <cstring>
+#include "../../../trace.hpp"
+#include "ethIP/NET_EthIP_Includes.h"
+#include "ethIP/NET_EthIP_Encap.hpp"
+#include "NET_IoBackend.hpp"
+#include "NET_NetworkHandler.hpp"
+#include "NET_TcpSendQueues.hpp"
+#include "utils/netstatistics.hpp"
+
+//a peer gone away must not raise SIGPIPE, a full socket must not block the control thread unless there is
+//no queue to take the rest of the reply, the queues are compiled in with -DOpENer_TCP_SEND_QUEUES=ON
+#if defined(OPENER_WITH_TCP_SEND_QUEUES) && defined(MSG_NOSIGNAL) && defined(MSG_DONTWAIT)
+#define OPENER_TCP_SEND_FLAGS (MSG_NOSIGNAL | MSG_DONTWAIT)
+#elif defined(MSG_NOSIGNAL)
+#define OPENER_TCP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define OPENER_TCP_SEND_FLAGS 0
+#endif
+
+//Static variables
+NET_TcpSendQueues::Queue_t NET_TcpSendQueues::queues[OPENER_TCP_SEND_QUEUES];
+
+#ifdef OPENER_WITH_TCP_SEND_QUEUES
+static CipUsint queue_buffers[OPENER_TCP_SEND_QUEUES][OPENER_TCP_SEND_QUEUE_FRAMES][OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+#endif
+
+static bool WouldBlock()
+{
+    return (EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno);
+}
+
+void NET_TcpSendQueues::Init()
+{
+    memset(queues, 0, sizeof(queues));
+}
+
+bool NET_TcpSendQueues::Open(int socket)
+{
+    for (int i = 0; i < OPENER_TCP_SEND_QUEUES; i++)
+    {
+        if (!queues[i].open)
+        {
+            memset(&queues[i], 0, sizeof(queues[i]));
+            queues[i].open = true;
+            queues[i].socket = socket;
+            return true;
+        }
+    }
+    return false;
+}
+
+void NET_TcpSendQueues::Close(int socket)
+{
+    Queue_t *queue = Find(socket);
+    if (nullptr == queue)
+    {
+        return;
+    }
+    if (0 < queue->number_of_replies)
+    {
+        OPENER_TRACE_WARN("networkhandler: %d replies on fd %d dropped with the connection\n",
+                          queue->number_of_replies, socket);
+    }
+    queue->number_of_replies = 0;
+    queue->reserved = 0;
+    UpdateInterest(queue);
+    queue->open = false;
+}
+
+bool NET_TcpSendQueues::Send(int socket, const CipUsint *reply, CipUdint reply_length)
+{
+    Queue_t *queue = Find(socket);
+    CipUdint sent_length = 0;
+
+    if ((nullptr == queue) || (0 == queue->number_of_replies))
+    {
+        long result = send(socket, (const char *) reply, reply_length, OPENER_TCP_SEND_FLAGS);
+        if ((long) reply_length == result)
+        {
+            CountSent(socket, reply_length);
+            return true;
+        }
+        if ((0 > result) && !WouldBlock())
+        {
+            OPENER_TRACE_ERR("networkhandler: error on send: %s\n", strerror(errno));
+            NET_NetworkHandler::CountSentPacket(result, reply_length, true);
+            NetStatistics::CountError(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket));
+            return false;
+        }
+        sent_length = (0 < result) ? (CipUdint) result : 0;
+    }
+
+#ifdef OPENER_WITH_TCP_SEND_QUEUES
+    if ((nullptr == queue) || (OPENER_TCP_SEND_QUEUE_FRAMES == queue->number_of_replies)
+        || (sizeof(queue_buffers[0][0]) < reply_length))
+    {
+        //the rest of the stream would be corrupt without this reply
+        OPENER_TRACE_ERR("networkhandler: no room for the reply on fd %d, closing it\n", socket);
+        NET_NetworkHandler::CountSentPacket(sent_length, reply_length, true);
+        NetStatistics::CountError(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket));
+        return false;
+    }
+
+    int tail = (queue->head + queue->number_of_replies) % OPENER_TCP_SEND_QUEUE_FRAMES;
+    memcpy(queue_buffers[queue - queues][tail], reply, reply_length);
+    queue->reply_length[tail] = reply_length;
+    if (0 == queue->number_of_replies)
+    {
+        queue->head_offset = sent_length;
+    }
+    queue->number_of_replies++;
+    UpdateInterest(queue);
+    return true;
+#else
+    //a blocking send only comes back short if the connection is broken
+    OPENER_TRACE_ERR("networkhandler: reply on fd %d not fully sent, closing it\n", socket);
+    NET_NetworkHandler::CountSentPacket(sent_length, reply_length, true);
+    NetStatistics::CountError(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket));
+    return false;
+#endif
+}
+
+bool NET_TcpSendQueues::Flush(int socket)
+{
+    Queue_t *queue = Find(socket);
+    if ((nullptr == queue) || (0 == queue->number_of_replies))
+    {
+        return true;
+    }
+#ifdef OPENER_WITH_TCP_SEND_QUEUES
+    CipUsint (*buffers)[OPENER_EXPLICIT_FRAME_BUFFER_SIZE] = queue_buffers[queue - queues];
+
+#ifdef WIN
+    long result = send(socket, (const char *) &buffers[queue->head][queue->head_offset],
+                       queue->reply_length[queue->head] - queue->head_offset, OPENER_TCP_SEND_FLAGS);
+#else
+    //all waiting replies go out with one system call
+    struct iovec vectors[OPENER_TCP_SEND_QUEUE_FRAMES];
+    for (int i = 0; i < queue->number_of_replies; i++)
+    {
+        int reply = (queue->head + i) % OPENER_TCP_SEND_QUEUE_FRAMES;
+        CipUdint offset = (0 == i) ? queue->head_offset : 0;
+        vectors[i].iov_base = &buffers[reply][offset];
+        vectors[i].iov_len = queue->reply_length[reply] - offset;
+    }
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = vectors;
+    message.msg_iovlen = (size_t) queue->number_of_replies;
+    long result = sendmsg(socket, &message, OPENER_TCP_SEND_FLAGS);
+#endif
+
+    if (0 > result)
+    {
+        if (WouldBlock())
+        {
+            UpdateInterest(queue);
+            return true;
+        }
+        OPENER_TRACE_ERR("networkhandler: error on send: %s\n", strerror(errno));
+        NetStatistics::Count(NetStatistics::kOutErrors);
+        NetStatistics::CountError(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket));
+        return false;
+    }
+
+    CipUdint sent_length = (CipUdint) result;
+    while ((0 < queue->number_of_replies)
+           && (queue->reply_length[queue->head] - queue->head_offset <= sent_length))
+    {
+        sent_length -= queue->reply_length[queue->head] - queue->head_offset;
+        CountSent(socket, queue->reply_length[queue->head]);
+        queue->head = (queue->head + 1) % OPENER_TCP_SEND_QUEUE_FRAMES;
+        queue->head_offset = 0;
+        queue->number_of_replies--;
+    }
+    queue->head_offset += sent_length;
+    UpdateInterest(queue);
+#endif
+    return true;
+}
+
+bool NET_TcpSendQueues::CanReceive(int socket)
+{
+    Queue_t *queue = Find(socket);
+    return (nullptr == queue) || (OPENER_TCP_SEND_QUEUE_FRAMES > queue->number_of_replies + queue->reserved);
+}
+
+void NET_TcpSendQueues::Reserve(int socket)
+{
+    Queue_t *queue = Find(socket);
+    if (nullptr != queue)
+    {
+        queue->reserved++;
+        UpdateInterest(queue);
+    }
+}
+
+void NET_TcpSendQueues::Release(int socket)
+{
+    Queue_t *queue = Find(socket);
+    if ((nullptr != queue) && (0 < queue->reserved))
+    {
+        queue->reserved--;
+        UpdateInterest(queue);
+    }
+}
+
+int NET_TcpSendQueues::GetNumberOfQueuedReplies(int socket)
+{
+    Queue_t *queue = Find(socket);
+    return (nullptr == queue) ? 0 : queue->number_of_replies;
+}
+
+int NET_TcpSendQueues::FlushWritable(int *broken_sockets)
+{
+    int number_of_broken_sockets = 0;
+    for (int i = 0; i < OPENER_TCP_SEND_QUEUES; i++)
+    {
+        int socket = queues[i].socket;
+        if (!queues[i].open || !queues[i].writing
+            || !NET_Connection::SelectIsSet(socket, NET_Connection::kWriteSet))
+        {
+            continue;
+        }
+        NET_Connection::SelectRemove(socket, NET_Connection::kWriteSet);
+        if (!Flush(socket))
+        {
+            broken_sockets[number_of_broken_sockets++] = socket;
+        }
+    }
+    return number_of_broken_sockets;
+}
+
+NET_TcpSendQueues::Queue_t* NET_TcpSendQueues::Find(int socket)
+{
+    for (int i = 0; i < OPENER_TCP_SEND_QUEUES; i++)
+    {
+        if (queues[i].open && (socket == queues[i].socket))
+        {
+            return &queues[i];
+        }
+    }
+    return nullptr;
+}
+
+void NET_TcpSendQueues::CountSent(int socket, CipUdint reply_length)
+{
+    OPENER_TRACE_INFO("reply sent:\n");
+    NET_NetworkHandler::CountSentPacket(reply_length, reply_length, true);
+    NetStatistics::CountSent(NetStatistics::kEndpointSession, NET_EthIP_Encap::GetSessionIndex(socket), reply_length);
+}
+
+void NET_TcpSendQueues::UpdateInterest(Queue_t *queue)
+{
+    bool paused = OPENER_TCP_SEND_QUEUE_FRAMES <= queue->number_of_replies + queue->reserved;
+    bool writing = 0 < queue->number_of_replies;
+    //the io_uring write poll is one shot, it is asked for again after every flush
+    if ((paused != queue->paused) || (writing != queue->writing) || writing)
+    {
+        NET_IoBackend::SetInterest(queue->socket, !paused, writing);
+    }
+    queue->paused = paused;
+    queue->writing = writing;
+}
@@ -0,0 +1,104 @@
+//
+// Send queues of the TCP connections carrying explicit messages
+//
+
+#ifndef OPENER_NET_TCPSENDQUEUES_H
+#define OPENER_NET_TCPSENDQUEUES_H
+
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+
+/**
+ * @brief NET_TcpSendQueues keeps the replies a TCP connection could not take right away
+ *
+ * A reply is sent right away if nothing is waiting before it. What the socket
+ * does not take is copied into the queue of the connection, the socket is then
+ * watched for writing and all waiting replies are handed to the kernel with
+ * one gathered send once it can be written again, see Flush. The bytes of a
+ * connection always go out in the order the replies have been queued.
+ *
+ * Backpressure: every connection has room for OPENER_TCP_SEND_QUEUE_FRAMES
+ * replies, requests handed to the explicit message workers hold their room
+ * until the reply is queued, see Reserve. Once no room is left the connection
+ * is not read from any more, the requests of a slow peer wait in its socket
+ * and TCP slows it down, while the other connections go on. A reply is never
+ * dropped, if it does not fit after all the connection is closed.
+ *
+ * The queue buffers are only built with -DOpENer_TCP_SEND_QUEUES=ON, without
+ * them a reply is sent blocking and nothing is ever queued.
+ *
+ * Only the control thread uses the queues.
+ */
+class NET_TcpSendQueues
+{
+    public:
+        /** @brief Forget all queues, called when the network handler is initialized */
+        static void Init();
+
+        /** @brief Give a newly accepted connection a queue
+         *
+         * @return false if all queues are taken, the connection has to be refused
+         */
+        static bool Open(int socket);
+
+        /** @brief Drop the queue of a connection about to be closed, along with what waits in it */
+        static void Close(int socket);
+
+        /** @brief Send a reply or queue what the socket does not take right away
+         *
+         * @return false if the connection is broken or its queue is full, it has to be closed
+         */
+        static bool Send(int socket, const CipUsint* reply, CipUdint reply_length);
+
+        /** @brief Hand the waiting replies to a socket found writable
+         *
+         * @return false if the connection is broken, it has to be closed
+         */
+        static bool Flush(int socket);
+
+        /** @brief true if a request of the connection can be read, its reply has room in the queue */
+        static bool CanReceive(int socket);
+
+        /** @brief Keep room for the reply of a request handed to the explicit message workers */
+        static void Reserve(int socket);
+
+        /** @brief Give back the room kept by Reserve, before the reply is sent */
+        static void Release(int socket);
+
+        /** @brief Number of replies waiting in the queue of a connection */
+        static int GetNumberOfQueuedReplies(int socket);
+
+        /** @brief Flush the queues whose sockets are marked in the write set, called by the control thread
+         *
+         * @param broken_sockets filled with the sockets that have to be closed
+         * @return number of sockets in broken_sockets
+         */
+        static int FlushWritable(int* broken_sockets);
+
+    private:
+        typedef struct
+        {
+            bool open;              /**< the queue belongs to a connection */
+            int socket;
+            int head;               /**< oldest waiting reply */
+            int number_of_replies;
+            int reserved;           /**< replies of requests in the hands of the workers */
+            CipUdint head_offset;   /**< bytes of the oldest reply already sent */
+            bool paused;            /**< the socket is not read from */
+            bool writing;           /**< the socket is watched for writing */
+            CipUdint reply_length[OPENER_TCP_SEND_QUEUE_FRAMES];
+        } Queue_t;
+
+        static Queue_t queues[OPENER_TCP_SEND_QUEUES];
+
+        /** @brief The queue of a connection, nullptr if it has none */
+        static Queue_t* Find(int socket);
+
+        /** @brief Count a reply handed to the kernel completely */
+        static void CountSent(int socket, CipUdint reply_length);
+
+        /** @brief Pause reading and watch for writing as the queue needs it */
+        static void UpdateInterest(Queue_t* queue);
+};
+
+#endif //OPENER_NET_TCPSENDQUEUES_H
@@ -0,0 +1,266 @@
+//
+// Virtual adapters: simulated devices hosted by one stack on addresses of their own
+//
+
+#include <cerrno>
+#include <cstring>
+#include "../../../trace.hpp"
+#include "cip/CIP_Objects/CIP_0001_Identity/CIP_Identity.hpp"
+#include "cip/CIP_Objects/CIP_0004_Assembly/CIP_Assembly.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "NET_IoBackend.hpp"
+#include "NET_IoShards.hpp"
+#include "NET_ExplicitWorkers.hpp"
+#include "NET_NetworkHandler.hpp"
+#include "NET_VirtualAdapters.hpp"
+
+#ifndef WIN
+static_assert(2 * OPENER_VIRTUAL_ADAPTERS < FD_SETSIZE, "the listeners of the virtual adapters do not fit an fd_set");
+#endif
+
+//Static variables
+NET_VirtualAdapters::Adapter_t NET_VirtualAdapters::adapters[OPENER_VIRTUAL_ADAPTERS];
+int NET_VirtualAdapters::number_of_adapters = 1;
+int NET_VirtualAdapters::current_adapter = 0;
+NET_VirtualAdapters::Assembly_t NET_VirtualAdapters::assemblies[OPENER_VIRTUAL_ADAPTER_ASSEMBLIES];
+int NET_VirtualAdapters::number_of_assemblies = 0;
+#if 0 < OPENER_VIRTUAL_ADAPTER_DATA_SIZE
+static CipByte assembly_copies[OPENER_VIRTUAL_ADAPTER_DATA_SIZE];
+CipByte* NET_VirtualAdapters::assembly_data = assembly_copies;
+#else
+CipByte* NET_VirtualAdapters::assembly_data = nullptr;
+#endif
+CipUdint NET_VirtualAdapters::assembly_data_size = 0;
+CipUint NET_VirtualAdapters::socket_adapters[FD_SETSIZE];
+
+CipStatus NET_VirtualAdapters::Start(int adapters_to_start)
+{
+    CipUdint primary_address = CIP_TCPIP_Interface::interface_configuration_.ip_address;
+    if (IsActive() || (2 > adapters_to_start) || (OPENER_VIRTUAL_ADAPTERS < adapters_to_start)
+        || (nullptr == NET_NetworkHandler::netStats[NET_NetworkHandler::tcp_listener])
+        || (INADDR_ANY == primary_address))
+    {
+        return kCipStatusError;
+    }
+    if (NET_IoShards::IsActive() || NET_ExplicitWorkers::IsActive())
+    {
+        OPENER_TRACE_ERR("networkhandler: virtual adapters cannot run with I/O shards or explicit workers\n");
+        return kCipStatusError;
+    }
+
+    const CIP_Identity *identity = CIP_Identity::GetInstance(0);
+    adapters[0].ip_address = primary_address;
+    adapters[0].multicast_address = CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address;
+    adapters[0].serial_number = (nullptr != identity) ? identity->serial_number : 0;
+
+    //the assemblies of the virtual adapters start out with the data of adapter 0
+    number_of_assemblies = 0;
+    assembly_data_size = 0;
+    for (CipUdint i = 1; i < CIP_Assembly::GetNumberOfInstances(); i++)
+    {
+        CIP_Assembly *assembly = (CIP_Assembly *) CIP_Assembly::GetInstance(i);
+        if ((nullptr == assembly) || (nullptr == assembly->GetAssemblyData()->data)
+            || (0 == assembly->GetAssemblyData()->length))
+        {
+            continue;
+        }
+        if (OPENER_VIRTUAL_ADAPTER_ASSEMBLIES == number_of_assemblies)
+        {
+            OPENER_TRACE_ERR("networkhandler: more assemblies than OPENER_VIRTUAL_ADAPTER_ASSEMBLIES\n");
+            number_of_assemblies = 0;
+            return kCipStatusError;
+        }
+        Assembly_t entry = { i, assembly, assembly->GetAssemblyData()->data, assembly_data_size };
+        assemblies[number_of_assemblies++] = entry;
+        assembly_data_size += assembly->GetAssemblyData()->length;
+    }
+    size_t copies_size = (size_t) (adapters_to_start - 1) * assembly_data_size;
+    if (OPENER_VIRTUAL_ADAPTER_DATA_SIZE < copies_size)
+    {
+        OPENER_TRACE_ERR("networkhandler: the assemblies of %d adapters do not fit OPENER_VIRTUAL_ADAPTER_DATA_SIZE\n",
+                         adapters_to_start);
+        number_of_assemblies = 0;
+        assembly_data_size = 0;
+        return kCipStatusError;
+    }
+    for (size_t copy = 0; copy < copies_size; copy += assembly_data_size)
+    {
+        for (int i = 0; i < number_of_assemblies; i++)
+        {
+            memcpy(&assembly_data[copy + assemblies[i].offset], assemblies[i].data,
+                   assemblies[i].assembly->GetAssemblyData()->length);
+        }
+    }
+
+    for (number_of_adapters = 1; number_of_adapters < adapters_to_start; number_of_adapters++)
+    {
+        Adapter_t *adapter = &adapters[number_of_adapters];
+        CipUdint index = (CipUdint) number_of_adapters;
+        adapter->ip_address = NET_Connection::endian_htonl(NET_Connection::endian_ntohl(primary_address) + index);
+        adapter->multicast_address = NET_Connection::endian_htonl(
+                NET_Connection::endian_ntohl(adapters[0].multicast_address) + (index << 5));
+        adapter->serial_number = adapters[0].serial_number + index;
+
+        if (!OpenListeners(adapter))
+        {
+            //the listeners of this one are closed along with the others
+            number_of_adapters++;
+            Stop();
+            return kCipStatusError;
+        }
+    }
+
+    OPENER_TRACE_STATE("networkhandler: %d virtual adapters started\n", number_of_adapters - 1);
+    return kCipStatusOk;
+}
+
+void NET_VirtualAdapters::Stop()
+{
+    Enter(0);
+    for (int i = 1; i < number_of_adapters; i++)
+    {
+        NET_IoBackend::Unwatch(adapters[i].tcp_listener.GetSocketHandle());
+        NET_IoBackend::Unwatch(adapters[i].udp_unicast_listener.GetSocketHandle());
+        adapters[i].tcp_listener.CloseSocket();
+        adapters[i].udp_unicast_listener.CloseSocket();
+    }
+    number_of_adapters = 1;
+    number_of_assemblies = 0;
+    assembly_data_size = 0;
+    memset(socket_adapters, 0, sizeof(socket_adapters));
+}
+
+bool NET_VirtualAdapters::IsActive()
+{
+    return 1 < number_of_adapters;
+}
+
+int NET_VirtualAdapters::GetNumberOfAdapters()
+{
+    return number_of_adapters;
+}
+
+void NET_VirtualAdapters::Enter(int adapter)
+{
+    if ((current_adapter == adapter) || (0 > adapter) || (number_of_adapters <= adapter))
+    {
+        return;
+    }
+
+    Adapter_t *entered = &adapters[adapter];
+    CIP_TCPIP_Interface::interface_configuration_.ip_address = entered->ip_address;
+    CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address = entered->multicast_address;
+    CIP_Identity::SetDeviceSerialNumber(entered->serial_number);
+    for (int i = 0; i < number_of_assemblies; i++)
+    {
+        assemblies[i].assembly->SetAssemblyData((0 == adapter) ? assemblies[i].data
+                                                : GetAssemblyData(adapter, assemblies[i].instance_number));
+    }
+    current_adapter = adapter;
+}
+
+int NET_VirtualAdapters::GetCurrentAdapter()
+{
+    return current_adapter;
+}
+
+CipUdint NET_VirtualAdapters::GetAddress(int adapter)
+{
+    if (0 == adapter)
+    {
+        return IsActive() ? adapters[0].ip_address : CIP_TCPIP_Interface::interface_configuration_.ip_address;
+    }
+    return ((0 < adapter) && (number_of_adapters > adapter)) ? adapters[adapter].ip_address : INADDR_ANY;
+}
+
+NET_Connection* NET_VirtualAdapters::GetTcpListener(int adapter)
+{
+    if (0 == adapter)
+    {
+        return NET_NetworkHandler::netStats[NET_NetworkHandler::tcp_listener];
+    }
+    return ((0 < adapter) && (number_of_adapters > adapter)) ? &adapters[adapter].tcp_listener : nullptr;
+}
+
+NET_Connection* NET_VirtualAdapters::GetUdpUnicastListener(int adapter)
+{
+    if (0 == adapter)
+    {
+        return NET_NetworkHandler::netStats[NET_NetworkHandler::udp_ucast_listener];
+    }
+    return ((0 < adapter) && (number_of_adapters > adapter)) ? &adapters[adapter].udp_unicast_listener : nullptr;
+}
+
+int NET_VirtualAdapters::GetSocketAdapter(int socket)
+{
+    return ((0 <= socket) && (FD_SETSIZE > socket)) ? (int) socket_adapters[socket] : 0;
+}
+
+void NET_VirtualAdapters::SetSocketAdapter(int socket, int adapter)
+{
+    //the sockets served by the network handler are below FD_SETSIZE
+    if ((0 <= socket) && (FD_SETSIZE > socket))
+    {
+        socket_adapters[socket] = (CipUint) adapter;
+    }
+}
+
+CipByte* NET_VirtualAdapters::GetAssemblyData(int adapter, CipUdint instance_number)
+{
+    if ((0 > adapter) || (number_of_adapters <= adapter))
+    {
+        return nullptr;
+    }
+    for (int i = 0; i < number_of_assemblies; i++)
+    {
+        if (instance_number == assemblies[i].instance_number)
+        {
+            return (0 == adapter) ? assemblies[i].data
+                                  : &assembly_data[(size_t) (adapter - 1) * assembly_data_size + assemblies[i].offset];
+        }
+    }
+    return nullptr;
+}
+
+bool NET_VirtualAdapters::OpenListeners(Adapter_t *adapter)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = NET_NetworkHandler::listener_address.sin_port;
+    address.sin_addr.s_addr = adapter->ip_address;
+
+    if ((-1 == adapter->tcp_listener.InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP))
+        || (-1 == adapter->udp_unicast_listener.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)))
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot create the listeners of a virtual adapter: %s\n", strerror(errno));
+        return false;
+    }
+    int tcp_socket = adapter->tcp_listener.GetSocketHandle();
+    int udp_socket = adapter->udp_unicast_listener.GetSocketHandle();
+#ifndef WIN
+    if ((FD_SETSIZE <= tcp_socket) || (FD_SETSIZE <= udp_socket))
+    {
+        OPENER_TRACE_ERR("networkhandler: no socket below FD_SETSIZE left for a virtual adapter\n");
+        return false;
+    }
+#endif
+
+    adapter->tcp_listener.SetSocketOpt(SOL_SOCKET, SO_REUSEADDR, 1);
+    adapter->udp_unicast_listener.SetSocketOpt(SOL_SOCKET, SO_REUSEADDR, 1);
+    adapter->tcp_listener.ApplyProfile(NET_Connection::kSocketTcpListener);
+    if ((-1 == adapter->tcp_listener.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) &address))
+        || (-1 == adapter->udp_unicast_listener.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) &address))
+        || (-1 == adapter->tcp_listener.Listen(MAX_NO_OF_TCP_SOCKETS)))
+    {
+        OPENER_TRACE_ERR("networkhandler: cannot bind a virtual adapter to %s: %s\n",
+                         inet_ntoa(address.sin_addr), strerror(errno));
+        return false;
+    }
+
+    NET_IoBackend::Watch(tcp_socket, NET_IoBackend::kWatchListener);
+    NET_IoBackend::Watch(udp_socket, NET_IoBackend::kWatchReadable);
+    NET_NetworkHandler::highest_socket_handle = NET_NetworkHandler::GetMaxSocket(
+            NET_NetworkHandler::highest_socket_handle, tcp_socket, udp_socket, 0);
+    return true;
+}
@@ -0,0 +1,117 @@
+//
+// Virtual adapters: simulated devices hosted by one stack on addresses of their own
+//
+
+#ifndef OPENER_NET_VIRTUALADAPTERS_H
+#define OPENER_NET_VIRTUALADAPTERS_H
+
+#include "../../ciptypes.hpp"
+#include "../../../opener_user_conf.hpp"
+#include "NET_Connection.hpp"
+
+class CIP_Assembly;
+
+/**
+ * @brief NET_VirtualAdapters runs more adapters in the process of the stack, for load and commissioning tests
+ *
+ * Adapter 0 is the device the stack has been initialized for. The adapters
+ * started beside it take the addresses following its own, e.g. 127.0.0.2 and
+ * on for a stack on 127.0.0.1, or the aliases of its interface. Each one has
+ * a TCP listener and a UDP unicast socket of its own, the broadcast socket of
+ * the stack answers a ListIdentity for all of them.
+ *
+ * The adapters are no independent devices: the CIP objects keep one set of
+ * static data, the control thread switches it over to the adapter whose
+ * socket or connection it serves with Enter:
+ *  - the IP address of the TCP/IP Interface and the multicast addresses, a
+ *    block of 32 per adapter after the one of adapter 0,
+ *  - the serial number of the Identity, the one of adapter 0 plus its index,
+ *  - the data of the assemblies, each adapter has a copy of those created
+ *    before Start, see GetAssemblyData,
+ *  - the connection point slots and multicast producers of the connections
+ *    opened on it, they are kept per adapter by CIP_AppConnType.
+ * Everything else, the product and the configuration of the objects, the
+ * sessions, connection records and frame buffers, is shared by all adapters.
+ * OPENER_NUMBER_OF_SUPPORTED_SESSIONS and OPENER_CIP_NUM_CONNECTIONS have to be
+ * raised along with the number of adapters for one scanner on each.
+ *
+ * Since only the control thread switches adapters, the I/O shards and the
+ * explicit message workers cannot run with virtual adapters. The ready sockets
+ * are kept in fd_sets whatever the backend, so all sockets, two listeners per
+ * adapter, have to stay below FD_SETSIZE.
+ *
+ * The state of the adapters is allocated statically, starting them does not
+ * allocate memory.
+ */
+class NET_VirtualAdapters
+{
+    public:
+        /** @brief Start the adapters 1 to number_of_adapters - 1, at most OPENER_VIRTUAL_ADAPTERS in all
+         *
+         * Called after the network handler is initialized on a unicast address,
+         * with the assemblies already created.
+         *
+         * @return kCipStatusError if an adapter cannot be set up, none is started then
+         */
+        static CipStatus Start(int number_of_adapters);
+
+        /** @brief Close the sockets of the virtual adapters, adapter 0 is entered again */
+        static void Stop();
+
+        static bool IsActive();
+
+        /** @brief Number of adapters including adapter 0, 1 while none has been started */
+        static int GetNumberOfAdapters();
+
+        /** @brief Switch the static data of the CIP objects over to the adapter, nothing is done if it is current */
+        static void Enter(int adapter);
+
+        static int GetCurrentAdapter();
+
+        /** @brief IP address of the adapter in network byte order */
+        static CipUdint GetAddress(int adapter);
+
+        static NET_Connection* GetTcpListener(int adapter);
+        static NET_Connection* GetUdpUnicastListener(int adapter);
+
+        /** @brief Adapter a TCP connection has been accepted for, 0 if it is unknown */
+        static int GetSocketAdapter(int socket);
+        static void SetSocketAdapter(int socket, int adapter);
+
+        /** @brief Data of an assembly of the adapter, for the application to read and write
+         *
+         * @return nullptr if the assembly has no data or has been created after Start
+         */
+        static CipByte* GetAssemblyData(int adapter, CipUdint instance_number);
+
+    private:
+        typedef struct
+        {
+            CipUdint ip_address;
+            CipUdint multicast_address;
+            CipUdint serial_number;
+            NET_Connection tcp_listener;
+            NET_Connection udp_unicast_listener;
+        } Adapter_t;
+
+        typedef struct
+        {
+            CipUdint instance_number;
+            CIP_Assembly* assembly;
+            CipByte* data; /**< the data of adapter 0, given by the application */
+            CipUdint offset; /**< of the copies in the data of each virtual adapter */
+        } Assembly_t;
+
+        static Adapter_t adapters[OPENER_VIRTUAL_ADAPTERS];
+        static int number_of_adapters;
+        static int current_adapter;
+        static Assembly_t assemblies[OPENER_VIRTUAL_ADAPTER_ASSEMBLIES];
+        static int number_of_assemblies;
+        static CipByte* assembly_data; /**< all copies, one block per virtual adapter */
+        static CipUdint assembly_data_size; /**< of the block of one adapter */
+        static CipUint socket_adapters[FD_SETSIZE]; /**< indexed by the socket */
+
+        static bool OpenListeners(Adapter_t* adapter);
+};
+
+#endif //OPENER_NET_VIRTUALADAPTERS_H
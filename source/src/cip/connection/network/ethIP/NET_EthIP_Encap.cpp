@@ -10,8 +10,12 @@
 #include "eip_endianconv.hpp"
 #include "../NET_Endianconv.hpp"
 #include "../NET_NetworkHandler.hpp"
+#include "../NET_ExplicitWorkers.hpp"
+#include "../NET_VirtualAdapters.hpp"
 #include "../../../CIP_Objects/CIP_0001_Identity/CIP_Identity.hpp"
 #include "../../CIP_CommonPacket.hpp"
+#include "../../CIP_RequestContext.hpp"
+#include "utils/netstatistics.hpp"
 
 //Static variables
 bool NET_EthIP_Encap::initialized = false;
@@ -76,15 +80,16 @@ bool NET_EthIP_Encap::EncapsulationInit()
 }
 
 
-int NET_EthIP_Encap::HandleReceivedExplictTcpData(int socket, CipUsint* buffer,
+int NET_EthIP_Encap::HandleReceivedExplictTcpData(CIP_RequestContext* context,
     unsigned int length, int* remaining_bytes)
 {
     CipStatus return_value = kCipGeneralStatusCodeSuccess;
+    int reply_length = 0;
     EncapsulationData encapsulation_data;
     /* eat the encapsulation header*/
     /* the structure contains a pointer to the encapsulated data*/
     /* returns how many bytes are left after the encapsulated data*/
-    *remaining_bytes = CreateEncapsulationStructure(buffer, length, &encapsulation_data);
+    *remaining_bytes = CreateEncapsulationStructure(context->buffer, length, &encapsulation_data);
 
     if (kEncapsulationHeaderOptionsFlag == encapsulation_data.options) /*TODO generate appropriate error response*/
     {
@@ -102,18 +107,22 @@ int NET_EthIP_Encap::HandleReceivedExplictTcpData(int socket, CipUsint* buffer,
 
                 case (kEncapsulationCommandListServices):
                     HandleReceivedListServicesCommand(&encapsulation_data);
+                    return_value = kCipStatusSend;
                     break;
 
                 case (kEncapsulationCommandListIdentity):
                     HandleReceivedListIdentityCommandTcp(&encapsulation_data);
+                    return_value = kCipStatusSend;
                     break;
 
                 case (kEncapsulationCommandListInterfaces):
                     HandleReceivedListInterfacesCommand(&encapsulation_data);
+                    return_value = kCipStatusSend;
                     break;
 
                 case (kEncapsulationCommandRegisterSession):
-                    HandleReceivedRegisterSessionCommand(socket, &encapsulation_data);
+                    HandleReceivedRegisterSessionCommand(context->socket, &encapsulation_data);
+                    return_value = kCipStatusSend;
                     break;
 
                 case (kEncapsulationCommandUnregisterSession):
@@ -122,33 +131,34 @@ int NET_EthIP_Encap::HandleReceivedExplictTcpData(int socket, CipUsint* buffer,
                     break;
 
                 case (kEncapsulationCommandSendRequestReplyData):
-                    return_value = HandleReceivedSendRequestResponseDataCommand(
-                        &encapsulation_data);
+                    return_value = HandleReceivedSendRequestResponseDataCommand(context, &encapsulation_data);
                     break;
 
                 case (kEncapsulationCommandSendUnitData):
-                    return_value = HandleReceivedSendUnitDataCommand(&encapsulation_data);
+                    return_value = HandleReceivedSendUnitDataCommand(context, &encapsulation_data);
                     break;
 
                 default:
+                    NetStatistics::Count(NetStatistics::kInUnknownProtos);
                     encapsulation_data.status = kEncapsulationProtocolInvalidCommand;
                     encapsulation_data.data_length = 0;
                     break;
             }
-            /* if nRetVal is greater than 0 data has to be sent */
-            if (kCipGeneralStatusCodeSuccess < return_value.status)
+            /* the reply length does not fit into a status */
+            if (kCipStatusSend == return_value.status)
             {
-                return_value = (CipStatus)EncapsulateData(&encapsulation_data);
+                reply_length = EncapsulateData(&encapsulation_data);
             }
         }
     }
 
-    return return_value.status;
+    return reply_length;
 }
 
 int NET_EthIP_Encap::HandleReceivedExplictUdpData(int socket, struct sockaddr* from_address, CipUsint* buffer, unsigned int buffer_length, int* number_of_remaining_bytes, bool unicast)
 {
     CipStatus status = kCipGeneralStatusCodeSuccess;
+    int reply_length = 0;
     EncapsulationData encapsulation_data;
     /* eat the encapsulation header*/
     /* the structure contains a pointer to the encapsulated data*/
@@ -167,12 +177,14 @@ int NET_EthIP_Encap::HandleReceivedExplictUdpData(int socket, struct sockaddr* f
             {
                 case (kEncapsulationCommandListServices):
                     HandleReceivedListServicesCommand(&encapsulation_data);
+                    status = kCipStatusSend;
                     break;
 
                 case (kEncapsulationCommandListIdentity):
                     if (unicast == true)
                     {
                         HandleReceivedListIdentityCommandTcp(&encapsulation_data);
+                        status = kCipStatusSend;
                     } else
                     {
                         HandleReceivedListIdentityCommandUdp (socket, (struct sockaddr_in*)from_address, &encapsulation_data);
@@ -182,6 +194,7 @@ int NET_EthIP_Encap::HandleReceivedExplictUdpData(int socket, struct sockaddr* f
 
                 case (kEncapsulationCommandListInterfaces):
                     HandleReceivedListInterfacesCommand(&encapsulation_data);
+                    status = kCipStatusSend;
                     break;
 
                 /* The following commands are not to be sent via UDP */
@@ -190,19 +203,24 @@ int NET_EthIP_Encap::HandleReceivedExplictUdpData(int socket, struct sockaddr* f
                 case (kEncapsulationCommandUnregisterSession):
                 case (kEncapsulationCommandSendRequestReplyData):
                 case (kEncapsulationCommandSendUnitData):
+                    encapsulation_data.status = kEncapsulationProtocolInvalidCommand;
+                    encapsulation_data.data_length = 0;
+                    break;
+
                 default:
+                    NetStatistics::Count(NetStatistics::kInUnknownProtos);
                     encapsulation_data.status = kEncapsulationProtocolInvalidCommand;
                     encapsulation_data.data_length = 0;
                     break;
             }
-            /* if nRetVal is greater than 0 data has to be sent */
-            if (0 < status.status)
+            /* the reply length does not fit into a status */
+            if (kCipStatusSend == status.status)
             {
-                status = (CipStatus)EncapsulateData(&encapsulation_data);
+                reply_length = EncapsulateData(&encapsulation_data);
             }
         }
     }
-    return status.status;
+    return reply_length;
 }
 
 int NET_EthIP_Encap::EncapsulateData(const EncapsulationData* const send_data)
@@ -303,29 +321,8 @@ int NET_EthIP_Encap::EncapsulateListIdentyResponseMessage(CipByte* const communi
 
     communication_buffer_runner += 8;
 
-    const CIP_Identity * identity_instance = CIP_Identity::GetInstance(0);
-
-    NET_Endianconv::AddIntToMessage(identity_instance->vendor_id, communication_buffer_runner);
-
-    NET_Endianconv::AddIntToMessage(identity_instance->device_type, communication_buffer_runner);
-
-    NET_Endianconv::AddIntToMessage(identity_instance->product_code, communication_buffer_runner);
-
-    *(communication_buffer_runner)++ = identity_instance->revision.major_revision;
-
-    *(communication_buffer_runner)++ = identity_instance->revision.minor_revision;
-
-    NET_Endianconv::AddIntToMessage(identity_instance->status.val, communication_buffer_runner);
-
-    NET_Endianconv::AddDintToMessage(identity_instance->serial_number, communication_buffer_runner);
-
-    *communication_buffer_runner++ = (unsigned char)identity_instance->product_name.length;
-
-    memcpy(communication_buffer_runner, identity_instance->product_name.string, identity_instance->product_name.length);
-
-    communication_buffer_runner += identity_instance->product_name.length;
-
-    *communication_buffer_runner++ = 0xFF;
+    //vendor to state are kept encoded by the Identity object
+    communication_buffer_runner += CIP_Identity::CopyWireImage(communication_buffer_runner, true);
 
     // the -2 is for not counting the length field
     NET_Endianconv::AddIntToMessage((CipUint) (communication_buffer_runner - id_length_buffer - 2), id_length_buffer);
@@ -351,6 +348,12 @@ void NET_EthIP_Encap::DetermineDelayTime(CipByte* buffer_start,  DelayedEncapsul
 
     // Sets delay time between 0 and maximum_delay_time
     delayed_message_buffer->time_out = (maximum_delay_time);//todo: add randomic factor
+    if (NET_VirtualAdapters::IsActive())
+    {
+        // the virtual adapters answer one after the other, not in one burst
+        delayed_message_buffer->time_out = (CipDint) (maximum_delay_time * (NET_VirtualAdapters::GetCurrentAdapter() + 1)
+                                                      / NET_VirtualAdapters::GetNumberOfAdapters());
+    }
 }
 
 /* @brief Check supported protocol, generate session handle, send replay back to originator.
@@ -432,7 +435,7 @@ CipStatus NET_EthIP_Encap::HandleReceivedUnregisterSessionCommand(
 /** @brief Call Connection Manager.
  *  @param receive_data Pointer to structure with data and header information.
  */
-CipStatus NET_EthIP_Encap::HandleReceivedSendUnitDataCommand(EncapsulationData* receive_data)
+CipStatus NET_EthIP_Encap::HandleReceivedSendUnitDataCommand(CIP_RequestContext* context, EncapsulationData* receive_data)
 {
     CipInt send_size;
     CipStatus return_value = kCipGeneralStatusCodeSuccess;
@@ -446,11 +449,16 @@ CipStatus NET_EthIP_Encap::HandleReceivedSendUnitDataCommand(EncapsulationData*
 
         if (kSessionStatusValid == CheckRegisteredSessions(receive_data)) /* see if the EIP session is registered*/
         {
-            send_size = (CipInt) CIP_CommonPacket::NotifyConnectedCommonPacketFormat(receive_data, &receive_data->communication_buffer_start[ENCAPSULATION_HEADER_LENGTH]);
+            context->session_handle = receive_data->session_handle;
+            // the explicit message workers may open and close connections meanwhile
+            CIP_ConnectionManager::Lock();
+            send_size = (CipInt) CIP_CommonPacket::NotifyConnectedCommonPacketFormat(context, receive_data, &receive_data->communication_buffer_start[ENCAPSULATION_HEADER_LENGTH]);
+            CIP_ConnectionManager::Unlock();
 
             if (0 < send_size)
             { /* need to send reply */
                 receive_data->data_length = (CipUint) send_size;
+                return_value = kCipStatusSend;
             }
             else
             {
@@ -461,6 +469,7 @@ CipStatus NET_EthIP_Encap::HandleReceivedSendUnitDataCommand(EncapsulationData*
         { /* received a package with non registered session handle */
             receive_data->data_length = 0;
             receive_data->status = kEncapsulationProtocolInvalidSessionHandle;
+            return_value = kCipStatusSend;
         }
     }
     return return_value;
@@ -468,12 +477,11 @@ CipStatus NET_EthIP_Encap::HandleReceivedSendUnitDataCommand(EncapsulationData*
 
 /** @brief Call UCMM or Message Router if UCMM not implemented.
  *  @param receive_data Pointer to structure with data and header information.
- *  @return status 	0 .. success.
+ *  @return status 	kCipStatusSend .. reply to be sent
  * 					-1 .. error
  */
-CipStatus NET_EthIP_Encap::HandleReceivedSendRequestResponseDataCommand(EncapsulationData* receive_data)
+CipStatus NET_EthIP_Encap::HandleReceivedSendRequestResponseDataCommand(CIP_RequestContext* context, EncapsulationData* receive_data)
 {
-    CipInt send_size;
     CipStatus return_value = kCipGeneralStatusCodeSuccess;
 
     if (receive_data->data_length >= 6) {
@@ -485,16 +493,25 @@ CipStatus NET_EthIP_Encap::HandleReceivedSendRequestResponseDataCommand(Encapsul
 
         if (kSessionStatusValid == CheckRegisteredSessions(receive_data)) /* see if the EIP session is registered*/
         {
-            send_size = (CipInt) CIP_CommonPacket::NotifyCommonPacketFormat(receive_data, &receive_data->communication_buffer_start[ENCAPSULATION_HEADER_LENGTH]);
-
-            if (send_size >= 0)
+            context->session_handle = receive_data->session_handle;
+            if (!NET_ExplicitWorkers::IsActive())
             {
-                // need to send reply
-                receive_data->data_length = (CipUint) send_size;
+                return_value = ExecuteSendRequestResponseData(context, receive_data);
+            }
+            else if (NET_ExplicitWorkers::Submit(context->socket, receive_data->session_handle,
+                                                 receive_data->communication_buffer_start,
+                                                 (CipUdint) (ENCAPSULATION_HEADER_LENGTH + 6 + receive_data->data_length)))
+            {
+                // the reply is sent once a worker has executed the request
+                return_value = kCipGeneralStatusCodeSuccess;
             }
             else
             {
-                return_value = kCipStatusError;
+                // all workers are busy and the queue is full
+                NetStatistics::CountError(NetStatistics::kEndpointSession, (int) receive_data->session_handle - 1);
+                receive_data->data_length = 0;
+                receive_data->status = kEncapsulationProtocolInsufficientMemory;
+                return_value = kCipStatusSend;
             }
         }
         else
@@ -502,11 +519,43 @@ CipStatus NET_EthIP_Encap::HandleReceivedSendRequestResponseDataCommand(Encapsul
             // received a package with non registered session handle
             receive_data->data_length = 0;
             receive_data->status = kEncapsulationProtocolInvalidSessionHandle;
+            return_value = kCipStatusSend;
         }
     }
     return return_value;
 }
 
+CipStatus NET_EthIP_Encap::ExecuteSendRequestResponseData(CIP_RequestContext* context, EncapsulationData* receive_data)
+{
+    CipInt send_size = (CipInt) CIP_CommonPacket::NotifyCommonPacketFormat(context, receive_data, &receive_data->communication_buffer_start[ENCAPSULATION_HEADER_LENGTH]);
+
+    if (send_size >= 0)
+    {
+        // need to send reply
+        receive_data->data_length = (CipUint) send_size;
+        return kCipStatusSend;
+    }
+    return kCipStatusError;
+}
+
+int NET_EthIP_Encap::HandleQueuedSendRequestResponseData(CIP_RequestContext* context, unsigned int buffer_length)
+{
+    EncapsulationData encapsulation_data;
+    CreateEncapsulationStructure(context->buffer, (int) buffer_length, &encapsulation_data);
+    encapsulation_data.status = kEncapsulationProtocolSuccess;
+    context->session_handle = encapsulation_data.session_handle;
+
+    /* skip over the interface handle and the timeout as on receive */
+    NET_Endianconv::MoveMessageNOctets(6, encapsulation_data.current_communication_buffer_position);
+    encapsulation_data.data_length -= 6;
+
+    if (kCipStatusSend == ExecuteSendRequestResponseData(context, &encapsulation_data).status)
+    {
+        return EncapsulateData(&encapsulation_data);
+    }
+    return 0;
+}
+
 /** @brief search for available sessions an return index.
  *  @return return index of free session in anRegisteredSessions.
  * 			kInvalidSession .. no free session available
@@ -577,6 +626,18 @@ void NET_EthIP_Encap::CloseSession(int socket)
     }
 }
 
+int NET_EthIP_Encap::GetSessionIndex(int socket)
+{
+    for (int i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; ++i)
+    {
+        if (g_registered_sessions[i] == socket)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
 bool NET_EthIP_Encap::EncapsulationShutdown()
 {
     if (initialized)
@@ -606,7 +667,7 @@ void NET_EthIP_Encap::ManageEncapsulationMessages(MilliSeconds elapsed_time)
             if (0 > g_delayed_encapsulation_messages[i].time_out)
             {
                 // If delay is reached or passed, send the UDP message
-                NET_NetworkHandler::SendUdpData((struct sockaddr*)g_delayed_encapsulation_messages[i].receiver, g_delayed_encapsulation_messages[i].socket, &(g_delayed_encapsulation_messages[i].message[0]),
+                NET_NetworkHandler::SendUdpData((struct sockaddr*)&g_delayed_encapsulation_messages[i].receiver, g_delayed_encapsulation_messages[i].socket, &(g_delayed_encapsulation_messages[i].message[0]),
                                                 (CipUint) g_delayed_encapsulation_messages[i].message_size);g_delayed_encapsulation_messages[i].socket = -1;
             }
         }
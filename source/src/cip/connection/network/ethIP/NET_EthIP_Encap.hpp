@@ -6,13 +6,16 @@
 #ifndef OPENER_ENCAP_ETHIP_H_
 #define OPENER_ENCAP_ETHIP_H_
 
-#define ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES 2 /**< According to EIP spec at least 2 delayed message requests should be supported */
+#define ENCAP_NUMBER_OF_SUPPORTED_DELAYED_ENCAP_MESSAGES (2 * OPENER_VIRTUAL_ADAPTERS) /**< According to EIP spec at least 2 delayed message requests should be supported, per adapter */
 
 #define ENCAP_MAX_DELAYED_ENCAP_MESSAGE_SIZE (ENCAPSULATION_HEADER_LENGTH + 39 + sizeof(OPENER_DEVICE_NAME)) /* currently we only have the size of an encapsulation message */
 
 #include "../../../ciptypes.hpp"
 #include "../../../../opener_user_conf.hpp"
 #include "../NET_Encapsulation.hpp"
+#include "NET_EthIP_Includes.h"
+
+class CIP_RequestContext;
 
 /** @file encap.h
  * @brief This file contains the public interface of the encapsulation layer
@@ -84,15 +87,15 @@ public:
      * @brief Notify the encapsulation layer that an explicit message has been
      * received via TCP.
      *
-     * @param socket_handle socket handle from which data is received.
-     * @param buffer buffer that contains the received data. This buffer will also
-     * contain the response if one is to be sent.
-     * @param buffer length of the data in buffer.
+     * @param context the message being handled: the socket it has been received
+     * on and the buffer that contains it. This buffer will also contain the
+     * response if one is to be sent.
+     * @param buffer_length length of the data in the buffer.
      * @param number_of_remaining_bytes return how many bytes of the input are left
      * over after we're done here
      * @return length of reply that need to be sent back
      */
-    static int HandleReceivedExplictTcpData (int socket, CipUsint *buffer, unsigned int buffer_length,
+    static int HandleReceivedExplictTcpData (CIP_RequestContext *context, unsigned int buffer_length,
                                       int *number_of_remaining_bytes);
 
 /** @ingroup CIP_API
@@ -110,6 +113,29 @@ public:
  */
     static int HandleReceivedExplictUdpData (int socket, struct sockaddr* from_address, CipUsint* buffer, unsigned int buffer_length, int* number_of_remaining_bytes, bool unicast);
 
+    /** @brief Execute a SendRRData request queued for the explicit message workers
+     *
+     * The session has been checked when the request was received.
+     *
+     * @param context the context of the worker, its buffer holds the request
+     *  and receives the reply
+     * @param buffer_length length of the request
+     * @return length of the reply, 0 if there is none
+     */
+    static int HandleQueuedSendRequestResponseData(CIP_RequestContext* context, unsigned int buffer_length);
+
+    /** @brief Release the session registered on a TCP socket whose peer is gone
+     *
+     * @param socket the socket handle the session was registered on
+     */
+    static void CloseSession(int socket);
+
+    /** @brief Index of the session registered on a TCP socket, session handle - 1
+     *
+     * @return the index, -1 if no session is registered on the socket
+     */
+    static int GetSessionIndex(int socket);
+
 
 private:
     static bool initialized;
@@ -154,7 +180,7 @@ private:
     {
         CipDint time_out; /**< time out in milli seconds */
         int socket; /**< associated socket */
-        struct sockaddr_in *receiver;
+        struct sockaddr_in receiver; /**< originator of the request */
         CipByte message[ENCAP_MAX_DELAYED_ENCAP_MESSAGE_SIZE];
         unsigned int message_size;
     } DelayedEncapsulationMessage;
@@ -179,9 +205,12 @@ private:
     static CipStatus HandleReceivedUnregisterSessionCommand(
             EncapsulationData* receive_data);
 
-    static CipStatus HandleReceivedSendUnitDataCommand(EncapsulationData* receive_data);
+    static CipStatus HandleReceivedSendUnitDataCommand(CIP_RequestContext* context, EncapsulationData* receive_data);
+
+    static CipStatus HandleReceivedSendRequestResponseDataCommand(CIP_RequestContext* context, EncapsulationData* receive_data);
 
-    static CipStatus HandleReceivedSendRequestResponseDataCommand(EncapsulationData* receive_data);
+    /** @brief Hand the common packet format of a SendRRData request to the message router */
+    static CipStatus ExecuteSendRequestResponseData(CIP_RequestContext* context, EncapsulationData* receive_data);
 
     static int GetFreeSessionIndex(void);
 
@@ -197,7 +226,6 @@ private:
                             DelayedEncapsulationMessage* delayed_message_buffer);
 
     static int EncapsulateListIdentyResponseMessage(CipByte* const communication_buffer);
-    static void CloseSession(int socket);
 
 
 };
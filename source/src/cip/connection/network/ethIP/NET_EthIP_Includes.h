@@ -18,9 +18,11 @@
 #elif __linux__
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
     #include <sys/select.h>
     #include <bits/socket.h>
+    #include <time.h>
 #endif
 
 
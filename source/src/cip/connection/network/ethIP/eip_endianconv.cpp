@@ -10,7 +10,7 @@
 #include "../NET_Endianconv.hpp"
 #include "NET_EthIP_Includes.h"
 
-int EncapsulateIpAddress(CipUint port, CipUdint address, CipByte* communication_buffer)
+int EncapsulateIpAddress(CipUint port, CipUdint address, CipByte*& communication_buffer)
 {
     int size = 0;
     if (NET_Endianconv::kOpENerEndianessLittle == NET_Endianconv::g_opENer_platform_endianess)
@@ -26,19 +26,19 @@ int EncapsulateIpAddress(CipUint port, CipUdint address, CipByte* communication_
         {
             (communication_buffer)[0] = (unsigned char)(AF_INET >> 8);
             (communication_buffer)[1] = (unsigned char) AF_INET;
-            *communication_buffer += 2;
+            communication_buffer += 2;
             size += 2;
 
             (communication_buffer)[0] = (unsigned char)(port >> 8);
             (communication_buffer)[1] = (unsigned char)port;
-            *communication_buffer += 2;
+            communication_buffer += 2;
             size += 2;
 
             (communication_buffer)[3] = (unsigned char)address;
             (communication_buffer)[2] = (unsigned char)(address >> 8);
             (communication_buffer)[1] = (unsigned char)(address >> 16);
             (communication_buffer)[0] = (unsigned char)(address >> 24);
-            *communication_buffer += 4;
+            communication_buffer += 4;
             size += 4;
         }
         else
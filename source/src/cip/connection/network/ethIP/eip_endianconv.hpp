@@ -16,6 +16,6 @@
  * @param address IP address of the socket, has to be provided in big-endian
  * @param communcation_buffer The message buffer for sending the message
  */
-int EncapsulateIpAddress(CipUint port, CipUdint address, CipByte* communication_buffer);
+int EncapsulateIpAddress(CipUint port, CipUdint address, CipByte*& communication_buffer);
 
 #endif /* OPENER_ENDIANCONV_H_ */
@@ -0,0 +1,804 @@
+//
+// Tests of the network layer
+//
+
+#include "TEST_Network.hpp"
+#include <cstring>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <cip/ciptypes.hpp>
+#include <opener_user_conf.hpp>
+
+#define WAIT_ROUNDS 100
+#define LOOPBACK_FRAMES (2 * OPENER_IO_URING_RECEIVE_BUFFERS + 3)
+#define IO_SHARDS 4
+#define SHARD_FRAMES 64
+#define IO_PORT 0x08AE
+#define IO_RPI_US 10000
+#define WORKER_REQUESTS 12
+#define QUEUED_REPLY_SIZE 4000
+#define QUEUED_REPLIES 200
+#define VIRTUAL_ADAPTERS 3
+#define VIRTUAL_ADAPTER_SERIAL 1000
+
+//A socket bound to an ephemeral port of the loopback interface
+static int open_loopback_socket(int type, struct sockaddr_in * address)
+{
+    int socket_handle = socket(AF_INET, type, 0);
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(*address);
+    if ((0 > socket_handle) || (0 != bind(socket_handle, (struct sockaddr *) address, sizeof(*address)))
+        || (0 != getsockname(socket_handle, (struct sockaddr *) address, &address_length)))
+    {
+        if (0 <= socket_handle)
+            close(socket_handle);
+        return -1;
+    }
+    return socket_handle;
+}
+
+static bool wait_for(int socket_handle, int select_set)
+{
+    for (int i = 0; i < WAIT_ROUNDS; i++)
+    {
+        struct timeval timeout = { 0, 20000 };
+        if ((0 < NET_IoBackend::Wait(FD_SETSIZE, &timeout)) && NET_Connection::SelectIsSet(socket_handle, select_set))
+            return true;
+    }
+    return false;
+}
+
+// A connection is accepted from a watched listener, its data and writability are reported
+bool test_tcp_loopback()
+{
+    struct sockaddr_in address;
+    int listener = open_loopback_socket(SOCK_STREAM, &address);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    if ((0 > listener) || (0 > client) || (0 != listen(listener, 4)))
+        return false;
+    NET_IoBackend::Watch(listener, NET_IoBackend::kWatchListener);
+
+    bool passed = false;
+    int accepted = -1;
+    const char request[] = "ping";
+    char received[sizeof(request)];
+    if ((0 == connect(client, (struct sockaddr *) &address, sizeof(address)))
+        && wait_for(listener, NET_Connection::kReadSet))
+    {
+        accepted = NET_IoBackend::Accept(listener);
+    }
+    if (0 <= accepted)
+    {
+        NET_IoBackend::Watch(accepted, NET_IoBackend::kWatchReadable);
+        passed = (sizeof(request) == send(client, request, sizeof(request), 0))
+                 && wait_for(accepted, NET_Connection::kReadSet)
+                 && (sizeof(request) == recv(accepted, received, sizeof(received), 0))
+                 && (0 == memcmp(request, received, sizeof(request)));
+
+        //a socket asked for is reported writable, the paused one is not reported readable
+        NET_IoBackend::SetInterest(accepted, false, true);
+        passed = passed && (sizeof(request) == send(client, request, sizeof(request), 0))
+                 && wait_for(accepted, NET_Connection::kWriteSet)
+                 && !NET_Connection::SelectIsSet(accepted, NET_Connection::kReadSet);
+        NET_IoBackend::SetInterest(accepted, true, false);
+        passed = passed && wait_for(accepted, NET_Connection::kReadSet)
+                 && (sizeof(request) == recv(accepted, received, sizeof(received), 0));
+
+        NET_IoBackend::Unwatch(accepted);
+        close(accepted);
+    }
+    NET_IoBackend::Unwatch(listener);
+    close(listener);
+    close(client);
+    return passed;
+}
+
+// More frames than receive buffers arrive at once, the frames left in the socket are taken once the buffers are back
+bool test_udp_loopback()
+{
+    struct sockaddr_in address;
+    struct sockaddr_in sender_address;
+    int receiver = open_loopback_socket(SOCK_DGRAM, &address);
+    int sender = open_loopback_socket(SOCK_DGRAM, &sender_address);
+    if ((0 > receiver) || (0 > sender))
+        return false;
+    NET_IoBackend::Watch(receiver, NET_IoBackend::kWatchDatagrams);
+
+    for (CipUdint i = 0; i < LOOPBACK_FRAMES; i++)
+    {
+        if (sizeof(i) != sendto(sender, (const char *) &i, sizeof(i), 0, (struct sockaddr *) &address, sizeof(address)))
+            return false;
+    }
+
+    bool passed = true;
+    CipUdint frames = 0;
+    int rounds = 0;
+    while (passed && (LOOPBACK_FRAMES > frames) && (WAIT_ROUNDS > rounds++))
+    {
+        if (!wait_for(receiver, NET_Connection::kReadSet))
+            break;
+
+        //all frames received with one wait have to fit into the buffer ring
+        CipUdint frames_of_wait = 0;
+        CipUdint frame;
+        struct sockaddr_in from_address;
+        CipUlint receive_time;
+        while (true)
+        {
+            int size;
+            if (NET_IoBackend::IsReceiving())
+            {
+                size = NET_IoBackend::ReceiveQueued(receiver, (CipUsint *) &frame, sizeof(frame), &from_address,
+                                                    &receive_time);
+            }
+            else
+            {
+                size = (int) recv(receiver, (char *) &frame, sizeof(frame), MSG_DONTWAIT);
+                from_address = sender_address;
+            }
+            if (0 > size)
+                break;
+            passed = passed && (sizeof(frame) == size) && (frames == frame)
+                     && (sender_address.sin_port == from_address.sin_port);
+            frames++;
+            frames_of_wait++;
+        }
+        passed = passed && (!NET_IoBackend::IsReceiving() || (OPENER_IO_URING_RECEIVE_BUFFERS >= frames_of_wait));
+    }
+    passed = passed && (LOOPBACK_FRAMES == frames);
+
+    //a produced frame goes out, with io_uring once the next wait submits it
+    CipUdint frame = 0x12345678;
+    passed = passed && (sizeof(frame) == NET_IoBackend::SendTo(receiver, (const CipUsint *) &frame, sizeof(frame),
+                                                               (struct sockaddr *) &sender_address, 0));
+    CipUdint answer = 0;
+    for (int i = 0; passed && (i < WAIT_ROUNDS) && (0 > recv(sender, (char *) &answer, sizeof(answer), MSG_DONTWAIT)); i++)
+    {
+        struct timeval timeout = { 0, 10000 };
+        NET_IoBackend::Wait(FD_SETSIZE, &timeout);
+    }
+
+    NET_IoBackend::Unwatch(receiver);
+    close(receiver);
+    close(sender);
+    return passed && (frame == answer);
+}
+
+#ifdef OPENER_WITH_IO_SHARDS
+static int count_threads()
+{
+    int threads = 0;
+    DIR * tasks = opendir("/proc/self/task");
+    if (nullptr == tasks)
+        return -1;
+    for (struct dirent * task = readdir(tasks); nullptr != task; task = readdir(tasks))
+    {
+        if ('.' != task->d_name[0])
+            threads++;
+    }
+    closedir(tasks);
+    return threads;
+}
+
+//An I/O frame as an originator produces it, the connection id is the one the steering program hashes
+static int build_io_frame(CipUsint * frame, CipUdint connection_id, CipUdint sequence_number)
+{
+    const CipUsint header[] = { 0x02, 0x00, 0x02, 0x80, 0x08, 0x00 };
+    memcpy(frame, header, sizeof(header));
+    for (int i = 0; i < 4; i++)
+    {
+        frame[6 + i] = (CipUsint) (connection_id >> (8 * i));
+        frame[10 + i] = (CipUsint) (sequence_number >> (8 * i));
+    }
+    const CipUsint data_item[] = { 0xB1, 0x00, 0x02, 0x00, 0x01, 0x00 };
+    memcpy(frame + 14, data_item, sizeof(data_item));
+    return 14 + (int) sizeof(data_item);
+}
+
+// Every I/O frame is taken by the shard its connection id hashes to
+bool test_io_shard_steering()
+{
+    if (kCipStatusOk != NET_IoShards::Start(IO_SHARDS).status)
+        return false;
+
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(IO_PORT);
+
+    CipUdint expected[IO_SHARDS] = { 0 };
+    bool passed = 0 <= sender;
+    for (CipUdint i = 0; passed && (i < SHARD_FRAMES); i++)
+    {
+        CipUdint connection_id = 0x00C30000 + i * 0x101;
+        CipUsint frame[32];
+        int frame_length = build_io_frame(frame, connection_id, i);
+        expected[NET_IoShards::GetShard(connection_id)]++;
+        passed = frame_length == sendto(sender, (const char *) frame, frame_length, 0, (struct sockaddr *) &address,
+                                        sizeof(address));
+    }
+
+    CipUdint received = 0;
+    for (int i = 0; passed && (SHARD_FRAMES > received) && (i < WAIT_ROUNDS); i++)
+    {
+        usleep(10000);
+        received = 0;
+        for (int shard = 0; shard < IO_SHARDS; shard++)
+        {
+            received += NET_IoShards::GetReceivedFrames(shard);
+        }
+    }
+
+    //the ids are spread over the shards, each one took exactly its own
+    int shards_used = 0;
+    for (int shard = 0; passed && (shard < IO_SHARDS); shard++)
+    {
+        passed = expected[shard] == NET_IoShards::GetReceivedFrames(shard);
+        shards_used += (0 < expected[shard]) ? 1 : 0;
+    }
+    NET_IoShards::Stop();
+    if (0 <= sender)
+        close(sender);
+    return passed && (SHARD_FRAMES == received) && (1 < shards_used);
+}
+
+// Stopping joins all shard threads, their slots can be started again
+bool test_io_shard_shutdown()
+{
+    int threads = count_threads();
+    if (kCipStatusOk != NET_IoShards::Start(IO_SHARDS).status)
+        return false;
+    bool started = NET_IoShards::IsActive() && (threads + IO_SHARDS == count_threads());
+    NET_IoShards::Stop();
+
+    //a joined thread may still be listed until the kernel has released it
+    int remaining = count_threads();
+    for (int i = 0; (threads != remaining) && (i < WAIT_ROUNDS); i++)
+    {
+        usleep(1000);
+        remaining = count_threads();
+    }
+    bool stopped = !NET_IoShards::IsActive() && (0 == NET_IoShards::GetNumberOfShards()) && (threads == remaining);
+
+    //assigning a new thread to a slot still joinable would terminate the process
+    bool restarted = kCipStatusOk == NET_IoShards::Start(IO_SHARDS).status;
+    NET_IoShards::Stop();
+    return started && stopped && restarted;
+}
+#endif
+
+static void push_uint(std::vector<CipUsint> * data, CipUint value)
+{
+    data->push_back((CipUsint) (value & 0xFF));
+    data->push_back((CipUsint) (value >> 8));
+}
+
+static void push_udint(std::vector<CipUsint> * data, CipUdint value)
+{
+    push_uint(data, (CipUint) (value & 0xFFFF));
+    push_uint(data, (CipUint) (value >> 16));
+}
+
+// Input only connection with a multicast T->O connection, which is produced
+// without a TCP peer and can be received on the loopback interface
+static void build_large_forward_open_io(CipMessageRouterRequest_t * req, CipUint serial, CipUint t_to_o_size,
+                                        CipUsint input_assembly, CipUsint config_assembly)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceLargeForwardOpen;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_udint(&req->request_data, 0);
+    push_udint(&req->request_data, 0);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(2);
+    req->request_data.insert(req->request_data.end(), 3, 0);
+    push_udint(&req->request_data, IO_RPI_US);       // O->T RPI
+    push_udint(&req->request_data, 0);               // null O->T connection
+    push_udint(&req->request_data, IO_RPI_US);       // T->O RPI
+    push_udint(&req->request_data, ((CipUdint) CIP_ConnectionManager::kRoutingTypeMulticastConnection << 16) | t_to_o_size);
+    req->request_data.push_back(0x01);               // cyclic, class 1
+    req->request_data.push_back(3);                  // path size in words
+    req->request_data.push_back(0x20);               // assembly class
+    req->request_data.push_back(0x04);
+    req->request_data.push_back(0x24);               // configuration instance
+    req->request_data.push_back(config_assembly);
+    req->request_data.push_back(0x2C);               // produced connection point
+    req->request_data.push_back(input_assembly);
+}
+
+static void put_uint(CipUsint *& message, CipUint value)
+{
+    *message++ = (CipUsint) (value & 0xFF);
+    *message++ = (CipUsint) (value >> 8);
+}
+
+static void put_udint(CipUsint *& message, CipUdint value)
+{
+    put_uint(message, (CipUint) (value & 0xFFFF));
+    put_uint(message, (CipUint) (value >> 16));
+}
+
+// Encapsulation header in front of data_length bytes of command data
+static CipUsint * put_encapsulation_header(CipUsint * frame, CipUint command, CipUdint session_handle, CipUint data_length)
+{
+    CipUsint *message = frame;
+    put_uint(message, command);
+    put_uint(message, data_length);
+    put_udint(message, session_handle);
+    put_udint(message, 0);                     // status
+    memset(message, 0, 12);                    // sender context and options
+    return message + 12;
+}
+
+static bool receive_frame(int socket, CipUsint * frame, CipUint * frame_length)
+{
+    if (ENCAPSULATION_HEADER_LENGTH != recv(socket, (char *) frame, ENCAPSULATION_HEADER_LENGTH, MSG_WAITALL))
+        return false;
+    CipUint data_length = (CipUint) (frame[2] | (frame[3] << 8));
+    if ((0 != data_length) && (data_length != recv(socket, (char *) frame + ENCAPSULATION_HEADER_LENGTH, data_length, MSG_WAITALL)))
+        return false;
+    *frame_length = (CipUint) (ENCAPSULATION_HEADER_LENGTH + data_length);
+    return true;
+}
+
+// The context requests are handled in, as the network handler owns one
+static CIP_RequestContext * begin_request(int socket)
+{
+    static CipUsint buffer[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    static CIP_RequestContext context;
+    if (nullptr == context.buffer)
+        context.Init(buffer, sizeof(buffer));
+    context.Begin(socket, nullptr);
+    return &context;
+}
+
+// The originator sends a frame, the target handles it as the network handler
+// does and the originator receives the reply
+static int exchange(NET_Connection * originator, NET_Connection * target, const CipUsint * frame,
+                    CipUint frame_length, CipUsint * reply)
+{
+    CIP_RequestContext * context = begin_request(target->GetSocketHandle());
+    CipUsint * buffer = context->buffer;
+    CipUint length;
+    int remaining_bytes;
+
+    if ((frame_length != originator->SendData((void *) frame, frame_length))
+        || !receive_frame(target->GetSocketHandle(), buffer, &length))
+        return -1;
+    int reply_length = NET_EthIP_Encap::HandleReceivedExplictTcpData(context, length, &remaining_bytes);
+    if ((0 >= reply_length) || (reply_length != target->SendData(buffer, (CipUdint) reply_length))
+        || !receive_frame(originator->GetSocketHandle(), reply, &length))
+        return -1;
+    return length;
+}
+
+// SendRRData with an unconnected request to instance 1 of a class
+static CipUint build_rr_data_frame(CipUsint * frame, CipUdint session_handle, CipUsint service, CipUsint class_id,
+                                   const std::vector<CipUsint> & request_data)
+{
+    CipUint request_length = (CipUint) (6 + request_data.size());
+    CipUsint *message = put_encapsulation_header(frame, 0x6F, session_handle, (CipUint) (16 + request_length));
+    put_udint(message, 0);                     // interface handle
+    put_uint(message, 0);                      // timeout
+    put_uint(message, 2);
+    put_uint(message, CIP_CommonPacket::kCipItemIdNullAddress);
+    put_uint(message, 0);
+    put_uint(message, CIP_CommonPacket::kCipItemIdUnconnectedDataItem);
+    put_uint(message, request_length);
+    *message++ = service;
+    *message++ = 2;                            // path size in words
+    *message++ = 0x20;
+    *message++ = class_id;
+    *message++ = 0x24;
+    *message++ = 0x01;
+    memcpy(message, request_data.data(), request_data.size());
+    return (CipUint) (ENCAPSULATION_HEADER_LENGTH + 16 + request_length);
+}
+
+static void build_forward_close(CipMessageRouterRequest_t * req, CipUint serial)
+{
+    req->service = CIP_ConnectionManager::kConnMgrServiceForwardClose;
+    req->request_data.clear();
+    req->request_data.push_back(0x0A);
+    req->request_data.push_back(0x0E);
+    push_uint(&req->request_data, serial);
+    push_uint(&req->request_data, 0x1234);
+    push_udint(&req->request_data, 0xCAFE);
+    req->request_data.push_back(0);
+    req->request_data.push_back(0);
+}
+
+// A TCP connection on the loopback interface, the target side as accepted by the network handler
+static bool connect_loopback(NET_Connection * listener, NET_Connection * originator, NET_Connection * target)
+{
+    struct sockaddr_in listener_address;
+    memset(&listener_address, 0, sizeof(listener_address));
+    listener_address.sin_family = AF_INET;
+    listener_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(listener_address);
+
+    listener->InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    originator->InitSocket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if ((0 != listener->BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) &listener_address))
+        || (0 != listener->Listen(1))
+        || (0 != getsockname(listener->GetSocketHandle(), (struct sockaddr *) &listener_address, &address_length))
+        || (0 != connect(originator->GetSocketHandle(), (struct sockaddr *) &listener_address, address_length)))
+        return false;
+
+    target->SetSocketHandle(accept(listener->GetSocketHandle(), nullptr, nullptr));
+    return true;
+}
+
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+// SendRRData requests of a session are handed to the explicit message workers,
+// their replies come back in the order the requests have been sent
+bool test_explicit_workers()
+{
+    static CipUsint frame[64];
+    static CipUsint reply[OPENER_EXPLICIT_FRAME_BUFFER_SIZE];
+    const int general_status_offset = ENCAPSULATION_HEADER_LENGTH + 16 + 2;
+    CipUint length;
+    int remaining_bytes;
+
+    NET_Connection listener, originator, target;
+    NET_EthIP_Encap::EncapsulationInit();
+    if (!connect_loopback(&listener, &originator, &target))
+        return false;
+
+    //Register a session
+    CipUsint *message = put_encapsulation_header(frame, 0x65, 0, 4);
+    put_uint(message, 1);
+    put_uint(message, 0);
+    if (ENCAPSULATION_HEADER_LENGTH + 4 != exchange(&originator, &target, frame, ENCAPSULATION_HEADER_LENGTH + 4, reply))
+        return false;
+    CipUdint session_handle = (CipUdint) (reply[4] | (reply[5] << 8) | (reply[6] << 16) | (reply[7] << 24));
+
+    if (kCipStatusOk != NET_ExplicitWorkers::Start(2).status)
+        return false;
+
+    //Get_Attribute_Single of the connection manager, the sender context tells the requests apart
+    const CipUsint attribute[] = { 0x30, 0x01 };
+    std::vector<CipUsint> attribute_path(attribute, attribute + sizeof(attribute));
+    CipUint frame_length = build_rr_data_frame(frame, session_handle, 0x0E,
+                                               (CipUsint) CIP_ConnectionManager::class_id, attribute_path);
+    frame[ENCAPSULATION_HEADER_LENGTH + 17] = 3; // path size with the attribute
+
+    bool queued = true;
+    for (CipUsint i = 0; (i < WORKER_REQUESTS) && queued; i++)
+    {
+        frame[12] = i;
+        CIP_RequestContext * context = begin_request(target.GetSocketHandle());
+        queued = (frame_length == originator.SendData(frame, frame_length))
+                 && receive_frame(target.GetSocketHandle(), context->buffer, &length)
+                 && (0 == NET_EthIP_Encap::HandleReceivedExplictTcpData(context, length, &remaining_bytes));
+    }
+
+    //The network handler sends the replies once the wake up socket is readable
+    CipUsint replies = 0;
+    bool in_order = true;
+    for (int polls = 0; queued && (replies < WORKER_REQUESTS) && (polls < 1000); polls++)
+    {
+        struct pollfd wake_up = { NET_ExplicitWorkers::GetWakeSocket(), POLLIN, 0 };
+        if (0 < poll(&wake_up, 1, 10))
+            NET_ExplicitWorkers::SendReplies();
+
+        struct pollfd received = { originator.GetSocketHandle(), POLLIN, 0 };
+        while ((0 < poll(&received, 1, 0)) && receive_frame(originator.GetSocketHandle(), reply, &length))
+        {
+            in_order = in_order && (replies == reply[12]) && (general_status_offset < length)
+                       && (kCipGeneralStatusCodeSuccess == reply[general_status_offset]);
+            replies++;
+        }
+    }
+    NET_ExplicitWorkers::Stop();
+
+    return queued && in_order && (WORKER_REQUESTS == replies)
+           && (0 == NET_ExplicitWorkers::GetNumberOfRejectedRequests());
+}
+#endif
+
+#ifdef OPENER_WITH_TCP_SEND_QUEUES
+// A peer that does not read fills the send queue of its connection, the
+// connection stops taking requests instead of losing replies, and every byte
+// arrives in order once the peer reads again
+bool test_tcp_send_queue()
+{
+    static CipUsint reply[QUEUED_REPLY_SIZE];
+    static CipUsint received[QUEUED_REPLY_SIZE];
+    CipUdint small_buffer = 32768;
+
+    NET_Connection listener, originator, target;
+    if (!connect_loopback(&listener, &originator, &target))
+        return false;
+    target.SetSocketOpt(SOL_SOCKET, SO_SNDBUF, small_buffer);
+    originator.SetSocketOpt(SOL_SOCKET, SO_RCVBUF, small_buffer);
+    int socket = target.GetSocketHandle();
+    NET_TcpSendQueues::Init();
+    if (!NET_TcpSendQueues::Open(socket))
+        return false;
+
+    //replies are sent as long as the connection would take a request, then the peer reads
+    CipUdint replies_sent = 0, bytes_received = 0;
+    bool in_order = true, paused = false;
+    while ((bytes_received < QUEUED_REPLIES * QUEUED_REPLY_SIZE) && in_order)
+    {
+        while ((replies_sent < QUEUED_REPLIES) && NET_TcpSendQueues::CanReceive(socket))
+        {
+            for (CipUint i = 0; i < QUEUED_REPLY_SIZE; i++)
+                reply[i] = (CipUsint) (replies_sent + i);
+            if (!NET_TcpSendQueues::Send(socket, reply, QUEUED_REPLY_SIZE))
+                return false;
+            replies_sent++;
+        }
+        paused = paused || !NET_TcpSendQueues::CanReceive(socket);
+
+        long length = recv(originator.GetSocketHandle(), (char *) received, sizeof(received), 0);
+        if (0 >= length)
+            return false;
+        for (long i = 0; i < length; i++, bytes_received++)
+        {
+            CipUdint reply_number = bytes_received / QUEUED_REPLY_SIZE;
+            in_order = in_order && (received[i] == (CipUsint) (reply_number + bytes_received % QUEUED_REPLY_SIZE));
+        }
+        if (!NET_TcpSendQueues::Flush(socket))
+            return false;
+    }
+    int left = NET_TcpSendQueues::GetNumberOfQueuedReplies(socket);
+    NET_TcpSendQueues::Close(socket);
+    return paused && in_order && (0 == left) && (QUEUED_REPLIES == replies_sent);
+}
+#endif
+
+// Accepted sessions and producers are tuned with the profiles of their kind
+bool test_socket_profiles()
+{
+    NET_Connection listener, originator, target;
+    if (!connect_loopback(&listener, &originator, &target))
+        return false;
+
+    int no_delay = 0, type_of_service = 0;
+    socklen_t option_length = sizeof(no_delay);
+    NET_Connection::ApplyProfile(target.GetSocketHandle(), NET_Connection::kSocketTcpSession);
+    getsockopt(target.GetSocketHandle(), IPPROTO_TCP, TCP_NODELAY, (char *) &no_delay, &option_length);
+    option_length = sizeof(type_of_service);
+    getsockopt(target.GetSocketHandle(), IPPROTO_IP, IP_TOS, (char *) &type_of_service, &option_length);
+    bool session_tuned = (0 != no_delay) && ((27 << 2) == type_of_service);
+
+    //a changed DSCP marks the sockets opened from then on
+    NET_Connection::SetDscp(NET_Connection::kTrafficScheduled, 46);
+    NET_Connection producer;
+    producer.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    producer.ApplyProfile(NET_Connection::kSocketIoProducer);
+    option_length = sizeof(type_of_service);
+    getsockopt(producer.GetSocketHandle(), IPPROTO_IP, IP_TOS, (char *) &type_of_service, &option_length);
+    bool producer_tuned = ((46 << 2) == type_of_service);
+    NET_Connection::SetDscp(NET_Connection::kTrafficScheduled, 47);
+    return session_tuned && producer_tuned;
+}
+
+// Produced frames carry the DSCP of their T->O priority, captured on the loopback interface
+bool test_qos_marking(CIP_ConnectionManager * manager)
+{
+    static CipByte input_data[32];
+    const CipUsint priorities[2] = { 3, 0 }; // urgent and low
+    const CipUsint expected_dscp[2] = { 55, 31 };
+    CipMessageRouterRequest_t req;
+    CipMessageRouterResponse_t resp;
+
+    CIP_Assembly::Init();
+    CIP_Assembly::Create(nullptr, 0); // configuration assembly, instance 1
+    CipUsint input_assembly = (CipUsint) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(input_data, sizeof(input_data));
+    CIP_AppConnType::ConfigureInputOnlyConnectionPoint(0, 0, input_assembly, 1);
+
+    //the multicast producer sends to the loopback interface
+    CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address = htonl(INADDR_LOOPBACK);
+    CIP_TCPIP_Interface::g_time_to_live_value = 1;
+
+    static struct sockaddr_in receiver_storage;
+    struct sockaddr_in * receiver_address = &receiver_storage;
+    memset(receiver_address, 0, sizeof(struct sockaddr_in));
+    receiver_address->sin_family = AF_INET;
+    receiver_address->sin_port = htons(IO_PORT);
+    receiver_address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    NET_Connection receiver;
+    struct timeval receive_timeout = { 1, 0 };
+    receiver.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    receiver.SetSocketOpt(SOL_SOCKET, SO_REUSEADDR, 1);
+    receiver.SetSocketOpt(IPPROTO_IP, IP_RECVTOS, 1);
+    setsockopt(receiver.GetSocketHandle(), SOL_SOCKET, SO_RCVTIMEO, (char *) &receive_timeout, sizeof(receive_timeout));
+    if (0 != receiver.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) receiver_address))
+        return false;
+
+    bool marked = true;
+    for (int i = 0; i < 2; i++)
+    {
+        CipUint serial = (CipUint) (60 + i);
+        build_large_forward_open_io(&req, serial, sizeof(input_data) + 2, input_assembly, 1);
+        req.request_data[37] |= (CipUsint) (priorities[i] << 2); // bits 26 and 27 of the T->O parameter
+        if (kCipGeneralStatusCodeSuccess != manager->InstanceServices(req.service, &req, &resp).status)
+            return false;
+
+        CIP_AppConnType::ManageMulticastProducers(IO_RPI_US / 1000);
+
+        static CipUsint frame[512];
+        CipUsint control[CMSG_SPACE(sizeof(int))];
+        struct iovec frame_vector = { frame, sizeof(frame) };
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &frame_vector;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        int type_of_service = -1;
+        if (0 < recvmsg(receiver.GetSocketHandle(), &message, 0))
+        {
+            for (struct cmsghdr * header = CMSG_FIRSTHDR(&message); nullptr != header;
+                 header = CMSG_NXTHDR(&message, header))
+            {
+                if ((IPPROTO_IP == header->cmsg_level) && (IP_TOS == header->cmsg_type))
+                    type_of_service = *(CipUsint *) CMSG_DATA(header);
+            }
+        }
+        marked = marked && ((expected_dscp[i] << 2) == type_of_service);
+
+        build_forward_close(&req, serial);
+        manager->InstanceServices(req.service, &req, &resp);
+    }
+
+    return marked && (CIP_ConnectionManager::GetNumberOfFreeConnections() == OPENER_CIP_NUM_CONNECTIONS);
+}
+
+//the adapters are only there in a simulation build
+#if (VIRTUAL_ADAPTERS <= OPENER_VIRTUAL_ADAPTERS) && (0 < OPENER_VIRTUAL_ADAPTER_DATA_SIZE)
+// ListIdentity of an adapter, the reply is checked for its address and serial number
+static bool send_list_identity(NET_Connection * scanner, CipUdint address, CipUint maximum_delay)
+{
+    CipUsint frame[ENCAPSULATION_HEADER_LENGTH];
+    put_encapsulation_header(frame, 0x63, 0, 0);
+    frame[12] = (CipUsint) maximum_delay;      // the sender context holds the delay of a broadcast
+    frame[13] = (CipUsint) (maximum_delay >> 8);
+
+    struct sockaddr_in adapter;
+    memset(&adapter, 0, sizeof(adapter));
+    adapter.sin_family = AF_INET;
+    adapter.sin_port = htons(0xAF12);
+    adapter.sin_addr.s_addr = address;
+    return sizeof(frame) == scanner->SendDataTo(frame, sizeof(frame), (struct sockaddr *) &adapter);
+}
+
+// Three adapters in one stack, each answers from its own address with its own serial number
+bool test_virtual_adapters()
+{
+    const int address_offset = ENCAPSULATION_HEADER_LENGTH + 12;
+    const int serial_offset = ENCAPSULATION_HEADER_LENGTH + 34;
+    CipUdint first_address = htonl(INADDR_LOOPBACK);
+
+    CIP_Identity::Init();
+    CIP_Identity::SetDeviceSerialNumber(VIRTUAL_ADAPTER_SERIAL);
+    CIP_TCPIP_Interface::interface_configuration_.ip_address = first_address;
+    NET_EthIP_Encap::EncapsulationInit();
+    if ((kCipGeneralStatusCodeSuccess != NET_NetworkHandler::NetworkHandlerInitialize().status)
+        || (kCipStatusOk != NET_VirtualAdapters::Start(VIRTUAL_ADAPTERS).status))
+        return false;
+
+    NET_Connection scanner;
+    struct sockaddr_in scanner_address;
+    memset(&scanner_address, 0, sizeof(scanner_address));
+    scanner_address.sin_family = AF_INET;
+    scanner_address.sin_addr.s_addr = first_address;
+    scanner.InitSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    scanner.BindSocket(NET_Connection::kOriginatorAddress, (struct sockaddr *) &scanner_address);
+
+    //one request to each adapter, then one the broadcast socket takes for all of them
+    bool sent = true;
+    for (int adapter = 0; adapter < VIRTUAL_ADAPTERS; adapter++)
+        sent = sent && send_list_identity(&scanner, NET_VirtualAdapters::GetAddress(adapter), 0);
+    sent = sent && send_list_identity(&scanner, htonl(INADDR_LOOPBACK + 9), 500);
+
+    int replies[VIRTUAL_ADAPTERS] = { 0 };
+    int total_replies = 0;
+    bool consistent = true;
+    for (int loops = 0; sent && (total_replies < 2 * VIRTUAL_ADAPTERS) && (loops < 200); loops++)
+    {
+        NET_NetworkHandler::NetworkHandlerProcessOnce();
+
+        CipUsint reply[256];
+        struct sockaddr_in from;
+        struct pollfd received = { scanner.GetSocketHandle(), POLLIN, 0 };
+        while ((0 < poll(&received, 1, 0))
+               && (serial_offset + 4 <= scanner.RecvDataFrom(reply, sizeof(reply), (struct sockaddr *) &from)))
+        {
+            int adapter = (int) (ntohl(from.sin_addr.s_addr) - INADDR_LOOPBACK);
+            CipUdint serial = (CipUdint) (reply[serial_offset] | (reply[serial_offset + 1] << 8));
+            if ((0 > adapter) || (VIRTUAL_ADAPTERS <= adapter))
+            {
+                consistent = false;
+                continue;
+            }
+            consistent = consistent && (0 == memcmp(&reply[address_offset], &from.sin_addr.s_addr, 4))
+                         && (VIRTUAL_ADAPTER_SERIAL + (CipUdint) adapter == serial);
+            replies[adapter]++;
+            total_replies++;
+        }
+    }
+    bool current_restored = (0 == NET_VirtualAdapters::GetCurrentAdapter())
+                            && (first_address == CIP_TCPIP_Interface::interface_configuration_.ip_address);
+    NET_NetworkHandler::NetworkHandlerFinish();
+
+    bool all_answered = true;
+    for (int adapter = 0; adapter < VIRTUAL_ADAPTERS; adapter++)
+        all_answered = all_answered && (2 == replies[adapter]);
+    return sent && consistent && all_answered && current_restored && !NET_VirtualAdapters::IsActive();
+}
+#endif
+
+int main()
+{
+    for (int backend = 0; backend < NET_IoBackend::kNumberOfBackends; backend++)
+    {
+        if (!NET_IoBackend::SetBackend((NET_IoBackend::Backend_e) backend))
+            continue;
+        NET_IoBackend::Init();
+        //not usable on the running kernel, the fallback is tested on its own
+        if (backend != NET_IoBackend::GetBackend())
+        {
+            NET_IoBackend::Finish();
+            continue;
+        }
+
+        bool passed = test_tcp_loopback() && test_udp_loopback();
+        NET_IoBackend::Finish();
+        if (!passed)
+            return -1;
+    }
+
+#ifdef OPENER_WITH_IO_SHARDS
+    if ( !test_io_shard_steering() )
+        return -1;
+
+    if ( !test_io_shard_shutdown() )
+        return -1;
+#endif
+
+    //the explicit messages and produced frames are served by the connection manager
+    CIP_Connection::Init();
+    CIP_ConnectionManager::Init();
+    CIP_ConnectionManager * manager = (CIP_ConnectionManager*)CIP_ConnectionManager::GetInstance(0);
+    CIP_MessageRouter::RegisterCIPClass((void*)CIP_ConnectionManager::GetClass(), CIP_ConnectionManager::class_id);
+
+#ifdef OPENER_WITH_EXPLICIT_WORKERS
+    if ( !test_explicit_workers() )
+        return -1;
+#endif
+
+#ifdef OPENER_WITH_TCP_SEND_QUEUES
+    if ( !test_tcp_send_queue() )
+        return -1;
+#endif
+
+    if ( !test_socket_profiles() )
+        return -1;
+
+    if ( !test_qos_marking(manager) )
+        return -1;
+
+#if (VIRTUAL_ADAPTERS <= OPENER_VIRTUAL_ADAPTERS) && (0 < OPENER_VIRTUAL_ADAPTER_DATA_SIZE)
+    if ( !test_virtual_adapters() )
+        return -1;
+#endif
+
+    CIP_ConnectionManager::Shut();
+    CIP_Connection::Shut();
+
+    return 0;
+}
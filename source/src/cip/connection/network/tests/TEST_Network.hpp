@@ -0,0 +1,25 @@
+//
+// Tests of the network layer
+//
+
+#ifndef OPENERMAIN_TEST_NETWORK_H
+#define OPENERMAIN_TEST_NETWORK_H
+
+#include "cip/connection/network/NET_Connection.hpp"
+#include "cip/connection/network/NET_IoBackend.hpp"
+#include "cip/connection/network/NET_IoShards.hpp"
+#include "cip/connection/network/NET_NetworkHandler.hpp"
+#include "cip/connection/network/NET_ExplicitWorkers.hpp"
+#include "cip/connection/network/NET_TcpSendQueues.hpp"
+#include "cip/connection/network/NET_VirtualAdapters.hpp"
+#include "cip/connection/CIP_RequestContext.hpp"
+#include "cip/connection/CIP_CommonPacket.hpp"
+#include "cip/CIP_Objects/CIP_0001_Identity/CIP_Identity.hpp"
+#include "cip/CIP_Objects/CIP_0002_MessageRouter/CIP_MessageRouter.hpp"
+#include "cip/CIP_Objects/CIP_0004_Assembly/CIP_Assembly.hpp"
+#include "cip/CIP_Objects/CIP_0005_Connection/CIP_Connection.hpp"
+#include "cip/CIP_Objects/CIP_0006_ConnectionManager/CIP_ConnectionManager.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/CIP_AppConnType.hpp"
+
+#endif //OPENERMAIN_TEST_NETWORK_H
@@ -80,12 +80,70 @@ typedef unsigned short in_port_t;
  */
 #define OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH 3
 
-/** @brief The number of bytes used for the buffer that will be used for generating any
- *  reply data of messages. There are two uses in OpENer:
- *    1. Explicit messages will use this buffer to store the data generated by the request
- *    2. I/O Connections will use this buffer for the produced data
+/** @brief Define the number of shared multicast T->O producers
+ *
+ *  Every input assembly produced via multicast gets one producer which is
+ *  shared by all exclusive owner, input only and listen only connections
+ *  consuming it, so at most one producer per configured connection point.
+ */
+#define OPENER_CIP_NUM_MULTICAST_PRODUCERS (OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS + OPENER_CIP_NUM_INPUT_ONLY_CONNS + OPENER_CIP_NUM_LISTEN_ONLY_CONNS)
+
+/** @brief Define the number of connections that may be attached to one shared multicast producer
+ */
+#define OPENER_CIP_NUM_MULTICAST_CONSUMERS_PER_PRODUCER (OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS \
+    + OPENER_CIP_NUM_INPUT_ONLY_CONNS * OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH \
+    + OPENER_CIP_NUM_LISTEN_ONLY_CONNS * OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH)
+
+/** @brief Define the number of assembly instances the application can create
+ */
+#define OPENER_CIP_NUM_ASSEMBLIES 16
+
+/** @brief Define the number of data points fragmented connections (transport
+ *  classes 4 to 6) can stream from and to besides the assemblies
+ */
+#define OPENER_CIP_NUM_FRAGMENTED_DATA_POINTS 4
+
+/** @brief Define the number of connections that may be open at the same time
+ *
+ *  The connection manager and the connection objects are allocated for this
+ *  number of explicit and I/O connections at init, so opening a connection
+ *  never allocates memory.
+ */
+#define OPENER_CIP_NUM_CONNECTIONS (OPENER_CIP_NUM_EXPLICIT_CONNS + OPENER_CIP_NUM_MULTICAST_CONSUMERS_PER_PRODUCER)
+
+/** @brief Default size in bytes of the frame buffers of explicit messages
+ *
+ *  A Large_Forward_Open may request explicit connections of up to 4 KB, the
+ *  rest is room for the encapsulation and common packet format headers.
+ *  Received requests and their replies share one buffer.
+ */
+#define OPENER_EXPLICIT_FRAME_BUFFER_SIZE (4096 + 64)
+
+/** @brief Default number of explicit message frame buffers
+ *
+ *  One is shared by received requests and their replies, every connection
+ *  may take one more to keep the last reply of a class 3 connection.
+ */
+#define OPENER_EXPLICIT_FRAME_BUFFERS (1 + OPENER_CIP_NUM_CONNECTIONS)
+
+/** @brief Default size in bytes of the frame buffers of I/O connections
+ *
+ *  Bounds the largest I/O connection that can be granted. Use
+ *  NET_BufferPool::Configure to change it at runtime, e.g. for jumbo frames.
  */
-#define OPENER_MESSAGE_DATA_REPLY_BUFFER 100
+#define OPENER_IO_FRAME_BUFFER_SIZE (4096 + 64)
+
+/** @brief Default number of I/O frame buffers, one is used for receiving and
+ *  two for producing a frame
+ */
+#define OPENER_IO_FRAME_BUFFERS 4
+
+/** @brief Size in bytes of the static arena all frame buffers are carved from
+ *
+ *  A runtime configuration of the buffer classes has to fit into it.
+ */
+#define OPENER_FRAME_BUFFER_ARENA_SIZE (OPENER_EXPLICIT_FRAME_BUFFERS * OPENER_EXPLICIT_FRAME_BUFFER_SIZE \
+    + OPENER_IO_FRAME_BUFFERS * OPENER_IO_FRAME_BUFFER_SIZE)
 
 /** @brief Number of sessions that can be handled at the same time
  */
@@ -95,6 +153,12 @@ typedef unsigned short in_port_t;
  */
 static const int kOpENerTimerTickInMilliSeconds = 10;
 
+/** @brief Number of slots of the connection watchdog timer wheel
+ *
+ *  Each slot covers one timer tick, later watchdogs wrap around the wheel.
+ */
+#define OPENER_WATCHDOG_WHEEL_SLOTS 256
+
 /** @brief Define if RUN IDLE data is sent with consumed data
 */
 static const int kOpENerConsumedDataHasRunIdleHeader = 1;
@@ -105,6 +169,106 @@ static const int kOpENerConsumedDataHasRunIdleHeader = 1;
 */
 static const int kOpENerProducedDataHasRunIdleHeader = 0;
 
+/** @brief Number of threads that can trace, each gets its own trace ring
+ *
+ *  Threads beyond that trace nothing, their trace points are counted as dropped.
+ */
+#define OPENER_TRACE_THREADS 4
+
+/** @brief Number of records of each trace ring, the oldest records are overwritten
+ */
+#define OPENER_TRACE_RING_RECORDS 512
+
+/** @brief Number of distinct trace points that can be registered
+ */
+#define OPENER_TRACE_FORMATS 256
+
+/** @brief Number of threads that count network statistics in a block of their own
+ *
+ *  Threads beyond that share one more block and count with atomic additions.
+ */
+#define OPENER_STATISTICS_THREADS 4
+
+/** @brief Period in ms of the shared memory statistics snapshot, once one has been opened
+ */
+#define OPENER_STATISTICS_SNAPSHOT_INTERVAL 1000
+
+/** @brief Number of submission entries of the io_uring network backend, the
+ *  completion queue is four times as large
+ */
+#define OPENER_IO_URING_ENTRIES 128
+
+/** @brief Number of buffers the io_uring backend receives I/O frames into, a power of 2
+ *
+ *  A frame keeps its buffer until it is handled, if all are taken the frames
+ *  wait in the socket.
+ */
+#define OPENER_IO_URING_RECEIVE_BUFFERS 32
+
+/** @brief Size in bytes of the io_uring receive buffers, an I/O frame plus the
+ *  recvmsg header, the sender address and the receive timestamp
+ */
+#define OPENER_IO_URING_RECEIVE_BUFFER_SIZE (OPENER_IO_FRAME_BUFFER_SIZE + 128)
+
+/** @brief Number of produced frames the io_uring backend can have in flight,
+ *  beyond that they are sent right away
+ */
+#define OPENER_IO_URING_SEND_SLOTS 16
+
+/** @brief Largest number of I/O shards, worker threads receiving the frames of
+ *  the consuming I/O connections, see NET_IoShards
+ */
+#define OPENER_IO_SHARDS 8
+
+/** @brief Number of frames an I/O shard receives with one system call, each
+ *  shard has as many I/O frame buffers of its own
+ */
+#define OPENER_IO_SHARD_BATCH 8
+
+/** @brief Largest number of explicit message workers, threads executing the
+ *  SendRRData requests of the sessions, see NET_ExplicitWorkers
+ */
+#define OPENER_EXPLICIT_WORKERS 4
+
+/** @brief Number of SendRRData requests that can wait for or be handled by the
+ *  explicit message workers, each slot has an explicit frame buffer of its own
+ */
+#define OPENER_EXPLICIT_WORKER_SLOTS 16
+
+/** @brief Number of TCP connections with a send queue, see NET_TcpSendQueues,
+ *  connections beyond that are refused
+ */
+#define OPENER_TCP_SEND_QUEUES OPENER_NUMBER_OF_SUPPORTED_SESSIONS
+
+/** @brief Number of replies that can wait in the send queue of a TCP connection,
+ *  each has an explicit frame buffer of its own
+ *
+ *  A connection is not read from while its queue has no room for one more reply.
+ */
+#define OPENER_TCP_SEND_QUEUE_FRAMES 4
+
+/** @brief Number of adapters the stack can host on addresses of their own, see NET_VirtualAdapters,
+ *  adapter 0 included
+ *
+ *  Every adapter has connection tables of its own, only simulation builds raise
+ *  it with -DOpENer_VIRTUAL_ADAPTERS=n. The adapters share the connection
+ *  records, one connection on each at most.
+ */
+#ifndef OPENER_VIRTUAL_ADAPTERS
+#define OPENER_VIRTUAL_ADAPTERS 1
+#endif
+
+/** @brief Number of assemblies the virtual adapters keep data of their own for
+ */
+#define OPENER_VIRTUAL_ADAPTER_ASSEMBLIES 32
+
+/** @brief Size in bytes of the assembly data of all virtual adapters, adapter 0 excluded,
+ *  raised with -DOpENer_VIRTUAL_ADAPTER_DATA_SIZE=n along with the number of adapters
+ */
+#ifndef OPENER_VIRTUAL_ADAPTER_DATA_SIZE
+#define OPENER_VIRTUAL_ADAPTER_DATA_SIZE 0
+#endif
+
 #ifdef OPENER_WITH_TRACES
 /* If we have tracing enabled provide print tracing macro */
 #include <stdio.h>
@@ -149,13 +313,4 @@ static const int kOpENerProducedDataHasRunIdleHeader = 0;
 
 #endif
 
-/** @brief The number of bytes used for the Ethernet message buffer on
- * the pc port. For different platforms it may makes sense to 
- * have more than one buffer.
- *
- *  This buffer size will be used for any received message.
- *  The same buffer is used for the replied explicit message.
- */
-#define PC_OPENER_ETHERNET_BUFFER_SIZE 512
-
 #endif /*OPENER_USER_CONF_H_*/
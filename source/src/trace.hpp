@@ -12,8 +12,6 @@
  * @brief Tracing infrastructure for OpENer
  */
 
-#ifdef OPENER_WITH_TRACES
-
 /** @def OPENER_TRACE_LEVEL_ERROR Enable tracing of error messages. This is the
  *  default if no trace level is given.
  */
@@ -22,64 +20,64 @@
 /** @def OPENER_TRACE_LEVEL_WARNING Enable tracing of warning messages */
 #define OPENER_TRACE_LEVEL_WARNING 0x02
 
-/** @def OPENER_TRACE_LEVEL_WARNING Enable tracing of state messages */
+/** @def OPENER_TRACE_LEVEL_STATE Enable tracing of state messages */
 #define OPENER_TRACE_LEVEL_STATE 0x04
 
 /** @def OPENER_TRACE_LEVEL_INFO Enable tracing of info messages*/
 #define OPENER_TRACE_LEVEL_INFO 0x08
 
+#ifdef OPENER_WITH_TRACES
+
+#include "utils/tracebuffer.hpp"
+
+/** @def OPENER_TRACE_LEVEL Levels compiled in, the others cost nothing.
+ *  The levels traced at runtime are set with TraceBuffer::SetLevelMask().
+ */
 #ifndef OPENER_TRACE_LEVEL
 #pragma message( \
     "OPENER_TRACE_LEVEL was not defined setting it to OPENER_TRACE_LEVEL_ERROR")
-#else
-#warning OPENER_TRACE_LEVEL was not defined setting it to OPENER_TRACE_LEVEL_ERROR
-#endif
-
 #define OPENER_TRACE_LEVEL OPENER_TRACE_LEVEL_ERROR
-
+#endif
 
 /* @def OPENER_TRACE_ENABLED Can be used for conditional code compilation */
 #define OPENER_TRACE_ENABLED
 
+/** @def OPENER_TRACE(level, format, ...) Record a trace point into the trace
+ *  ring of the calling thread. The format is registered on the first pass, the
+ *  arguments are stored in binary and only formatted when a dump is decoded.
+ */
+#define OPENER_TRACE(level, format, ...)                                                 \
+    do {                                                                                 \
+        if (((level) & OPENER_TRACE_LEVEL) && TraceBuffer::IsLevelEnabled(level)) {      \
+            static const CipUint trace_format_id =                                       \
+                TraceBuffer::RegisterFormat(level, __FILE__, __LINE__, format);          \
+            TraceBuffer::Write(trace_format_id, ##__VA_ARGS__);                           \
+        }                                                                                \
+    } while (0)
+
 /** @def OPENER_TRACE_ERR(...) Trace error messages.
  *  In order to activate this trace level set the OPENER_TRACE_LEVEL_ERROR flag
  *  in OPENER_TRACE_LEVEL.
  */
-#define OPENER_TRACE_ERR(...)                              \
-    do {                                                   \
-        if (OPENER_TRACE_LEVEL_ERROR & OPENER_TRACE_LEVEL) \
-            LOG_TRACE(__VA_ARGS__);                        \
-    } while (0)
+#define OPENER_TRACE_ERR(...) OPENER_TRACE(OPENER_TRACE_LEVEL_ERROR, __VA_ARGS__)
 
 /** @def OPENER_TRACE_WARN(...) Trace warning messages.
  *  In order to activate this trace level set the OPENER_TRACE_LEVEL_WARNING
  * flag in OPENER_TRACE_LEVEL.
  */
-#define OPENER_TRACE_WARN(...)                               \
-    do {                                                     \
-        if (OPENER_TRACE_LEVEL_WARNING & OPENER_TRACE_LEVEL) \
-            LOG_TRACE(__VA_ARGS__);                          \
-    } while (0)
+#define OPENER_TRACE_WARN(...) OPENER_TRACE(OPENER_TRACE_LEVEL_WARNING, __VA_ARGS__)
 
 /** @def OPENER_TRACE_STATE(...) Trace state messages.
  *  In order to activate this trace level set the OPENER_TRACE_LEVEL_STATE flag
  *  in OPENER_TRACE_LEVEL.
  */
-#define OPENER_TRACE_STATE(...)                            \
-    do {                                                   \
-        if (OPENER_TRACE_LEVEL_STATE & OPENER_TRACE_LEVEL) \
-            LOG_TRACE(__VA_ARGS__);                        \
-    } while (0)
+#define OPENER_TRACE_STATE(...) OPENER_TRACE(OPENER_TRACE_LEVEL_STATE, __VA_ARGS__)
 
 /** @def OPENER_TRACE_INFO(...) Trace information messages.
  *  In order to activate this trace level set the OPENER_TRACE_LEVEL_INFO flag
  *  in OPENER_TRACE_LEVEL.
  */
-#define OPENER_TRACE_INFO(...)                            \
-    do {                                                  \
-        if (OPENER_TRACE_LEVEL_INFO & OPENER_TRACE_LEVEL) \
-            LOG_TRACE(__VA_ARGS__);                       \
-    } while (0);
+#define OPENER_TRACE_INFO(...) OPENER_TRACE(OPENER_TRACE_LEVEL_INFO, __VA_ARGS__)
 
 #else
 /* define the tracing macros empty in order to save space */
@@ -0,0 +1,37 @@
+/*
+ * heapguard.cpp
+ *
+ *  Global allocation functions of the static memory build profile, only built
+ *  with OPENER_STATIC_MEMORY
+ */
+
+#include <cstdlib>
+#include <new>
+#include "staticmemory.hpp"
+
+//Replaces the global allocation functions, every allocation of the process passes here
+void * operator new(size_t size)
+{
+    StaticMemory::NotifyAllocation(size);
+    void * memory = malloc(size ? size : 1);
+    if (nullptr == memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void * operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void * memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void * memory) noexcept
+{
+    free(memory);
+}
@@ -0,0 +1,267 @@
+/*
+ * iolatency.cpp
+ *
+ *  Latency and jitter probes of the implicit I/O path
+ */
+
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include "iolatency.hpp"
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+int LatencyHistogram::GetBucketIndex(CipUlint value)
+{
+    if (value < (CipUlint) kSubBuckets)
+    {
+        return (int) value;
+    }
+    if (value >= ((CipUlint) 1 << kMaxValueBits))
+    {
+        value = ((CipUlint) 1 << kMaxValueBits) - 1;
+    }
+
+    int most_significant_bit = 63 - __builtin_clzll(value);
+    int shift = most_significant_bit - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + (int) ((value >> shift) & (kSubBuckets - 1));
+}
+
+CipUlint LatencyHistogram::GetBucketHighestValue(int index)
+{
+    if (index < kSubBuckets)
+    {
+        return (CipUlint) index;
+    }
+    int shift = index / kSubBuckets - 1;
+    CipUlint sub_bucket = (CipUlint) (index % kSubBuckets);
+    return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(CipUlint value)
+{
+    buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    CipUlint current = min.load(std::memory_order_relaxed);
+    while ((value < current) && !min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+    current = max.load(std::memory_order_relaxed);
+    while ((value > current) && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::Reset()
+{
+    for (int i = 0; i < kBuckets; i++)
+    {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+CipUlint LatencyHistogram::GetCount() const
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+CipUlint LatencyHistogram::GetMin() const
+{
+    return (0 == GetCount()) ? 0 : min.load(std::memory_order_relaxed);
+}
+
+CipUlint LatencyHistogram::GetMax() const
+{
+    return max.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const
+{
+    CipUlint samples = GetCount();
+    return (0 == samples) ? 0.0 : (double) sum.load(std::memory_order_relaxed) / (double) samples;
+}
+
+double LatencyHistogram::GetStandardDeviation() const
+{
+    double mean = GetMean();
+    double squares = 0.0;
+    CipUlint samples = 0;
+    for (int i = 0; i < kBuckets; i++)
+    {
+        CipUlint bucket_count = buckets[i].load(std::memory_order_relaxed);
+        if (0 != bucket_count)
+        {
+            //middle of the bucket
+            CipUlint lowest = (0 == i) ? 0 : GetBucketHighestValue(i - 1) + 1;
+            double deviation = ((double) lowest + (double) GetBucketHighestValue(i)) / 2.0 - mean;
+            squares += deviation * deviation * (double) bucket_count;
+            samples += bucket_count;
+        }
+    }
+    return (0 == samples) ? 0.0 : std::sqrt(squares / (double) samples);
+}
+
+CipUlint LatencyHistogram::GetPercentile(double percentile) const
+{
+    CipUlint samples = 0;
+    for (int i = 0; i < kBuckets; i++)
+    {
+        samples += buckets[i].load(std::memory_order_relaxed);
+    }
+    if (0 == samples)
+    {
+        return 0;
+    }
+
+    CipUlint rank = (CipUlint) std::ceil(percentile / 100.0 * (double) samples);
+    if (0 == rank)
+    {
+        rank = 1;
+    }
+    CipUlint seen = 0;
+    for (int i = 0; i < kBuckets; i++)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            CipUlint highest = GetBucketHighestValue(i);
+            CipUlint largest = GetMax();
+            return (highest < largest) ? highest : largest;
+        }
+    }
+    return GetMax();
+}
+
+std::atomic<bool> IoLatency::enabled(false);
+thread_local CipUlint IoLatency::received = 0;
+IoLatency::AssemblyMarks_t IoLatency::assembly_marks[kPublishSlots];
+LatencyHistogram IoLatency::histograms[kNumberOfProbes];
+
+void IoLatency::Enable(bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool IoLatency::IsEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+CipUlint IoLatency::Now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (CipUlint) now.tv_sec * 1000000000ULL + (CipUlint) now.tv_nsec;
+}
+
+void IoLatency::MarkReceived(CipUlint timestamp)
+{
+    received = timestamp;
+}
+
+void IoLatency::RecordConsumed()
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+    CipUlint receive_time = received;
+    received = 0;
+    if (0 != receive_time)
+    {
+        CipUlint now = Now();
+        histograms[kProbeConsume].Record((now > receive_time) ? now - receive_time : 0);
+    }
+}
+
+void IoLatency::MarkPublished(CipUdint assembly)
+{
+    if (IsEnabled())
+    {
+        assembly_marks[assembly % kPublishSlots].published.store(Now(), std::memory_order_relaxed);
+    }
+}
+
+void IoLatency::RecordProduced(CipUdint assembly, CipUlint frame_start)
+{
+    if (!IsEnabled() || (0 == frame_start))
+    {
+        return;
+    }
+    CipUlint now = Now();
+    AssemblyMarks_t & marks = assembly_marks[assembly % kPublishSlots];
+
+    histograms[kProbeProduce].Record((now > frame_start) ? now - frame_start : 0);
+
+    CipUlint published = marks.published.exchange(0, std::memory_order_relaxed);
+    if (0 != published)
+    {
+        histograms[kProbePublish].Record((now > published) ? now - published : 0);
+    }
+
+    CipUlint last_produced = marks.last_produced.exchange(now, std::memory_order_relaxed);
+    if ((0 != last_produced) && (now > last_produced))
+    {
+        histograms[kProbeProducedInterval].Record(now - last_produced);
+    }
+}
+
+const LatencyHistogram & IoLatency::GetHistogram(Probe_e probe)
+{
+    return histograms[probe];
+}
+
+void IoLatency::Reset()
+{
+    received = 0;
+    for (int i = 0; i < kPublishSlots; i++)
+    {
+        assembly_marks[i].published.store(0, std::memory_order_relaxed);
+        assembly_marks[i].last_produced.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < kNumberOfProbes; i++)
+    {
+        histograms[i].Reset();
+    }
+}
+
+void IoLatency::Dump(std::ostream & stream)
+{
+    static const char * const kProbeNames[kNumberOfProbes] = { "consume", "publish", "produce", "interval" };
+
+    stream << std::left << std::setw(10) << "probe" << std::right << std::setw(10) << "count";
+    static const char * const kColumns[] = { "min", "mean", "stddev", "p50", "p90", "p99", "p99.9", "max" };
+    for (const char * column : kColumns)
+    {
+        stream << std::setw(10) << column;
+    }
+    stream << "   [us]" << std::endl;
+
+    stream << std::fixed << std::setprecision(1);
+    for (int i = 0; i < kNumberOfProbes; i++)
+    {
+        const LatencyHistogram & histogram = histograms[i];
+        double values[] = {
+            (double) histogram.GetMin(), histogram.GetMean(), histogram.GetStandardDeviation(),
+            (double) histogram.GetPercentile(50.0), (double) histogram.GetPercentile(90.0),
+            (double) histogram.GetPercentile(99.0), (double) histogram.GetPercentile(99.9),
+            (double) histogram.GetMax()
+        };
+        stream << std::left << std::setw(10) << kProbeNames[i] << std::right << std::setw(10) << histogram.GetCount();
+        for (double value : values)
+        {
+            stream << std::setw(10) << value / 1000.0;
+        }
+        stream << std::endl;
+    }
+    stream.unsetf(std::ios_base::floatfield);
+}
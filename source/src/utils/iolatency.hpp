@@ -0,0 +1,115 @@
+/*
+ * iolatency.hpp
+ *
+ *  Latency and jitter probes of the implicit I/O path
+ */
+
+#ifndef OPENER_UTILS_IOLATENCY_H_
+#define OPENER_UTILS_IOLATENCY_H_
+
+#include <atomic>
+#include <ostream>
+#include <typedefs.hpp>
+
+/** @brief Lock-free log-linear histogram of nanosecond values
+ *
+ *  Values are bucketed HDR style: exact below 32 ns, above that every power
+ *  of two is split into 32 linear sub-buckets, so each bucket is accurate to
+ *  within 1/32 of its value. Recording is a handful of relaxed atomic
+ *  operations and may run concurrently with readers on other threads.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void Record(CipUlint value);
+    void Reset();
+
+    CipUlint GetCount() const;
+    CipUlint GetMin() const;
+    CipUlint GetMax() const;
+    double GetMean() const;
+    /** @brief Standard deviation, computed from the buckets */
+    double GetStandardDeviation() const;
+
+    /** @brief Highest value equivalent to the bucket holding the given percentile (0-100) */
+    CipUlint GetPercentile(double percentile) const;
+
+private:
+    static const int kSubBucketBits = 5;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kMaxValueBits = 40; //about 18 minutes in ns, larger values saturate
+    static const int kBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+    static int GetBucketIndex(CipUlint value);
+    static CipUlint GetBucketHighestValue(int index);
+
+    std::atomic<CipUlint> buckets[kBuckets];
+    std::atomic<CipUlint> count;
+    std::atomic<CipUlint> sum;
+    std::atomic<CipUlint> min;
+    std::atomic<CipUlint> max;
+};
+
+/** @brief Probes of the implicit I/O path
+ *
+ *  The network handler marks the kernel receive time of each consumed frame
+ *  and the assembly object records when its data has been updated. The
+ *  producer records when a frame has been handed to the socket, measured from
+ *  the start of building it, from the last application publish of its
+ *  assembly and from the previous frame of the same assembly (jitter against
+ *  the RPI). The probes are off by default and cost one branch then.
+ */
+class IoLatency
+{
+public:
+    typedef enum
+    {
+        kProbeConsume = 0,      ///< frame received by the kernel -> assembly updated
+        kProbePublish,          ///< application publish -> frame handed to the socket
+        kProbeProduce,          ///< frame build started -> frame handed to the socket
+        kProbeProducedInterval, ///< interval between two frames of the same assembly
+        kNumberOfProbes
+    } Probe_e;
+
+    static void Enable(bool enable);
+    static bool IsEnabled();
+
+    /** @brief Timestamp in ns on the clock of the kernel receive timestamps (CLOCK_REALTIME) */
+    static CipUlint Now();
+
+    /** @brief Receive time of the frame the calling thread handles, 0 once it has been handled */
+    static void MarkReceived(CipUlint timestamp);
+
+    /** @brief The received frame has been copied into its assembly */
+    static void RecordConsumed();
+
+    /** @brief The application has written new data into the given assembly */
+    static void MarkPublished(CipUdint assembly);
+
+    /** @brief A frame of the given assembly, started at frame_start, has been handed to the socket */
+    static void RecordProduced(CipUdint assembly, CipUlint frame_start);
+
+    static const LatencyHistogram & GetHistogram(Probe_e probe);
+    static void Reset();
+
+    /** @brief Writes one line per probe: count, min, mean, stddev, p50, p90, p99, p99.9 and max in us */
+    static void Dump(std::ostream & stream);
+
+private:
+    static const int kPublishSlots = 16; //assemblies are hashed by number, collisions only lose samples
+
+    typedef struct
+    {
+        std::atomic<CipUlint> published;
+        std::atomic<CipUlint> last_produced;
+    } AssemblyMarks_t;
+
+    static std::atomic<bool> enabled;
+    static thread_local CipUlint received; //each thread handling frames, e.g. the I/O shards, has its own
+    static AssemblyMarks_t assembly_marks[kPublishSlots];
+    static LatencyHistogram histograms[kNumberOfProbes];
+};
+
+#endif
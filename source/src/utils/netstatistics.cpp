@@ -0,0 +1,410 @@
+/*
+ * netstatistics.cpp
+ *
+ *  Interface, media, connection and session counters of the network handler
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#endif
+#include "netstatistics.hpp"
+
+namespace
+{
+    typedef struct alignas(64)
+    {
+        std::atomic<CipUlint> interface_counters[NetStatistics::kNumberOfInterfaceCounters];
+        std::atomic<CipUlint> connections[OPENER_CIP_NUM_CONNECTIONS][NetStatistics::kNumberOfEndpointCounters];
+        std::atomic<CipUlint> sessions[OPENER_NUMBER_OF_SUPPORTED_SESSIONS][NetStatistics::kNumberOfEndpointCounters];
+    } Block_t;
+
+    /* The snapshot is written seqlock style: sequence is odd while it is written */
+    typedef struct
+    {
+        std::atomic<CipUlint> sequence;
+        NetStatistics::Snapshot_t snapshot;
+    } SharedSnapshot_t;
+
+    //the last block is shared by the threads that got none of their own
+    Block_t blocks[OPENER_STATISTICS_THREADS + 1];
+    std::atomic<CipUint> attached_blocks(0);
+
+    thread_local Block_t * thread_block = nullptr;
+    thread_local bool thread_block_shared = false;
+
+    std::atomic<CipUlint> interface_baseline[NetStatistics::kNumberOfInterfaceCounters];
+    std::atomic<CipUlint> media_baseline[NetStatistics::kNumberOfMediaCounters];
+    char interface_name[IF_NAMESIZE] = "";
+
+    SharedSnapshot_t * shared_snapshot = nullptr;
+    char shared_snapshot_name[64] = "";
+
+    /* Files of the Linux interface statistics behind the media counters, the
+     * kernel only knows the total of collisions and calls the late ones window
+     * errors and the excessive ones aborted transmissions */
+    const char * const kMediaCounterFiles[NetStatistics::kNumberOfMediaCounters] = {
+        "rx_frame_errors",   //alignment errors
+        "rx_crc_errors",     //FCS errors
+        "collisions",        //single collisions
+        nullptr,             //multiple collisions
+        nullptr,             //SQE test errors
+        nullptr,             //deferred transmissions
+        "tx_window_errors",  //late collisions
+        "tx_aborted_errors", //excessive collisions
+        "tx_fifo_errors",    //MAC transmit errors
+        "tx_carrier_errors", //carrier sense errors
+        "rx_length_errors",  //frame too long
+        "rx_over_errors"     //MAC receive errors
+    };
+
+    Block_t * GetThreadBlock()
+    {
+        if (nullptr == thread_block)
+        {
+            CipUint block = attached_blocks.fetch_add(1, std::memory_order_relaxed);
+            thread_block_shared = (block >= OPENER_STATISTICS_THREADS);
+            thread_block = &blocks[thread_block_shared ? OPENER_STATISTICS_THREADS : block];
+        }
+        return thread_block;
+    }
+
+    //the owning thread is the only writer of its block, no read-modify-write needed
+    void Add(std::atomic<CipUlint> & counter, CipUlint value)
+    {
+        if (thread_block_shared)
+        {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }
+        else
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }
+
+    void Maximum(std::atomic<CipUlint> & counter, CipUlint value)
+    {
+        CipUlint current = counter.load(std::memory_order_relaxed);
+        while ((value > current) && !counter.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::atomic<CipUlint> * GetEndpointCounters(Block_t * block, NetStatistics::Endpoint_e endpoint, int index)
+    {
+        if ((NetStatistics::kEndpointConnection == endpoint) && (0 <= index) && (index < OPENER_CIP_NUM_CONNECTIONS))
+        {
+            return block->connections[index];
+        }
+        if ((NetStatistics::kEndpointSession == endpoint) && (0 <= index) && (index < OPENER_NUMBER_OF_SUPPORTED_SESSIONS))
+        {
+            return block->sessions[index];
+        }
+        return nullptr;
+    }
+
+    CipUlint ReadCounterFile(const char * name)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s", interface_name, name);
+
+        //no stdio, it allocates and the heap may be sealed already
+        int file = open(path, O_RDONLY);
+        if (0 > file)
+        {
+            return 0;
+        }
+        char text[32];
+        ssize_t length = read(file, text, sizeof(text) - 1);
+        close(file);
+        if (0 >= length)
+        {
+            return 0;
+        }
+        text[length] = '\0';
+        return strtoull(text, nullptr, 10);
+    }
+}
+
+void NetStatistics::Count(InterfaceCounter_e counter, CipUlint value)
+{
+    Add(GetThreadBlock()->interface_counters[counter], value);
+}
+
+void NetStatistics::CountEndpoint(Endpoint_e endpoint, int index, EndpointCounter_e counter, CipUlint value)
+{
+    std::atomic<CipUlint> * counters = ::GetEndpointCounters(GetThreadBlock(), endpoint, index);
+    if (nullptr != counters)
+    {
+        Add(counters[counter], value);
+    }
+}
+
+void NetStatistics::CountReceived(Endpoint_e endpoint, int index, CipUdint octets, CipUlint latency)
+{
+    std::atomic<CipUlint> * counters = ::GetEndpointCounters(GetThreadBlock(), endpoint, index);
+    if (nullptr == counters)
+    {
+        return;
+    }
+    Add(counters[kPacketsIn], 1);
+    Add(counters[kOctetsIn], octets);
+    if (0 != latency)
+    {
+        Add(counters[kLatencySamples], 1);
+        Add(counters[kLatencySum], latency);
+        Maximum(counters[kLatencyMax], latency);
+    }
+}
+
+void NetStatistics::CountSent(Endpoint_e endpoint, int index, CipUdint octets)
+{
+    std::atomic<CipUlint> * counters = ::GetEndpointCounters(GetThreadBlock(), endpoint, index);
+    if (nullptr != counters)
+    {
+        Add(counters[kPacketsOut], 1);
+        Add(counters[kOctetsOut], octets);
+    }
+}
+
+void NetStatistics::CountError(Endpoint_e endpoint, int index)
+{
+    CountEndpoint(endpoint, index, kErrors, 1);
+}
+
+CipUlint NetStatistics::ReadInterfaceCounter(int counter)
+{
+    CipUlint sum = 0;
+    for (int i = 0; i <= OPENER_STATISTICS_THREADS; i++)
+    {
+        sum += blocks[i].interface_counters[counter].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void NetStatistics::GetInterfaceCounters(CipUdint counters[kNumberOfInterfaceCounters], bool clear)
+{
+    for (int i = 0; i < kNumberOfInterfaceCounters; i++)
+    {
+        CipUlint current = ReadInterfaceCounter(i);
+        CipUlint baseline = clear ? interface_baseline[i].exchange(current, std::memory_order_relaxed)
+                                  : interface_baseline[i].load(std::memory_order_relaxed);
+        counters[i] = (CipUdint) (current - baseline);
+    }
+}
+
+void NetStatistics::ClearInterfaceCounters()
+{
+    for (int i = 0; i < kNumberOfInterfaceCounters; i++)
+    {
+        interface_baseline[i].store(ReadInterfaceCounter(i), std::memory_order_relaxed);
+    }
+}
+
+void NetStatistics::SetInterfaceAddress(CipUdint ip_address)
+{
+    interface_name[0] = '\0';
+#ifdef __linux__
+    struct ifaddrs * interfaces;
+    if (0 != getifaddrs(&interfaces))
+    {
+        return;
+    }
+    for (struct ifaddrs * interface = interfaces; nullptr != interface; interface = interface->ifa_next)
+    {
+        if ((nullptr != interface->ifa_addr) && (AF_INET == interface->ifa_addr->sa_family)
+            && (ip_address == ((struct sockaddr_in *) interface->ifa_addr)->sin_addr.s_addr))
+        {
+            strncpy(interface_name, interface->ifa_name, sizeof(interface_name) - 1);
+            interface_name[sizeof(interface_name) - 1] = '\0';
+            break;
+        }
+    }
+    freeifaddrs(interfaces);
+#endif
+    ClearMediaCounters();
+}
+
+void NetStatistics::ReadMediaCounters(CipUlint counters[kNumberOfMediaCounters])
+{
+    for (int i = 0; i < kNumberOfMediaCounters; i++)
+    {
+        counters[i] = (('\0' != interface_name[0]) && (nullptr != kMediaCounterFiles[i]))
+                      ? ReadCounterFile(kMediaCounterFiles[i]) : 0;
+    }
+}
+
+void NetStatistics::GetMediaCounters(CipUdint counters[kNumberOfMediaCounters], bool clear)
+{
+    CipUlint current[kNumberOfMediaCounters];
+    ReadMediaCounters(current);
+    for (int i = 0; i < kNumberOfMediaCounters; i++)
+    {
+        CipUlint baseline = clear ? media_baseline[i].exchange(current[i], std::memory_order_relaxed)
+                                  : media_baseline[i].load(std::memory_order_relaxed);
+        counters[i] = (CipUdint) (current[i] - baseline);
+    }
+}
+
+void NetStatistics::ClearMediaCounters()
+{
+    CipUlint current[kNumberOfMediaCounters];
+    ReadMediaCounters(current);
+    for (int i = 0; i < kNumberOfMediaCounters; i++)
+    {
+        media_baseline[i].store(current[i], std::memory_order_relaxed);
+    }
+}
+
+void NetStatistics::GetEndpointCounters(Endpoint_e endpoint, int index, CipUlint counters[kNumberOfEndpointCounters])
+{
+    memset(counters, 0, kNumberOfEndpointCounters * sizeof(CipUlint));
+    for (int i = 0; i <= OPENER_STATISTICS_THREADS; i++)
+    {
+        std::atomic<CipUlint> * block_counters = ::GetEndpointCounters(&blocks[i], endpoint, index);
+        if (nullptr == block_counters)
+        {
+            return;
+        }
+        for (int counter = 0; counter < kNumberOfEndpointCounters; counter++)
+        {
+            CipUlint value = block_counters[counter].load(std::memory_order_relaxed);
+            if (kLatencyMax == counter)
+            {
+                counters[counter] = (value > counters[counter]) ? value : counters[counter];
+            }
+            else
+            {
+                counters[counter] += value;
+            }
+        }
+    }
+}
+
+bool NetStatistics::OpenSnapshot(const char * name)
+{
+    CloseSnapshot();
+
+    int memory = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (0 > memory)
+    {
+        return false;
+    }
+    void * mapping = MAP_FAILED;
+    if (0 == ftruncate(memory, sizeof(SharedSnapshot_t)))
+    {
+        mapping = mmap(nullptr, sizeof(SharedSnapshot_t), PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    }
+    close(memory);
+    if (MAP_FAILED == mapping)
+    {
+        shm_unlink(name);
+        return false;
+    }
+
+    shared_snapshot = (SharedSnapshot_t *) mapping;
+    strncpy(shared_snapshot_name, name, sizeof(shared_snapshot_name) - 1);
+    shared_snapshot_name[sizeof(shared_snapshot_name) - 1] = '\0';
+    PublishSnapshot();
+    return true;
+}
+
+void NetStatistics::CloseSnapshot()
+{
+    if (nullptr != shared_snapshot)
+    {
+        munmap(shared_snapshot, sizeof(SharedSnapshot_t));
+        shm_unlink(shared_snapshot_name);
+        shared_snapshot = nullptr;
+    }
+}
+
+void NetStatistics::PublishSnapshot()
+{
+    if (nullptr == shared_snapshot)
+    {
+        return;
+    }
+
+    //aggregate first, so the snapshot is only inconsistent for the copy
+    Snapshot_t snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.magic = kSnapshotMagic;
+    snapshot.size = sizeof(Snapshot_t);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    snapshot.timestamp = (CipUlint) now.tv_sec * 1000000000ULL + (CipUlint) now.tv_nsec;
+
+    for (int i = 0; i < kNumberOfInterfaceCounters; i++)
+    {
+        snapshot.interface_counters[i] = ReadInterfaceCounter(i);
+    }
+    ReadMediaCounters(snapshot.media_counters);
+    for (int i = 0; i < OPENER_CIP_NUM_CONNECTIONS; i++)
+    {
+        GetEndpointCounters(kEndpointConnection, i, snapshot.connections[i]);
+    }
+    for (int i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++)
+    {
+        GetEndpointCounters(kEndpointSession, i, snapshot.sessions[i]);
+    }
+
+    CipUlint sequence = shared_snapshot->sequence.load(std::memory_order_relaxed);
+    shared_snapshot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&shared_snapshot->snapshot, &snapshot, sizeof(snapshot));
+    shared_snapshot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool NetStatistics::ReadSnapshot(const char * name, Snapshot_t * snapshot)
+{
+    int memory = shm_open(name, O_RDONLY, 0);
+    if (0 > memory)
+    {
+        return false;
+    }
+    void * mapping = mmap(nullptr, sizeof(SharedSnapshot_t), PROT_READ, MAP_SHARED, memory, 0);
+    close(memory);
+    if (MAP_FAILED == mapping)
+    {
+        return false;
+    }
+
+    const SharedSnapshot_t * shared = (const SharedSnapshot_t *) mapping;
+    bool consistent = false;
+    for (int attempt = 0; (attempt < 1000) && !consistent; attempt++)
+    {
+        CipUlint sequence = shared->sequence.load(std::memory_order_acquire);
+        if (0 != (sequence & 1))
+        {
+            continue;
+        }
+        memcpy(snapshot, &shared->snapshot, sizeof(*snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        consistent = (sequence == shared->sequence.load(std::memory_order_relaxed));
+    }
+    munmap(mapping, sizeof(SharedSnapshot_t));
+
+    return consistent && (kSnapshotMagic == snapshot->magic) && (sizeof(Snapshot_t) == snapshot->size);
+}
+
+void NetStatistics::Reset()
+{
+    for (int i = 0; i <= OPENER_STATISTICS_THREADS; i++)
+    {
+        memset((void *) &blocks[i], 0, sizeof(Block_t));
+    }
+    for (int i = 0; i < kNumberOfInterfaceCounters; i++)
+    {
+        interface_baseline[i].store(0, std::memory_order_relaxed);
+    }
+    ClearMediaCounters();
+}
@@ -0,0 +1,145 @@
+/*
+ * netstatistics.hpp
+ *
+ *  Interface, media, connection and session counters of the network handler
+ */
+
+#ifndef OPENER_UTILS_NETSTATISTICS_H_
+#define OPENER_UTILS_NETSTATISTICS_H_
+
+#include <atomic>
+#include <typedefs.hpp>
+#include "../opener_user_conf.hpp"
+
+/** @brief Network statistics, counted per thread and aggregated on read
+ *
+ *  Each counting thread owns a cache line aligned block of counters and is its
+ *  only writer, so counting is a relaxed load and store without any lock or
+ *  shared cache line. Readers sum up the blocks of all threads while they keep
+ *  counting. The blocks are taken from a static pool, see
+ *  OPENER_STATISTICS_THREADS.
+ *
+ *  The interface counters are the ones of the Ethernet Link object, counted at
+ *  the sockets of the stack. The media counters are read from the interface
+ *  statistics of the operating system. Both are cleared by remembering the
+ *  current values, the counting threads are not touched.
+ *
+ *  An external exporter reads a snapshot of all counters from shared memory,
+ *  published every OPENER_STATISTICS_SNAPSHOT_INTERVAL ms once OpenSnapshot()
+ *  has been called.
+ */
+class NetStatistics
+{
+public:
+    typedef enum
+    {
+        kInOctets = 0,
+        kInUcastPackets,
+        kInNucastPackets,
+        kInDiscards,
+        kInErrors,
+        kInUnknownProtos,
+        kOutOctets,
+        kOutUcastPackets,
+        kOutNucastPackets,
+        kOutDiscards,
+        kOutErrors,
+        kNumberOfInterfaceCounters
+    } InterfaceCounter_e;
+
+    typedef enum
+    {
+        kAlignmentErrors = 0,
+        kFcsErrors,
+        kSingleCollisions,
+        kMultipleCollisions,
+        kSqeTestErrors,
+        kDeferredTransmissions,
+        kLateCollisions,
+        kExcessiveCollisions,
+        kMacTransmitErrors,
+        kCarrierSenseErrors,
+        kFrameTooLong,
+        kMacReceiveErrors,
+        kNumberOfMediaCounters
+    } MediaCounter_e;
+
+    typedef enum
+    {
+        kEndpointConnection = 0, ///< indexed by connection record, id - 1
+        kEndpointSession,        ///< indexed by session, handle - 1
+        kNumberOfEndpoints
+    } Endpoint_e;
+
+    typedef enum
+    {
+        kPacketsIn = 0,
+        kOctetsIn,
+        kPacketsOut,
+        kOctetsOut,
+        kErrors,
+        kLatencySamples,
+        kLatencySum,     ///< ns, receive -> handled
+        kLatencyMax,     ///< ns
+        kNumberOfEndpointCounters
+    } EndpointCounter_e;
+
+    static const CipUdint kSnapshotMagic = 0x4E455453; //"STEN"
+
+    /** @brief Layout of the shared memory snapshot, exporters must be built with the same configuration */
+    typedef struct
+    {
+        CipUdint magic;
+        CipUdint size;            ///< sizeof(Snapshot_t)
+        CipUlint timestamp;       ///< ns since the epoch
+        CipUlint interface_counters[kNumberOfInterfaceCounters];
+        CipUlint media_counters[kNumberOfMediaCounters];
+        CipUlint connections[OPENER_CIP_NUM_CONNECTIONS][kNumberOfEndpointCounters];
+        CipUlint sessions[OPENER_NUMBER_OF_SUPPORTED_SESSIONS][kNumberOfEndpointCounters];
+    } Snapshot_t;
+
+    /** @brief Counts on an interface counter of the calling thread */
+    static void Count(InterfaceCounter_e counter, CipUlint value = 1);
+
+    /** @brief A packet of an endpoint has been received and handled
+     *  @param latency ns from receive to handled, 0 if unknown
+     */
+    static void CountReceived(Endpoint_e endpoint, int index, CipUdint octets, CipUlint latency);
+    static void CountSent(Endpoint_e endpoint, int index, CipUdint octets);
+    static void CountError(Endpoint_e endpoint, int index);
+
+    /** @brief Interface counters since the last clear, truncated to UDINT as on the wire
+     *
+     * @param clear the values read become the new baseline, nothing counted meanwhile is lost
+     */
+    static void GetInterfaceCounters(CipUdint counters[kNumberOfInterfaceCounters], bool clear = false);
+    static void ClearInterfaceCounters();
+
+    /** @brief Media counters of the interface holding the given IPv4 address (network order) */
+    static void SetInterfaceAddress(CipUdint ip_address);
+    static void GetMediaCounters(CipUdint counters[kNumberOfMediaCounters], bool clear = false);
+    static void ClearMediaCounters();
+
+    /** @brief Counters of an endpoint since start, all zero for an invalid index */
+    static void GetEndpointCounters(Endpoint_e endpoint, int index, CipUlint counters[kNumberOfEndpointCounters]);
+
+    /** @brief Creates the shared memory snapshot of the given name ("/opener_statistics") */
+    static bool OpenSnapshot(const char * name);
+    static void CloseSnapshot();
+
+    /** @brief Writes a fresh snapshot, a no-op unless one has been opened */
+    static void PublishSnapshot();
+
+    /** @brief Copies a consistent snapshot out of shared memory, for exporters */
+    static bool ReadSnapshot(const char * name, Snapshot_t * snapshot);
+
+    /** @brief Forgets all counts, only while no other thread counts */
+    static void Reset();
+
+private:
+    static CipUlint ReadInterfaceCounter(int counter);
+    static void ReadMediaCounters(CipUlint counters[kNumberOfMediaCounters]);
+    static void CountEndpoint(Endpoint_e endpoint, int index, EndpointCounter_e counter, CipUlint value);
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * staticmemory.cpp
+ *
+ *  Heap allocation guard of the static memory build profile
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include "staticmemory.hpp"
+#include "../trace.hpp"
+#include "../opener_user_conf.hpp"
+
+static std::atomic<bool> sealed(false);
+static std::atomic<CipUdint> sealed_allocations(0);
+
+void StaticMemory::Seal()
+{
+    sealed_allocations = 0;
+    sealed = true;
+}
+
+void StaticMemory::Unseal()
+{
+    sealed = false;
+}
+
+bool StaticMemory::IsSealed()
+{
+    return sealed;
+}
+
+CipUdint StaticMemory::GetSealedAllocations()
+{
+    return sealed_allocations;
+}
+
+void StaticMemory::NotifyAllocation(size_t size)
+{
+    //the size is only reported by the trap of the static memory profile
+    (void) size;
+    if (sealed)
+    {
+        sealed_allocations++;
+#ifdef OPENER_STATIC_MEMORY
+        OPENER_TRACE_ERR("static memory: heap allocation of %u bytes after init\n", (unsigned) size);
+        abort();
+#endif
+    }
+}
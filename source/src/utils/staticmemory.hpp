@@ -0,0 +1,39 @@
+/*
+ * staticmemory.hpp
+ *
+ *  Heap allocation guard of the static memory build profile
+ */
+
+#ifndef OPENER_UTILS_STATICMEMORY_H_
+#define OPENER_UTILS_STATICMEMORY_H_
+
+#include <cstddef>
+#include <typedefs.hpp>
+
+/** @brief Guards against heap allocations once the stack is initialized
+ *
+ *  Every pool is sized from opener_user_conf.hpp and allocated while the stack
+ *  initializes. The stack seals the heap when it is up. Only the static memory
+ *  profile (OPENER_STATIC_MEMORY) replaces the global operator new, see
+ *  heapguard.cpp, and an allocation after the seal traps there. Threads
+ *  allocate when they are created, so they have to be started before the seal.
+ */
+class StaticMemory
+{
+public:
+    /** @brief Start counting heap allocations, in the static memory profile they trap from now on */
+    static void Seal();
+
+    /** @brief Allow heap allocations again, e.g. to shut the stack down */
+    static void Unseal();
+
+    static bool IsSealed();
+
+    /** @brief Number of heap allocations made while the heap was sealed */
+    static CipUdint GetSealedAllocations();
+
+    /** @brief Called by the global operator new for every allocation, counts the allocations after the seal */
+    static void NotifyAllocation(size_t size);
+};
+
+#endif
@@ -0,0 +1,207 @@
+//
+// Tests of the utilities
+//
+
+#include "TEST_Utils.hpp"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "opener_user_conf.hpp"
+
+static std::vector<std::string> decode_lines()
+{
+    std::stringstream dump, text;
+    std::vector<std::string> lines;
+    TraceBuffer::Dump(dump);
+    if (!TraceBuffer::Decode(dump, text))
+        return lines;
+
+    std::string line;
+    while (std::getline(text, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// A record is rendered offline with the registered format and the recorded arguments
+bool test_trace_round_trip()
+{
+    CipUint format_id = TraceBuffer::RegisterFormat(OPENER_TRACE_LEVEL_WARNING, "src/cip/example.cpp", 42,
+                                                    "connection %d of %u: %s, 0x%04x %.2f %c%%\n");
+    TraceBuffer::Write(format_id, -5, 7u, "peer gone", (CipUint) 0xBEE, 1.5, 'Z');
+
+    std::vector<std::string> lines = decode_lines();
+    if (1 != lines.size())
+        return false;
+    return std::string::npos != lines[0].find("WARN  example.cpp:42 connection -5 of 7: peer gone, 0x0bee 1.50 Z%");
+}
+
+// The oldest records are overwritten. The slot of the oldest record of a full
+// ring is the next one written, a dump leaves it out.
+bool test_trace_ring_wraparound()
+{
+    TraceBuffer::Clear();
+    CipUint format_id = TraceBuffer::RegisterFormat(OPENER_TRACE_LEVEL_INFO, "wrap.cpp", 1, "record %u");
+    for (CipUdint i = 0; i < OPENER_TRACE_RING_RECORDS + 10; i++)
+    {
+        TraceBuffer::Write(format_id, i);
+    }
+
+    std::vector<std::string> lines = decode_lines();
+    return (OPENER_TRACE_RING_RECORDS - 1 == lines.size())
+           && (std::string::npos != lines.front().find("record 11"))
+           && (std::string::npos != lines.back().find("record " + std::to_string(OPENER_TRACE_RING_RECORDS + 9)));
+}
+
+// Threads beyond the ring pool trace nothing, their records are counted as dropped
+bool test_trace_threads()
+{
+    TraceBuffer::Clear();
+    CipUint format_id = TraceBuffer::RegisterFormat(OPENER_TRACE_LEVEL_STATE, "thread.cpp", 1, "thread %d");
+
+    //the main thread holds a ring already
+    for (int i = 0; i < OPENER_TRACE_THREADS; i++)
+    {
+        std::thread tracer([format_id, i]() { TraceBuffer::Write(format_id, i); });
+        tracer.join();
+    }
+
+    std::vector<std::string> lines = decode_lines();
+    return (OPENER_TRACE_THREADS == lines.size()) && (1 == TraceBuffer::GetDroppedRecords())
+           && (std::string::npos != lines.back().find("1 trace records dropped"));
+}
+
+bool test_trace_level_mask()
+{
+    CipUsint mask = TraceBuffer::GetLevelMask();
+    if (!TraceBuffer::IsLevelEnabled(OPENER_TRACE_LEVEL_ERROR) || TraceBuffer::IsLevelEnabled(OPENER_TRACE_LEVEL_INFO))
+        return false;
+
+    TraceBuffer::SetLevelMask(OPENER_TRACE_LEVEL_INFO);
+    bool switched = TraceBuffer::IsLevelEnabled(OPENER_TRACE_LEVEL_INFO)
+                    && !TraceBuffer::IsLevelEnabled(OPENER_TRACE_LEVEL_ERROR);
+    TraceBuffer::SetLevelMask(mask);
+    return switched;
+}
+
+// Counts of all threads are summed up, including the threads sharing the last block
+bool test_statistics_threads()
+{
+    NetStatistics::Reset();
+    std::vector<std::thread> counters;
+    for (int i = 0; i < OPENER_STATISTICS_THREADS + 2; i++)
+    {
+        counters.emplace_back([]() {
+            for (int packet = 0; packet < 1000; packet++)
+            {
+                NetStatistics::Count(NetStatistics::kInOctets, 100);
+                NetStatistics::CountReceived(NetStatistics::kEndpointConnection, 0, 100, packet + 1);
+            }
+        });
+    }
+    for (std::thread & counter : counters)
+    {
+        counter.join();
+    }
+
+    CipUdint interface_counters[NetStatistics::kNumberOfInterfaceCounters];
+    NetStatistics::GetInterfaceCounters(interface_counters);
+    CipUlint connection[NetStatistics::kNumberOfEndpointCounters];
+    NetStatistics::GetEndpointCounters(NetStatistics::kEndpointConnection, 0, connection);
+
+    CipUlint packets = 1000 * (OPENER_STATISTICS_THREADS + 2);
+    if ((100 * packets != interface_counters[NetStatistics::kInOctets]) || (packets != connection[NetStatistics::kPacketsIn])
+        || (packets != connection[NetStatistics::kLatencySamples]) || (1000 != connection[NetStatistics::kLatencyMax]))
+        return false;
+
+    //clearing keeps counting
+    NetStatistics::ClearInterfaceCounters();
+    NetStatistics::Count(NetStatistics::kInOctets, 1);
+    NetStatistics::GetInterfaceCounters(interface_counters, true);
+    if (1 != interface_counters[NetStatistics::kInOctets])
+        return false;
+
+    //a get and clear starts again from the values it returned
+    NetStatistics::Count(NetStatistics::kInOctets, 2);
+    NetStatistics::GetInterfaceCounters(interface_counters);
+    NetStatistics::GetEndpointCounters(NetStatistics::kEndpointSession, OPENER_NUMBER_OF_SUPPORTED_SESSIONS, connection);
+    return (2 == interface_counters[NetStatistics::kInOctets]) && (0 == connection[NetStatistics::kPacketsIn]);
+}
+
+// An exporter reads the counters from shared memory
+bool test_statistics_snapshot()
+{
+    const char * name = "/opener_test_statistics";
+    NetStatistics::Reset();
+    NetStatistics::CountSent(NetStatistics::kEndpointSession, 2, 64);
+    if (!NetStatistics::OpenSnapshot(name))
+        return false;
+
+    NetStatistics::Count(NetStatistics::kOutErrors, 3);
+    NetStatistics::PublishSnapshot();
+
+    NetStatistics::Snapshot_t snapshot;
+    bool read = NetStatistics::ReadSnapshot(name, &snapshot);
+    NetStatistics::CloseSnapshot();
+
+    return read && (3 == snapshot.interface_counters[NetStatistics::kOutErrors])
+           && (64 == snapshot.sessions[2][NetStatistics::kOctetsOut]) && (0 != snapshot.timestamp)
+           && !NetStatistics::ReadSnapshot(name, &snapshot);
+}
+
+// Percentiles are accurate to a bucket, 1/32 of the value
+bool test_latency_histogram()
+{
+    LatencyHistogram histogram;
+    for (CipUlint value = 1; value <= 1000; value++)
+    {
+        histogram.Record(value * 1000);
+    }
+
+    if ((1000 != histogram.GetCount()) || (1000 != histogram.GetMin()) || (1000000 != histogram.GetMax())
+        || (500500.0 != histogram.GetMean()))
+        return false;
+
+    CipUlint p50 = histogram.GetPercentile(50.0);
+    CipUlint p99 = histogram.GetPercentile(99.0);
+    if ((p50 < 500000) || (p50 > 500000 + 500000 / 32) || (p99 < 990000) || (p99 > 990000 + 990000 / 32)
+        || (histogram.GetMax() != histogram.GetPercentile(100.0)))
+        return false;
+
+    //uniform over 0..1000 us
+    double deviation = histogram.GetStandardDeviation();
+    if ((deviation < 280000.0) || (deviation > 297000.0))
+        return false;
+
+    histogram.Reset();
+    return (0 == histogram.GetCount()) && (0 == histogram.GetPercentile(50.0));
+}
+
+int main()
+{
+    if ( !test_trace_level_mask() )
+        return -1;
+
+    if ( !test_trace_round_trip() )
+        return -1;
+
+    if ( !test_trace_ring_wraparound() )
+        return -1;
+
+    if ( !test_trace_threads() )
+        return -1;
+
+    if ( !test_statistics_threads() )
+        return -1;
+
+    if ( !test_statistics_snapshot() )
+        return -1;
+
+    if ( !test_latency_histogram() )
+        return -1;
+
+    return 0;
+}
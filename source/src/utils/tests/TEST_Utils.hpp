@@ -0,0 +1,13 @@
+//
+// Tests of the utilities
+//
+
+#ifndef OPENERMAIN_TEST_UTILS_H
+#define OPENERMAIN_TEST_UTILS_H
+
+#include "utils/tracebuffer.hpp"
+#include "utils/netstatistics.hpp"
+#include "utils/iolatency.hpp"
+#include "trace.hpp"
+
+#endif //OPENERMAIN_TEST_UTILS_H
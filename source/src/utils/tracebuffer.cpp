@@ -0,0 +1,469 @@
+/*
+ * tracebuffer.cpp
+ *
+ *  Binary trace rings behind the OPENER_TRACE_* macros
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "tracebuffer.hpp"
+#include "../trace.hpp"
+#include "../opener_user_conf.hpp"
+
+namespace
+{
+    const char kDumpMagic[8] = { 'O', 'p', 'E', 'N', 'e', 'r', 'T', '1' };
+    const CipUint kEndOfRecords = 0xFFFF;
+    const size_t kRecordDataSize = sizeof(((TraceBuffer::Record_t *) nullptr)->data);
+
+    typedef struct
+    {
+        std::atomic<bool> registered;
+        CipUsint level;
+        int line;
+        const char * file;
+        const char * format;
+    } Format_t;
+
+    /* The owning thread is the only writer. head counts the records ever
+     * written, record i is in slot i % OPENER_TRACE_RING_RECORDS. A reader
+     * copies a record and checks with head afterwards whether the writer may
+     * have overwritten it meanwhile, seqlock style. */
+    typedef struct
+    {
+        std::atomic<CipUlint> head;
+        TraceBuffer::Record_t records[OPENER_TRACE_RING_RECORDS];
+    } Ring_t;
+
+    Format_t formats[OPENER_TRACE_FORMATS];
+    std::atomic<CipUint> format_count(0);
+
+    Ring_t rings[OPENER_TRACE_THREADS];
+    std::atomic<CipUint> attached_rings(0);
+    std::atomic<CipUdint> dropped_records(0);
+
+    thread_local Ring_t * thread_ring = nullptr;
+    thread_local bool thread_attached = false;
+
+    template<typename T>
+    void WriteValue(std::ostream & stream, T value)
+    {
+        stream.write((const char *) &value, sizeof(value));
+    }
+
+    template<typename T>
+    bool ReadValue(std::istream & stream, T * value)
+    {
+        return (bool) stream.read((char *) value, sizeof(*value));
+    }
+
+    void WriteString(std::ostream & stream, const char * string)
+    {
+        CipUint length = (CipUint) strlen(string);
+        WriteValue(stream, length);
+        stream.write(string, length);
+    }
+
+    bool ReadString(std::istream & stream, std::string * string)
+    {
+        CipUint length;
+        if (!ReadValue(stream, &length))
+        {
+            return false;
+        }
+        string->resize(length);
+        return (0 == length) || (bool) stream.read(&(*string)[0], length);
+    }
+}
+
+std::atomic<CipUsint> TraceBuffer::level_mask(OPENER_TRACE_LEVEL_ERROR | OPENER_TRACE_LEVEL_WARNING);
+
+CipUint TraceBuffer::RegisterFormat(CipUsint level, const char * file, int line, const char * format)
+{
+    CipUint id = format_count.fetch_add(1, std::memory_order_relaxed);
+    if (id >= OPENER_TRACE_FORMATS)
+    {
+        format_count.store(OPENER_TRACE_FORMATS, std::memory_order_relaxed);
+        return kInvalidFormat;
+    }
+
+    formats[id].level = level;
+    formats[id].file = file;
+    formats[id].line = line;
+    formats[id].format = format;
+    formats[id].registered.store(true, std::memory_order_release);
+    return id;
+}
+
+void TraceBuffer::SetLevelMask(CipUsint mask)
+{
+    level_mask.store(mask, std::memory_order_relaxed);
+}
+
+CipUsint TraceBuffer::GetLevelMask()
+{
+    return level_mask.load(std::memory_order_relaxed);
+}
+
+TraceBuffer::Record_t * TraceBuffer::BeginRecord(CipUint format_id)
+{
+    if (!thread_attached)
+    {
+        thread_attached = true;
+        CipUint ring = attached_rings.fetch_add(1, std::memory_order_relaxed);
+        thread_ring = (ring < OPENER_TRACE_THREADS) ? &rings[ring] : nullptr;
+    }
+    if ((nullptr == thread_ring) || (kInvalidFormat == format_id))
+    {
+        dropped_records.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    //readers that see any of the new record also see that its slot is being written
+    std::atomic_thread_fence(std::memory_order_release);
+
+    CipUlint head = thread_ring->head.load(std::memory_order_relaxed);
+    Record_t * record = &thread_ring->records[head % OPENER_TRACE_RING_RECORDS];
+    record->timestamp = (CipUlint) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    record->format_id = format_id;
+    record->argument_count = 0;
+    record->length = 0;
+    return record;
+}
+
+void TraceBuffer::EndRecord()
+{
+    thread_ring->head.store(thread_ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void TraceBuffer::PutScalar(Record_t * record, ArgumentType_e type, CipUlint value)
+{
+    if (record->length + 1 + sizeof(value) > kRecordDataSize)
+    {
+        return;
+    }
+    record->data[record->length] = (CipUsint) type;
+    memcpy(&record->data[record->length + 1], &value, sizeof(value));
+    record->length = (CipUsint) (record->length + 1 + sizeof(value));
+    record->argument_count++;
+}
+
+void TraceBuffer::PutArgument(Record_t * record, double value)
+{
+    CipUlint bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutScalar(record, kArgumentDouble, bits);
+}
+
+void TraceBuffer::PutArgument(Record_t * record, const void * value)
+{
+    PutScalar(record, kArgumentPointer, (CipUlint) (uintptr_t) value);
+}
+
+void TraceBuffer::PutArgument(Record_t * record, const char * value)
+{
+    if ((size_t) record->length + 2 > kRecordDataSize)
+    {
+        return;
+    }
+    if (nullptr == value)
+    {
+        value = "(null)";
+    }
+
+    //strings are copied as far as they fit, longer ones are cut
+    size_t length = strlen(value);
+    length = std::min(length, std::min((size_t) 255, kRecordDataSize - record->length - 2));
+    record->data[record->length] = (CipUsint) kArgumentString;
+    record->data[record->length + 1] = (CipUsint) length;
+    memcpy(&record->data[record->length + 2], value, length);
+    record->length = (CipUsint) (record->length + 2 + length);
+    record->argument_count++;
+}
+
+CipUdint TraceBuffer::GetDroppedRecords()
+{
+    return dropped_records.load(std::memory_order_relaxed);
+}
+
+void TraceBuffer::Clear()
+{
+    //a ring is only cleared as a whole, its owner may be writing
+    for (CipUint i = 0; i < OPENER_TRACE_THREADS; i++)
+    {
+        for (CipUdint j = 0; j < OPENER_TRACE_RING_RECORDS; j++)
+        {
+            rings[i].records[j].format_id = kInvalidFormat;
+        }
+    }
+    dropped_records.store(0, std::memory_order_relaxed);
+}
+
+void TraceBuffer::Dump(std::ostream & stream)
+{
+    stream.write(kDumpMagic, sizeof(kDumpMagic));
+    WriteValue(stream, GetDroppedRecords());
+
+    CipUint registered = 0;
+    CipUint count = std::min(format_count.load(std::memory_order_relaxed), (CipUint) OPENER_TRACE_FORMATS);
+    for (CipUint id = 0; id < count; id++)
+    {
+        registered += formats[id].registered.load(std::memory_order_acquire) ? 1 : 0;
+    }
+    WriteValue(stream, registered);
+    for (CipUint id = 0; (id < count) && (0 < registered); id++)
+    {
+        if (formats[id].registered.load(std::memory_order_acquire))
+        {
+            WriteValue(stream, id);
+            WriteValue(stream, formats[id].level);
+            WriteValue(stream, (CipDint) formats[id].line);
+            WriteString(stream, formats[id].file);
+            WriteString(stream, formats[id].format);
+            registered--;
+        }
+    }
+
+    CipUint ring_count = std::min(attached_rings.load(std::memory_order_relaxed), (CipUint) OPENER_TRACE_THREADS);
+    for (CipUint ring = 0; ring < ring_count; ring++)
+    {
+        CipUlint head = rings[ring].head.load(std::memory_order_acquire);
+        CipUlint first = (head > OPENER_TRACE_RING_RECORDS) ? head - OPENER_TRACE_RING_RECORDS : 0;
+        for (CipUlint i = first; i < head; i++)
+        {
+            Record_t record = rings[ring].records[i % OPENER_TRACE_RING_RECORDS];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            //skip the record if the writer may be writing its slot, the slot after the newest record
+            if ((i + OPENER_TRACE_RING_RECORDS > rings[ring].head.load(std::memory_order_relaxed))
+                && (kInvalidFormat != record.format_id))
+            {
+                WriteValue(stream, ring);
+                stream.write((const char *) &record, sizeof(record));
+            }
+        }
+    }
+    WriteValue(stream, kEndOfRecords);
+}
+
+namespace
+{
+    typedef struct
+    {
+        CipUsint level;
+        CipDint line;
+        std::string file;
+        std::string format;
+    } DecodedFormat_t;
+
+    typedef struct
+    {
+        CipUint ring;
+        TraceBuffer::Record_t record;
+    } DecodedRecord_t;
+
+    const char * LevelName(CipUsint level)
+    {
+        switch (level)
+        {
+            case OPENER_TRACE_LEVEL_ERROR: return "ERR  ";
+            case OPENER_TRACE_LEVEL_WARNING: return "WARN ";
+            case OPENER_TRACE_LEVEL_STATE: return "STATE";
+            case OPENER_TRACE_LEVEL_INFO: return "INFO ";
+            default: return "?    ";
+        }
+    }
+
+    // Renders a record with its format, printf conversions are fed from the recorded arguments
+    std::string Render(const std::string & format, const TraceBuffer::Record_t & record)
+    {
+        std::string text;
+        char buffer[512];
+        CipUsint offset = 0;
+        CipUsint arguments_left = record.argument_count;
+
+        for (size_t i = 0; i < format.size(); i++)
+        {
+            if (('%' != format[i]) || (i + 1 == format.size()))
+            {
+                text += format[i];
+                continue;
+            }
+            if ('%' == format[++i])
+            {
+                text += '%';
+                continue;
+            }
+
+            //flags, width and precision are kept, length modifiers are replaced to fit the recorded width
+            std::string spec = "%";
+            while ((i < format.size()) && strchr("-+ #0123456789.", format[i]))
+            {
+                spec += format[i++];
+            }
+            while ((i < format.size()) && strchr("hljztL", format[i]))
+            {
+                i++;
+            }
+            if (i == format.size())
+            {
+                break;
+            }
+            char conversion = format[i];
+
+            if (0 == arguments_left)
+            {
+                text += "<?>";
+                continue;
+            }
+            if (offset >= record.length)
+            {
+                break;
+            }
+            arguments_left--;
+            CipUsint type = record.data[offset];
+
+            if (TraceBuffer::kArgumentString == type)
+            {
+                CipUsint length = record.data[offset + 1];
+                std::string value((const char *) &record.data[offset + 2], length);
+                offset = (CipUsint) (offset + 2 + length);
+                snprintf(buffer, sizeof(buffer), ('s' == conversion) ? (spec + "s").c_str() : "<%s>", value.c_str());
+                text += buffer;
+                continue;
+            }
+
+            CipUlint value;
+            memcpy(&value, &record.data[offset + 1], sizeof(value));
+            offset = (CipUsint) (offset + 1 + sizeof(value));
+            double real;
+            memcpy(&real, &value, sizeof(real));
+
+            switch (conversion)
+            {
+                case 'd':
+                case 'i':
+                    snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(),
+                             (TraceBuffer::kArgumentDouble == type) ? (long long) real : (long long) value);
+                    break;
+                case 'u':
+                case 'o':
+                case 'x':
+                case 'X':
+                    snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(),
+                             (TraceBuffer::kArgumentDouble == type) ? (unsigned long long) real : (unsigned long long) value);
+                    break;
+                case 'c':
+                    snprintf(buffer, sizeof(buffer), (spec + "c").c_str(), (int) value);
+                    break;
+                case 'e':
+                case 'E':
+                case 'f':
+                case 'F':
+                case 'g':
+                case 'G':
+                case 'a':
+                case 'A':
+                    snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(),
+                             (TraceBuffer::kArgumentDouble == type) ? real
+                             : (TraceBuffer::kArgumentSigned == type) ? (double) (CipLint) value : (double) value);
+                    break;
+                case 'p':
+                    snprintf(buffer, sizeof(buffer), "0x%llx", (unsigned long long) value);
+                    break;
+                default:
+                    snprintf(buffer, sizeof(buffer), "<%%%c>", conversion);
+                    break;
+            }
+            text += buffer;
+        }
+
+        while (!text.empty() && ('\n' == text[text.size() - 1]))
+        {
+            text.erase(text.size() - 1);
+        }
+        return text;
+    }
+}
+
+bool TraceBuffer::Decode(std::istream & dump, std::ostream & text)
+{
+    char magic[sizeof(kDumpMagic)];
+    CipUdint dropped;
+    CipUint count;
+    if (!dump.read(magic, sizeof(magic)) || (0 != memcmp(magic, kDumpMagic, sizeof(magic)))
+        || !ReadValue(dump, &dropped) || !ReadValue(dump, &count))
+    {
+        return false;
+    }
+
+    std::map<CipUint, DecodedFormat_t> decoded_formats;
+    for (CipUint i = 0; i < count; i++)
+    {
+        CipUint id;
+        DecodedFormat_t format;
+        if (!ReadValue(dump, &id) || !ReadValue(dump, &format.level) || !ReadValue(dump, &format.line)
+            || !ReadString(dump, &format.file) || !ReadString(dump, &format.format))
+        {
+            return false;
+        }
+        size_t separator = format.file.find_last_of("/\\");
+        if (std::string::npos != separator)
+        {
+            format.file.erase(0, separator + 1);
+        }
+        decoded_formats[id] = format;
+    }
+
+    std::vector<DecodedRecord_t> records;
+    for (;;)
+    {
+        DecodedRecord_t record;
+        if (!ReadValue(dump, &record.ring))
+        {
+            return false;
+        }
+        if (kEndOfRecords == record.ring)
+        {
+            break;
+        }
+        if (!ReadValue(dump, &record.record))
+        {
+            return false;
+        }
+        records.push_back(record);
+    }
+    std::stable_sort(records.begin(), records.end(), [](const DecodedRecord_t & a, const DecodedRecord_t & b)
+    {
+        return a.record.timestamp < b.record.timestamp;
+    });
+
+    char prefix[64];
+    CipUlint start = records.empty() ? 0 : records[0].record.timestamp;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const DecodedRecord_t & record = records[i];
+        CipUlint elapsed = record.record.timestamp - start;
+        snprintf(prefix, sizeof(prefix), "[%6llu.%06llu] T%u ", (unsigned long long) (elapsed / 1000000000ULL),
+                 (unsigned long long) (elapsed % 1000000000ULL / 1000ULL), (unsigned int) record.ring);
+
+        std::map<CipUint, DecodedFormat_t>::const_iterator format = decoded_formats.find(record.record.format_id);
+        if (decoded_formats.end() == format)
+        {
+            text << prefix << "?     unknown trace point " << record.record.format_id << std::endl;
+            continue;
+        }
+        text << prefix << LevelName(format->second.level) << " " << format->second.file << ":" << format->second.line
+             << " " << Render(format->second.format, record.record) << std::endl;
+    }
+    if (0 != dropped)
+    {
+        text << dropped << " trace records dropped, no free trace ring for their thread" << std::endl;
+    }
+    return true;
+}
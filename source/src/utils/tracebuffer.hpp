@@ -0,0 +1,110 @@
+/*
+ * tracebuffer.hpp
+ *
+ *  Binary trace rings behind the OPENER_TRACE_* macros
+ */
+
+#ifndef OPENER_UTILS_TRACEBUFFER_H_
+#define OPENER_UTILS_TRACEBUFFER_H_
+
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <typedefs.hpp>
+
+/** @brief Lock-free per-thread rings of binary trace records
+ *
+ *  A trace point registers its format string once and then only writes a
+ *  record of the timestamp, the format id and its arguments into the ring of
+ *  the calling thread: no formatting, no locks, no system calls. Each thread
+ *  is the only writer of its ring, the oldest records are overwritten. The
+ *  rings are taken from a static pool, see OPENER_TRACE_THREADS.
+ *
+ *  Dump() writes the format table and all records in a binary form that
+ *  Decode() (or the trace_decode tool) turns into text offline.
+ */
+class TraceBuffer
+{
+public:
+    static const CipUsint kRecordSize = 128;
+    static const CipUint kInvalidFormat = 0xFFFF;
+
+    typedef enum
+    {
+        kArgumentSigned = 1,
+        kArgumentUnsigned,
+        kArgumentDouble,
+        kArgumentPointer,
+        kArgumentString  ///< length byte and the characters, without terminator
+    } ArgumentType_e;
+
+    typedef struct
+    {
+        CipUlint timestamp; ///< ns of a monotonic clock
+        CipUint format_id;
+        CipUsint argument_count;
+        CipUsint length;    ///< bytes of data used
+        CipUdint reserved;
+        CipUsint data[kRecordSize - 16]; ///< per argument a type tag and its value
+    } Record_t;
+
+    /** @brief Registers a trace point, called once per trace point
+     *  @return the format id, kInvalidFormat if the format table is full
+     */
+    static CipUint RegisterFormat(CipUsint level, const char * file, int line, const char * format);
+
+    /** @brief Levels traced at runtime, a subset of the levels compiled in (OPENER_TRACE_LEVEL) */
+    static void SetLevelMask(CipUsint mask);
+    static CipUsint GetLevelMask();
+    static bool IsLevelEnabled(CipUsint level)
+    {
+        return 0 != (level_mask.load(std::memory_order_relaxed) & level);
+    }
+
+    /** @brief Writes a record into the ring of the calling thread */
+    template<typename... Args>
+    static void Write(CipUint format_id, Args... args)
+    {
+        Record_t * record = BeginRecord(format_id);
+        if (nullptr != record)
+        {
+            int unused[] = { 0, (PutArgument(record, args), 0)... };
+            (void) unused;
+            EndRecord();
+        }
+    }
+
+    /** @brief Trace points not recorded because their thread got no ring */
+    static CipUdint GetDroppedRecords();
+
+    /** @brief Forgets all records, the rings stay with their threads */
+    static void Clear();
+
+    /** @brief Writes the format table and the records of all rings, may run while other threads trace */
+    static void Dump(std::ostream & stream);
+
+    /** @brief Renders a dump as text, one line per record in timestamp order
+     *  @return false if the dump is malformed
+     */
+    static bool Decode(std::istream & dump, std::ostream & text);
+
+private:
+    static Record_t * BeginRecord(CipUint format_id);
+    static void EndRecord();
+
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    PutArgument(Record_t * record, T value)
+    {
+        PutScalar(record, std::is_signed<T>::value ? kArgumentSigned : kArgumentUnsigned, (CipUlint) value);
+    }
+    static void PutArgument(Record_t * record, double value);
+    static void PutArgument(Record_t * record, const char * value);
+    static void PutArgument(Record_t * record, const void * value);
+    static void PutScalar(Record_t * record, ArgumentType_e type, CipUlint value);
+
+    static std::atomic<CipUsint> level_mask;
+};
+
+#endif
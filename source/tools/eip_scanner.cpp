@@ -0,0 +1,886 @@
+//
+// Loopback EtherNet/IP scanner simulator and load generator
+//
+// N scanners run concurrently against one adapter, each on its own TCP
+// connection: RegisterSession, Large_Forward_Open of input only class 1
+// connections with a multicast T->O connection at the requested RPI, then a
+// flood of unconnected Get_Attribute_Single requests until the run ends.
+// Multicast listeners join the T->O group meanwhile and count the produced
+// frames. Throughput, latency percentiles and packet loss are reported.
+//
+// With -o the first connection of scanner 0 is an exclusive owner instead:
+// O->T frames are sent point to point at the RPI for the whole run.
+//
+// With -a the adapter is hosted by the tool itself, the stack is initialized
+// in process and driven by its own thread on the scanned address. Everything
+// stays on 127.0.0.1 by default. Adding -L enables the I/O latency probes of
+// the hosted adapter, which publishes new input data every RPI, and dumps them
+// at the end of the run or on SIGUSR1. With -T the trace rings of a stack
+// built with OpENer_TRACES are dumped into a file for trace_decode. With -S
+// the network statistics of the hosted adapter are published in shared memory
+// for stats_export while the run lasts. With -b the hosted adapter runs on the
+// given network backend, so the backends can be compared on the same load.
+// With -w the O->T frames of the hosted adapter are received by that many I/O
+// shards instead of its network handler thread. With -x its SendRRData requests
+// are executed by that many explicit message workers. With -v the hosted stack
+// runs that many virtual adapters on the addresses following the scanned one,
+// scanner i connects to the adapter i modulo their number.
+//
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "cip/CIP_Common.hpp"
+#include "cip/CIP_AppConnType.hpp"
+#include "cip/CIP_Objects/CIP_0004_Assembly/CIP_Assembly.hpp"
+#include "cip/CIP_Objects/CIP_00F5_TCPIP_Interface/CIP_TCPIP_Interface.hpp"
+#include "cip/connection/CIP_CommonPacket.hpp"
+#include "cip/connection/network/NET_NetworkHandler.hpp"
+#include "cip/connection/network/NET_IoBackend.hpp"
+#include "cip/connection/network/NET_IoShards.hpp"
+#include "cip/connection/network/NET_ExplicitWorkers.hpp"
+#include "cip/connection/network/NET_VirtualAdapters.hpp"
+#include "cip/connection/network/ethIP/NET_EthIP_Encap.hpp"
+#include "utils/iolatency.hpp"
+#include "utils/tracebuffer.hpp"
+#include "utils/netstatistics.hpp"
+#include "trace.hpp"
+
+#define ENCAPSULATION_PORT 0xAF12
+#define IO_PORT 0x08AE
+#define DEFAULT_MULTICAST_GROUP "239.192.1.0"
+#define ORIGINATOR_VENDOR_ID 0x1234
+#define ORIGINATOR_SERIAL_NUMBER 0x5CA00000
+#define FRAME_BUFFER_SIZE 4096
+
+#define COMMAND_REGISTER_SESSION 0x65
+#define COMMAND_UNREGISTER_SESSION 0x66
+#define COMMAND_SEND_RR_DATA 0x6F
+#define SERVICE_GET_ATTRIBUTE_SINGLE 0x0E
+#define SERVICE_FORWARD_CLOSE 0x4E
+#define SERVICE_LARGE_FORWARD_OPEN 0x5B
+#define ITEM_SEQUENCED_ADDRESS 0x8002
+#define ITEM_SOCKADDR_INFO_T_TO_O 0x8001
+
+//SendRRData reply: encapsulation header, command specific data, null address and data item headers
+#define REPLY_ITEM_COUNT_OFFSET (ENCAPSULATION_HEADER_LENGTH + 6)
+#define REPLY_GENERAL_STATUS_OFFSET (ENCAPSULATION_HEADER_LENGTH + 18)
+#define REPLY_DATA_OFFSET (ENCAPSULATION_HEADER_LENGTH + 20)
+
+typedef struct
+{
+    const char * host;
+    const char * trace_file;
+    const char * statistics_snapshot;
+    const char * backend;
+    int shards;
+    int workers;
+    int adapters;
+    int scanners;
+    int seconds;
+    int io_connections;
+    int rpi_ms;
+    int listeners;
+    int class_id;
+    int instance_id;
+    int attribute_id;
+    int input_assembly;
+    int config_assembly;
+    int output_assembly;
+    int input_size;
+    bool host_adapter;
+    bool exclusive_owner;
+    bool measure_latency;
+} Options_t;
+
+typedef struct
+{
+    std::vector<MicroSeconds> request_latencies;
+    std::vector<MicroSeconds> setup_latencies;
+    CipUdint failed_requests;
+    CipUdint opened_connections;
+    CipUdint failed_connections;
+    CipUdint sent_frames;
+    in_addr_t multicast_group;
+    bool connected;
+} ScannerResult_t;
+
+typedef struct
+{
+    CipUdint first_sequence;
+    CipUdint last_sequence;
+    CipUdint received;
+    MicroSeconds first_time;
+    MicroSeconds last_time;
+} Stream_t;
+
+typedef struct
+{
+    std::map<CipUdint, Stream_t> streams;
+    bool joined;
+} ListenerResult_t;
+
+enum
+{
+    kPhaseSetup = 0,
+    kPhaseRun = 1,
+    kPhaseClose = 2
+};
+
+static std::atomic<int> phase(kPhaseSetup);
+static std::atomic<int> scanners_ready(0);
+static std::atomic<bool> adapter_running(false);
+static std::atomic<bool> dump_requested(false);
+
+static void put_uint(CipUsint *& message, CipUint value)
+{
+    *message++ = (CipUsint) (value & 0xFF);
+    *message++ = (CipUsint) (value >> 8);
+}
+
+static void put_udint(CipUsint *& message, CipUdint value)
+{
+    put_uint(message, (CipUint) (value & 0xFFFF));
+    put_uint(message, (CipUint) (value >> 16));
+}
+
+static CipUint get_uint(const CipUsint * message)
+{
+    return (CipUint) (message[0] | (message[1] << 8));
+}
+
+static CipUdint get_udint(const CipUsint * message)
+{
+    return (CipUdint) get_uint(message) | ((CipUdint) get_uint(message + 2) << 16);
+}
+
+// Encapsulation header in front of data_length bytes of command data
+static CipUsint * put_encapsulation_header(CipUsint * frame, CipUint command, CipUdint session_handle, CipUint data_length)
+{
+    CipUsint *message = frame;
+    put_uint(message, command);
+    put_uint(message, data_length);
+    put_udint(message, session_handle);
+    put_udint(message, 0);                     // status
+    memset(message, 0, 12);                    // sender context and options
+    return message + 12;
+}
+
+// SendRRData with an unconnected request, the path is given in words
+static CipUint build_rr_data_frame(CipUsint * frame, CipUdint session_handle, CipUsint service,
+                                   const CipUsint * path, CipUsint path_words,
+                                   const CipUsint * request_data, CipUint request_data_length)
+{
+    CipUint request_length = (CipUint) (2 + 2 * path_words + request_data_length);
+    CipUsint *message = put_encapsulation_header(frame, COMMAND_SEND_RR_DATA, session_handle, (CipUint) (16 + request_length));
+    put_udint(message, 0);                     // interface handle
+    put_uint(message, 0);                      // timeout
+    put_uint(message, 2);
+    put_uint(message, CIP_CommonPacket::kCipItemIdNullAddress);
+    put_uint(message, 0);
+    put_uint(message, CIP_CommonPacket::kCipItemIdUnconnectedDataItem);
+    put_uint(message, request_length);
+    *message++ = service;
+    *message++ = path_words;
+    memcpy(message, path, 2 * path_words);
+    message += 2 * path_words;
+    memcpy(message, request_data, request_data_length);
+    return (CipUint) (ENCAPSULATION_HEADER_LENGTH + 16 + request_length);
+}
+
+// Large_Forward_Open of an input only connection: null O->T, multicast T->O.
+// An exclusive owner connection has a point to point O->T connection with a
+// run/idle header on the output assembly, which is as large as the input assembly.
+static CipUint build_forward_open_frame(CipUsint * frame, CipUdint session_handle, CipUint serial,
+                                        CipUdint originator_serial, bool exclusive_owner, const Options_t * options)
+{
+    static const CipUsint connection_manager_path[] = { 0x20, 0x06, 0x24, 0x01 };
+    CipUsint request[64];
+    CipUsint *message = request;
+    CipUdint rpi = (CipUdint) options->rpi_ms * 1000;
+
+    *message++ = 0x0A;                         // priority/time tick
+    *message++ = 0x0E;                         // timeout ticks
+    put_udint(message, 0);                     // O->T id, chosen by the target
+    put_udint(message, 0);                     // T->O id, chosen by the target
+    put_uint(message, serial);
+    put_uint(message, ORIGINATOR_VENDOR_ID);
+    put_udint(message, originator_serial);
+    *message++ = 2;                            // timeout multiplier
+    memset(message, 0, 3);
+    message += 3;
+    put_udint(message, rpi);                   // O->T RPI
+    if (exclusive_owner)                       // sequence count, run/idle header and data
+        put_udint(message, ((CipUdint) CIP_ConnectionManager::kRoutingTypePointToPointConnection << 16)
+                           | (CipUdint) (options->input_size + 6));
+    else
+        put_udint(message, 0);                 // null O->T connection
+    put_udint(message, rpi);                   // T->O RPI
+    put_udint(message, ((CipUdint) CIP_ConnectionManager::kRoutingTypeMulticastConnection << 16)
+                       | (CipUdint) (options->input_size + 2));
+    *message++ = 0x01;                         // cyclic, class 1
+    *message++ = exclusive_owner ? 4 : 3;      // path size in words
+    *message++ = 0x20;                         // assembly class
+    *message++ = 0x04;
+    *message++ = 0x24;                         // configuration instance
+    *message++ = (CipUsint) options->config_assembly;
+    if (exclusive_owner)
+    {
+        *message++ = 0x2C;                     // consumed connection point
+        *message++ = (CipUsint) options->output_assembly;
+    }
+    *message++ = 0x2C;                         // produced connection point
+    *message++ = (CipUsint) options->input_assembly;
+
+    return build_rr_data_frame(frame, session_handle, SERVICE_LARGE_FORWARD_OPEN, connection_manager_path, 2,
+                               request, (CipUint) (message - request));
+}
+
+static CipUint build_forward_close_frame(CipUsint * frame, CipUdint session_handle, CipUint serial,
+                                         CipUdint originator_serial, const Options_t * options)
+{
+    static const CipUsint connection_manager_path[] = { 0x20, 0x06, 0x24, 0x01 };
+    CipUsint request[32];
+    CipUsint *message = request;
+
+    *message++ = 0x0A;
+    *message++ = 0x0E;
+    put_uint(message, serial);
+    put_uint(message, ORIGINATOR_VENDOR_ID);
+    put_udint(message, originator_serial);
+    *message++ = 3;                            // path size in words
+    *message++ = 0;
+    *message++ = 0x20;
+    *message++ = 0x04;
+    *message++ = 0x24;
+    *message++ = (CipUsint) options->config_assembly;
+    *message++ = 0x2C;
+    *message++ = (CipUsint) options->input_assembly;
+
+    return build_rr_data_frame(frame, session_handle, SERVICE_FORWARD_CLOSE, connection_manager_path, 2,
+                               request, (CipUint) (message - request));
+}
+
+static bool receive_frame(int socket, CipUsint * frame, CipUint * frame_length)
+{
+    if (ENCAPSULATION_HEADER_LENGTH != recv(socket, (char *) frame, ENCAPSULATION_HEADER_LENGTH, MSG_WAITALL))
+        return false;
+    CipUint data_length = get_uint(frame + 2);
+    if (data_length > FRAME_BUFFER_SIZE - ENCAPSULATION_HEADER_LENGTH)
+        return false;
+    if ((0 != data_length) && (data_length != recv(socket, (char *) frame + ENCAPSULATION_HEADER_LENGTH, data_length, MSG_WAITALL)))
+        return false;
+    *frame_length = (CipUint) (ENCAPSULATION_HEADER_LENGTH + data_length);
+    return true;
+}
+
+// Sends a request and waits for its reply, the round trip time is returned in latency
+static bool exchange(int socket, const CipUsint * frame, CipUint frame_length, CipUsint * reply,
+                     CipUint * reply_length, MicroSeconds * latency)
+{
+    MicroSeconds start = NET_NetworkHandler::GetMicroSeconds();
+    if ((frame_length != send(socket, (const char *) frame, frame_length, 0))
+        || !receive_frame(socket, reply, reply_length))
+        return false;
+    *latency = NET_NetworkHandler::GetMicroSeconds() - start;
+    return true;
+}
+
+static bool reply_succeeded(const CipUsint * reply, CipUint reply_length)
+{
+    return (REPLY_GENERAL_STATUS_OFFSET < reply_length)
+           && (0 == get_udint(reply + 8))      // encapsulation status
+           && (kCipGeneralStatusCodeSuccess == reply[REPLY_GENERAL_STATUS_OFFSET]);
+}
+
+// The T->O multicast group of a Forward_Open reply, if the sockaddr info item is there
+static bool find_multicast_group(const CipUsint * reply, CipUint reply_length, in_addr_t * group)
+{
+    CipUint item_count = get_uint(reply + REPLY_ITEM_COUNT_OFFSET);
+    const CipUsint *item = reply + REPLY_ITEM_COUNT_OFFSET + 2;
+    const CipUsint *end = reply + reply_length;
+
+    for (CipUint i = 0; (i < item_count) && (item + 4 <= end); i++)
+    {
+        CipUint type = get_uint(item);
+        CipUint length = get_uint(item + 2);
+        if ((ITEM_SOCKADDR_INFO_T_TO_O == type) && (16 <= length) && (item + 4 + length <= end))
+        {
+            //the sockaddr is in network byte order: family, port, address
+            memcpy(group, item + 8, sizeof(in_addr_t));
+            return true;
+        }
+        item += 4 + length;
+    }
+    return false;
+}
+
+// Sends the O->T frames of an exclusive owner connection at the RPI until the run ends
+static void run_producer(CipUdint connection_id, const Options_t * options, CipUdint * sent_frames)
+{
+    CipUsint frame[FRAME_BUFFER_SIZE];
+    *sent_frames = 0;
+
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (0 > handle)
+        return;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(IO_PORT);
+    address.sin_addr.s_addr = inet_addr(options->host);
+
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    for (CipUdint sequence = 1; kPhaseRun == phase; sequence++)
+    {
+        CipUsint *message = frame;
+        put_uint(message, 2);
+        put_uint(message, ITEM_SEQUENCED_ADDRESS);
+        put_uint(message, 8);
+        put_udint(message, connection_id);
+        put_udint(message, sequence);
+        put_uint(message, CIP_CommonPacket::kCipItemIdConnectedDataItem);
+        put_uint(message, (CipUint) (options->input_size + 6));
+        put_uint(message, (CipUint) sequence);  // sequence count, new data in every frame
+        put_udint(message, 1);                 // run
+        memset(message, (int) (sequence & 0xFF), (size_t) options->input_size);
+        message += options->input_size;
+
+        if (0 < sendto(handle, (const char *) frame, (size_t) (message - frame), 0, (struct sockaddr *) &address, sizeof(address)))
+            (*sent_frames)++;
+
+        next += std::chrono::milliseconds(options->rpi_ms);
+        std::this_thread::sleep_until(next);
+    }
+    close(handle);
+}
+
+// The virtual adapters of a hosted stack follow the address of the first one
+static int connect_to_adapter(const Options_t * options, int index)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(ENCAPSULATION_PORT);
+    address.sin_addr.s_addr = htonl(ntohl(inet_addr(options->host)) + (CipUdint) (index % options->adapters));
+
+    int handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (0 > handle)
+        return -1;
+    int option_value = 1;
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (char *) &option_value, sizeof(option_value));
+    if (0 != connect(handle, (struct sockaddr *) &address, sizeof(address)))
+    {
+        close(handle);
+        return -1;
+    }
+    return handle;
+}
+
+static void run_scanner(int index, const Options_t * options, ScannerResult_t * result)
+{
+    static const CipUsint no_data[1] = { 0 };
+    CipUsint frame[FRAME_BUFFER_SIZE], reply[FRAME_BUFFER_SIZE];
+    CipUint reply_length;
+    MicroSeconds latency;
+    CipUdint originator_serial = ORIGINATOR_SERIAL_NUMBER + (CipUdint) index;
+    CipUdint session_handle = 0;
+
+    result->failed_requests = 0;
+    result->opened_connections = 0;
+    result->failed_connections = 0;
+    result->sent_frames = 0;
+    result->multicast_group = 0;
+    result->connected = false;
+
+    int handle = connect_to_adapter(options, index);
+    if (0 <= handle)
+    {
+        CipUsint *message = put_encapsulation_header(frame, COMMAND_REGISTER_SESSION, 0, 4);
+        put_uint(message, 1);                  // protocol version
+        put_uint(message, 0);                  // options
+        if (exchange(handle, frame, ENCAPSULATION_HEADER_LENGTH + 4, reply, &reply_length, &latency)
+            && (0 == get_udint(reply + 8)))
+        {
+            session_handle = get_udint(reply + 4);
+            result->setup_latencies.push_back(latency);
+            result->connected = true;
+        }
+    }
+
+    //Serial numbers are unique per scanner, the originator serial number tells the scanners apart
+    CipUdint owned_connection_id = 0;
+    for (int i = 0; result->connected && (i < options->io_connections); i++)
+    {
+        bool exclusive_owner = options->exclusive_owner && (0 == index) && (0 == i);
+        CipUint frame_length = build_forward_open_frame(frame, session_handle, (CipUint) (i + 1), originator_serial,
+                                                        exclusive_owner, options);
+        if (exchange(handle, frame, frame_length, reply, &reply_length, &latency) && reply_succeeded(reply, reply_length))
+        {
+            result->setup_latencies.push_back(latency);
+            result->opened_connections++;
+            find_multicast_group(reply, reply_length, &result->multicast_group);
+            if (exclusive_owner)               // the O->T id leads the reply data
+                owned_connection_id = get_udint(reply + REPLY_DATA_OFFSET + 2 * reply[REPLY_GENERAL_STATUS_OFFSET + 1]);
+        }
+        else
+        {
+            result->failed_connections++;
+        }
+    }
+
+    scanners_ready++;
+    while (kPhaseSetup == phase)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::thread producer;
+    if (0 != owned_connection_id)
+        producer = std::thread(run_producer, owned_connection_id, options, &result->sent_frames);
+
+    //One request outstanding at a time, the next one goes out as soon as the reply is in
+    CipUsint path[6] = { 0x20, (CipUsint) options->class_id, 0x24, (CipUsint) options->instance_id,
+                         0x30, (CipUsint) options->attribute_id };
+    CipUint get_length = build_rr_data_frame(frame, session_handle, SERVICE_GET_ATTRIBUTE_SINGLE, path, 3, no_data, 0);
+    while (result->connected && (kPhaseRun == phase))
+    {
+        if (!exchange(handle, frame, get_length, reply, &reply_length, &latency))
+        {
+            result->connected = false;
+            break;
+        }
+        if (reply_succeeded(reply, reply_length))
+            result->request_latencies.push_back(latency);
+        else
+            result->failed_requests++;
+    }
+    if (producer.joinable())
+        producer.join();
+
+    for (int i = 0; result->connected && (i < options->io_connections); i++)
+    {
+        CipUint frame_length = build_forward_close_frame(frame, session_handle, (CipUint) (i + 1), originator_serial, options);
+        exchange(handle, frame, frame_length, reply, &reply_length, &latency);
+    }
+
+    if (0 <= handle)
+    {
+        if (result->connected)
+        {
+            put_encapsulation_header(frame, COMMAND_UNREGISTER_SESSION, session_handle, 0);
+            send(handle, (const char *) frame, ENCAPSULATION_HEADER_LENGTH, 0);
+        }
+        close(handle);
+    }
+}
+
+// Counts the frames of every T->O stream received on the group until the run ends
+static void run_listener(in_addr_t group, const Options_t * options, ListenerResult_t * result)
+{
+    CipUsint frame[FRAME_BUFFER_SIZE];
+    result->joined = false;
+
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (0 > handle)
+        return;
+
+    int option_value = 1;
+    struct timeval timeout = { 0, 100000 };
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(IO_PORT);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    struct ip_mreq membership;
+    membership.imr_multiaddr.s_addr = group;
+    membership.imr_interface.s_addr = inet_addr(options->host);
+
+    if ((0 != setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (char *) &option_value, sizeof(option_value)))
+        || (0 != setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, (char *) &timeout, sizeof(timeout)))
+        || (0 != bind(handle, (struct sockaddr *) &address, sizeof(address)))
+        || (0 != setsockopt(handle, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char *) &membership, sizeof(membership))))
+    {
+        std::cerr << "listener: cannot join " << inet_ntoa(membership.imr_multiaddr) << ": " << strerror(errno) << std::endl;
+        close(handle);
+        return;
+    }
+    result->joined = true;
+
+    while (kPhaseRun == phase)
+    {
+        long received = recv(handle, (char *) frame, sizeof(frame), 0);
+        //item count, then the sequenced address item with the connection id and sequence number
+        if ((14 > received) || (ITEM_SEQUENCED_ADDRESS != get_uint(frame + 2)))
+            continue;
+
+        CipUdint connection_id = get_udint(frame + 6);
+        CipUdint sequence = get_udint(frame + 10);
+        MicroSeconds now = NET_NetworkHandler::GetMicroSeconds();
+
+        std::map<CipUdint, Stream_t>::iterator it = result->streams.find(connection_id);
+        if (result->streams.end() == it)
+        {
+            Stream_t stream = { sequence, sequence, 1, now, now };
+            result->streams[connection_id] = stream;
+            continue;
+        }
+        Stream_t *stream = &it->second;
+        //sequence numbers are compared modulo 2^32, older frames only count as received
+        if (0 < (CipDint) (sequence - stream->last_sequence))
+        {
+            stream->last_sequence = sequence;
+            stream->last_time = now;
+        }
+        stream->received++;
+    }
+    close(handle);
+}
+
+static void request_dump(int)
+{
+    dump_requested = true;
+}
+
+// The adapter hosted in process: an input only connection point on a fresh
+// input assembly, with -o also an exclusive owner point on a fresh output
+// assembly, served by the network handler on its own thread
+static bool start_adapter(Options_t * options, std::thread * adapter_thread)
+{
+    static std::vector<CipByte> input_data, output_data;
+
+    CIP_TCPIP_Interface::interface_configuration_.ip_address = inet_addr(options->host);
+    CIP_TCPIP_Interface::g_multicast_configuration.starting_multicast_address = inet_addr(DEFAULT_MULTICAST_GROUP);
+    CIP_TCPIP_Interface::g_time_to_live_value = 1;
+
+    if (nullptr != options->trace_file)
+        TraceBuffer::SetLevelMask(OPENER_TRACE_LEVEL_ERROR | OPENER_TRACE_LEVEL_WARNING
+                                  | OPENER_TRACE_LEVEL_STATE | OPENER_TRACE_LEVEL_INFO);
+    CIP_Common::CipStackInit((CipUint) getpid());
+    IoLatency::Enable(options->measure_latency);
+
+    input_data.assign((size_t) options->input_size, 0);
+    output_data.assign((size_t) options->input_size, 0);
+    options->config_assembly = (int) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(nullptr, 0);
+    options->input_assembly = (int) CIP_Assembly::GetNumberOfInstances();
+    CIP_Assembly::Create(input_data.data(), (CipUint) input_data.size());
+    CIP_AppConnType::ConfigureInputOnlyConnectionPoint(0, 0, (unsigned int) options->input_assembly,
+                                                      (unsigned int) options->config_assembly);
+    if (options->exclusive_owner)
+    {
+        options->output_assembly = (int) CIP_Assembly::GetNumberOfInstances();
+        CIP_Assembly::Create(output_data.data(), (CipUint) output_data.size());
+        CIP_AppConnType::ConfigureExclusiveOwnerConnectionPoint(0, (unsigned int) options->output_assembly,
+                                                               (unsigned int) options->input_assembly,
+                                                               (unsigned int) options->config_assembly);
+    }
+
+    bool backend_set = (nullptr == options->backend);
+    for (int i = 0; !backend_set && (i < NET_IoBackend::kNumberOfBackends); i++)
+    {
+        NET_IoBackend::Backend_e backend = (NET_IoBackend::Backend_e) i;
+        backend_set = (0 == strcmp(options->backend, NET_IoBackend::GetName(backend))) && NET_IoBackend::SetBackend(backend);
+    }
+    if (!backend_set || (kCipGeneralStatusCodeSuccess != NET_NetworkHandler::NetworkHandlerInitialize().status))
+        return false;
+    //the one in use, it falls back to a simpler one if the kernel lacks it
+    options->backend = NET_IoBackend::GetName(NET_IoBackend::GetBackend());
+    if ((1 < options->adapters) && (kCipStatusOk != NET_VirtualAdapters::Start(options->adapters).status))
+        return false;
+    if ((0 < options->shards) && (kCipStatusOk != NET_IoShards::Start(options->shards).status))
+        return false;
+    if ((0 < options->workers) && (kCipStatusOk != NET_ExplicitWorkers::Start(options->workers).status))
+        return false;
+    if ((nullptr != options->statistics_snapshot) && !NetStatistics::OpenSnapshot(options->statistics_snapshot))
+        return false;
+
+    if (options->measure_latency)
+        signal(SIGUSR1, request_dump);
+
+    adapter_running = true;
+    *adapter_thread = std::thread([options]()
+    {
+        MicroSeconds rpi = (MicroSeconds) options->rpi_ms * 1000;
+        MicroSeconds next_publish = NET_NetworkHandler::GetMicroSeconds();
+        while (adapter_running)
+        {
+            //the application side: new input data every RPI
+            if (options->measure_latency && (NET_NetworkHandler::GetMicroSeconds() >= next_publish))
+            {
+                input_data[0]++;
+                IoLatency::MarkPublished((CipUdint) options->input_assembly);
+                next_publish += rpi;
+            }
+            if (dump_requested.exchange(false))
+                IoLatency::Dump(std::cout);
+            NET_NetworkHandler::NetworkHandlerProcessOnce();
+        }
+    });
+    return true;
+}
+
+static MicroSeconds percentile(const std::vector<MicroSeconds> & sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = (size_t) (fraction * (double) (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static void print_latencies(const char * name, std::vector<MicroSeconds> * latencies)
+{
+    std::sort(latencies->begin(), latencies->end());
+    std::cout << std::setw(18) << std::left << name << std::right
+              << " p50 " << std::setw(7) << percentile(*latencies, 0.50)
+              << " p90 " << std::setw(7) << percentile(*latencies, 0.90)
+              << " p99 " << std::setw(7) << percentile(*latencies, 0.99)
+              << " p99.9 " << std::setw(7) << percentile(*latencies, 0.999)
+              << " max " << std::setw(7) << (latencies->empty() ? 0 : latencies->back()) << " us" << std::endl;
+}
+
+static void usage(const char * name)
+{
+    std::cout << "usage: " << name << " [options]\n"
+              << "  -a             host the adapter in this process\n"
+              << "  -L             with -a, measure the I/O latency of the adapter\n"
+              << "  -T file        with -a, trace all levels and dump the traces into file\n"
+              << "  -S name        with -a, publish the network statistics in shared memory name\n"
+              << "  -b backend     with -a, network backend of the adapter: select, epoll or io_uring\n"
+              << "  -w shards      with -a, I/O shards receiving the O->T frames of the adapter (0)\n"
+              << "  -x workers     with -a, explicit message workers executing the SendRRData requests (0)\n"
+              << "  -v adapters    with -a, adapters hosted on the addresses from -h on, not with -w or -x (1)\n"
+              << "  -o             open the first connection of scanner 0 as exclusive owner\n"
+              << "  -h address     adapter address (127.0.0.1)\n"
+              << "  -n scanners    concurrent scanners, one TCP connection each (4)\n"
+              << "  -t seconds     duration of the request flood (5)\n"
+              << "  -c count       class 1 connections per scanner (1)\n"
+              << "  -r ms          RPI of the class 1 connections (10)\n"
+              << "  -l count       multicast listeners (1)\n"
+              << "  -g c.i.a       class, instance and attribute to get (6.1.1)\n"
+              << "  -i instance    input assembly of the class 1 connections (101)\n"
+              << "  -k instance    configuration assembly of the class 1 connections (102)\n"
+              << "  -O instance    output assembly of the exclusive owner connection (150)\n"
+              << "  -s bytes       size of the input assembly (32)" << std::endl;
+}
+
+int main(int argc, char * argv[])
+{
+    //the flood reads the open requests counter of the connection manager
+    Options_t options = { "127.0.0.1", nullptr, nullptr, nullptr, 0, 0, 1, 4, 5, 1, 10, 1, 6, 1, 1, 101, 102, 150, 32, false, false, false };
+    int option;
+
+    while (-1 != (option = getopt(argc, argv, "aLT:S:b:w:x:v:oh:n:t:c:r:l:g:i:k:O:s:")))
+    {
+        switch (option)
+        {
+            case 'a': options.host_adapter = true; break;
+            case 'L': options.measure_latency = true; break;
+            case 'T': options.trace_file = optarg; break;
+            case 'S': options.statistics_snapshot = optarg; break;
+            case 'b': options.backend = optarg; break;
+            case 'w': options.shards = atoi(optarg); break;
+            case 'x': options.workers = atoi(optarg); break;
+            case 'v': options.adapters = atoi(optarg); break;
+            case 'o': options.exclusive_owner = true; break;
+            case 'h': options.host = optarg; break;
+            case 'n': options.scanners = atoi(optarg); break;
+            case 't': options.seconds = atoi(optarg); break;
+            case 'c': options.io_connections = atoi(optarg); break;
+            case 'r': options.rpi_ms = atoi(optarg); break;
+            case 'l': options.listeners = atoi(optarg); break;
+            case 'g':
+                if (3 != sscanf(optarg, "%d.%d.%d", &options.class_id, &options.instance_id, &options.attribute_id))
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'i': options.input_assembly = atoi(optarg); break;
+            case 'k': options.config_assembly = atoi(optarg); break;
+            case 'O': options.output_assembly = atoi(optarg); break;
+            case 's': options.input_size = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((0 >= options.scanners) || (0 >= options.seconds) || (0 > options.io_connections)
+        || (0 >= options.rpi_ms) || (0 > options.listeners) || (0 >= options.input_size)
+        || ((options.measure_latency || (nullptr != options.trace_file) || (nullptr != options.statistics_snapshot)
+             || (nullptr != options.backend) || (0 != options.shards) || (0 != options.workers)
+             || (1 != options.adapters)) && !options.host_adapter)
+        || (0 > options.shards) || (0 > options.workers) || (0 >= options.adapters)
+        || ((1 < options.adapters) && ((0 != options.shards) || (0 != options.workers))))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::thread adapter_thread;
+    if (options.host_adapter && !start_adapter(&options, &adapter_thread))
+    {
+        std::cerr << "cannot start the adapter on " << options.host << std::endl;
+        return 1;
+    }
+
+    std::vector<ScannerResult_t> scanner_results((size_t) options.scanners);
+    std::vector<std::thread> scanners;
+    for (int i = 0; i < options.scanners; i++)
+    {
+        scanners.push_back(std::thread(run_scanner, i, &options, &scanner_results[(size_t) i]));
+    }
+    while (scanners_ready < options.scanners)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    in_addr_t group = inet_addr(DEFAULT_MULTICAST_GROUP);
+    CipUdint opened_connections = 0;
+    for (size_t i = 0; i < scanner_results.size(); i++)
+    {
+        opened_connections += scanner_results[i].opened_connections;
+        if (0 != scanner_results[i].multicast_group)
+            group = scanner_results[i].multicast_group;
+    }
+
+    std::vector<ListenerResult_t> listener_results((size_t) ((0 < opened_connections) ? options.listeners : 0));
+    std::vector<std::thread> listeners;
+
+    phase = kPhaseRun;
+    for (size_t i = 0; i < listener_results.size(); i++)
+    {
+        listeners.push_back(std::thread(run_listener, group, &options, &listener_results[i]));
+    }
+    MicroSeconds start = NET_NetworkHandler::GetMicroSeconds();
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    phase = kPhaseClose;
+    MicroSeconds elapsed = NET_NetworkHandler::GetMicroSeconds() - start;
+
+    for (size_t i = 0; i < listeners.size(); i++)
+    {
+        listeners[i].join();
+    }
+    for (size_t i = 0; i < scanners.size(); i++)
+    {
+        scanners[i].join();
+    }
+    if (options.host_adapter)
+    {
+        adapter_running = false;
+        adapter_thread.join();
+        NET_NetworkHandler::NetworkHandlerFinish();
+    }
+
+    //Report
+    std::vector<MicroSeconds> request_latencies, setup_latencies;
+    CipUdint failed_requests = 0, failed_connections = 0, sent_frames = 0;
+    int connected_scanners = 0;
+    for (size_t i = 0; i < scanner_results.size(); i++)
+    {
+        ScannerResult_t *result = &scanner_results[i];
+        request_latencies.insert(request_latencies.end(), result->request_latencies.begin(), result->request_latencies.end());
+        setup_latencies.insert(setup_latencies.end(), result->setup_latencies.begin(), result->setup_latencies.end());
+        failed_requests += result->failed_requests;
+        failed_connections += result->failed_connections;
+        sent_frames += result->sent_frames;
+        if (!result->setup_latencies.empty())
+            connected_scanners++;
+    }
+
+    double seconds = (double) elapsed / 1000000.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "adapter " << options.host;
+    if (options.host_adapter)
+    {
+        std::cout << " (in process, " << options.backend;
+        if (0 < options.shards)
+            std::cout << ", " << options.shards << " I/O shards";
+        if (0 < options.workers)
+            std::cout << ", " << options.workers << " explicit workers, "
+                      << NET_ExplicitWorkers::GetNumberOfRejectedRequests() << " requests rejected";
+        if (1 < options.adapters)
+            std::cout << ", " << options.adapters << " virtual adapters";
+        std::cout << ")";
+    }
+    std::cout
+              << ", input assembly " << options.input_assembly << ", configuration assembly " << options.config_assembly << ", "
+              << connected_scanners << "/" << options.scanners << " scanners registered, "
+              << opened_connections << " class 1 connections opened, " << failed_connections << " refused" << std::endl;
+    std::cout << request_latencies.size() << " requests in " << seconds << " s: "
+              << (double) request_latencies.size() / seconds << " requests/s, "
+              << failed_requests << " failed" << std::endl;
+    print_latencies("request latency", &request_latencies);
+    print_latencies("setup latency", &setup_latencies);
+    if (options.exclusive_owner)
+        std::cout << sent_frames << " O->T frames sent to output assembly " << options.output_assembly << std::endl;
+
+    in_addr group_address;
+    group_address.s_addr = group;
+    for (size_t i = 0; i < listener_results.size(); i++)
+    {
+        ListenerResult_t *result = &listener_results[i];
+        std::cout << "listener " << i << " on " << inet_ntoa(group_address) << ":";
+        if (!result->joined)
+        {
+            std::cout << " not joined" << std::endl;
+            continue;
+        }
+        if (result->streams.empty())
+            std::cout << " no frames received";
+        for (std::map<CipUdint, Stream_t>::iterator it = result->streams.begin(); it != result->streams.end(); ++it)
+        {
+            Stream_t *stream = &it->second;
+            CipUdint expected = stream->last_sequence - stream->first_sequence + 1;
+            CipUdint lost = (expected > stream->received) ? expected - stream->received : 0;
+            double interval = (1 < expected) ? (double) (stream->last_time - stream->first_time) / 1000.0 / (expected - 1) : 0.0;
+            std::cout << " connection 0x" << std::hex << it->first << std::dec << " "
+                      << stream->received << " frames, " << lost << " lost ("
+                      << std::setprecision(3) << (100.0 * lost / expected) << " %), "
+                      << std::setprecision(2) << interval << " ms interval" << std::setprecision(1);
+        }
+        std::cout << std::endl;
+    }
+
+    if (nullptr != options.trace_file)
+    {
+        std::ofstream dump(options.trace_file, std::ios::binary);
+        TraceBuffer::Dump(dump);
+        std::cout << "traces dumped into " << options.trace_file << std::endl;
+    }
+    if (options.measure_latency)
+    {
+        std::cout << "adapter I/O latency" << std::endl;
+        IoLatency::Dump(std::cout);
+    }
+    if (nullptr != options.statistics_snapshot)
+    {
+        CipUdint counters[NetStatistics::kNumberOfInterfaceCounters];
+        NetStatistics::GetInterfaceCounters(counters);
+        std::cout << "adapter interface: in " << counters[NetStatistics::kInUcastPackets] << " + "
+                  << counters[NetStatistics::kInNucastPackets] << " packets, " << counters[NetStatistics::kInOctets]
+                  << " octets, " << counters[NetStatistics::kInDiscards] << " discarded, out "
+                  << counters[NetStatistics::kOutUcastPackets] << " + " << counters[NetStatistics::kOutNucastPackets]
+                  << " packets, " << counters[NetStatistics::kOutOctets] << " octets, "
+                  << counters[NetStatistics::kOutErrors] << " errors" << std::endl;
+        NetStatistics::CloseSnapshot();
+    }
+
+    return ((0 < connected_scanners) && !request_latencies.empty()) ? 0 : 1;
+}
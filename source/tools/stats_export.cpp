@@ -0,0 +1,99 @@
+//
+// Exporter of the OpENer network statistics
+//
+// The stack publishes its interface, media, connection and session counters
+// in shared memory (see NetStatistics::OpenSnapshot), they are read from there
+// without involving the stack and written in the Prometheus text format. With
+// -i the snapshot is exported again every interval until interrupted.
+//
+
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "utils/netstatistics.hpp"
+
+static const char * const kInterfaceCounterNames[NetStatistics::kNumberOfInterfaceCounters] = {
+    "in_octets", "in_ucast_packets", "in_nucast_packets", "in_discards", "in_errors", "in_unknown_protos",
+    "out_octets", "out_ucast_packets", "out_nucast_packets", "out_discards", "out_errors"
+};
+
+static const char * const kMediaCounterNames[NetStatistics::kNumberOfMediaCounters] = {
+    "alignment_errors", "fcs_errors", "single_collisions", "multiple_collisions", "sqe_test_errors",
+    "deferred_transmissions", "late_collisions", "excessive_collisions", "mac_transmit_errors",
+    "carrier_sense_errors", "frame_too_long", "mac_receive_errors"
+};
+
+static const char * const kEndpointCounterNames[NetStatistics::kNumberOfEndpointCounters] = {
+    "packets_in", "octets_in", "packets_out", "octets_out", "errors",
+    "latency_samples", "latency_ns_sum", "latency_ns_max"
+};
+
+// Endpoints that never counted anything are left out
+static void export_endpoints(const char * endpoint, const CipUlint (*counters)[NetStatistics::kNumberOfEndpointCounters],
+                             int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        bool used = false;
+        for (int counter = 0; counter < NetStatistics::kNumberOfEndpointCounters; counter++)
+        {
+            used = used || (0 != counters[i][counter]);
+        }
+        for (int counter = 0; used && (counter < NetStatistics::kNumberOfEndpointCounters); counter++)
+        {
+            std::cout << "opener_" << endpoint << "_" << kEndpointCounterNames[counter] << "{" << endpoint << "=\""
+                      << i + 1 << "\"} " << counters[i][counter] << "\n";
+        }
+    }
+}
+
+static void export_snapshot(const NetStatistics::Snapshot_t & snapshot)
+{
+    for (int i = 0; i < NetStatistics::kNumberOfInterfaceCounters; i++)
+    {
+        std::cout << "opener_interface_" << kInterfaceCounterNames[i] << " " << snapshot.interface_counters[i] << "\n";
+    }
+    for (int i = 0; i < NetStatistics::kNumberOfMediaCounters; i++)
+    {
+        std::cout << "opener_media_" << kMediaCounterNames[i] << " " << snapshot.media_counters[i] << "\n";
+    }
+    export_endpoints("connection", snapshot.connections, OPENER_CIP_NUM_CONNECTIONS);
+    export_endpoints("session", snapshot.sessions, OPENER_NUMBER_OF_SUPPORTED_SESSIONS);
+    std::cout << "opener_snapshot_timestamp_ns " << snapshot.timestamp << std::endl;
+}
+
+int main(int argc, char * argv[])
+{
+    int interval = 0;
+    int option;
+    while (-1 != (option = getopt(argc, argv, "i:")))
+    {
+        if ('i' != option)
+        {
+            interval = -1;
+            break;
+        }
+        interval = atoi(optarg);
+    }
+    if ((0 > interval) || (optind + 1 != argc))
+    {
+        std::cout << "usage: " << argv[0] << " [-i seconds] name" << std::endl;
+        return 1;
+    }
+
+    do
+    {
+        NetStatistics::Snapshot_t snapshot;
+        if (!NetStatistics::ReadSnapshot(argv[optind], &snapshot))
+        {
+            std::cerr << "no statistics snapshot " << argv[optind] << " of this configuration" << std::endl;
+            return 1;
+        }
+        export_snapshot(snapshot);
+        if (0 < interval)
+            sleep((unsigned int) interval);
+    } while (0 < interval);
+
+    return 0;
+}
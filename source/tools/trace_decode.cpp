@@ -0,0 +1,35 @@
+//
+// Offline decoder of OpENer trace dumps
+//
+// The stack records its trace points in binary form (see TraceBuffer), a dump
+// written by TraceBuffer::Dump() is turned into text here, one line per
+// record in timestamp order: seconds since the first record, trace ring of
+// the thread, level, source location and the formatted message.
+//
+
+#include <iostream>
+#include <fstream>
+
+#include "utils/tracebuffer.hpp"
+
+int main(int argc, char * argv[])
+{
+    if (2 != argc)
+    {
+        std::cout << "usage: " << argv[0] << " dump" << std::endl;
+        return 1;
+    }
+
+    std::ifstream dump(argv[1], std::ios::binary);
+    if (!dump)
+    {
+        std::cerr << "cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    if (!TraceBuffer::Decode(dump, std::cout))
+    {
+        std::cerr << argv[1] << " is not a complete trace dump" << std::endl;
+        return 1;
+    }
+    return 0;
+}